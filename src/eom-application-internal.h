@@ -46,10 +46,16 @@ struct _EomApplicationPrivate {
 	EomStartupFlags   flags;
 
 	PeasExtensionSet *extensions;
+
+	guint             stats_registration_id;
+
+	gboolean          accelerators_loaded;
 };
 
 EggToolbarsModel *eom_application_get_toolbars_model  (EomApplication *application);
 
+EomPluginEngine  *eom_application_get_plugin_engine   (EomApplication *application);
+
 void              eom_application_save_toolbars_model (EomApplication *application);
 
 void              eom_application_reset_toolbars_model (EomApplication *app);
@@ -32,6 +32,8 @@
 #include "eom-application.h"
 #include "eom-application-activatable.h"
 #include "eom-application-internal.h"
+#include "eom-stats.h"
+#include "eom-debug.h"
 #include "eom-util.h"
 
 #include <string.h>
@@ -45,6 +47,7 @@
 
 static void eom_application_load_accelerators (void);
 static void eom_application_save_accelerators (void);
+static void eom_application_startup (GApplication *application);
 
 G_DEFINE_TYPE_WITH_PRIVATE (EomApplication, eom_application, GTK_TYPE_APPLICATION);
 
@@ -93,7 +96,10 @@ eom_application_finalize (GObject *object)
 		g_object_unref (priv->plugin_engine);
 		priv->plugin_engine = NULL;
 	}
-	eom_application_save_accelerators ();
+
+	/* Don't overwrite the user's accelerators if they were never read */
+	if (priv->accelerators_loaded)
+		eom_application_save_accelerators ();
 }
 
 static void
@@ -132,6 +138,45 @@ eom_application_before_emit (GApplication *application,
 									 platform_data);
 }
 
+static gboolean
+eom_application_dbus_register (GApplication    *application,
+			       GDBusConnection *connection,
+			       const gchar     *object_path,
+			       GError         **error)
+{
+	EomApplicationPrivate *priv = EOM_APPLICATION (application)->priv;
+
+	if (!G_APPLICATION_CLASS (eom_application_parent_class)->dbus_register (application,
+										connection,
+										object_path,
+										error))
+		return FALSE;
+
+	priv->stats_registration_id = eom_stats_dbus_register (connection,
+							       object_path,
+							       error);
+
+	return priv->stats_registration_id != 0;
+}
+
+static void
+eom_application_dbus_unregister (GApplication    *application,
+				 GDBusConnection *connection,
+				 const gchar     *object_path)
+{
+	EomApplicationPrivate *priv = EOM_APPLICATION (application)->priv;
+
+	if (priv->stats_registration_id != 0) {
+		g_dbus_connection_unregister_object (connection,
+						     priv->stats_registration_id);
+		priv->stats_registration_id = 0;
+	}
+
+	G_APPLICATION_CLASS (eom_application_parent_class)->dbus_unregister (application,
+									     connection,
+									     object_path);
+}
+
 static void
 eom_application_class_init (EomApplicationClass *eom_application_class)
 {
@@ -143,10 +188,13 @@ eom_application_class_init (EomApplicationClass *eom_application_class)
 
 	object_class->finalize = eom_application_finalize;
 
+	application_class->startup = eom_application_startup;
 	application_class->activate = eom_application_activate;
 	application_class->open = eom_application_open;
 	application_class->add_platform_data = eom_application_add_platform_data;
 	application_class->before_emit = eom_application_before_emit;
+	application_class->dbus_register = eom_application_dbus_register;
+	application_class->dbus_unregister = eom_application_dbus_unregister;
 }
 
 static void
@@ -171,46 +219,112 @@ static void
 eom_application_init (EomApplication *eom_application)
 {
 	EomApplicationPrivate *priv;
-	const gchar *dot_dir = eom_util_dot_dir ();
 
 	eom_session_init (eom_application);
 
 	eom_application->priv = eom_application_get_instance_private (eom_application);
 	priv = eom_application->priv;
 
-	priv->toolbars_model = egg_toolbars_model_new ();
-	priv->plugin_engine = eom_plugin_engine_new ();
 	priv->flags = 0;
+}
 
-	egg_toolbars_model_load_names (priv->toolbars_model,
-				       EOM_DATA_DIR "/eom-toolbar.xml");
-
-	if (G_LIKELY (dot_dir != NULL))
-		priv->toolbars_file = g_build_filename
-			(dot_dir, "eom_toolbar.xml", NULL);
+static void
+eom_application_load_style (void)
+{
+	GFile *css_file;
+	GtkCssProvider *provider;
+	GError *error = NULL;
+
+	/* Load special style properties for EomThumbView's scrollbar */
+	css_file = g_file_new_for_uri ("resource:///org/mate/eom/ui/eom.css");
+	provider = gtk_css_provider_new ();
+	if (G_UNLIKELY (!gtk_css_provider_load_from_file(provider,
+	                                                 css_file,
+	                                                 &error)))
+	{
+		g_critical ("Could not load CSS data: %s", error->message);
+		g_clear_error (&error);
+	} else {
+		gtk_style_context_add_provider_for_screen (
+				gdk_screen_get_default(),
+				GTK_STYLE_PROVIDER (provider),
+				GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+	}
+	g_object_unref (provider);
+	g_object_unref (css_file);
 
-	if (!dot_dir || !egg_toolbars_model_load_toolbars (priv->toolbars_model,
-					       priv->toolbars_file)) {
+	/* Add application specific icons to search path */
+	gtk_icon_theme_append_search_path (gtk_icon_theme_get_default (),
+                                           EOM_DATA_DIR G_DIR_SEPARATOR_S "icons");
+}
 
-		egg_toolbars_model_load_toolbars (priv->toolbars_model,
-						  EOM_DATA_DIR "/eom-toolbar.xml");
-	}
+/* Everything not needed to show the first image is done here, once the
+ * main loop is idle, so it does not delay the first window. */
+static gboolean
+eom_application_load_deferred (gpointer user_data)
+{
+	EomApplication *application = EOM_APPLICATION (user_data);
 
-	egg_toolbars_model_set_flags (priv->toolbars_model, 0,
-				      EGG_TB_MODEL_NOT_REMOVABLE);
+	eom_application_load_style ();
 
 	eom_application_load_accelerators ();
+	application->priv->accelerators_loaded = TRUE;
+
+	eom_application_get_plugin_engine (application);
+
+	eom_debug_startup_mark ("deferred startup done");
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+eom_application_startup (GApplication *application)
+{
+	G_APPLICATION_CLASS (eom_application_parent_class)->startup (application);
+
+	eom_debug_startup_mark ("application startup");
+
+	g_idle_add_full (G_PRIORITY_LOW,
+			 eom_application_load_deferred,
+			 g_object_ref (application),
+			 g_object_unref);
+}
+
+/**
+ * eom_application_get_plugin_engine:
+ * @application: an #EomApplication
+ *
+ * Gets the plugin engine, creating it and activating the application
+ * extensions on first use.
+ *
+ * Returns: (transfer none): the #EomPluginEngine
+ **/
+EomPluginEngine *
+eom_application_get_plugin_engine (EomApplication *application)
+{
+	EomApplicationPrivate *priv;
+
+	g_return_val_if_fail (EOM_IS_APPLICATION (application), NULL);
+
+	priv = application->priv;
+
+	if (priv->plugin_engine != NULL)
+		return priv->plugin_engine;
+
+	priv->plugin_engine = eom_plugin_engine_new ();
 
 	priv->extensions = peas_extension_set_new (
 	                           PEAS_ENGINE (priv->plugin_engine),
 	                           EOM_TYPE_APPLICATION_ACTIVATABLE,
-	                           "app",  EOM_APPLICATION (eom_application),
+	                           "app",  application,
 	                           NULL);
 	peas_extension_set_call (priv->extensions, "activate");
 	g_signal_connect (priv->extensions, "extension-added",
-	                  G_CALLBACK (on_extension_added), eom_application);
+	                  G_CALLBACK (on_extension_added), application);
 	g_signal_connect (priv->extensions, "extension-removed",
-	                  G_CALLBACK (on_extension_removed), eom_application);
+	                  G_CALLBACK (on_extension_removed), application);
+
+	return priv->plugin_engine;
 }
 
 /**
@@ -463,9 +577,40 @@ eom_application_open_uris (EomApplication  *application,
 EggToolbarsModel *
 eom_application_get_toolbars_model (EomApplication *application)
 {
+	EomApplicationPrivate *priv;
+	const gchar *dot_dir;
+
 	g_return_val_if_fail (EOM_IS_APPLICATION (application), NULL);
 
-	return application->priv->toolbars_model;
+	priv = application->priv;
+
+	/* Created on demand so that remote instances never parse
+	 * the toolbar files */
+	if (priv->toolbars_model != NULL)
+		return priv->toolbars_model;
+
+	dot_dir = eom_util_dot_dir ();
+
+	priv->toolbars_model = egg_toolbars_model_new ();
+
+	egg_toolbars_model_load_names (priv->toolbars_model,
+				       EOM_DATA_DIR "/eom-toolbar.xml");
+
+	if (G_LIKELY (dot_dir != NULL))
+		priv->toolbars_file = g_build_filename
+			(dot_dir, "eom_toolbar.xml", NULL);
+
+	if (!dot_dir || !egg_toolbars_model_load_toolbars (priv->toolbars_model,
+					       priv->toolbars_file)) {
+
+		egg_toolbars_model_load_toolbars (priv->toolbars_model,
+						  EOM_DATA_DIR "/eom-toolbar.xml");
+	}
+
+	egg_toolbars_model_set_flags (priv->toolbars_model, 0,
+				      EGG_TB_MODEL_NOT_REMOVABLE);
+
+	return priv->toolbars_model;
 }
 
 /**
@@ -477,7 +622,8 @@ eom_application_get_toolbars_model (EomApplication *application)
 void
 eom_application_save_toolbars_model (EomApplication *application)
 {
-	if (G_LIKELY(application->priv->toolbars_file != NULL))
+	if (G_LIKELY(application->priv->toolbars_model != NULL &&
+		     application->priv->toolbars_file != NULL))
         	egg_toolbars_model_save_toolbars (application->priv->toolbars_model,
 				 	          application->priv->toolbars_file,
 						  "1.0");
@@ -497,7 +643,8 @@ eom_application_reset_toolbars_model (EomApplication *app)
 
 	priv = app->priv;
 
-	g_object_unref (app->priv->toolbars_model);
+	if (priv->toolbars_model != NULL)
+		g_object_unref (priv->toolbars_model);
 
 	priv->toolbars_model = egg_toolbars_model_new ();
 
@@ -0,0 +1,1056 @@
+/* Eye Of Mate - Pipeline Benchmark
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Measures the image pipeline without a display. A synthetic corpus
+ * is written to a scratch directory, then driven through the same
+ * functions the viewer uses:
+ *
+ *  - images: every file is loaded, thumbnailed, rotated and saved
+ *  - folder: a directory of --files images is added to a list store
+ *
+ * The results are printed as JSON: per operation, the throughput,
+ * the latency percentiles in microseconds, and the peak RSS of the
+ * whole run. Setting EOM_TRACE also writes a trace of the run. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "eom-debug.h"
+#include "eom-image.h"
+#include "eom-image-save-info.h"
+#include "eom-list-store.h"
+#include "eom-thumbnail.h"
+#include "eom-transform.h"
+
+#if HAVE_EXEMPI
+#include <exempi/xmp.h>
+#endif
+
+typedef struct {
+	const gchar *name;
+	gint         width;
+	gint         height;
+} BenchSize;
+
+static const BenchSize sizes[] = {
+	{ "small",   640,  480 },
+	{ "medium", 1920, 1280 },
+	{ "large",  4000, 3000 },
+};
+
+/* EXIF orientations written to the landscape JPEGs */
+static const gint jpeg_orientations[] = { 1, 3, 6, 8 };
+
+typedef struct {
+	gchar       *path;
+	const gchar *format;    /* gdk-pixbuf format name */
+	const gchar *size;
+} CorpusFile;
+
+typedef struct {
+	gchar   *name;
+	GArray  *samples;       /* gint64, microseconds */
+	guint64  items;
+	guint64  bytes;
+	guint64  pixels;
+	guint    failures;
+} BenchMetric;
+
+static gchar   *scenario = NULL;
+static gint     n_files = 10000;
+static gint     iterations = 3;
+static gchar   *corpus_dir = NULL;
+static gchar   *output_path = NULL;
+
+static GOptionEntry entries[] = {
+	{ "scenario", 's', 0, G_OPTION_ARG_STRING, &scenario,
+	  "What to measure: images, folder or all", "NAME" },
+	{ "files", 'n', 0, G_OPTION_ARG_INT, &n_files,
+	  "Number of files in the folder scenario", "N" },
+	{ "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+	  "Times each operation is repeated", "N" },
+	{ "corpus", 'c', 0, G_OPTION_ARG_FILENAME, &corpus_dir,
+	  "Directory for the corpus, kept after the run", "DIR" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path,
+	  "Write the results to FILE instead of stdout", "FILE" },
+	{ NULL }
+};
+
+static GPtrArray *metrics = NULL;
+
+static BenchMetric *
+bench_metric_get (const gchar *operation,
+		  const gchar *format,
+		  const gchar *size)
+{
+	BenchMetric *metric;
+	gchar *name;
+	guint i;
+
+	if (format != NULL)
+		name = g_strjoin (".", operation, format, size, NULL);
+	else
+		name = g_strdup (operation);
+
+	for (i = 0; i < metrics->len; i++) {
+		metric = g_ptr_array_index (metrics, i);
+
+		if (strcmp (metric->name, name) == 0) {
+			g_free (name);
+			return metric;
+		}
+	}
+
+	metric = g_new0 (BenchMetric, 1);
+	metric->name = name;
+	metric->samples = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	g_ptr_array_add (metrics, metric);
+
+	return metric;
+}
+
+static void
+bench_metric_free (BenchMetric *metric)
+{
+	g_array_unref (metric->samples);
+	g_free (metric->name);
+	g_free (metric);
+}
+
+static void
+bench_metric_add (BenchMetric *metric,
+		  gint64       start,
+		  guint64      items,
+		  guint64      bytes,
+		  guint64      pixels)
+{
+	gint64 duration = g_get_monotonic_time () - start;
+
+	g_array_append_val (metric->samples, duration);
+	metric->items += items;
+	metric->bytes += bytes;
+	metric->pixels += pixels;
+}
+
+static gint
+compare_durations (gconstpointer a, gconstpointer b)
+{
+	gint64 da = *(const gint64 *) a;
+	gint64 db = *(const gint64 *) b;
+
+	return (da > db) - (da < db);
+}
+
+static gint64
+percentile (GArray *samples, guint percent)
+{
+	return g_array_index (samples, gint64, (samples->len - 1) * percent / 100);
+}
+
+static void
+format_rate (gchar *buffer, gdouble amount, gint64 total_us)
+{
+	/* Avoid locale dependent decimal separators */
+	g_ascii_formatd (buffer, G_ASCII_DTOSTR_BUF_SIZE, "%.2f",
+			 total_us > 0 ? amount * G_USEC_PER_SEC / total_us : 0.0);
+}
+
+static void
+bench_write_report (FILE *file, gint64 wall)
+{
+	struct rusage usage;
+	gboolean first = TRUE;
+	guint i, j;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		usage.ru_maxrss = 0;
+
+	fprintf (file,
+		 "{\"scenario\":\"%s\",\"iterations\":%d,\"files\":%d,"
+		 "\"wall_us\":%" G_GINT64_FORMAT ",\"peak_rss_kb\":%ld,"
+		 "\"operations\":{",
+		 scenario, iterations, n_files, wall, (glong) usage.ru_maxrss);
+
+	for (i = 0; i < metrics->len; i++) {
+		BenchMetric *metric = g_ptr_array_index (metrics, i);
+		gchar items_rate[G_ASCII_DTOSTR_BUF_SIZE];
+		gchar bytes_rate[G_ASCII_DTOSTR_BUF_SIZE];
+		gchar pixels_rate[G_ASCII_DTOSTR_BUF_SIZE];
+		gint64 total = 0;
+
+		if (metric->samples->len == 0)
+			continue;
+
+		g_array_sort (metric->samples, compare_durations);
+
+		for (j = 0; j < metric->samples->len; j++)
+			total += g_array_index (metric->samples, gint64, j);
+
+		format_rate (items_rate, metric->items, total);
+		format_rate (bytes_rate, metric->bytes / (1024.0 * 1024.0), total);
+		format_rate (pixels_rate, metric->pixels / 1e6, total);
+
+		fprintf (file,
+			 "%s\n\"%s\":{\"count\":%u,\"failures\":%u,"
+			 "\"items_per_second\":%s,\"mb_per_second\":%s,"
+			 "\"mpixels_per_second\":%s,"
+			 "\"total_us\":%" G_GINT64_FORMAT ","
+			 "\"p50_us\":%" G_GINT64_FORMAT ","
+			 "\"p90_us\":%" G_GINT64_FORMAT ","
+			 "\"p99_us\":%" G_GINT64_FORMAT ","
+			 "\"max_us\":%" G_GINT64_FORMAT "}",
+			 first ? "" : ",",
+			 metric->name, metric->samples->len, metric->failures,
+			 items_rate, bytes_rate, pixels_rate, total,
+			 percentile (metric->samples, 50),
+			 percentile (metric->samples, 90),
+			 percentile (metric->samples, 99),
+			 g_array_index (metric->samples, gint64,
+					metric->samples->len - 1));
+
+		first = FALSE;
+	}
+
+	fputs ("\n}}\n", file);
+}
+
+/* Corpus */
+
+/* Gradients with some noise, so that the files don't
+ * compress much better than photographs would */
+static GdkPixbuf *
+corpus_make_pixbuf (gint width, gint height, gboolean has_alpha)
+{
+	GdkPixbuf *pixbuf;
+	guchar *pixels, *p;
+	gint rowstride, n_channels;
+	guint32 seed = 0x2545f491;
+	gint x, y;
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+
+	for (y = 0; y < height; y++) {
+		p = pixels + y * rowstride;
+
+		for (x = 0; x < width; x++, p += n_channels) {
+			guint noise;
+
+			seed = seed * 1664525 + 1013904223;
+			noise = (seed >> 24) & 0x1f;
+
+			p[0] = (x * 255 / width + noise) & 0xff;
+			p[1] = (y * 255 / height + noise) & 0xff;
+			p[2] = ((x ^ y) + noise) & 0xff;
+
+			if (has_alpha)
+				p[3] = 0xff - ((x + y) & 0x3f);
+		}
+	}
+
+	return pixbuf;
+}
+
+static gboolean
+corpus_write_jpeg (const gchar  *path,
+		   GdkPixbuf    *pixbuf,
+		   gint          orientation,
+		   GError      **error)
+{
+	/* APP1 segment holding a single Orientation tag */
+	guchar exif[] = {
+		0xff, 0xe1, 0x00, 0x22,
+		'E', 'x', 'i', 'f', 0x00, 0x00,
+		'I', 'I', 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00,
+		0x01, 0x00,
+		0x12, 0x01, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00,
+		0x01, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00
+	};
+	gchar *buffer;
+	gsize length;
+	GByteArray *data;
+	gboolean success;
+
+	if (!gdk_pixbuf_save_to_buffer (pixbuf, &buffer, &length, "jpeg",
+					error, "quality", "90", NULL))
+		return FALSE;
+
+	exif[28] = orientation;
+
+	/* Right after the start of image marker */
+	data = g_byte_array_sized_new (length + sizeof (exif));
+	g_byte_array_append (data, (guchar *) buffer, 2);
+	g_byte_array_append (data, exif, sizeof (exif));
+	g_byte_array_append (data, (guchar *) buffer + 2, length - 2);
+
+	success = g_file_set_contents (path, (gchar *) data->data, data->len, error);
+
+	g_byte_array_unref (data);
+	g_free (buffer);
+
+	return success;
+}
+
+typedef struct {
+	GByteArray *data;
+	guchar      block[255];
+	guint       block_len;
+	guint32     bits;
+	guint       n_bits;
+} GifWriter;
+
+static void
+gif_put_byte (GifWriter *writer, guchar byte)
+{
+	writer->block[writer->block_len++] = byte;
+
+	if (writer->block_len == sizeof (writer->block)) {
+		guchar len = writer->block_len;
+
+		g_byte_array_append (writer->data, &len, 1);
+		g_byte_array_append (writer->data, writer->block, writer->block_len);
+		writer->block_len = 0;
+	}
+}
+
+static void
+gif_put_code (GifWriter *writer, guint code)
+{
+	writer->bits |= code << writer->n_bits;
+	writer->n_bits += 9;
+
+	while (writer->n_bits >= 8) {
+		gif_put_byte (writer, writer->bits & 0xff);
+		writer->bits >>= 8;
+		writer->n_bits -= 8;
+	}
+}
+
+static void
+gif_put_le16 (GByteArray *data, guint value)
+{
+	guchar bytes[2] = { value & 0xff, (value >> 8) & 0xff };
+
+	g_byte_array_append (data, bytes, 2);
+}
+
+/* gdk-pixbuf can't write GIF files. This writes them without
+ * compression: only literal 9 bit codes, with a clear code often
+ * enough that the code size never grows. */
+static gboolean
+corpus_write_gif (const gchar  *path,
+		  GdkPixbuf    *pixbuf,
+		  GError      **error)
+{
+	const guint clear_code = 256, end_code = 257;
+	GifWriter writer = { NULL, { 0 }, 0, 0, 0 };
+	const guchar header[] = { 'G', 'I', 'F', '8', '9', 'a' };
+	guchar byte;
+	guchar *pixels;
+	gint width, height, rowstride, n_channels;
+	gint x, y, run = 0;
+	gboolean success;
+	guint i;
+
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+
+	writer.data = g_byte_array_sized_new (width * height * 9 / 8 + 1024);
+
+	g_byte_array_append (writer.data, header, sizeof (header));
+	gif_put_le16 (writer.data, width);
+	gif_put_le16 (writer.data, height);
+
+	/* 256 entry global color table: a 6x6x6 color cube */
+	byte = 0xf7;
+	g_byte_array_append (writer.data, &byte, 1);
+	byte = 0;
+	g_byte_array_append (writer.data, &byte, 1);
+	g_byte_array_append (writer.data, &byte, 1);
+
+	for (i = 0; i < 256; i++) {
+		guchar rgb[3] = { 0, 0, 0 };
+
+		if (i < 216) {
+			rgb[0] = (i / 36) * 51;
+			rgb[1] = ((i / 6) % 6) * 51;
+			rgb[2] = (i % 6) * 51;
+		}
+
+		g_byte_array_append (writer.data, rgb, 3);
+	}
+
+	byte = 0x2c;
+	g_byte_array_append (writer.data, &byte, 1);
+	gif_put_le16 (writer.data, 0);
+	gif_put_le16 (writer.data, 0);
+	gif_put_le16 (writer.data, width);
+	gif_put_le16 (writer.data, height);
+	byte = 0;
+	g_byte_array_append (writer.data, &byte, 1);
+
+	/* LZW minimum code size */
+	byte = 8;
+	g_byte_array_append (writer.data, &byte, 1);
+
+	for (y = 0; y < height; y++) {
+		guchar *p = pixels + y * rowstride;
+
+		for (x = 0; x < width; x++, p += n_channels) {
+			if (run == 0)
+				gif_put_code (&writer, clear_code);
+
+			gif_put_code (&writer, (p[0] * 6 / 256) * 36 +
+					       (p[1] * 6 / 256) * 6 +
+					        p[2] * 6 / 256);
+
+			/* Decoders widen codes once 254 entries were added */
+			run = (run + 1) % 250;
+		}
+	}
+
+	gif_put_code (&writer, end_code);
+
+	if (writer.n_bits > 0)
+		gif_put_byte (&writer, writer.bits & 0xff);
+
+	if (writer.block_len > 0) {
+		byte = writer.block_len;
+		g_byte_array_append (writer.data, &byte, 1);
+		g_byte_array_append (writer.data, writer.block, writer.block_len);
+	}
+
+	/* Block terminator and trailer */
+	byte = 0;
+	g_byte_array_append (writer.data, &byte, 1);
+	byte = 0x3b;
+	g_byte_array_append (writer.data, &byte, 1);
+
+	success = g_file_set_contents (path, (gchar *) writer.data->data,
+				       writer.data->len, error);
+
+	g_byte_array_unref (writer.data);
+
+	return success;
+}
+
+static gboolean
+corpus_write_svg (const gchar  *path,
+		  gint          width,
+		  gint          height,
+		  GError      **error)
+{
+	GString *svg;
+	guint32 seed = 0x9e3779b9;
+	gboolean success;
+	gint i;
+
+	svg = g_string_new (NULL);
+
+	g_string_append_printf (svg,
+		"<svg xmlns=\"http://www.w3.org/2000/svg\" "
+		"width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n"
+		"<defs><linearGradient id=\"g\" x1=\"0\" y1=\"0\" x2=\"1\" y2=\"1\">"
+		"<stop offset=\"0\" stop-color=\"#204a87\"/>"
+		"<stop offset=\"1\" stop-color=\"#f57900\"/>"
+		"</linearGradient></defs>\n"
+		"<rect width=\"%d\" height=\"%d\" fill=\"url(#g)\"/>\n",
+		width, height, width, height, width, height);
+
+	for (i = 0; i < 500; i++) {
+		gint cx, cy, r;
+
+		seed = seed * 1664525 + 1013904223;
+		cx = (seed >> 8) % width;
+		seed = seed * 1664525 + 1013904223;
+		cy = (seed >> 8) % height;
+		r = 4 + (seed >> 24) % (MIN (width, height) / 8);
+
+		g_string_append_printf (svg,
+			"<circle cx=\"%d\" cy=\"%d\" r=\"%d\" "
+			"fill=\"#%06x\" fill-opacity=\"0.5\"/>\n",
+			cx, cy, r, seed & 0xffffff);
+	}
+
+	g_string_append (svg, "</svg>\n");
+
+	success = g_file_set_contents (path, svg->str, svg->len, error);
+
+	g_string_free (svg, TRUE);
+
+	return success;
+}
+
+static void
+corpus_add (GPtrArray   *corpus,
+	    const gchar *dir,
+	    const gchar *format,
+	    const gchar *extension,
+	    const gchar *size,
+	    gint         width,
+	    gint         height,
+	    gint         orientation)
+{
+	CorpusFile *entry;
+	gchar *name;
+
+	if (orientation > 0)
+		name = g_strdup_printf ("%s-%s-%dx%d-o%d.%s", format, size,
+					width, height, orientation, extension);
+	else
+		name = g_strdup_printf ("%s-%s-%dx%d.%s", format, size,
+					width, height, extension);
+
+	entry = g_new0 (CorpusFile, 1);
+	entry->path = g_build_filename (dir, name, NULL);
+	entry->format = format;
+	entry->size = size;
+
+	g_ptr_array_add (corpus, entry);
+	g_free (name);
+}
+
+static void
+corpus_file_free (CorpusFile *entry)
+{
+	g_free (entry->path);
+	g_free (entry);
+}
+
+/* Writes JPEG, PNG, GIF and SVG files of every size, both in
+ * landscape and portrait, the landscape JPEGs once per EXIF
+ * orientation. Files already there are reused. */
+static GPtrArray *
+corpus_generate (const gchar *dir, GError **error)
+{
+	GPtrArray *corpus;
+	guint i, j, k;
+
+	corpus = g_ptr_array_new_with_free_func ((GDestroyNotify) corpus_file_free);
+
+	for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		for (j = 0; j < 2; j++) {
+			gint width = j == 0 ? sizes[i].width : sizes[i].height;
+			gint height = j == 0 ? sizes[i].height : sizes[i].width;
+			guint first = corpus->len;
+
+			if (j == 0) {
+				for (k = 0; k < G_N_ELEMENTS (jpeg_orientations); k++)
+					corpus_add (corpus, dir, "jpeg", "jpg", sizes[i].name,
+						    width, height, jpeg_orientations[k]);
+			} else {
+				corpus_add (corpus, dir, "jpeg", "jpg", sizes[i].name,
+					    width, height, 0);
+			}
+
+			corpus_add (corpus, dir, "png", "png", sizes[i].name, width, height, 0);
+			corpus_add (corpus, dir, "gif", "gif", sizes[i].name, width, height, 0);
+			corpus_add (corpus, dir, "svg", "svg", sizes[i].name, width, height, 0);
+
+			for (k = first; k < corpus->len; k++) {
+				CorpusFile *entry = g_ptr_array_index (corpus, k);
+				GdkPixbuf *pixbuf;
+				gboolean success;
+
+				if (g_file_test (entry->path, G_FILE_TEST_EXISTS))
+					continue;
+
+				if (strcmp (entry->format, "svg") == 0) {
+					success = corpus_write_svg (entry->path, width, height, error);
+				} else {
+					pixbuf = corpus_make_pixbuf (width, height,
+								     strcmp (entry->format, "png") == 0);
+
+					if (strcmp (entry->format, "jpeg") == 0)
+						success = corpus_write_jpeg (entry->path, pixbuf,
+									     j == 0 ? jpeg_orientations[k - first] : 1,
+									     error);
+					else if (strcmp (entry->format, "gif") == 0)
+						success = corpus_write_gif (entry->path, pixbuf, error);
+					else
+						success = gdk_pixbuf_save (pixbuf, entry->path, "png",
+									   error, NULL);
+
+					g_object_unref (pixbuf);
+				}
+
+				if (!success) {
+					g_ptr_array_unref (corpus);
+					return NULL;
+				}
+			}
+		}
+	}
+
+	return corpus;
+}
+
+static void
+remove_tree (const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+
+	if (dir != NULL) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *child = g_build_filename (path, name, NULL);
+
+			remove_tree (child);
+			g_free (child);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_remove (path);
+}
+
+/* Scenarios */
+
+static GdkPixbufFormat *
+get_writable_format (const gchar *name)
+{
+	GSList *formats, *l;
+	GdkPixbufFormat *found = NULL;
+
+	formats = gdk_pixbuf_get_formats ();
+
+	for (l = formats; l != NULL && found == NULL; l = l->next) {
+		GdkPixbufFormat *format = l->data;
+		gchar *format_name = gdk_pixbuf_format_get_name (format);
+
+		if (strcmp (format_name, name) == 0 &&
+		    gdk_pixbuf_format_is_writable (format))
+			found = format;
+
+		g_free (format_name);
+	}
+
+	g_slist_free (formats);
+
+	return found;
+}
+
+static void
+bench_image_file (CorpusFile *entry, const gchar *save_dir)
+{
+	BenchMetric *load, *transform, *save, *cold, *warm;
+	GdkPixbufFormat *target_format;
+	GFile *file, *target;
+	EomImage *image;
+	GdkPixbuf *thumbnail;
+	GError *error = NULL;
+	GStatBuf stat_buf;
+	guint64 bytes = 0, pixels;
+	gchar *basename, *target_path;
+	gint64 start;
+	gint width, height;
+	gint i;
+
+	load = bench_metric_get ("load", entry->format, entry->size);
+	transform = bench_metric_get ("transform", entry->format, entry->size);
+	save = bench_metric_get ("save", entry->format, entry->size);
+	cold = bench_metric_get ("thumbnail-cold", entry->format, entry->size);
+	warm = bench_metric_get ("thumbnail-warm", entry->format, entry->size);
+
+	if (g_stat (entry->path, &stat_buf) == 0)
+		bytes = stat_buf.st_size;
+
+	file = g_file_new_for_path (entry->path);
+
+	/* Formats gdk-pixbuf can't write are saved as PNG */
+	target_format = get_writable_format (entry->format);
+	if (target_format == NULL)
+		target_format = get_writable_format ("png");
+
+	basename = g_path_get_basename (entry->path);
+	target_path = g_strdup_printf ("%s%csaved-%s.%s", save_dir, G_DIR_SEPARATOR,
+				       basename, strcmp (entry->format, "jpeg") == 0 ? "jpg" : "png");
+	target = g_file_new_for_path (target_path);
+
+	/* The thumbnail cache starts empty, only the first one is made */
+	for (i = 0; i < iterations + 1; i++) {
+		image = eom_image_new_file (file, basename);
+
+		start = g_get_monotonic_time ();
+		thumbnail = eom_thumbnail_load (image, &error);
+
+		if (thumbnail != NULL) {
+			bench_metric_add (i == 0 ? cold : warm, start, 1, bytes, 0);
+			g_object_unref (thumbnail);
+		} else {
+			(i == 0 ? cold : warm)->failures++;
+			g_clear_error (&error);
+		}
+
+		g_object_unref (image);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		EomImageSaveInfo *source, *target_info;
+		EomTransform *rotation;
+
+		image = eom_image_new_file (file, basename);
+		eom_image_autorotate (image);
+
+		start = g_get_monotonic_time ();
+
+		if (!eom_image_load (image, EOM_IMAGE_DATA_ALL, NULL, &error)) {
+			g_printerr ("Could not load %s: %s\n", entry->path,
+				    error != NULL ? error->message : "unknown error");
+			g_clear_error (&error);
+			load->failures++;
+			g_object_unref (image);
+			continue;
+		}
+
+		eom_image_get_size (image, &width, &height);
+		pixels = (guint64) MAX (width, 0) * MAX (height, 0);
+
+		bench_metric_add (load, start, 1, bytes, pixels);
+
+		/* Goes through eom_transform_apply(), and leaves the
+		 * image modified so that saving has to encode it */
+		rotation = eom_transform_rotate_new (90);
+
+		start = g_get_monotonic_time ();
+		eom_image_transform (image, rotation, NULL);
+		bench_metric_add (transform, start, 1, 0, pixels);
+
+		g_object_unref (rotation);
+
+		source = eom_image_save_info_new_from_image (image);
+		target_info = eom_image_save_info_new_from_file (target, target_format);
+		target_info->overwrite = TRUE;
+
+		start = g_get_monotonic_time ();
+
+		if (eom_image_save_as_by_info (image, source, target_info, &error)) {
+			bench_metric_add (save, start, 1, 0, pixels);
+		} else {
+			g_printerr ("Could not save %s: %s\n", target_path,
+				    error != NULL ? error->message : "unknown error");
+			g_clear_error (&error);
+			save->failures++;
+		}
+
+		g_object_unref (source);
+		g_object_unref (target_info);
+		g_object_unref (image);
+
+		g_remove (target_path);
+	}
+
+	g_object_unref (target);
+	g_object_unref (file);
+	g_free (target_path);
+	g_free (basename);
+}
+
+static gboolean
+bench_images (const gchar *dir)
+{
+	GPtrArray *corpus;
+	GError *error = NULL;
+	gchar *images_dir, *save_dir;
+	guint i;
+
+	images_dir = g_build_filename (dir, "images", NULL);
+	save_dir = g_build_filename (dir, "saved", NULL);
+
+	g_mkdir_with_parents (images_dir, 0700);
+	g_mkdir_with_parents (save_dir, 0700);
+
+	corpus = corpus_generate (images_dir, &error);
+
+	if (corpus == NULL) {
+		g_printerr ("Could not generate the corpus: %s\n", error->message);
+		g_error_free (error);
+		g_free (images_dir);
+		g_free (save_dir);
+		return FALSE;
+	}
+
+	for (i = 0; i < corpus->len; i++)
+		bench_image_file (g_ptr_array_index (corpus, i), save_dir);
+
+	g_ptr_array_unref (corpus);
+	g_free (images_dir);
+	g_free (save_dir);
+
+	return TRUE;
+}
+
+/* Fills a directory with @n_files small images. Most of them are hard
+ * links to a few templates, reading a folder doesn't open the files. */
+static gboolean
+folder_generate (const gchar *dir, gint count, GError **error)
+{
+	const gchar *extensions[] = { "jpg", "png", "gif", "svg" };
+	gchar *templates[G_N_ELEMENTS (extensions)];
+	GdkPixbuf *pixbuf;
+	gboolean success = TRUE;
+	gchar *marker;
+	guint i;
+	gint n;
+
+	marker = g_strdup_printf ("%s%c.complete-%d", dir, G_DIR_SEPARATOR, count);
+
+	if (g_file_test (marker, G_FILE_TEST_EXISTS)) {
+		g_free (marker);
+		return TRUE;
+	}
+
+	pixbuf = corpus_make_pixbuf (160, 120, FALSE);
+
+	for (i = 0; i < G_N_ELEMENTS (extensions); i++)
+		templates[i] = g_strdup_printf ("%s%c.template.%s", dir,
+						G_DIR_SEPARATOR, extensions[i]);
+
+	success = corpus_write_jpeg (templates[0], pixbuf, 1, error) &&
+		  gdk_pixbuf_save (pixbuf, templates[1], "png", error, NULL) &&
+		  corpus_write_gif (templates[2], pixbuf, error) &&
+		  corpus_write_svg (templates[3], 160, 120, error);
+
+	for (n = 0; success && n < count; n++) {
+		gchar *path;
+
+		path = g_strdup_printf ("%s%cimage-%06d.%s", dir, G_DIR_SEPARATOR,
+					n, extensions[n % G_N_ELEMENTS (extensions)]);
+
+		if (link (templates[n % G_N_ELEMENTS (extensions)], path) != 0 &&
+		    !g_file_test (path, G_FILE_TEST_EXISTS)) {
+			gchar *contents = NULL;
+			gsize length;
+
+			success = g_file_get_contents (templates[n % G_N_ELEMENTS (extensions)],
+						       &contents, &length, error) &&
+				  g_file_set_contents (path, contents, length, error);
+			g_free (contents);
+		}
+
+		g_free (path);
+	}
+
+	/* The templates start with a dot, so they are not listed */
+	if (success)
+		success = g_file_set_contents (marker, "", 0, error);
+
+	for (i = 0; i < G_N_ELEMENTS (extensions); i++)
+		g_free (templates[i]);
+
+	g_object_unref (pixbuf);
+	g_free (marker);
+
+	return success;
+}
+
+static gboolean
+bench_folder (const gchar *dir)
+{
+	BenchMetric *add, *lookup;
+	GError *error = NULL;
+	GFile *folder;
+	GList *file_list;
+	gchar *folder_dir, *size;
+	gint i;
+
+	size = g_strdup_printf ("%d", n_files);
+	folder_dir = g_build_filename (dir, "folder", size, NULL);
+	g_mkdir_with_parents (folder_dir, 0700);
+
+	if (!folder_generate (folder_dir, n_files, &error)) {
+		g_printerr ("Could not generate the folder: %s\n", error->message);
+		g_error_free (error);
+		g_free (folder_dir);
+		g_free (size);
+		return FALSE;
+	}
+
+	add = bench_metric_get ("add-files", "folder", size);
+	lookup = bench_metric_get ("lookup", "folder", size);
+
+	folder = g_file_new_for_path (folder_dir);
+	file_list = g_list_prepend (NULL, folder);
+
+	for (i = 0; i < iterations; i++) {
+		EomListStore *store;
+		gint length, pos, step;
+		gint64 start;
+
+		store = EOM_LIST_STORE (eom_list_store_new ());
+
+		start = g_get_monotonic_time ();
+		eom_list_store_add_files (store, file_list, FALSE);
+		length = eom_list_store_length (store);
+		bench_metric_add (add, start, length, 0, 0);
+
+		if (length != n_files)
+			add->failures++;
+
+		/* What the window does on every selection change */
+		step = MAX (length / 1000, 1);
+
+		for (pos = 0; pos < length; pos += step) {
+			EomImage *image = eom_list_store_get_image_by_pos (store, pos);
+
+			start = g_get_monotonic_time ();
+
+			if (eom_list_store_get_pos_by_image (store, image) == pos)
+				bench_metric_add (lookup, start, 1, 0, 0);
+			else
+				lookup->failures++;
+
+			g_object_unref (image);
+		}
+
+		g_object_unref (store);
+	}
+
+	g_list_free (file_list);
+	g_object_unref (folder);
+	g_free (folder_dir);
+	g_free (size);
+
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gchar *scratch_dir = NULL;
+	const gchar *dir;
+	gboolean success = TRUE;
+	gint64 start;
+	FILE *output = stdout;
+
+	context = g_option_context_new ("- measure the eom image pipeline");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (scenario == NULL)
+		scenario = g_strdup ("all");
+
+	if (strcmp (scenario, "images") != 0 &&
+	    strcmp (scenario, "folder") != 0 &&
+	    strcmp (scenario, "all") != 0) {
+		g_printerr ("Unknown scenario '%s', use images, folder or all\n",
+			    scenario);
+		return 1;
+	}
+
+	if (n_files < 1 || iterations < 1) {
+		g_printerr ("--files and --iterations must be positive\n");
+		return 1;
+	}
+
+	if (corpus_dir == NULL) {
+		scratch_dir = g_dir_make_tmp ("eom-benchmark-XXXXXX", &error);
+
+		if (scratch_dir == NULL) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			return 1;
+		}
+
+		dir = scratch_dir;
+	} else {
+		g_mkdir_with_parents (corpus_dir, 0700);
+		dir = corpus_dir;
+	}
+
+	/* Keep thumbnails and settings away from the user's own,
+	 * before anything asks GLib where they are */
+	{
+		gchar *cache_dir = g_build_filename (dir, "cache", NULL);
+
+		remove_tree (cache_dir);
+		g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+		g_setenv ("GSETTINGS_BACKEND", "memory", FALSE);
+		g_free (cache_dir);
+	}
+
+#if HAVE_EXEMPI
+	xmp_init ();
+#endif
+	eom_debug_init ();
+	eom_thumbnail_init ();
+
+	metrics = g_ptr_array_new_with_free_func ((GDestroyNotify) bench_metric_free);
+
+	start = g_get_monotonic_time ();
+
+	if (strcmp (scenario, "images") == 0 || strcmp (scenario, "all") == 0)
+		success = bench_images (dir) && success;
+
+	if (strcmp (scenario, "folder") == 0 || strcmp (scenario, "all") == 0)
+		success = bench_folder (dir) && success;
+
+	if (output_path != NULL) {
+		output = fopen (output_path, "w");
+
+		if (output == NULL) {
+			g_printerr ("Could not open %s\n", output_path);
+			output = stdout;
+		}
+	}
+
+	bench_write_report (output, g_get_monotonic_time () - start);
+
+	if (output != stdout)
+		fclose (output);
+
+	if (scratch_dir != NULL) {
+		remove_tree (scratch_dir);
+		g_free (scratch_dir);
+	}
+
+	g_ptr_array_unref (metrics);
+
+	return success ? 0 : 1;
+}
@@ -43,10 +43,27 @@ enum {
 };
 
 struct _EomClipboardHandlerPrivate {
-	GdkPixbuf *pixbuf;
-	gchar     *uri;
+	GdkPixbuf    *pixbuf;
+	gchar        *uri;
+
+	/* Unmodified source file, offered as is for its own type */
+	GFile        *file;
+	const gchar  *mime_type;
+	GMappedFile  *mapped_file;
+
+	/* PNG encoding started on copy, see eom_clipboard_handler_start_png() */
+	GCancellable *png_cancellable;
+	GMutex        png_lock;
+	GCond         png_cond;
+	gboolean      png_done;
+	GBytes       *png;
 };
 
+typedef struct {
+	GByteArray   *buffer;
+	GCancellable *cancellable;
+} PngWriteData;
+
 G_DEFINE_TYPE_WITH_PRIVATE (EomClipboardHandler, eom_clipboard_handler, G_TYPE_INITIALLY_UNOWNED)
 
 static GdkPixbuf*
@@ -168,14 +185,40 @@ eom_clipboard_handler_dispose (GObject *obj)
 		g_free (priv->uri);
 		priv->uri = NULL;
 	}
+	if (priv->png_cancellable != NULL) {
+		g_cancellable_cancel (priv->png_cancellable);
+		g_clear_object (&priv->png_cancellable);
+	}
+	if (priv->mapped_file != NULL) {
+		g_mapped_file_unref (priv->mapped_file);
+		priv->mapped_file = NULL;
+	}
+	g_clear_object (&priv->file);
 
 	G_OBJECT_CLASS (eom_clipboard_handler_parent_class)->dispose (obj);
 }
 
+static void
+eom_clipboard_handler_finalize (GObject *obj)
+{
+	EomClipboardHandlerPrivate *priv = EOM_CLIPBOARD_HANDLER (obj)->priv;
+
+	if (priv->png != NULL)
+		g_bytes_unref (priv->png);
+
+	g_mutex_clear (&priv->png_lock);
+	g_cond_clear (&priv->png_cond);
+
+	G_OBJECT_CLASS (eom_clipboard_handler_parent_class)->finalize (obj);
+}
+
 static void
 eom_clipboard_handler_init (EomClipboardHandler *handler)
 {
 	handler->priv = eom_clipboard_handler_get_instance_private (handler);
+
+	g_mutex_init (&handler->priv->png_lock);
+	g_cond_init (&handler->priv->png_cond);
 }
 
 static void
@@ -186,6 +229,7 @@ eom_clipboard_handler_class_init (EomClipboardHandlerClass *klass)
 	g_obj_class->get_property = eom_clipboard_handler_get_property;
 	g_obj_class->set_property = eom_clipboard_handler_set_property;
 	g_obj_class->dispose = eom_clipboard_handler_dispose;
+	g_obj_class->finalize = eom_clipboard_handler_finalize;
 
 	g_object_class_install_property (
 		g_obj_class, PROP_PIXBUF,
@@ -217,6 +261,13 @@ eom_clipboard_handler_new (EomImage *img)
 			    "uri", uri,
 			    NULL);
 	g_free (uri);
+
+	/* Pasting a JPEG as JPEG shouldn't mean encoding it again */
+	if (!eom_image_is_modified (img) && eom_image_is_jpeg (img)) {
+		EOM_CLIPBOARD_HANDLER (obj)->priv->file = g_object_ref (file);
+		EOM_CLIPBOARD_HANDLER (obj)->priv->mime_type = "image/jpeg";
+	}
+
 	g_object_unref (file);
 	g_object_unref (pbuf);
 	g_object_unref (img);
@@ -225,6 +276,124 @@ eom_clipboard_handler_new (EomImage *img)
 
 }
 
+static gboolean
+png_write_cb (const gchar *buf, gsize count, GError **error, gpointer user_data)
+{
+	PngWriteData *data = user_data;
+
+	/* Stops the encoding once the clipboard was taken over */
+	if (g_cancellable_set_error_if_cancelled (data->cancellable, error))
+		return FALSE;
+
+	g_byte_array_append (data->buffer, (const guint8 *) buf, count);
+
+	return TRUE;
+}
+
+static void
+encode_png_thread (GTask        *task,
+		   gpointer      source_object,
+		   gpointer      task_data,
+		   GCancellable *cancellable)
+{
+	EomClipboardHandlerPrivate *priv = EOM_CLIPBOARD_HANDLER (source_object)->priv;
+	PngWriteData data;
+	GBytes *png = NULL;
+
+	data.buffer = g_byte_array_new ();
+	data.cancellable = cancellable;
+
+	if (gdk_pixbuf_save_to_callback (priv->pixbuf, png_write_cb, &data,
+					 "png", NULL, NULL)) {
+		png = g_byte_array_free_to_bytes (data.buffer);
+	} else {
+		g_byte_array_unref (data.buffer);
+	}
+
+	g_mutex_lock (&priv->png_lock);
+	priv->png = png;
+	priv->png_done = TRUE;
+	g_cond_broadcast (&priv->png_cond);
+	g_mutex_unlock (&priv->png_lock);
+
+	g_task_return_boolean (task, png != NULL);
+}
+
+/* Encodes the image as PNG in a thread right when it is copied, as
+ * encoding it while answering a paste blocks the main loop for as long
+ * as it takes, every time the image is pasted */
+static void
+eom_clipboard_handler_start_png (EomClipboardHandler *handler)
+{
+	EomClipboardHandlerPrivate *priv = handler->priv;
+	GTask *task;
+
+	priv->png_cancellable = g_cancellable_new ();
+
+	task = g_task_new (handler, priv->png_cancellable, NULL, NULL);
+	g_task_run_in_thread (task, encode_png_thread);
+	g_object_unref (task);
+}
+
+static gboolean
+eom_clipboard_handler_set_png_data (EomClipboardHandler *handler,
+				    GtkSelectionData *selection)
+{
+	EomClipboardHandlerPrivate *priv = handler->priv;
+	GBytes *png = NULL;
+
+	if (priv->png_cancellable == NULL)
+		return FALSE;
+
+	/* A paste right after copying waits for what's left of the
+	 * encoding, any later one gets the cached result */
+	g_mutex_lock (&priv->png_lock);
+	while (!priv->png_done)
+		g_cond_wait (&priv->png_cond, &priv->png_lock);
+	if (priv->png != NULL)
+		png = g_bytes_ref (priv->png);
+	g_mutex_unlock (&priv->png_lock);
+
+	if (png == NULL)
+		return FALSE;
+
+	gtk_selection_data_set (selection,
+				gtk_selection_data_get_target (selection), 8,
+				g_bytes_get_data (png, NULL),
+				g_bytes_get_size (png));
+	g_bytes_unref (png);
+
+	return TRUE;
+}
+
+static gboolean
+eom_clipboard_handler_set_file_data (EomClipboardHandler *handler,
+				     GtkSelectionData *selection)
+{
+	EomClipboardHandlerPrivate *priv = handler->priv;
+
+	if (priv->mapped_file == NULL) {
+		gchar *path = g_file_get_path (priv->file);
+
+		/* Remote files are left to the encoders */
+		if (path == NULL)
+			return FALSE;
+
+		priv->mapped_file = g_mapped_file_new (path, FALSE, NULL);
+		g_free (path);
+
+		if (priv->mapped_file == NULL)
+			return FALSE;
+	}
+
+	gtk_selection_data_set (selection,
+				gtk_selection_data_get_target (selection), 8,
+				(const guchar *) g_mapped_file_get_contents (priv->mapped_file),
+				g_mapped_file_get_length (priv->mapped_file));
+
+	return TRUE;
+}
+
 static void
 eom_clipboard_handler_get_func (GtkClipboard *clipboard,
 				GtkSelectionData *selection,
@@ -239,7 +408,19 @@ eom_clipboard_handler_get_func (GtkClipboard *clipboard,
 	switch (info) {
 	case TARGET_PIXBUF:
 	{
-		GdkPixbuf *pixbuf = eom_clipboard_handler_get_pixbuf (handler);
+		GdkAtom target = gtk_selection_data_get_target (selection);
+		GdkPixbuf *pixbuf;
+
+		if (handler->priv->mime_type != NULL &&
+		    target == gdk_atom_intern (handler->priv->mime_type, FALSE) &&
+		    eom_clipboard_handler_set_file_data (handler, selection))
+			break;
+
+		if (target == gdk_atom_intern_static_string ("image/png") &&
+		    eom_clipboard_handler_set_png_data (handler, selection))
+			break;
+
+		pixbuf = eom_clipboard_handler_get_pixbuf (handler);
 		g_object_ref (pixbuf);
 		gtk_selection_data_set_pixbuf (selection, pixbuf);
 		g_object_unref (pixbuf);
@@ -271,8 +452,15 @@ eom_clipboard_handler_get_func (GtkClipboard *clipboard,
 static void
 eom_clipboard_handler_clear_func (GtkClipboard *clipboard, gpointer owner)
 {
+	EomClipboardHandlerPrivate *priv;
+
 	g_return_if_fail (EOM_IS_CLIPBOARD_HANDLER (owner));
 
+	priv = EOM_CLIPBOARD_HANDLER (owner)->priv;
+
+	if (priv->png_cancellable != NULL)
+		g_cancellable_cancel (priv->png_cancellable);
+
 	g_object_unref (G_OBJECT (owner));
 }
 
@@ -312,6 +500,8 @@ eom_clipboard_handler_copy_to_clipboard (EomClipboardHandler *handler,
 	if (!set) {
 		gtk_clipboard_clear (clipboard);
 		g_object_unref (handler);
+	} else if (handler->priv->pixbuf != NULL) {
+		eom_clipboard_handler_start_png (handler);
 	}
 
 	gtk_target_table_free (targets, n_targets);
@@ -50,6 +50,7 @@
 #define EOM_CONF_VIEW_TRANSPARENCY              "transparency"
 #define EOM_CONF_VIEW_TRANS_COLOR               "trans-color"
 #define EOM_CONF_VIEW_USE_BG_COLOR              "use-background-color"
+#define EOM_CONF_VIEW_PIXEL_CACHE_SIZE          "pixel-cache-size"
 
 #define EOM_CONF_FULLSCREEN_RANDOM              "random"
 #define EOM_CONF_FULLSCREEN_LOOP                "loop"
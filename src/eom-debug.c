@@ -30,6 +30,10 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include "eom-debug.h"
 
@@ -42,6 +46,267 @@ static gdouble last = 0.0;
 
 static EomDebug debug = EOM_DEBUG_NO_DEBUG;
 
+static gint64 startup_time = 0;
+
+/* Trace events are written in the Chrome trace-event JSON array format
+ * so that the output can be loaded into chrome://tracing or Perfetto. */
+static FILE    *trace_file = NULL;
+static GMutex   trace_mutex;
+static gint64   trace_start = 0;
+static gint     trace_last_tid = 0;
+static GPrivate trace_tid;
+
+/* Durations are also aggregated per event name and dumped as a summary
+ * next to the trace on exit, so runs can be compared by scripts. */
+static gchar      *trace_stats_path = NULL;
+static GHashTable *trace_durations = NULL;
+static GHashTable *trace_open_spans = NULL;
+
+static guint
+trace_get_tid (void)
+{
+	guint tid;
+
+	tid = GPOINTER_TO_UINT (g_private_get (&trace_tid));
+
+	if (G_UNLIKELY (tid == 0)) {
+		tid = (guint) g_atomic_int_add (&trace_last_tid, 1) + 1;
+		g_private_set (&trace_tid, GUINT_TO_POINTER (tid));
+	}
+
+	return tid;
+}
+
+static void
+trace_record_unlocked (const gchar   *name,
+		       gchar          phase,
+		       gconstpointer  id,
+		       gint64         ts,
+		       gint64         dur)
+{
+	GArray *samples;
+
+	if (id != NULL && (phase == 'b' || phase == 'e')) {
+		gchar *key = g_strdup_printf ("%p:%s", id, name);
+
+		if (phase == 'b') {
+			gint64 *start = g_new (gint64, 1);
+
+			*start = ts;
+			g_hash_table_replace (trace_open_spans, key, start);
+			return;
+		} else {
+			gint64 *start = g_hash_table_lookup (trace_open_spans, key);
+
+			if (start != NULL) {
+				dur = ts - *start;
+				g_hash_table_remove (trace_open_spans, key);
+			}
+
+			g_free (key);
+		}
+	}
+
+	if (dur < 0)
+		return;
+
+	samples = g_hash_table_lookup (trace_durations, name);
+
+	if (samples == NULL) {
+		samples = g_array_new (FALSE, FALSE, sizeof (gint64));
+		g_hash_table_insert (trace_durations, g_strdup (name), samples);
+	}
+
+	g_array_append_val (samples, dur);
+}
+
+static gint
+compare_durations (gconstpointer a, gconstpointer b)
+{
+	gint64 da = *(const gint64 *) a;
+	gint64 db = *(const gint64 *) b;
+
+	return (da > db) - (da < db);
+}
+
+static gint64
+trace_percentile (GArray *samples, guint percent)
+{
+	return g_array_index (samples, gint64,
+			      (samples->len - 1) * percent / 100);
+}
+
+static void
+trace_write_stats_unlocked (void)
+{
+	FILE *file;
+	GHashTableIter iter;
+	gpointer key, value;
+	struct rusage usage;
+	gint64 wall;
+	gboolean first = TRUE;
+
+	file = fopen (trace_stats_path, "w");
+
+	if (file == NULL) {
+		g_warning ("Could not open trace statistics file %s",
+			   trace_stats_path);
+		return;
+	}
+
+	wall = MAX (g_get_monotonic_time () - trace_start, 1);
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		usage.ru_maxrss = 0;
+
+	fprintf (file,
+		 "{\"wall_us\":%" G_GINT64_FORMAT ",\"peak_rss_kb\":%ld,"
+		 "\"events\":{",
+		 wall, (glong) usage.ru_maxrss);
+
+	g_hash_table_iter_init (&iter, trace_durations);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GArray *samples = value;
+		gchar rate[G_ASCII_DTOSTR_BUF_SIZE];
+		gint64 total = 0;
+		guint i;
+
+		g_array_sort (samples, compare_durations);
+
+		for (i = 0; i < samples->len; i++)
+			total += g_array_index (samples, gint64, i);
+
+		/* Avoid locale dependent decimal separators */
+		g_ascii_formatd (rate, sizeof (rate), "%.2f",
+				 samples->len * (gdouble) G_USEC_PER_SEC / wall);
+
+		fprintf (file,
+			 "%s\n\"%s\":{\"count\":%u,\"per_second\":%s,"
+			 "\"total_us\":%" G_GINT64_FORMAT ","
+			 "\"p50_us\":%" G_GINT64_FORMAT ","
+			 "\"p90_us\":%" G_GINT64_FORMAT ","
+			 "\"p99_us\":%" G_GINT64_FORMAT ","
+			 "\"max_us\":%" G_GINT64_FORMAT "}",
+			 first ? "" : ",",
+			 (const gchar *) key, samples->len, rate, total,
+			 trace_percentile (samples, 50),
+			 trace_percentile (samples, 90),
+			 trace_percentile (samples, 99),
+			 g_array_index (samples, gint64, samples->len - 1));
+
+		first = FALSE;
+	}
+
+	fputs ("\n}}\n", file);
+	fclose (file);
+}
+
+static void
+trace_write_unlocked (const gchar   *category,
+		      const gchar   *name,
+		      gchar          phase,
+		      gconstpointer  id,
+		      gint64         ts,
+		      gint64         dur,
+		      const gchar   *args)
+{
+	fprintf (trace_file,
+		 "{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"%c\","
+		 "\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u",
+		 category, name, phase, ts - trace_start,
+		 (gint) getpid (), trace_get_tid ());
+
+	if (id != NULL)
+		fprintf (trace_file, ",\"id\":\"%p\"", id);
+
+	if (dur >= 0)
+		fprintf (trace_file, ",\"dur\":%" G_GINT64_FORMAT, dur);
+
+	if (args != NULL)
+		fprintf (trace_file, ",\"args\":{%s}", args);
+
+	fputs ("},\n", trace_file);
+
+	trace_record_unlocked (name, phase, id, ts, dur);
+}
+
+static void
+trace_close (void)
+{
+	g_mutex_lock (&trace_mutex);
+
+	if (trace_file != NULL) {
+		/* Every event is followed by a comma, so terminate the
+		 * array with an empty object to keep it valid JSON. */
+		fputs ("{}]\n", trace_file);
+		fclose (trace_file);
+		trace_file = NULL;
+
+		trace_write_stats_unlocked ();
+	}
+
+	g_mutex_unlock (&trace_mutex);
+}
+
+static void
+trace_init (void)
+{
+	const gchar *path;
+	gchar *default_path = NULL;
+
+	path = g_getenv ("EOM_TRACE");
+
+	if (path == NULL)
+		return;
+
+	if (*path == '\0' || strcmp (path, "1") == 0) {
+		gchar *basename;
+
+		basename = g_strdup_printf ("eom-trace-%d.json", (gint) getpid ());
+		default_path = g_build_filename (g_get_tmp_dir (), basename, NULL);
+		path = default_path;
+		g_free (basename);
+	}
+
+	trace_file = fopen (path, "w");
+
+	if (trace_file == NULL) {
+		g_warning ("Could not open trace file %s", path);
+		g_free (default_path);
+		return;
+	}
+
+	if (g_str_has_suffix (path, ".json")) {
+		gchar *base = g_strndup (path, strlen (path) - strlen (".json"));
+
+		trace_stats_path = g_strconcat (base, "-stats.json", NULL);
+		g_free (base);
+	} else {
+		trace_stats_path = g_strconcat (path, "-stats.json", NULL);
+	}
+
+	g_print ("Writing trace to %s and statistics to %s\n",
+		 path, trace_stats_path);
+	g_free (default_path);
+
+	trace_durations = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free,
+						 (GDestroyNotify) g_array_unref);
+	trace_open_spans = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_free);
+
+	trace_start = g_get_monotonic_time ();
+
+	fputs ("[\n", trace_file);
+
+	/* eom_debug_init() runs on the main thread, which thus gets tid 1 */
+	trace_write_unlocked ("__metadata", "thread_name", 'M', NULL,
+			      trace_start, -1, "\"name\":\"main\"");
+
+	atexit (trace_close);
+}
+
 void
 eom_debug_init (void)
 {
@@ -88,15 +353,54 @@ eom_debug_init (void)
 	if (g_getenv ("EOM_DEBUG_PLUGINS") != NULL)
 		debug = debug | EOM_DEBUG_PLUGINS;
 
+	if (g_getenv ("EOM_DEBUG_STATS") != NULL)
+		debug = debug | EOM_DEBUG_STATS;
+
+	if (g_getenv ("EOM_DEBUG_STARTUP") != NULL)
+		debug = debug | EOM_DEBUG_STARTUP;
+
 out:
 
 #ifdef ENABLE_PROFILING
 	if (debug != EOM_DEBUG_NO_DEBUG)
 		timer = g_timer_new ();
 #endif
+	trace_init ();
+
 	return;
 }
 
+gboolean
+eom_debug_is_enabled (EomDebug section)
+{
+	return (debug & section) != 0;
+}
+
+/**
+ * eom_debug_startup_mark:
+ * @milestone: a short name for the startup milestone reached
+ *
+ * Records a startup milestone. The first mark defines the start of the
+ * process; with EOM_DEBUG_STARTUP set, every later mark prints the
+ * time elapsed since then, giving a startup timing report.
+ **/
+void
+eom_debug_startup_mark (const gchar *milestone)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	if (startup_time == 0)
+		startup_time = now;
+
+	eom_trace_event ("startup", milestone, 'i', NULL, NULL);
+
+	if (G_UNLIKELY (debug & EOM_DEBUG_STARTUP)) {
+		g_print ("[startup] %8.1f ms  %s\n",
+			 (now - startup_time) / 1000.0, milestone);
+		fflush (stdout);
+	}
+}
+
 void
 eom_debug_message (EomDebug   section,
 		   const gchar      *file,
@@ -157,3 +461,117 @@ void eom_debug (EomDebug  section,
 		fflush (stdout);
 	}
 }
+
+/**
+ * eom_trace_enabled:
+ *
+ * Checks whether tracing was requested through the EOM_TRACE environment
+ * variable. Callers only need this to avoid building expensive arguments;
+ * the other trace functions return immediately when tracing is off.
+ *
+ * Returns: %TRUE if trace events are being recorded
+ **/
+gboolean
+eom_trace_enabled (void)
+{
+	return G_UNLIKELY (trace_file != NULL);
+}
+
+/**
+ * eom_trace_now:
+ *
+ * Returns: the current time in the clock used for trace timestamps,
+ * suitable as @start for eom_trace_complete()
+ **/
+gint64
+eom_trace_now (void)
+{
+	return g_get_monotonic_time ();
+}
+
+static void
+trace_event_valist (const gchar   *category,
+		    const gchar   *name,
+		    gchar          phase,
+		    gconstpointer  id,
+		    gint64         ts,
+		    gint64         dur,
+		    const gchar   *args_format,
+		    va_list        var_args)
+{
+	gchar *args = NULL;
+
+	if (args_format != NULL)
+		args = g_strdup_vprintf (args_format, var_args);
+
+	g_mutex_lock (&trace_mutex);
+
+	if (trace_file != NULL)
+		trace_write_unlocked (category, name, phase, id, ts, dur, args);
+
+	g_mutex_unlock (&trace_mutex);
+
+	g_free (args);
+}
+
+/**
+ * eom_trace_event:
+ * @category: the event category, e.g. "job"
+ * @name: the event name
+ * @phase: the trace-event phase, e.g. 'b' and 'e' for async spans or
+ * 'i' for instant events
+ * @id: (allow-none): identifier pairing the events of an async span
+ * @args_format: (allow-none): printf-style format for the members of the
+ * event's args object, e.g. <literal>"\"bytes\":%d"</literal>
+ * @...: the parameters to insert into the format string
+ *
+ * Records a trace event stamped with the current time and thread.
+ **/
+void
+eom_trace_event (const gchar   *category,
+		 const gchar   *name,
+		 gchar          phase,
+		 gconstpointer  id,
+		 const gchar   *args_format, ...)
+{
+	va_list var_args;
+
+	if (G_LIKELY (trace_file == NULL))
+		return;
+
+	va_start (var_args, args_format);
+	trace_event_valist (category, name, phase, id,
+			    g_get_monotonic_time (), -1,
+			    args_format, var_args);
+	va_end (var_args);
+}
+
+/**
+ * eom_trace_complete:
+ * @category: the event category
+ * @name: the event name
+ * @start: the start time of the event as returned by eom_trace_now()
+ * @args_format: (allow-none): printf-style format for the members of the
+ * event's args object
+ * @...: the parameters to insert into the format string
+ *
+ * Records a complete event spanning from @start until now on the
+ * calling thread.
+ **/
+void
+eom_trace_complete (const gchar *category,
+		    const gchar *name,
+		    gint64       start,
+		    const gchar *args_format, ...)
+{
+	va_list var_args;
+
+	if (G_LIKELY (trace_file == NULL))
+		return;
+
+	va_start (var_args, args_format);
+	trace_event_valist (category, name, 'X', NULL,
+			    start, g_get_monotonic_time () - start,
+			    args_format, var_args);
+	va_end (var_args);
+}
@@ -43,7 +43,9 @@ typedef enum {
 	EOM_DEBUG_PREFERENCES  = 1 << 8,
 	EOM_DEBUG_PRINTING     = 1 << 9,
 	EOM_DEBUG_LCMS         = 1 << 10,
-	EOM_DEBUG_PLUGINS      = 1 << 11
+	EOM_DEBUG_PLUGINS      = 1 << 11,
+	EOM_DEBUG_STATS        = 1 << 12,
+	EOM_DEBUG_STARTUP      = 1 << 13
 } EomDebug;
 
 #define	DEBUG_WINDOW		EOM_DEBUG_WINDOW,      __FILE__, __LINE__, G_STRFUNC
@@ -58,9 +60,15 @@ typedef enum {
 #define	DEBUG_PRINTING		EOM_DEBUG_PRINTING,    __FILE__, __LINE__, G_STRFUNC
 #define	DEBUG_LCMS 		EOM_DEBUG_LCMS,        __FILE__, __LINE__, G_STRFUNC
 #define	DEBUG_PLUGINS 		EOM_DEBUG_PLUGINS,     __FILE__, __LINE__, G_STRFUNC
+#define	DEBUG_STATS 		EOM_DEBUG_STATS,       __FILE__, __LINE__, G_STRFUNC
+#define	DEBUG_STARTUP 		EOM_DEBUG_STARTUP,     __FILE__, __LINE__, G_STRFUNC
 
 void   eom_debug_init        (void);
 
+gboolean eom_debug_is_enabled (EomDebug section);
+
+void   eom_debug_startup_mark (const gchar *milestone);
+
 void   eom_debug             (EomDebug    section,
           	              const gchar       *file,
           	              gint               line,
@@ -72,4 +80,19 @@ void   eom_debug_message     (EomDebug    section,
 			      const gchar       *function,
 			      const gchar       *format, ...) G_GNUC_PRINTF(5, 6);
 
+gboolean eom_trace_enabled   (void);
+
+gint64   eom_trace_now       (void);
+
+void     eom_trace_event     (const gchar   *category,
+			      const gchar   *name,
+			      gchar          phase,
+			      gconstpointer  id,
+			      const gchar   *args_format, ...) G_GNUC_PRINTF(5, 6);
+
+void     eom_trace_complete  (const gchar   *category,
+			      const gchar   *name,
+			      gint64         start,
+			      const gchar   *args_format, ...) G_GNUC_PRINTF(4, 5);
+
 #endif /* __EOM_DEBUG_H__ */
@@ -0,0 +1,716 @@
+/* Eye Of Mate - Image Header Prober
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <glib/gi18n.h>
+
+#include "eom-image-header.h"
+#include "eom-image-private.h"
+#include "eom-debug.h"
+#include "eom-stats.h"
+
+/* Headers are read in growing chunks; formats which keep their
+ * dimensions further away than this are left to the decoder */
+#define EOM_IMAGE_HEADER_CHUNK_SIZE	4096
+#define EOM_IMAGE_HEADER_MAX_SIZE	(128 * 1024)
+
+#define TIFF_TAG_IMAGE_WIDTH	256
+#define TIFF_TAG_IMAGE_LENGTH	257
+#define TIFF_TAG_ORIENTATION	274
+#define TIFF_TAG_ICC_PROFILE	34675
+#define TIFF_TYPE_SHORT		3
+
+typedef enum {
+	HEADER_FOUND,
+	HEADER_NEED_DATA,
+	HEADER_UNKNOWN
+} EomImageHeaderResult;
+
+static GThreadPool *probe_pool = NULL;
+static GMutex probe_pool_mutex;
+
+static guint16
+read16 (const guchar *p, gboolean little_endian)
+{
+	return little_endian ? (p[0] | p[1] << 8) : (p[0] << 8 | p[1]);
+}
+
+static guint32
+read32 (const guchar *p, gboolean little_endian)
+{
+	return little_endian ?
+		((guint32) p[0] | (guint32) p[1] << 8 |
+		 (guint32) p[2] << 16 | (guint32) p[3] << 24) :
+		((guint32) p[0] << 24 | (guint32) p[1] << 16 |
+		 (guint32) p[2] << 8 | (guint32) p[3]);
+}
+
+static gboolean
+set_size (EomImageHeader *header, guint64 width, guint64 height)
+{
+	if (width == 0 || height == 0 ||
+	    width > G_MAXINT || height > G_MAXINT)
+		return FALSE;
+
+	header->width = (gint) width;
+	header->height = (gint) height;
+
+	return TRUE;
+}
+
+/* Walks the first IFD of a TIFF structure, used both for TIFF files
+ * and for the EXIF blocks embedded in other formats */
+static EomImageHeaderResult
+parse_tiff (const guchar   *buf,
+	    gsize           len,
+	    EomImageHeader *header,
+	    gboolean        want_size)
+{
+	gboolean le;
+	guint32 ifd, width = 0, height = 0;
+	guint16 n_entries, i;
+
+	if (len < 8)
+		return HEADER_NEED_DATA;
+
+	if (memcmp (buf, "II*\0", 4) == 0)
+		le = TRUE;
+	else if (memcmp (buf, "MM\0*", 4) == 0)
+		le = FALSE;
+	else
+		return HEADER_UNKNOWN;
+
+	ifd = read32 (buf + 4, le);
+
+	if (ifd < 8)
+		return HEADER_UNKNOWN;
+
+	if ((guint64) ifd + 2 > len)
+		return HEADER_NEED_DATA;
+
+	n_entries = read16 (buf + ifd, le);
+
+	if ((guint64) ifd + 2 + (guint64) n_entries * 12 > len)
+		return HEADER_NEED_DATA;
+
+	for (i = 0; i < n_entries; i++) {
+		const guchar *entry = buf + ifd + 2 + i * 12;
+		guint16 tag, type;
+		guint32 value;
+
+		tag = read16 (entry, le);
+		type = read16 (entry + 2, le);
+		value = (type == TIFF_TYPE_SHORT) ?
+			read16 (entry + 8, le) : read32 (entry + 8, le);
+
+		switch (tag) {
+		case TIFF_TAG_IMAGE_WIDTH:
+			width = value;
+			break;
+		case TIFF_TAG_IMAGE_LENGTH:
+			height = value;
+			break;
+		case TIFF_TAG_ORIENTATION:
+			if (value >= 1 && value <= 8)
+				header->orientation = value;
+			break;
+		case TIFF_TAG_ICC_PROFILE:
+			header->has_profile = TRUE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (want_size && !set_size (header, width, height))
+		return HEADER_UNKNOWN;
+
+	return HEADER_FOUND;
+}
+
+static EomImageHeaderResult
+parse_jpeg (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	gsize pos = 2;
+
+	while (pos + 4 <= len) {
+		guchar marker;
+		gsize body, body_len;
+
+		if (buf[pos] != 0xFF)
+			return HEADER_UNKNOWN;
+
+		marker = buf[pos + 1];
+
+		if (marker == 0xFF) {
+			/* fill byte */
+			pos++;
+			continue;
+		}
+
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+			/* standalone marker without a length */
+			pos += 2;
+			continue;
+		}
+
+		/* No frame header before the scan data */
+		if (marker == 0xD9 || marker == 0xDA)
+			return HEADER_UNKNOWN;
+
+		body = pos + 4;
+		body_len = read16 (buf + pos + 2, FALSE);
+
+		if (body_len < 2)
+			return HEADER_UNKNOWN;
+
+		body_len -= 2;
+
+		/* SOFn, except for DHT, JPG and DAC */
+		if ((marker & 0xF0) == 0xC0 &&
+		    marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (body + 5 > len)
+				return HEADER_NEED_DATA;
+
+			return set_size (header,
+					 read16 (buf + body + 3, FALSE),
+					 read16 (buf + body + 1, FALSE)) ?
+				HEADER_FOUND : HEADER_UNKNOWN;
+		}
+
+		if (body + body_len <= len) {
+			if (marker == 0xE1 && body_len > 6 &&
+			    memcmp (buf + body, "Exif\0\0", 6) == 0) {
+				parse_tiff (buf + body + 6, body_len - 6,
+					    header, FALSE);
+			} else if (marker == 0xE2 && body_len > 12 &&
+				   memcmp (buf + body, "ICC_PROFILE\0", 12) == 0) {
+				header->has_profile = TRUE;
+			}
+		}
+
+		pos = body + body_len;
+	}
+
+	return HEADER_NEED_DATA;
+}
+
+static EomImageHeaderResult
+parse_png (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	guint64 pos;
+
+	if (len < 24)
+		return HEADER_NEED_DATA;
+
+	if (memcmp (buf + 12, "IHDR", 4) != 0 ||
+	    !set_size (header, read32 (buf + 16, FALSE),
+		       read32 (buf + 20, FALSE)))
+		return HEADER_UNKNOWN;
+
+	/* Ancillary chunks describing the colour space
+	 * and orientation come before the image data */
+	for (pos = 8; pos + 8 <= len; ) {
+		guint32 chunk_len = read32 (buf + pos, FALSE);
+		const guchar *type = buf + pos + 4;
+
+		if (memcmp (type, "IDAT", 4) == 0 ||
+		    memcmp (type, "IEND", 4) == 0)
+			break;
+
+		if (memcmp (type, "iCCP", 4) == 0) {
+			header->has_profile = TRUE;
+		} else if (memcmp (type, "eXIf", 4) == 0 &&
+			   pos + 8 + chunk_len <= len) {
+			parse_tiff (buf + pos + 8, chunk_len, header, FALSE);
+		}
+
+		/* length, type and CRC32 value */
+		pos += (guint64) chunk_len + 12;
+	}
+
+	return HEADER_FOUND;
+}
+
+static EomImageHeaderResult
+parse_gif (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	if (len < 10)
+		return HEADER_NEED_DATA;
+
+	if (memcmp (buf, "GIF87a", 6) != 0 && memcmp (buf, "GIF89a", 6) != 0)
+		return HEADER_UNKNOWN;
+
+	return set_size (header, read16 (buf + 6, TRUE), read16 (buf + 8, TRUE)) ?
+		HEADER_FOUND : HEADER_UNKNOWN;
+}
+
+static EomImageHeaderResult
+parse_webp (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	guint64 pos;
+	guint32 bits;
+
+	if (len < 30)
+		return HEADER_NEED_DATA;
+
+	if (memcmp (buf + 8, "WEBP", 4) != 0)
+		return HEADER_UNKNOWN;
+
+	if (memcmp (buf + 12, "VP8 ", 4) == 0) {
+		/* lossy bitstream, after the frame tag and start code */
+		if (buf[23] != 0x9d || buf[24] != 0x01 || buf[25] != 0x2a)
+			return HEADER_UNKNOWN;
+
+		return set_size (header,
+				 read16 (buf + 26, TRUE) & 0x3fff,
+				 read16 (buf + 28, TRUE) & 0x3fff) ?
+			HEADER_FOUND : HEADER_UNKNOWN;
+	}
+
+	if (memcmp (buf + 12, "VP8L", 4) == 0) {
+		/* lossless bitstream, 14 bits for each dimension minus one */
+		if (buf[20] != 0x2f)
+			return HEADER_UNKNOWN;
+
+		bits = read32 (buf + 21, TRUE);
+
+		return set_size (header,
+				 (bits & 0x3fff) + 1,
+				 ((bits >> 14) & 0x3fff) + 1) ?
+			HEADER_FOUND : HEADER_UNKNOWN;
+	}
+
+	if (memcmp (buf + 12, "VP8X", 4) != 0)
+		return HEADER_UNKNOWN;
+
+	/* extended format, 24 bits for each canvas dimension minus one */
+	if (!set_size (header,
+		       (buf[24] | buf[25] << 8 | buf[26] << 16) + 1,
+		       (buf[27] | buf[28] << 8 | buf[29] << 16) + 1))
+		return HEADER_UNKNOWN;
+
+	header->has_profile = (buf[20] & 0x20) != 0;
+
+	for (pos = 30; pos + 8 <= len; ) {
+		guint32 chunk_len = read32 (buf + pos + 4, TRUE);
+
+		if (memcmp (buf + pos, "EXIF", 4) == 0 &&
+		    pos + 8 + chunk_len <= len) {
+			const guchar *exif = buf + pos + 8;
+
+			/* some writers keep the JPEG APP1 identifier */
+			if (chunk_len > 6 && memcmp (exif, "Exif\0\0", 6) == 0) {
+				exif += 6;
+				chunk_len -= 6;
+			}
+
+			parse_tiff (exif, chunk_len, header, FALSE);
+			break;
+		}
+
+		/* chunks are padded to an even size */
+		pos += 8 + (guint64) chunk_len + (chunk_len & 1);
+	}
+
+	return HEADER_FOUND;
+}
+
+static gchar *
+svg_get_attribute (const gchar *tag, const gchar *name)
+{
+	gsize name_len = strlen (name);
+	const gchar *p = tag;
+
+	while ((p = strstr (p, name)) != NULL) {
+		const gchar *q = p + name_len;
+
+		/* make sure not to match e.g. stroke-width */
+		if (p > tag && g_ascii_isspace (p[-1])) {
+			while (g_ascii_isspace (*q))
+				q++;
+
+			if (*q == '=') {
+				q++;
+
+				while (g_ascii_isspace (*q))
+					q++;
+
+				if (*q == '"' || *q == '\'') {
+					const gchar *end = strchr (q + 1, *q);
+
+					if (end != NULL)
+						return g_strndup (q + 1, end - q - 1);
+				}
+			}
+		}
+
+		p = q;
+	}
+
+	return NULL;
+}
+
+/* Converts a length to user units, taking absolute units at 96 dpi as
+ * librsvg does. Returns 0 when there is no length, and -1 when it is
+ * relative to the font or the viewport, as its size is unknown here. */
+static gdouble
+svg_parse_length (const gchar *value)
+{
+	static const struct {
+		const gchar *unit;
+		gdouble      scale;
+	} units[] = {
+		{ "",   1.0 },
+		{ "px", 1.0 },
+		{ "in", 96.0 },
+		{ "cm", 96.0 / 2.54 },
+		{ "mm", 96.0 / 25.4 },
+		{ "pt", 96.0 / 72.0 },
+		{ "pc", 96.0 / 6.0 },
+	};
+	const gchar *end, *rest;
+	gdouble length;
+	guint i;
+
+	if (value == NULL)
+		return 0.0;
+
+	length = g_ascii_strtod (value, (gchar **) &end);
+
+	if (end == value)
+		return 0.0;
+
+	while (g_ascii_isspace (*end))
+		end++;
+
+	for (i = 0; i < G_N_ELEMENTS (units); i++) {
+		if (!g_str_has_prefix (end, units[i].unit))
+			continue;
+
+		rest = end + strlen (units[i].unit);
+
+		while (g_ascii_isspace (*rest))
+			rest++;
+
+		if (*rest == '\0')
+			return length * units[i].scale;
+	}
+
+	/* em, ex, % or a unit we don't know */
+	return -1.0;
+}
+
+static EomImageHeaderResult
+parse_svg (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	EomImageHeaderResult result = HEADER_UNKNOWN;
+	gchar *text, *tag, *end, *value;
+	gdouble width, height;
+
+	text = g_strndup ((const gchar *) buf, len);
+
+	/* skip a byte order mark and leading whitespace */
+	tag = text;
+	if (g_str_has_prefix (tag, "\xef\xbb\xbf"))
+		tag += 3;
+	while (g_ascii_isspace (*tag))
+		tag++;
+
+	if (*tag != '<')
+		goto out;
+
+	tag = strstr (tag, "<svg");
+	if (tag == NULL || (end = strchr (tag, '>')) == NULL) {
+		result = HEADER_NEED_DATA;
+		goto out;
+	}
+
+	*end = '\0';
+
+	value = svg_get_attribute (tag, "width");
+	width = svg_parse_length (value);
+	g_free (value);
+
+	value = svg_get_attribute (tag, "height");
+	height = svg_parse_length (value);
+	g_free (value);
+
+	/* Leave relative sizes to the loader */
+	if (width < 0.0 || height < 0.0)
+		goto out;
+
+	if (width <= 0.0 || height <= 0.0) {
+		gchar **parts;
+
+		value = svg_get_attribute (tag, "viewBox");
+		parts = value ? g_strsplit_set (g_strstrip (value), " ,\t\n\r", -1) : NULL;
+		width = height = 0.0;
+
+		if (parts != NULL) {
+			gdouble box[4];
+			gint i, n = 0;
+
+			for (i = 0; parts[i] != NULL && n < 4; i++) {
+				if (*parts[i] != '\0')
+					box[n++] = g_ascii_strtod (parts[i], NULL);
+			}
+
+			if (n == 4) {
+				width = box[2];
+				height = box[3];
+			}
+		}
+
+		g_strfreev (parts);
+		g_free (value);
+	}
+
+	if (width > 0.0 && height > 0.0 &&
+	    set_size (header, (guint64) ceil (width), (guint64) ceil (height)))
+		result = HEADER_FOUND;
+
+out:
+	g_free (text);
+
+	return result;
+}
+
+static EomImageHeaderResult
+parse_header (const guchar *buf, gsize len, EomImageHeader *header)
+{
+	static const guchar png_signature[] = { 0x89, 'P', 'N', 'G',
+						'\r', '\n', 0x1a, '\n' };
+
+	header->width = -1;
+	header->height = -1;
+	header->orientation = 0;
+	header->has_profile = FALSE;
+
+	if (len < 12)
+		return HEADER_NEED_DATA;
+
+	if (buf[0] == 0xFF && buf[1] == 0xD8)
+		return parse_jpeg (buf, len, header);
+
+	if (memcmp (buf, png_signature, sizeof (png_signature)) == 0)
+		return parse_png (buf, len, header);
+
+	if (memcmp (buf, "GIF8", 4) == 0)
+		return parse_gif (buf, len, header);
+
+	if (memcmp (buf, "RIFF", 4) == 0)
+		return parse_webp (buf, len, header);
+
+	if (memcmp (buf, "II*\0", 4) == 0 || memcmp (buf, "MM\0*", 4) == 0)
+		return parse_tiff (buf, len, header, TRUE);
+
+	return parse_svg (buf, len, header);
+}
+
+/**
+ * eom_image_header_parse:
+ * @buf: the first bytes of an image file
+ * @len: the number of bytes in @buf
+ * @header: (out): return location for the header information
+ *
+ * Reads the dimensions, EXIF orientation and colour profile presence
+ * of JPEG, PNG, GIF, WebP, TIFF and SVG images from their headers.
+ *
+ * Returns: %TRUE if the dimensions could be read from @buf.
+ **/
+gboolean
+eom_image_header_parse (const guchar   *buf,
+			gsize           len,
+			EomImageHeader *header)
+{
+	g_return_val_if_fail (buf != NULL || len == 0, FALSE);
+	g_return_val_if_fail (header != NULL, FALSE);
+
+	return parse_header (buf, len, header) == HEADER_FOUND;
+}
+
+/**
+ * eom_image_header_read:
+ * @file: the image file
+ * @header: (out): return location for the header information
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Like eom_image_header_parse(), reading only as much of @file as the
+ * header needs, which is a few kilobytes for most images.
+ *
+ * Returns: %TRUE if the dimensions of @file could be read.
+ **/
+gboolean
+eom_image_header_read (GFile          *file,
+		       EomImageHeader *header,
+		       GCancellable   *cancellable,
+		       GError        **error)
+{
+	GFileInputStream *stream;
+	EomImageHeaderResult result = HEADER_NEED_DATA;
+	guchar *buf = NULL;
+	gsize len = 0, size = 0;
+	gboolean eof = FALSE;
+
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (header != NULL, FALSE);
+
+	stream = g_file_read (file, cancellable, error);
+
+	if (stream == NULL)
+		return FALSE;
+
+	while (result == HEADER_NEED_DATA && !eof &&
+	       size < EOM_IMAGE_HEADER_MAX_SIZE) {
+		gsize bytes_read;
+
+		size = size ? MIN (size * 2, EOM_IMAGE_HEADER_MAX_SIZE) :
+			      EOM_IMAGE_HEADER_CHUNK_SIZE;
+		buf = g_realloc (buf, size);
+
+		if (!g_input_stream_read_all (G_INPUT_STREAM (stream),
+					      buf + len, size - len,
+					      &bytes_read,
+					      cancellable, error)) {
+			result = HEADER_UNKNOWN;
+			break;
+		}
+
+		len += bytes_read;
+		eof = (len < size);
+
+		result = parse_header (buf, len, header);
+	}
+
+	g_free (buf);
+	g_object_unref (stream);
+
+	if (result != HEADER_FOUND) {
+		if (error != NULL && *error == NULL)
+			g_set_error (error,
+				     EOM_IMAGE_ERROR,
+				     EOM_IMAGE_ERROR_GENERIC,
+				     _("Image dimensions could not be read from the file header."));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * eom_image_header_apply:
+ * @img: a #EomImage
+ * @header: (out) (allow-none): return location for the header
+ * information, or %NULL
+ *
+ * Probes the header of @img and stores its dimensions unless they are
+ * already known, so that %EOM_IMAGE_DATA_DIMENSION is available without
+ * decoding. The EXIF orientation is kept as well, and autorotated
+ * images report their size as displayed. This is safe to call from
+ * any thread.
+ *
+ * Returns: %TRUE if the header of @img could be read.
+ **/
+gboolean
+eom_image_header_apply (EomImage *img, EomImageHeader *header)
+{
+	EomImagePrivate *priv;
+	EomImageHeader tmp;
+	gint64 start;
+	gboolean success;
+
+	g_return_val_if_fail (EOM_IS_IMAGE (img), FALSE);
+
+	priv = img->priv;
+
+	if (header == NULL)
+		header = &tmp;
+
+	start = eom_trace_now ();
+
+	success = eom_image_header_read (priv->file, header, NULL, NULL);
+
+	eom_stats_counter_add (success ? "image.header-probed" :
+					 "image.header-unsupported", 1);
+	eom_stats_histogram_add ("image.header-us", eom_trace_now () - start);
+
+	if (!success)
+		return FALSE;
+
+	g_mutex_lock (&priv->status_mutex);
+
+	if (priv->orientation == 0)
+		priv->orientation = header->orientation;
+
+	/* A decoder may have been faster, its size is authoritative */
+	if (priv->width < 0 || priv->height < 0) {
+		priv->width = header->width;
+		priv->height = header->height;
+		priv->size_oriented = FALSE;
+
+		/* Report the size as it will be displayed */
+		if (priv->autorotate)
+			eom_image_orient_size (img);
+	}
+
+	g_mutex_unlock (&priv->status_mutex);
+
+	return TRUE;
+}
+
+static void
+probe_run (gpointer data, gpointer user_data)
+{
+	EomImage *img = EOM_IMAGE (data);
+
+	if (!eom_image_has_data (img, EOM_IMAGE_DATA_DIMENSION))
+		eom_image_header_apply (img, NULL);
+
+	g_object_unref (img);
+}
+
+/**
+ * eom_image_header_probe_async:
+ * @img: a #EomImage
+ *
+ * Queues @img for eom_image_header_apply() on a pool of threads shared
+ * by all images, so that whole folders are probed in parallel.
+ **/
+void
+eom_image_header_probe_async (EomImage *img)
+{
+	g_return_if_fail (EOM_IS_IMAGE (img));
+
+	g_mutex_lock (&probe_pool_mutex);
+	if (probe_pool == NULL)
+		probe_pool = g_thread_pool_new (probe_run, NULL,
+						g_get_num_processors (),
+						FALSE, NULL);
+	g_mutex_unlock (&probe_pool_mutex);
+
+	g_thread_pool_push (probe_pool, g_object_ref (img), NULL);
+}
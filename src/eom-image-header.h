@@ -0,0 +1,59 @@
+/* Eye Of Mate - Image Header Prober
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __EOM_IMAGE_HEADER_H__
+#define __EOM_IMAGE_HEADER_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "eom-image.h"
+
+G_BEGIN_DECLS
+
+typedef struct _EomImageHeader EomImageHeader;
+
+struct _EomImageHeader {
+	gint     width;
+	gint     height;
+	gint     orientation;	/* EXIF orientation, 0 if unknown */
+	gboolean has_profile;	/* an embedded ICC profile was found */
+};
+
+G_GNUC_INTERNAL
+gboolean	eom_image_header_parse		(const guchar   *buf,
+						 gsize           len,
+						 EomImageHeader *header);
+
+G_GNUC_INTERNAL
+gboolean	eom_image_header_read		(GFile          *file,
+						 EomImageHeader *header,
+						 GCancellable   *cancellable,
+						 GError        **error);
+
+G_GNUC_INTERNAL
+gboolean	eom_image_header_apply		(EomImage       *img,
+						 EomImageHeader *header);
+
+G_GNUC_INTERNAL
+void		eom_image_header_probe_async	(EomImage       *img);
+
+G_END_DECLS
+
+#endif /* __EOM_IMAGE_HEADER_H__ */
@@ -47,6 +47,7 @@
 #include <jerror.h>
 #include "transupp.h"
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib/gi18n.h>
 #if HAVE_EXIF
@@ -525,4 +526,255 @@ eom_image_jpeg_save_file (EomImage *image, const char *file,
 
 	return result;
 }
+
+gboolean
+eom_image_jpeg_crop_file (EomImage *image, const GdkRectangle *area,
+			  const char *file, GError **error)
+{
+#if JPEG_LIB_VERSION >= 80
+	struct jpeg_decompress_struct  srcinfo;
+	struct jpeg_compress_struct    dstinfo;
+	struct error_handler_data      jsrcerr, jdsterr;
+	jpeg_transform_info            transformoption;
+	jvirt_barray_ptr              *src_coef_arrays;
+	jvirt_barray_ptr              *dst_coef_arrays;
+	FILE                          *output_file;
+	FILE                          *input_file;
+
+	g_return_val_if_fail (EOM_IS_IMAGE (image), FALSE);
+	g_return_val_if_fail (area != NULL, FALSE);
+
+	memset (&transformoption, 0x0, sizeof (jpeg_transform_info));
+	transformoption.transform = JXFORM_NONE;
+	transformoption.crop = TRUE;
+	transformoption.crop_xoffset = area->x;
+	transformoption.crop_xoffset_set = JCROP_POS;
+	transformoption.crop_yoffset = area->y;
+	transformoption.crop_yoffset_set = JCROP_POS;
+	transformoption.crop_width = area->width;
+	transformoption.crop_width_set = JCROP_POS;
+	transformoption.crop_height = area->height;
+	transformoption.crop_height_set = JCROP_POS;
+
+	jsrcerr.filename = g_file_get_path (image->priv->file);
+	if (jsrcerr.filename == NULL) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_SAVE_NOT_LOCAL,
+			     _("Couldn't read the image file"));
+		return FALSE;
+	}
+
+	input_file = fopen (jsrcerr.filename, "rb");
+	if (input_file == NULL) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_VFS,
+			     _("Couldn't read the image file"));
+		g_free (jsrcerr.filename);
+		return FALSE;
+	}
+
+	output_file = fopen (file, "wb");
+	if (output_file == NULL) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_VFS,
+			     _("Couldn't create file \"%s\""), file);
+		fclose (input_file);
+		g_free (jsrcerr.filename);
+		return FALSE;
+	}
+
+	srcinfo.err = jpeg_std_error (&(jsrcerr.pub));
+	jsrcerr.pub.error_exit = fatal_error_handler;
+	jsrcerr.pub.output_message = output_message_handler;
+	jsrcerr.error = error;
+
+	jpeg_create_decompress (&srcinfo);
+
+	jdsterr.filename = (char *) file;
+	dstinfo.err = jpeg_std_error (&(jdsterr.pub));
+	jdsterr.pub.error_exit = fatal_error_handler;
+	jdsterr.pub.output_message = output_message_handler;
+	jdsterr.error = error;
+
+	jpeg_create_compress (&dstinfo);
+
+	if (sigsetjmp (jsrcerr.setjmp_buffer, 1)) {
+		fclose (output_file);
+		fclose (input_file);
+		jpeg_destroy_compress (&dstinfo);
+		jpeg_destroy_decompress (&srcinfo);
+		g_unlink (file);
+		g_free (jsrcerr.filename);
+		return FALSE;
+	}
+
+	if (sigsetjmp (jdsterr.setjmp_buffer, 1)) {
+		fclose (output_file);
+		fclose (input_file);
+		jpeg_destroy_compress (&dstinfo);
+		jpeg_destroy_decompress (&srcinfo);
+		g_unlink (file);
+		g_free (jsrcerr.filename);
+		return FALSE;
+	}
+
+	jpeg_stdio_src (&srcinfo, input_file);
+
+	/* Keep the Exif data, orientation included, and the color
+	 * profile, which apply to the cropped image as well */
+	jcopy_markers_setup (&srcinfo, JCOPYOPT_ALL);
+
+	(void) jpeg_read_header (&srcinfo, TRUE);
+
+	/* Moves the top left corner up to the closest iMCU boundary */
+	if (!jtransform_request_workspace (&srcinfo, &transformoption)) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_GENERIC,
+			     _("The selected area can't be read from the image file"));
+		fclose (output_file);
+		fclose (input_file);
+		jpeg_destroy_compress (&dstinfo);
+		jpeg_destroy_decompress (&srcinfo);
+		g_unlink (file);
+		g_free (jsrcerr.filename);
+		return FALSE;
+	}
+
+	/* Only the entropy coding is undone, there is no IDCT */
+	src_coef_arrays = jpeg_read_coefficients (&srcinfo);
+
+	jpeg_copy_critical_parameters (&srcinfo, &dstinfo);
+
+	dst_coef_arrays = jtransform_adjust_parameters (&srcinfo,
+							&dstinfo,
+							src_coef_arrays,
+							&transformoption);
+
+	jpeg_stdio_dest (&dstinfo, output_file);
+
+	jpeg_write_coefficients (&dstinfo, dst_coef_arrays);
+
+	jcopy_markers_execute (&srcinfo, &dstinfo, JCOPYOPT_ALL);
+
+	jtransform_execute_transformation (&srcinfo,
+					   &dstinfo,
+					   src_coef_arrays,
+					   &transformoption);
+
+	jpeg_finish_compress (&dstinfo);
+	jpeg_destroy_compress (&dstinfo);
+	(void) jpeg_finish_decompress (&srcinfo);
+	jpeg_destroy_decompress (&srcinfo);
+	g_free (jsrcerr.filename);
+
+	fclose (input_file);
+	fclose (output_file);
+
+	return TRUE;
+#else
+	g_set_error (error, EOM_IMAGE_ERROR,
+		     EOM_IMAGE_ERROR_GENERIC,
+		     _("Lossless cropping is not supported"));
+
+	return FALSE;
+#endif
+}
+
+GdkPixbuf *
+eom_image_jpeg_decode_area (EomImage *image, const GdkRectangle *area,
+			    GError **error)
+{
+	struct jpeg_decompress_struct  cinfo;
+	struct error_handler_data      jerr;
+	GdkPixbuf * volatile           pixbuf = NULL;
+	guchar * volatile              row = NULL;
+	FILE                          *input_file;
+	GdkRectangle                   region;
+	JSAMPROW                       rows[1];
+
+	g_return_val_if_fail (EOM_IS_IMAGE (image), NULL);
+	g_return_val_if_fail (area != NULL, NULL);
+
+	jerr.filename = g_file_get_path (image->priv->file);
+	if (jerr.filename == NULL) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_NOT_LOADED,
+			     _("Couldn't read the image file"));
+		return NULL;
+	}
+
+	input_file = fopen (jerr.filename, "rb");
+	if (input_file == NULL) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_VFS,
+			     _("Couldn't read the image file"));
+		g_free (jerr.filename);
+		return NULL;
+	}
+
+	cinfo.err = jpeg_std_error (&(jerr.pub));
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = error;
+
+	jpeg_create_decompress (&cinfo);
+
+	if (sigsetjmp (jerr.setjmp_buffer, 1)) {
+		if (pixbuf != NULL)
+			g_object_unref (pixbuf);
+		g_free (row);
+		jpeg_destroy_decompress (&cinfo);
+		fclose (input_file);
+		g_free (jerr.filename);
+		return NULL;
+	}
+
+	jpeg_stdio_src (&cinfo, input_file);
+	(void) jpeg_read_header (&cinfo, TRUE);
+
+	cinfo.out_color_space = JCS_RGB;
+	jpeg_start_decompress (&cinfo);
+
+	region.x = 0;
+	region.y = 0;
+	region.width = cinfo.output_width;
+	region.height = cinfo.output_height;
+
+	if (cinfo.output_components != 3 ||
+	    !gdk_rectangle_intersect (area, &region, &region)) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_GENERIC,
+			     _("The selected area can't be read from the image file"));
+		jpeg_destroy_decompress (&cinfo);
+		fclose (input_file);
+		g_free (jerr.filename);
+		return NULL;
+	}
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+				 region.width, region.height);
+	row = g_malloc (cinfo.output_width * 3);
+	rows[0] = row;
+
+	/* Rows below the area are never decoded */
+	while (cinfo.output_scanline < (JDIMENSION) (region.y + region.height)) {
+		JDIMENSION y = cinfo.output_scanline;
+
+		jpeg_read_scanlines (&cinfo, rows, 1);
+
+		if (y >= (JDIMENSION) region.y) {
+			memcpy (gdk_pixbuf_get_pixels (pixbuf) +
+				(y - region.y) * gdk_pixbuf_get_rowstride (pixbuf),
+				row + region.x * 3, region.width * 3);
+		}
+	}
+
+	jpeg_abort_decompress (&cinfo);
+	jpeg_destroy_decompress (&cinfo);
+	fclose (input_file);
+	g_free (row);
+	g_free (jerr.filename);
+
+	return pixbuf;
+}
 #endif
@@ -17,6 +17,22 @@ G_GNUC_INTERNAL
 gboolean eom_image_jpeg_save_file (EomImage *image, const char *file,
 				   EomImageSaveInfo *source, EomImageSaveInfo *target,
 				   GError **error);
+
+/* Saves the area of the source jpeg file to file without decoding it,
+ * which needs a JPEG library supporting lossless cropping. The top left
+ * corner of the area is moved to the closest block boundary above and
+ * to the left of it, so the result may be a few pixels larger.
+ */
+G_GNUC_INTERNAL
+gboolean eom_image_jpeg_crop_file (EomImage *image, const GdkRectangle *area,
+				   const char *file, GError **error);
+
+/* Decodes the area of the source jpeg file, stopping at its last row
+ * instead of decoding the whole image.
+ */
+G_GNUC_INTERNAL
+GdkPixbuf *eom_image_jpeg_decode_area (EomImage *image, const GdkRectangle *area,
+				       GError **error);
 #endif
 
 #endif /* _EOM_IMAGE_JPEG_H_ */
@@ -39,8 +39,20 @@ struct _EomImagePrivate {
 	gboolean          is_playing;
 	GdkPixbufAnimation     *anim;
 	GdkPixbufAnimationIter *anim_iter;
+	gint64            anim_time;
+	gint64            anim_deadline;
+	gint              anim_delay;
+	guint             anim_source;
+	/* Pre-transformed frames, see eom_image_anim_cache_frame() */
+	GPtrArray        *anim_frames;
+	gsize             anim_frames_size;
+	guint             anim_n_frames;
+	guint             anim_frame;
+	gboolean          anim_cache_full;
 	GdkPixbuf        *image;
+	gsize             image_bytes;
 	GdkPixbuf        *thumbnail;
+	guint             thumbnail_holds;
 #ifdef HAVE_RSVG
 	RsvgHandle       *svg;
 #endif
@@ -66,6 +78,15 @@ struct _EomImagePrivate {
 
 	gboolean          autorotate;
 	gint              orientation;
+	gboolean          size_oriented;
+	/* The EXIF orientation was looked at, see eom_image_real_autorotate() */
+	gboolean          orientation_checked;
+	/* The pixels came from the pixel cache, oriented already */
+	gboolean          pixels_oriented;
+	/* The pixels were converted to the display profile */
+	gboolean          display_corrected;
+	/* Pixel cache entry to write once the pixels are dropped */
+	gchar            *pixel_cache_key;
 #ifdef HAVE_EXIF
 	ExifData         *exif;
 #endif
@@ -92,6 +113,20 @@ struct _EomImagePrivate {
 	EomTransform     *trans_autorotate;
 };
 
+G_GNUC_INTERNAL
+void eom_image_orient_size (EomImage *img);
+
+G_GNUC_INTERNAL
+void eom_image_hold_thumbnail (EomImage *img);
+
+G_GNUC_INTERNAL
+void eom_image_release_thumbnail (EomImage *img);
+
+#ifdef HAVE_RSVG
+G_GNUC_INTERNAL
+void eom_image_render_svg (RsvgHandle *svg, cairo_t *cr);
+#endif
+
 G_END_DECLS
 
 #endif /* __EOM_IMAGE_PRIVATE_H__ */
@@ -28,7 +28,9 @@
 
 #include "eom-image.h"
 #include "eom-image-private.h"
+#include "eom-image-header.h"
 #include "eom-debug.h"
+#include "eom-stats.h"
 
 #ifdef HAVE_JPEG
 #include "eom-image-jpeg.h"
@@ -42,6 +44,7 @@
 #include "eom-util.h"
 #include "eom-jobs.h"
 #include "eom-thumbnail.h"
+#include "eom-pixel-cache.h"
 
 #include <unistd.h>
 #include <string.h>
@@ -83,6 +86,95 @@ static guint signals[SIGNAL_LAST] = { 0 };
 
 #define EOM_IMAGE_READ_BUFFER_SIZE 65535
 
+/* Upper bound for the memory used by the cached frames of an animation */
+#define EOM_IMAGE_ANIM_CACHE_SIZE (64 * 1024 * 1024)
+
+/* Shortest delay between frames, as enforced by the GIF loader */
+#define EOM_IMAGE_ANIM_MIN_DELAY 20
+
+/* Frames we are willing to drop in a row to catch up with the clock */
+#define EOM_IMAGE_ANIM_MAX_SKIP 8
+
+typedef struct {
+	GdkPixbuf *pixbuf;
+	gint       delay;
+} EomImageFrame;
+
+static void
+eom_image_frame_free (EomImageFrame *frame)
+{
+	g_object_unref (frame->pixbuf);
+	g_slice_free (EomImageFrame, frame);
+}
+
+static void
+eom_image_anim_clear_cache (EomImage *img)
+{
+	EomImagePrivate *priv = img->priv;
+
+	if (priv->anim_frames != NULL) {
+		g_ptr_array_unref (priv->anim_frames);
+		priv->anim_frames = NULL;
+	}
+
+	priv->anim_frames_size = 0;
+	priv->anim_n_frames = 0;
+	priv->anim_frame = 0;
+	priv->anim_cache_full = FALSE;
+}
+
+/* GdkPixbufAnimation still takes its times as GTimeVal */
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+static GdkPixbufAnimationIter *
+eom_image_anim_get_iter (GdkPixbufAnimation *anim, gint64 time)
+{
+	GTimeVal tv;
+
+	tv.tv_sec = time / G_USEC_PER_SEC;
+	tv.tv_usec = time % G_USEC_PER_SEC;
+
+	return gdk_pixbuf_animation_get_iter (anim, &tv);
+}
+
+static void
+eom_image_anim_iter_advance (GdkPixbufAnimationIter *iter, gint64 time)
+{
+	GTimeVal tv;
+
+	tv.tv_sec = time / G_USEC_PER_SEC;
+	tv.tv_usec = time % G_USEC_PER_SEC;
+
+	gdk_pixbuf_animation_iter_advance (iter, &tv);
+}
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+/* Hands the pixels over to the pixel cache, as long as they are
+ * still the ones decoded from the file */
+static void
+eom_image_pixel_cache_store (EomImage *img)
+{
+	EomImagePrivate *priv = img->priv;
+	gint orientation = 0;
+
+	if (priv->pixel_cache_key == NULL)
+		return;
+
+	if (priv->image != NULL &&
+	    priv->trans == NULL &&
+	    !priv->modified &&
+	    !priv->display_corrected) {
+		if (priv->orientation_checked)
+			orientation = (priv->trans_autorotate != NULL ?
+				       priv->orientation : 1);
+
+		eom_pixel_cache_store (priv->pixel_cache_key, priv->image,
+				       orientation, priv->file_type);
+	}
+
+	g_free (priv->pixel_cache_key);
+	priv->pixel_cache_key = NULL;
+}
+
 static void
 eom_image_free_mem_private (EomImage *image)
 {
@@ -93,6 +185,13 @@ eom_image_free_mem_private (EomImage *image)
 	if (priv->status == EOM_IMAGE_STATUS_LOADING) {
 		eom_image_cancel_load (image);
 	} else {
+		if (priv->anim_source != 0) {
+			g_source_remove (priv->anim_source);
+			priv->anim_source = 0;
+		}
+
+		eom_image_anim_clear_cache (image);
+
 		if (priv->anim_iter != NULL) {
 			g_object_unref (priv->anim_iter);
 			priv->anim_iter = NULL;
@@ -105,11 +204,22 @@ eom_image_free_mem_private (EomImage *image)
 
 		priv->is_playing = FALSE;
 
+		eom_image_pixel_cache_store (image);
+
 		if (priv->image != NULL) {
 			g_object_unref (priv->image);
 			priv->image = NULL;
 		}
 
+		priv->pixels_oriented = FALSE;
+		priv->display_corrected = FALSE;
+
+		if (priv->image_bytes > 0) {
+			eom_stats_counter_add ("image.decoded-bytes",
+					       -(gint64) priv->image_bytes);
+			priv->image_bytes = 0;
+		}
+
 #ifdef HAVE_RSVG
 		if (priv->svg != NULL) {
 			g_object_unref (priv->svg);
@@ -152,6 +262,13 @@ eom_image_free_mem_private (EomImage *image)
 	}
 }
 
+/* Live images by file; the values are weak references, so an
+ * entry never keeps its image alive */
+static GHashTable *image_registry = NULL;
+static GMutex image_registry_mutex;
+
+static void image_registry_remove (GFile *file);
+
 static void
 eom_image_dispose (GObject *object)
 {
@@ -162,6 +279,7 @@ eom_image_dispose (GObject *object)
 	eom_image_free_mem_private (EOM_IMAGE (object));
 
 	if (priv->file) {
+		image_registry_remove (priv->file);
 		g_object_unref (priv->file);
 		priv->file = NULL;
 	}
@@ -181,6 +299,11 @@ eom_image_dispose (GObject *object)
 		priv->file_type = NULL;
 	}
 
+	if (priv->pixel_cache_key) {
+		g_free (priv->pixel_cache_key);
+		priv->pixel_cache_key = NULL;
+	}
+
 	g_mutex_clear (&priv->status_mutex);
 
 	if (priv->trans) {
@@ -282,8 +405,11 @@ eom_image_init (EomImage *img)
 	img->priv->image = NULL;
 	img->priv->anim = NULL;
 	img->priv->anim_iter = NULL;
+	img->priv->anim_source = 0;
+	img->priv->anim_frames = NULL;
 	img->priv->is_playing = FALSE;
 	img->priv->thumbnail = NULL;
+	img->priv->thumbnail_holds = 0;
 	img->priv->width = -1;
 	img->priv->height = -1;
 	img->priv->modified = FALSE;
@@ -297,6 +423,7 @@ eom_image_init (EomImage *img)
 	img->priv->data_ref_count = 0;
 #ifdef HAVE_EXIF
 	img->priv->orientation = 0;
+	img->priv->size_oriented = FALSE;
 	img->priv->autorotate = FALSE;
 	img->priv->exif = NULL;
 #endif
@@ -311,15 +438,87 @@ eom_image_init (EomImage *img)
 #endif
 }
 
+static void
+image_registry_ref_free (GWeakRef *ref)
+{
+	g_weak_ref_clear (ref);
+	g_slice_free (GWeakRef, ref);
+}
+
+/* Drops the registry entry for @file unless another image has
+ * taken its place in the meantime */
+static void
+image_registry_remove (GFile *file)
+{
+	GWeakRef *ref;
+	GObject *live = NULL;
+
+	g_mutex_lock (&image_registry_mutex);
+
+	if (image_registry != NULL) {
+		ref = g_hash_table_lookup (image_registry, file);
+
+		if (ref != NULL) {
+			live = g_weak_ref_get (ref);
+
+			if (live == NULL)
+				g_hash_table_remove (image_registry, file);
+		}
+	}
+
+	g_mutex_unlock (&image_registry_mutex);
+
+	/* Outside the lock, as this could be the last reference */
+	if (live != NULL)
+		g_object_unref (live);
+}
+
+/**
+ * eom_image_new_file:
+ * @file: a #GFile
+ * @caption: the caption to use for a newly created image
+ *
+ * Returns the #EomImage for @file. As long as an image for the same
+ * file is alive, be it in this window or in another one, that image
+ * is returned instead of a new one, so its decoded data, thumbnail
+ * and metadata are shared rather than loaded twice.
+ *
+ * Returns: (transfer full): an #EomImage
+ **/
 EomImage *
 eom_image_new_file (GFile *file, const gchar *caption)
 {
 	EomImage *img;
+	GWeakRef *ref;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	g_mutex_lock (&image_registry_mutex);
+
+	if (image_registry == NULL) {
+		image_registry = g_hash_table_new_full (g_file_hash,
+							(GEqualFunc) g_file_equal,
+							g_object_unref,
+							(GDestroyNotify) image_registry_ref_free);
+	}
+
+	ref = g_hash_table_lookup (image_registry, file);
+	img = (ref != NULL) ? g_weak_ref_get (ref) : NULL;
+
+	if (img == NULL) {
+		img = EOM_IMAGE (g_object_new (EOM_TYPE_IMAGE, NULL));
 
-	img = EOM_IMAGE (g_object_new (EOM_TYPE_IMAGE, NULL));
+		img->priv->file = g_object_ref (file);
+		img->priv->caption = g_strdup (caption);
 
-	img->priv->file = g_object_ref (file);
-	img->priv->caption = g_strdup (caption);
+		ref = g_slice_new (GWeakRef);
+		g_weak_ref_init (ref, img);
+		g_hash_table_replace (image_registry, g_object_ref (file), ref);
+	} else {
+		eom_stats_counter_add ("image.shared", 1);
+	}
+
+	g_mutex_unlock (&image_registry_mutex);
 
 	return img;
 }
@@ -391,6 +590,36 @@ eom_image_update_exif_data (EomImage *image)
 #endif
 }
 
+/* Applies @trans to the cached frames of an animation. Frames
+ * sharing a pixbuf keep sharing the transformed one. */
+static void
+eom_image_anim_transform_cache (EomImage *img, EomTransform *trans)
+{
+	GPtrArray *frames = img->priv->anim_frames;
+	GHashTable *done;
+	guint i;
+
+	done = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				      NULL, g_object_unref);
+
+	for (i = 0; i < frames->len; i++) {
+		EomImageFrame *frame = g_ptr_array_index (frames, i);
+		GdkPixbuf *transformed;
+
+		transformed = g_hash_table_lookup (done, frame->pixbuf);
+
+		if (transformed == NULL) {
+			transformed = eom_transform_apply (trans, frame->pixbuf, NULL);
+			g_hash_table_insert (done, frame->pixbuf, transformed);
+		}
+
+		g_object_unref (frame->pixbuf);
+		frame->pixbuf = g_object_ref (transformed);
+	}
+
+	g_hash_table_destroy (done);
+}
+
 static void
 eom_image_real_transform (EomImage     *img,
 			  EomTransform *trans,
@@ -418,6 +647,12 @@ eom_image_real_transform (EomImage     *img,
 		modified = TRUE;
 	}
 
+	if (priv->anim_frames != NULL) {
+		g_mutex_lock (&priv->status_mutex);
+		eom_image_anim_transform_cache (img, trans);
+		g_mutex_unlock (&priv->status_mutex);
+	}
+
 	if (priv->thumbnail != NULL) {
 		transformed = eom_transform_apply (trans, priv->thumbnail, NULL);
 
@@ -485,11 +720,17 @@ eom_image_size_prepared (GdkPixbufLoader *loader,
 
 	img->priv->width = width;
 	img->priv->height = height;
+	img->priv->size_oriented = FALSE;
+
+	/* The orientation may be known from the header already */
+	if (img->priv->autorotate && img->priv->orientation != 0)
+		eom_image_orient_size (img);
 
 	g_mutex_unlock (&img->priv->status_mutex);
 
 #ifdef HAVE_EXIF
-	if (!img->priv->autorotate || img->priv->exif)
+	if (!img->priv->autorotate || img->priv->exif ||
+	    img->priv->size_oriented)
 #endif
 		eom_image_emit_size_prepared (img);
 }
@@ -529,13 +770,17 @@ eom_image_apply_transformations (EomImage *img, GError **error)
 {
 	GdkPixbuf *transformed = NULL;
 	EomTransform *composition = NULL;
+	EomTransform *autorotate;
 	EomImagePrivate *priv;
 
 	g_return_val_if_fail (EOM_IS_IMAGE (img), FALSE);
 
 	priv = img->priv;
 
-	if (priv->trans == NULL && priv->trans_autorotate == NULL) {
+	/* Pixels from the pixel cache are oriented already */
+	autorotate = (priv->pixels_oriented ? NULL : priv->trans_autorotate);
+
+	if (priv->trans == NULL && autorotate == NULL) {
 		return TRUE;
 	}
 
@@ -548,13 +793,12 @@ eom_image_apply_transformations (EomImage *img, GError **error)
 		return FALSE;
 	}
 
-	if (priv->trans != NULL && priv->trans_autorotate != NULL) {
-		composition = eom_transform_compose (priv->trans,
-						     priv->trans_autorotate);
+	if (priv->trans != NULL && autorotate != NULL) {
+		composition = eom_transform_compose (priv->trans, autorotate);
 	} else if (priv->trans != NULL) {
 		composition = g_object_ref (priv->trans);
-	} else if (priv->trans_autorotate != NULL) {
-		composition = g_object_ref (priv->trans_autorotate);
+	} else if (autorotate != NULL) {
+		composition = g_object_ref (autorotate);
 	}
 
 	if (composition != NULL) {
@@ -582,6 +826,7 @@ eom_image_apply_transformations (EomImage *img, GError **error)
 static void
 eom_image_get_file_info (EomImage *img,
 			 goffset *bytes,
+			 guint64 *mtime,
 			 gchar **mime_type,
 			 GError **error)
 {
@@ -590,13 +835,18 @@ eom_image_get_file_info (EomImage *img,
 	file_info = g_file_query_info (img->priv->file,
 				       G_FILE_ATTRIBUTE_STANDARD_SIZE ","
 				       G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-				       G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
+				       G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE ","
+				       G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				       G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
 				       0, NULL, error);
 
 	if (file_info == NULL) {
 		if (bytes)
 			*bytes = 0;
 
+		if (mtime)
+			*mtime = 0;
+
 		if (mime_type)
 			*mime_type = NULL;
 
@@ -608,6 +858,13 @@ eom_image_get_file_info (EomImage *img,
 		if (bytes)
 			*bytes = g_file_info_get_size (file_info);
 
+		if (mtime) {
+			*mtime = g_file_info_get_attribute_uint64 (file_info,
+								   G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+				 g_file_info_get_attribute_uint32 (file_info,
+								   G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+		}
+
 		if (mime_type) {
 			*mime_type = g_strdup (eom_util_get_content_type_with_fallback (file_info));
 		}
@@ -616,13 +873,254 @@ eom_image_get_file_info (EomImage *img,
 }
 
 #if defined(HAVE_LCMS) && defined(GDK_WINDOWING_X11)
+/* Most transforms needed are the same for many images, so they
+ * are shared, keyed by both profiles and the pixel format */
+#define EOM_IMAGE_TRANSFORM_CACHE_SIZE 16
+
+/* Pixels below which splitting the work over threads isn't worth it */
+#define EOM_IMAGE_TRANSFORM_BAND_PIXELS (256 * 1024)
+
+typedef struct {
+	cmsHTRANSFORM transform;
+	gint ref_count;
+} EomImageTransform;
+
+typedef struct {
+	cmsHTRANSFORM transform;
+	guchar *pixels;
+	gint width;
+	gint rows;
+	gint stride;
+	gint *pending;
+	GMutex *mutex;
+	GCond *cond;
+} EomImageTransformBand;
+
+static GMutex transform_cache_mutex;
+static GHashTable *transform_cache = NULL;
+static GThreadPool *transform_pool = NULL;
+
+static void
+eom_image_transform_unref (EomImageTransform *transform)
+{
+	if (g_atomic_int_dec_and_test (&transform->ref_count)) {
+		cmsDeleteTransform (transform->transform);
+		g_slice_free (EomImageTransform, transform);
+	}
+}
+
+/* Profiles don't need to carry their ID. Computing it writes to the
+ * profile, so it is done by whoever creates the profile, before
+ * other threads can get to it. */
+static void
+eom_image_profile_compute_id (cmsHPROFILE profile)
+{
+	if (profile != NULL)
+		cmsMD5computeID (profile);
+}
+
+static gboolean
+eom_image_profile_append_id (GString *key, cmsHPROFILE profile)
+{
+	static const cmsUInt8Number no_id[16] = { 0 };
+	cmsUInt8Number id[16];
+	guint i;
+
+	cmsGetHeaderProfileID (profile, id);
+
+	if (memcmp (id, no_id, sizeof (id)) == 0)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS (id); i++)
+		g_string_append_printf (key, "%02x", id[i]);
+
+	return TRUE;
+}
+
+static EomImageTransform *
+eom_image_transform_new (cmsHPROFILE      source,
+			 cmsHPROFILE      screen,
+			 cmsUInt32Number  color_type)
+{
+	EomImageTransform *transform;
+	cmsHTRANSFORM handle;
+
+	/* Without the one pixel cache, transforms can
+	 * be used from several threads at once */
+	handle = cmsCreateTransform (source, color_type,
+				     screen, color_type,
+				     INTENT_PERCEPTUAL,
+				     cmsFLAGS_NOCACHE);
+
+	if (handle == NULL)
+		return NULL;
+
+	transform = g_slice_new (EomImageTransform);
+	transform->transform = handle;
+	transform->ref_count = 1;
+
+	return transform;
+}
+
+/* Profiles are only read here, as they may be shared with other threads */
+static EomImageTransform *
+eom_image_lookup_transform (cmsHPROFILE      source,
+			    cmsHPROFILE      screen,
+			    cmsUInt32Number  color_type)
+{
+	EomImageTransform *transform;
+	GString *key;
+	gboolean has_ids;
+
+	key = g_string_new (NULL);
+	has_ids = eom_image_profile_append_id (key, source);
+	g_string_append_c (key, ':');
+	has_ids = eom_image_profile_append_id (key, screen) && has_ids;
+	g_string_append_printf (key, ":%x", color_type);
+
+	/* Nothing tells such profiles apart, so don't share the transform */
+	if (!has_ids) {
+		eom_debug_message (DEBUG_LCMS, "Profile without ID, not caching its transform");
+		g_string_free (key, TRUE);
+
+		return eom_image_transform_new (source, screen, color_type);
+	}
+
+	g_mutex_lock (&transform_cache_mutex);
+
+	if (transform_cache == NULL)
+		transform_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							 (GDestroyNotify) eom_image_transform_unref);
+
+	transform = g_hash_table_lookup (transform_cache, key->str);
+
+	if (transform == NULL) {
+		transform = eom_image_transform_new (source, screen, color_type);
+
+		if (transform != NULL) {
+			eom_debug_message (DEBUG_LCMS, "Created transform %s", key->str);
+
+			if (g_hash_table_size (transform_cache) >= EOM_IMAGE_TRANSFORM_CACHE_SIZE)
+				g_hash_table_remove_all (transform_cache);
+
+			g_hash_table_insert (transform_cache,
+					     g_string_free (key, FALSE),
+					     transform);
+			key = NULL;
+		}
+	}
+
+	if (transform != NULL)
+		g_atomic_int_inc (&transform->ref_count);
+
+	g_mutex_unlock (&transform_cache_mutex);
+
+	if (key != NULL)
+		g_string_free (key, TRUE);
+
+	return transform;
+}
+
+static void
+eom_image_transform_rows (cmsHTRANSFORM transform, guchar *p,
+			  gint width, gint rows, gint stride)
+{
+	gint row;
+
+	for (row = 0; row < rows; ++row) {
+		cmsDoTransform (transform, p, p, width);
+		p += stride;
+	}
+}
+
+static void
+eom_image_transform_band_run (gpointer data, gpointer user_data)
+{
+	EomImageTransformBand *band = data;
+
+	eom_image_transform_rows (band->transform, band->pixels,
+				  band->width, band->rows, band->stride);
+
+	g_mutex_lock (band->mutex);
+	if (--(*band->pending) == 0)
+		g_cond_signal (band->cond);
+	g_mutex_unlock (band->mutex);
+
+	g_slice_free (EomImageTransformBand, band);
+}
+
+/* Transforms @pixbuf in place, splitting big images in bands of
+ * rows transformed in parallel, and waits for all of them */
+static void
+eom_image_do_transform (EomImageTransform *transform, GdkPixbuf *pixbuf)
+{
+	gint width, rows, stride;
+	gint n_bands, band_rows, row;
+	gint pending;
+	GMutex mutex;
+	GCond cond;
+	guchar *p;
+
+	rows = gdk_pixbuf_get_height (pixbuf);
+	width = gdk_pixbuf_get_width (pixbuf);
+	stride = gdk_pixbuf_get_rowstride (pixbuf);
+	p = gdk_pixbuf_get_pixels (pixbuf);
+
+	n_bands = MIN ((gint) g_get_num_processors (),
+		       (gint64) width * rows / EOM_IMAGE_TRANSFORM_BAND_PIXELS);
+
+	if (n_bands <= 1) {
+		eom_image_transform_rows (transform->transform, p,
+					  width, rows, stride);
+		return;
+	}
+
+	g_mutex_lock (&transform_cache_mutex);
+	if (transform_pool == NULL)
+		transform_pool = g_thread_pool_new (eom_image_transform_band_run, NULL,
+						    g_get_num_processors (),
+						    FALSE, NULL);
+	g_mutex_unlock (&transform_cache_mutex);
+
+	g_mutex_init (&mutex);
+	g_cond_init (&cond);
+
+	band_rows = (rows + n_bands - 1) / n_bands;
+	pending = 0;
+
+	g_mutex_lock (&mutex);
+
+	for (row = 0; row < rows; row += band_rows) {
+		EomImageTransformBand *band = g_slice_new (EomImageTransformBand);
+
+		band->transform = transform->transform;
+		band->pixels = p + (gsize) row * stride;
+		band->width = width;
+		band->rows = MIN (band_rows, rows - row);
+		band->stride = stride;
+		band->pending = &pending;
+		band->mutex = &mutex;
+		band->cond = &cond;
+
+		pending++;
+		g_thread_pool_push (transform_pool, band, NULL);
+	}
+
+	while (pending > 0)
+		g_cond_wait (&cond, &mutex);
+
+	g_mutex_unlock (&mutex);
+
+	g_mutex_clear (&mutex);
+	g_cond_clear (&cond);
+}
+
 void
 eom_image_apply_display_profile (EomImage *img, cmsHPROFILE screen)
 {
 	EomImagePrivate *priv;
-	cmsHTRANSFORM transform;
-	gint row, width, rows, stride;
-	guchar *p;
+	EomImageTransform *transform;
+	gint64 start;
 
 	g_return_if_fail (img != NULL);
 
@@ -650,6 +1148,7 @@ eom_image_apply_display_profile (EomImage *img, cmsHPROFILE screen)
 				priv->profile =
 					cmsOpenProfileFromMem(profile_data,
 					                      profile_size);
+				eom_image_profile_compute_id (priv->profile);
 				g_free(profile_data);
 			}
 		}
@@ -659,6 +1158,7 @@ eom_image_apply_display_profile (EomImage *img, cmsHPROFILE screen)
 			eom_debug_message (DEBUG_LCMS, "Image has no ICC profile. "
 					   "Assuming sRGB.");
 			priv->profile = cmsCreate_sRGBProfile ();
+			eom_image_profile_compute_id (priv->profile);
 		}
 	}
 
@@ -674,25 +1174,17 @@ eom_image_apply_display_profile (EomImage *img, cmsHPROFILE screen)
 	if (gdk_pixbuf_get_has_alpha (priv->image))
 		color_type = TYPE_RGBA_8;
 
-	transform = cmsCreateTransform (priv->profile,
-	                                color_type,
-	                                screen,
-	                                color_type,
-	                                INTENT_PERCEPTUAL,
-	                                0);
+	start = eom_trace_now ();
+
+	transform = eom_image_lookup_transform (priv->profile, screen, color_type);
 
 	if (G_LIKELY (transform != NULL)) {
-		rows = gdk_pixbuf_get_height (priv->image);
-		width = gdk_pixbuf_get_width (priv->image);
-		stride = gdk_pixbuf_get_rowstride (priv->image);
-		p = gdk_pixbuf_get_pixels (priv->image);
-
-		for (row = 0; row < rows; ++row) {
-			cmsDoTransform (transform, p, p, width);
-			p += stride;
-		}
-		cmsDeleteTransform (transform);
+		eom_image_do_transform (transform, priv->image);
+		eom_image_transform_unref (transform);
+		priv->display_corrected = TRUE;
 	}
+
+	eom_trace_complete ("image", "color-transform", start, NULL);
 }
 
 static void
@@ -701,6 +1193,7 @@ eom_image_set_icc_data (EomImage *img, EomMetadataReader *md_reader)
 	EomImagePrivate *priv = img->priv;
 
 	priv->profile = eom_metadata_reader_get_icc_profile (md_reader);
+	eom_image_profile_compute_id (priv->profile);
 
 }
 #endif
@@ -751,6 +1244,21 @@ eom_image_set_orientation (EomImage *img)
 		}
 	}
 
+	eom_image_orient_size (img);
+}
+
+/*
+ * Swaps the size of @img if its orientation transposes it, unless that
+ * was already done for the size currently set.
+ */
+void
+eom_image_orient_size (EomImage *img)
+{
+	EomImagePrivate *priv = img->priv;
+
+	if (priv->size_oriented || priv->width < 0 || priv->height < 0)
+		return;
+
 	if (priv->orientation > 4 &&
 	    priv->orientation < 9) {
 		gint tmp;
@@ -759,10 +1267,12 @@ eom_image_set_orientation (EomImage *img)
 		priv->width = priv->height;
 		priv->height = tmp;
 	}
+
+	priv->size_oriented = TRUE;
 }
 
-static void
-eom_image_real_autorotate (EomImage *img)
+static EomTransformType
+eom_image_get_orientation_transform_type (gint orientation)
 {
 	static const EomTransformType lookup[8] = {EOM_TRANSFORM_NONE,
 					     EOM_TRANSFORM_FLIP_HORIZONTAL,
@@ -772,6 +1282,14 @@ eom_image_real_autorotate (EomImage *img)
 					     EOM_TRANSFORM_ROT_90,
 					     EOM_TRANSFORM_TRANSVERSE,
 					     EOM_TRANSFORM_ROT_270};
+
+	return (orientation >= 1 && orientation <= 8 ?
+		lookup[orientation - 1] : EOM_TRANSFORM_NONE);
+}
+
+static void
+eom_image_real_autorotate (EomImage *img)
+{
 	EomImagePrivate *priv;
 	EomTransformType type;
 
@@ -779,8 +1297,7 @@ eom_image_real_autorotate (EomImage *img)
 
 	priv = img->priv;
 
-	type = (priv->orientation >= 1 && priv->orientation <= 8 ?
-		lookup[priv->orientation - 1] : EOM_TRANSFORM_NONE);
+	type = eom_image_get_orientation_transform_type (priv->orientation);
 
 	if (type != EOM_TRANSFORM_NONE) {
 		img->priv->trans_autorotate = eom_transform_new (type);
@@ -788,6 +1305,7 @@ eom_image_real_autorotate (EomImage *img)
 
 	/* Disable auto orientation for next loads */
 	priv->autorotate = FALSE;
+	priv->orientation_checked = TRUE;
 }
 
 void
@@ -836,8 +1354,9 @@ eom_image_set_exif_data (EomImage *img, EomMetadataReader *md_reader)
 	priv->exif_chunk = NULL;
 	priv->exif_chunk_len = 0;
 
-	/* EXIF data is already available, set the image orientation */
-	if (priv->autorotate) {
+	/* EXIF data is already available, set the image orientation
+	 * unless the header already provided it */
+	if (priv->autorotate && !priv->size_oriented) {
 		eom_image_set_orientation (img);
 
 		/* Emit size prepared signal if we have the size */
@@ -876,6 +1395,44 @@ eom_image_get_dimension_from_thumbnail (EomImage *image,
 	return (*width || *height);
 }
 
+/* Looks the pixels up in the pixel cache, only taking them if they
+ * are oriented the way this load would orient the decoded ones */
+static GdkPixbuf *
+eom_image_pixel_cache_lookup (EomImage *img, const gchar *key, gchar **file_type)
+{
+	EomImagePrivate *priv = img->priv;
+	EomTransformType type;
+	GdkPixbuf *pixbuf;
+	gint orientation = 0;
+
+	pixbuf = eom_pixel_cache_lookup (key, &orientation, file_type);
+
+	if (pixbuf == NULL)
+		return NULL;
+
+	if (priv->autorotate) {
+		/* Take the orientation from the entry, as the
+		 * metadata is read past the point it is set */
+		if (orientation != 0) {
+			priv->orientation = orientation;
+			return pixbuf;
+		}
+	} else {
+		type = (priv->trans_autorotate != NULL ?
+			eom_transform_get_transform_type (priv->trans_autorotate) :
+			EOM_TRANSFORM_NONE);
+
+		if (eom_image_get_orientation_transform_type (orientation) == type)
+			return pixbuf;
+	}
+
+	g_object_unref (pixbuf);
+	g_free (*file_type);
+	*file_type = NULL;
+
+	return NULL;
+}
+
 static gboolean
 eom_image_real_load (EomImage *img,
 		     guint     data2read,
@@ -890,6 +1447,7 @@ eom_image_real_load (EomImage *img,
 	GdkPixbufLoader *loader = NULL;
 	guchar *buffer;
 	goffset bytes_read, bytes_read_total = 0;
+	gint64 load_start, read_start, read_time = 0;
 	gboolean failed = FALSE;
 	gboolean first_run = TRUE;
 	gboolean set_metadata = TRUE;
@@ -897,17 +1455,26 @@ eom_image_real_load (EomImage *img,
 	gboolean read_image_data = (data2read & EOM_IMAGE_DATA_IMAGE);
 	gboolean read_only_dimension = (data2read & EOM_IMAGE_DATA_DIMENSION) &&
 				  ((data2read ^ EOM_IMAGE_DATA_DIMENSION) == 0);
+	gboolean read_only_metadata =
+		(data2read & ~(EOM_IMAGE_DATA_EXIF | EOM_IMAGE_DATA_XMP)) == 0;
+	gboolean decode;
+	GdkPixbuf *cached = NULL;
+	gchar *cached_type = NULL;
+	gchar *cache_key = NULL;
+	guint64 mtime = 0;
 
 	priv = img->priv;
 
  	g_assert (!read_image_data || priv->image == NULL);
 
+	load_start = eom_trace_now ();
+
 	if (read_image_data && priv->file_type != NULL) {
 		g_free (priv->file_type);
 		priv->file_type = NULL;
 	}
 
-	eom_image_get_file_info (img, &priv->bytes, &mime_type, error);
+	eom_image_get_file_info (img, &priv->bytes, &mtime, &mime_type, error);
 
 	if (error && *error) {
 		g_free (mime_type);
@@ -925,16 +1492,48 @@ eom_image_real_load (EomImage *img,
 		if (done) {
 			priv->width = width;
 			priv->height = height;
+			priv->size_oriented = FALSE;
+
+			if (priv->autorotate && priv->orientation != 0)
+				eom_image_orient_size (img);
 
 			g_free (mime_type);
 			return TRUE;
 		}
+
+		/* Most formats store the size in the first few KB,
+		 * which saves setting up a decoder */
+		if (eom_image_header_apply (img, NULL)) {
+			g_free (mime_type);
+			return TRUE;
+		}
 	}
 
+	if (read_image_data) {
+		g_free (priv->pixel_cache_key);
+		priv->pixel_cache_key = NULL;
+
+		cache_key = eom_pixel_cache_get_key (priv->file, priv->bytes, mtime);
+		cached = eom_image_pixel_cache_lookup (img, cache_key, &cached_type);
+
+		if (cached != NULL) {
+			/* Only the metadata is left to read from the file */
+			read_only_metadata = TRUE;
+			priv->size_oriented = TRUE;
+		}
+	}
+
+	decode = ((read_image_data && cached == NULL) || read_only_dimension);
+
 	input_stream = g_file_read (priv->file, NULL, error);
 
 	if (input_stream == NULL) {
 		g_free (mime_type);
+		g_free (cache_key);
+		g_free (cached_type);
+
+		if (cached != NULL)
+			g_object_unref (cached);
 
 		if (error != NULL) {
 			g_clear_error (error);
@@ -948,7 +1547,7 @@ eom_image_real_load (EomImage *img,
 
 	buffer = g_new0 (guchar, EOM_IMAGE_READ_BUFFER_SIZE);
 
-	if (read_image_data || read_only_dimension) {
+	if (decode) {
 #ifdef HAVE_RSVG
 		if (priv->svg != NULL) {
 			g_object_unref (priv->svg);
@@ -990,10 +1589,12 @@ eom_image_real_load (EomImage *img,
 
 	while (!priv->cancel_loading) {
 		/* FIXME: make this async */
+		read_start = eom_trace_now ();
 		bytes_read = g_input_stream_read (G_INPUT_STREAM (input_stream),
 						  buffer,
 						  EOM_IMAGE_READ_BUFFER_SIZE,
 						  NULL, error);
+		read_time += eom_trace_now () - read_start;
 
 		if (bytes_read == 0) {
 			/* End of the file */
@@ -1009,7 +1610,7 @@ eom_image_real_load (EomImage *img,
 			break;
 		}
 
-		if ((read_image_data || read_only_dimension)) {
+		if (decode) {
 #ifdef HAVE_RSVG
 			if (use_rsvg) {
                             gboolean res;
@@ -1049,6 +1650,10 @@ eom_image_real_load (EomImage *img,
 				}
 
 				priv->metadata_status = EOM_IMAGE_METADATA_NOT_AVAILABLE;
+
+				/* Nothing else to read from this file */
+				if (read_only_metadata)
+					break;
 			}
 
 			first_run = FALSE;
@@ -1072,8 +1677,26 @@ eom_image_real_load (EomImage *img,
 					priv->metadata_status = EOM_IMAGE_METADATA_READY;
 				}
 
-				if (data2read == EOM_IMAGE_DATA_EXIF)
+				if (read_only_metadata)
 					break;
+			} else if (read_only_metadata &&
+				   G_IS_SEEKABLE (input_stream) &&
+				   g_seekable_can_seek (G_SEEKABLE (input_stream))) {
+				gsize skip;
+
+				/* Jump over segments the reader doesn't need
+				 * instead of reading them through the buffer */
+				skip = eom_metadata_reader_skip (md_reader);
+
+				if (skip > 0) {
+					if (!g_seekable_seek (G_SEEKABLE (input_stream),
+							      (goffset) skip,
+							      G_SEEK_CUR,
+							      NULL, NULL))
+						break;
+
+					bytes_read_total += skip;
+				}
 			}
 		}
 
@@ -1083,7 +1706,7 @@ eom_image_real_load (EomImage *img,
 		}
 	}
 
-	if (read_image_data || read_only_dimension) {
+	if (decode) {
 #ifdef HAVE_RSVG
 		if (use_rsvg) {
 			/* Ignore the error if loading failed earlier
@@ -1124,6 +1747,9 @@ eom_image_real_load (EomImage *img,
 			g_object_unref (priv->image);
 		}
 
+		if (cached != NULL) {
+			priv->image = g_object_ref (cached);
+		} else
 #ifdef HAVE_RSVG
                 if (use_rsvg) {
                     priv->image = rsvg_handle_get_pixbuf (priv->svg);
@@ -1138,20 +1764,33 @@ eom_image_real_load (EomImage *img,
 			priv->image = gdk_pixbuf_animation_get_static_image (priv->anim);
 			priv->anim = NULL;
 		} else {
-			priv->anim_iter = gdk_pixbuf_animation_get_iter (priv->anim,NULL);
+			priv->anim_time = g_get_real_time ();
+			priv->anim_iter = eom_image_anim_get_iter (priv->anim,
+								   priv->anim_time);
+			priv->anim_delay = gdk_pixbuf_animation_iter_get_delay_time (priv->anim_iter);
 			priv->image = gdk_pixbuf_animation_iter_get_pixbuf (priv->anim_iter);
 		}
 
                 }
 
 		if (G_LIKELY (priv->image != NULL)) {
-                        if (!use_rsvg)
+                        if (!use_rsvg && cached == NULL)
 			        g_object_ref (priv->image);
 
 			priv->width = gdk_pixbuf_get_width (priv->image);
 			priv->height = gdk_pixbuf_get_height (priv->image);
 
-                        if (use_rsvg) {
+			if (priv->image_bytes == 0) {
+				priv->image_bytes = gdk_pixbuf_get_byte_length (priv->image);
+				eom_stats_counter_add ("image.decoded-bytes",
+						       priv->image_bytes);
+			}
+
+                        if (cached != NULL) {
+                                format = NULL;
+                                priv->file_type = cached_type;
+                                cached_type = NULL;
+                        } else if (use_rsvg) {
                                 format = NULL;
                                 priv->file_type = g_strdup ("svg");
                         } else {
@@ -1163,10 +1802,14 @@ eom_image_real_load (EomImage *img,
 			}
 
 			priv->file_is_changed = FALSE;
+			priv->pixels_oriented = (cached != NULL);
+
+			if (cached != NULL)
+				eom_image_emit_size_prepared (img);
 
 			/* Set orientation again for safety, eg. if we don't
 			 * have Exif data or HAVE_EXIF is undefined. */
-			if (priv->autorotate) {
+			if (priv->autorotate && !priv->size_oriented) {
 				eom_image_set_orientation (img);
 				eom_image_emit_size_prepared (img);
 			}
@@ -1196,6 +1839,42 @@ eom_image_real_load (EomImage *img,
 			     _("Image loading failed."));
 	}
 
+	if (!failed && read_image_data && cached == NULL) {
+		gint64 decode_time = eom_trace_now () - load_start - read_time;
+
+		eom_stats_histogram_add ("image.decode-us", decode_time);
+		eom_stats_histogram_add ("image.read-us", read_time);
+
+		/* Keep the pixels around on disk once they are dropped,
+		 * if decoding them again would take a while */
+		if (priv->anim == NULL && !use_rsvg &&
+		    decode_time >= EOM_PIXEL_CACHE_MIN_DECODE_US) {
+			priv->pixel_cache_key = cache_key;
+			cache_key = NULL;
+		}
+	}
+
+	if (cached != NULL)
+		g_object_unref (cached);
+
+	g_free (cached_type);
+	g_free (cache_key);
+
+	if (eom_trace_enabled ()) {
+		gchar *uri = g_file_get_uri (priv->file);
+
+		/* Decoding happens incrementally between the reads */
+		eom_trace_complete ("image", "load", load_start,
+				    "\"uri\":\"%s\",\"bytes\":%" G_GOFFSET_FORMAT ","
+				    "\"read_us\":%" G_GINT64_FORMAT ","
+				    "\"decode_us\":%" G_GINT64_FORMAT ","
+				    "\"failed\":%s",
+				    uri, bytes_read_total, read_time,
+				    eom_trace_now () - load_start - read_time,
+				    failed ? "true" : "false");
+		g_free (uri);
+	}
+
 	return !failed;
 }
 
@@ -1248,6 +1927,7 @@ eom_image_load (EomImage *img, EomImageData data2read, EomJob *job, GError **err
 {
 	EomImagePrivate *priv;
 	gboolean success = FALSE;
+	gint64 transform_start;
 
 	eom_debug (DEBUG_IMAGE_LOAD);
 
@@ -1267,6 +1947,8 @@ eom_image_load (EomImage *img, EomImageData data2read, EomJob *job, GError **err
 
 	success = eom_image_real_load (img, data2read, job, error);
 
+	transform_start = eom_trace_now ();
+
 	/* Check that the metadata was loaded at least once before
 	 * trying to autorotate. Also only an imatge load job should try to
 	 * autorotate and image */
@@ -1282,6 +1964,9 @@ eom_image_load (EomImage *img, EomImageData data2read, EomJob *job, GError **err
 		success = eom_image_apply_transformations (img, error);
 	}
 
+	if (data2read & EOM_IMAGE_DATA_IMAGE)
+		eom_trace_complete ("image", "transform", transform_start, NULL);
+
 	if (success) {
 		priv->status = EOM_IMAGE_STATUS_LOADED;
 	} else {
@@ -1321,6 +2006,34 @@ eom_image_set_thumbnail (EomImage *img, GdkPixbuf *thumbnail)
 	}
 }
 
+/*
+ * An image is shown by the list store of every window that has it
+ * open, so its thumbnail is only dropped once none of them holds it
+ * any longer.
+ */
+void
+eom_image_hold_thumbnail (EomImage *img)
+{
+	g_return_if_fail (EOM_IS_IMAGE (img));
+
+	img->priv->thumbnail_holds++;
+}
+
+void
+eom_image_release_thumbnail (EomImage *img)
+{
+	EomImagePrivate *priv;
+
+	g_return_if_fail (EOM_IS_IMAGE (img));
+
+	priv = img->priv;
+
+	g_return_if_fail (priv->thumbnail_holds > 0);
+
+	if (--priv->thumbnail_holds == 0)
+		eom_image_set_thumbnail (img, NULL);
+}
+
 /**
  * eom_image_get_pixbuf:
  * @img: a #EomImage
@@ -1657,41 +2370,6 @@ eom_image_reset_modifications (EomImage *image)
 	priv->modified = FALSE;
 }
 
-static void
-eom_image_link_with_target (EomImage *image, EomImageSaveInfo *target)
-{
-	EomImagePrivate *priv;
-
-	g_return_if_fail (EOM_IS_IMAGE (image));
-	g_return_if_fail (EOM_IS_IMAGE_SAVE_INFO (target));
-
-	priv = image->priv;
-
-	/* update file location */
-	if (priv->file != NULL) {
-		g_object_unref (priv->file);
-	}
-	priv->file = g_object_ref (target->file);
-
-	/* Clear caption and caption key, these will be
-	 * updated on next eom_image_get_caption call.
-	 */
-	if (priv->caption != NULL) {
-		g_free (priv->caption);
-		priv->caption = NULL;
-	}
-	if (priv->collate_key != NULL) {
-		g_free (priv->collate_key);
-		priv->collate_key = NULL;
-	}
-
-	/* update file format */
-	if (priv->file_type != NULL) {
-		g_free (priv->file_type);
-	}
-	priv->file_type = g_strdup (target->format);
-}
-
 gboolean
 eom_image_save_by_info (EomImage *img, EomImageSaveInfo *source, GError **error)
 {
@@ -1863,10 +2541,10 @@ eom_image_save_as_by_info (EomImage *img, EomImageSaveInfo *source, EomImageSave
 		success = tmp_file_move_to_uri (img, tmp_file, target->file, target->overwrite, error);
 	}
 
-	if (success) {
-		/* update image information to new uri */
+	/* The image may be shown in other windows, so it keeps its file
+	 * and stays modified unless it was saved over that very file */
+	if (success && g_file_equal (priv->file, target->file)) {
 		eom_image_reset_modifications (img);
-		eom_image_link_with_target (img, target);
 	}
 
 	tmp_file_delete (tmp_file);
@@ -2257,39 +2935,6 @@ eom_image_is_supported_mime_type (const char *mime_type)
 	return (result != NULL);
 }
 
-static gboolean
-eom_image_iter_advance (EomImage *img)
-{
-	EomImagePrivate *priv;
- 	gboolean new_frame;
-
-	g_return_val_if_fail (EOM_IS_IMAGE (img), FALSE);
-	g_return_val_if_fail (GDK_IS_PIXBUF_ANIMATION_ITER (img->priv->anim_iter), FALSE);
-
-	priv = img->priv;
-
-	if ((new_frame = gdk_pixbuf_animation_iter_advance (img->priv->anim_iter, NULL)) == TRUE) {
-		g_mutex_lock (&priv->status_mutex);
-		g_object_unref (priv->image);
-		priv->image = gdk_pixbuf_animation_iter_get_pixbuf (priv->anim_iter);
-	 	g_object_ref (priv->image);
-		/* keep the transformation over time */
-		if (EOM_IS_TRANSFORM (priv->trans)) {
-			GdkPixbuf* transformed = eom_transform_apply (priv->trans, priv->image, NULL);
-			g_object_unref (priv->image);
-			priv->image = transformed;
-			priv->width = gdk_pixbuf_get_width (transformed);
-			priv->height = gdk_pixbuf_get_height (transformed);
-		}
-		g_mutex_unlock (&priv->status_mutex);
-		/* Emit next frame signal so we can update the display */
-		g_signal_emit (img, signals[SIGNAL_NEXT_FRAME], 0,
-			       gdk_pixbuf_animation_iter_get_delay_time (priv->anim_iter));
-	}
-
-	return new_frame;
-}
-
 /**
  * eom_image_is_animation:
  * @img: a #EomImage
@@ -2306,21 +2951,167 @@ eom_image_is_animation (EomImage *img)
 	return img->priv->anim != NULL;
 }
 
+/*
+ * Frames are cached in decoding order, starting with the first one. Once
+ * the decoder wraps around to the first frame, the cache holds a whole
+ * loop, which is played back from then on without decoding anything, see
+ * eom_image_anim_advance(). Animations too big for
+ * EOM_IMAGE_ANIM_CACHE_SIZE keep being decoded frame by frame.
+ *
+ * Takes ownership of @pixbuf and returns the one to display.
+ */
+static GdkPixbuf *
+eom_image_anim_cache_frame (EomImage *img, GdkPixbuf *pixbuf, gint delay)
+{
+	EomImagePrivate *priv = img->priv;
+	EomImageFrame *frame;
+
+	if (priv->anim_cache_full)
+		return pixbuf;
+
+	if (priv->anim_frames == NULL)
+		priv->anim_frames = g_ptr_array_new_with_free_func ((GDestroyNotify) eom_image_frame_free);
+
+	priv->anim_frames_size += gdk_pixbuf_get_byte_length (pixbuf);
+
+	if (priv->anim_frames_size > EOM_IMAGE_ANIM_CACHE_SIZE) {
+		eom_debug_message (DEBUG_IMAGE_DATA, "Animation too big to be cached");
+		eom_image_anim_clear_cache (img);
+		priv->anim_cache_full = TRUE;
+		return pixbuf;
+	}
+
+	frame = g_slice_new (EomImageFrame);
+	frame->pixbuf = g_object_ref (pixbuf);
+	frame->delay = delay;
+	g_ptr_array_add (priv->anim_frames, frame);
+
+	return pixbuf;
+}
+
+/* Moves on to the next frame. Returns its delay in milliseconds,
+ * or -1 if the current frame is the last one. */
+static gint
+eom_image_anim_advance (EomImage *img)
+{
+	EomImagePrivate *priv = img->priv;
+	GdkPixbuf *pixbuf;
+	gint delay;
+
+	g_mutex_lock (&priv->status_mutex);
+
+	if (priv->anim_n_frames > 0) {
+		EomImageFrame *frame;
+
+		priv->anim_frame = (priv->anim_frame + 1) % priv->anim_n_frames;
+		frame = g_ptr_array_index (priv->anim_frames, priv->anim_frame);
+
+		pixbuf = g_object_ref (frame->pixbuf);
+		delay = frame->delay;
+	} else {
+		gboolean on_last_frame;
+
+		if (priv->anim_delay < 0) {
+			g_mutex_unlock (&priv->status_mutex);
+			return -1;
+		}
+
+		/* The whole file is loaded before the animation is played,
+		 * so the only frame the decoder reports as still loading
+		 * is its last one */
+		on_last_frame = gdk_pixbuf_animation_iter_on_currently_loading_frame (priv->anim_iter);
+
+		/* Feed the iterator the time the next frame starts at rather
+		 * than the current time, so it always moves exactly one frame */
+		priv->anim_time += (gint64) priv->anim_delay * 1000;
+		eom_image_anim_iter_advance (priv->anim_iter, priv->anim_time);
+
+		delay = gdk_pixbuf_animation_iter_get_delay_time (priv->anim_iter);
+
+		/* Moving on from the last frame means the decoder wrapped
+		 * around to the first one, where the cache starts */
+		if (on_last_frame && delay >= 0 && priv->anim_frames != NULL) {
+			EomImageFrame *frame;
+
+			priv->anim_n_frames = priv->anim_frames->len;
+			priv->anim_frame = 0;
+
+			frame = g_ptr_array_index (priv->anim_frames, 0);
+			pixbuf = g_object_ref (frame->pixbuf);
+			delay = frame->delay;
+
+			eom_debug_message (DEBUG_IMAGE_DATA, "Animation loops after %u frames",
+					   priv->anim_n_frames);
+		} else {
+			pixbuf = gdk_pixbuf_animation_iter_get_pixbuf (priv->anim_iter);
+
+			/* The iterator may draw later frames into the same pixbuf,
+			 * so we always keep a copy. Keep the transformation over time. */
+			if (EOM_IS_TRANSFORM (priv->trans))
+				pixbuf = eom_transform_apply (priv->trans, pixbuf, NULL);
+			else
+				pixbuf = gdk_pixbuf_copy (pixbuf);
+
+			pixbuf = eom_image_anim_cache_frame (img, pixbuf, delay);
+		}
+	}
+
+	g_object_unref (priv->image);
+	priv->image = pixbuf;
+	priv->width = gdk_pixbuf_get_width (pixbuf);
+	priv->height = gdk_pixbuf_get_height (pixbuf);
+	priv->anim_delay = delay;
+
+	g_mutex_unlock (&priv->status_mutex);
+
+	return delay;
+}
+
 static gboolean
-private_timeout (gpointer data)
+eom_image_anim_timeout (gpointer data)
 {
 	EomImage *img = EOM_IMAGE (data);
 	EomImagePrivate *priv = img->priv;
+	gint64 now;
+	gint delay;
+	gint skipped = 0;
 
-	if (eom_image_is_animation (img) &&
-	    !g_source_is_destroyed (g_main_current_source ()) &&
-	    priv->is_playing) {
-		while (eom_image_iter_advance (img) != TRUE) {}; /* cpu-sucking ? */
-			g_timeout_add (gdk_pixbuf_animation_iter_get_delay_time (priv->anim_iter), private_timeout, img);
-	 		return FALSE;
- 	}
-	priv->is_playing = FALSE;
-	return FALSE; /* stop playing */
+	priv->anim_source = 0;
+
+	if (!eom_image_is_animation (img) || !priv->is_playing) {
+		priv->is_playing = FALSE;
+		return G_SOURCE_REMOVE;
+	}
+
+	now = g_get_monotonic_time ();
+
+	/* Deadlines are accumulated from the previous one instead of the
+	 * current time, so timer latency doesn't add up over a long loop.
+	 * When we are late by more than a frame, drop frames to catch up. */
+	do {
+		delay = eom_image_anim_advance (img);
+		if (delay < 0)
+			break;
+
+		priv->anim_deadline += (gint64) MAX (delay, EOM_IMAGE_ANIM_MIN_DELAY) * 1000;
+	} while (priv->anim_deadline <= now && ++skipped < EOM_IMAGE_ANIM_MAX_SKIP);
+
+	/* Emit next frame signal so we can update the display */
+	g_signal_emit (img, signals[SIGNAL_NEXT_FRAME], 0, delay);
+
+	if (delay < 0) {
+		priv->is_playing = FALSE;
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Too far behind, start counting from now */
+	if (priv->anim_deadline <= now)
+		priv->anim_deadline = now + (gint64) MAX (delay, EOM_IMAGE_ANIM_MIN_DELAY) * 1000;
+
+	priv->anim_source = g_timeout_add ((priv->anim_deadline - now + 999) / 1000,
+					   eom_image_anim_timeout, img);
+
+	return G_SOURCE_REMOVE;
 }
 
 /**
@@ -2335,6 +3126,7 @@ gboolean
 eom_image_start_animation (EomImage *img)
 {
 	EomImagePrivate *priv;
+	gint delay;
 
 	g_return_val_if_fail (EOM_IS_IMAGE (img), FALSE);
 	priv = img->priv;
@@ -2343,11 +3135,39 @@ eom_image_start_animation (EomImage *img)
 		return FALSE;
 
 	g_mutex_lock (&priv->status_mutex);
-	g_object_ref (priv->anim_iter);
 	priv->is_playing = TRUE;
+
+	/* The iterator has not moved since the image was loaded, so this
+	 * is the first frame, which the cache has to start with */
+	if (priv->anim_frames == NULL && !priv->anim_cache_full &&
+	    priv->anim_delay >= 0) {
+		GdkPixbuf *pixbuf;
+
+		pixbuf = gdk_pixbuf_animation_iter_get_pixbuf (priv->anim_iter);
+
+		if (EOM_IS_TRANSFORM (priv->trans))
+			pixbuf = eom_transform_apply (priv->trans, pixbuf, NULL);
+		else
+			pixbuf = gdk_pixbuf_copy (pixbuf);
+
+		pixbuf = eom_image_anim_cache_frame (img, pixbuf, priv->anim_delay);
+
+		g_object_unref (priv->image);
+		priv->image = pixbuf;
+	}
+
+	delay = priv->anim_delay;
 	g_mutex_unlock (&priv->status_mutex);
 
- 	g_timeout_add (gdk_pixbuf_animation_iter_get_delay_time (priv->anim_iter), private_timeout, img);
+	if (delay < 0) {
+		priv->is_playing = FALSE;
+		return FALSE;
+	}
+
+	priv->anim_deadline = g_get_monotonic_time ()
+		+ (gint64) MAX (delay, EOM_IMAGE_ANIM_MIN_DELAY) * 1000;
+	priv->anim_source = g_timeout_add (MAX (delay, EOM_IMAGE_ANIM_MIN_DELAY),
+					   eom_image_anim_timeout, img);
 
 	return TRUE;
 }
@@ -2369,6 +3189,23 @@ eom_image_get_svg (EomImage *img)
 	return img->priv->svg;
 }
 
+/* Renders @svg, as returned by eom_image_get_svg(), to @cr. SVGs are
+ * also rendered from a worker thread by the image view, and a handle
+ * can't render from several threads at once, so all rendering goes
+ * through here. Callers on other threads must hold a reference on @svg,
+ * as the image drops its own when it is unloaded. */
+void
+eom_image_render_svg (RsvgHandle *svg, cairo_t *cr)
+{
+	static GMutex render_mutex;
+
+	g_return_if_fail (RSVG_IS_HANDLE (svg));
+
+	g_mutex_lock (&render_mutex);
+	rsvg_handle_render_cairo (svg, cr);
+	g_mutex_unlock (&render_mutex);
+}
+
 #endif
 
 /**
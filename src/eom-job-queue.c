@@ -24,8 +24,12 @@
 
 #include "eom-jobs.h"
 #include "eom-job-queue.h"
+#include "eom-image.h"
+#include "eom-debug.h"
+#include "eom-stats.h"
 
 static GCond  render_cond;
+static GCond  trash_cond;
 static GMutex eom_queue_mutex;
 
 static GQueue *thumbnail_queue = NULL;
@@ -34,6 +38,65 @@ static GQueue *model_queue = NULL;
 static GQueue *transform_queue = NULL;
 static GQueue *save_queue = NULL;
 static GQueue *copy_queue = NULL;
+static GQueue *trash_queue = NULL;
+static GQueue *crop_queue = NULL;
+
+/* Jobs run to completion but not yet notified in the main loop,
+ * along with the idle source draining them */
+static GMutex finished_mutex;
+static GQueue finished_queue = G_QUEUE_INIT;
+static guint finished_source_id = 0;
+
+/* Main loop time in microseconds a single drain of the finished
+ * jobs may take, so a burst of completions gets spread over several
+ * iterations instead of holding up input handling and redraws */
+#define FINISHED_TIME_BUDGET 4000
+
+static EomImage *
+get_job_image (EomJob *job)
+{
+	if (EOM_IS_JOB_THUMBNAIL (job))
+		return EOM_JOB_THUMBNAIL (job)->image;
+	else if (EOM_IS_JOB_LOAD (job))
+		return EOM_JOB_LOAD (job)->image;
+
+	return NULL;
+}
+
+static void
+trace_job_queued (EomJob *job)
+{
+	EomImage *image;
+	gchar *uri = NULL;
+
+	if (!eom_trace_enabled ())
+		return;
+
+	image = get_job_image (job);
+
+	if (image != NULL) {
+		GFile *file = eom_image_get_file (image);
+
+		uri = g_file_get_uri (file);
+		g_object_unref (file);
+	}
+
+	/* URIs are escaped and therefore safe to embed in JSON */
+	eom_trace_event ("job", G_OBJECT_TYPE_NAME (job), 'b', job,
+			 "\"uri\":\"%s\"", uri ? uri : "");
+
+	g_free (uri);
+}
+
+static void
+stats_job_add (const gchar *counter, EomJob *job, gint64 delta)
+{
+	gchar *name;
+
+	name = g_strconcat (counter, G_OBJECT_TYPE_NAME (job), NULL);
+	eom_stats_counter_add (name, delta);
+	g_free (name);
+}
 
 static gboolean
 remove_job_from_queue (GQueue *queue, EomJob *job)
@@ -43,6 +106,10 @@ remove_job_from_queue (GQueue *queue, EomJob *job)
 	list = g_queue_find (queue, job);
 
 	if (list) {
+		eom_trace_event ("job", G_OBJECT_TYPE_NAME (job), 'e', job,
+				 "\"cancelled\":true");
+		stats_job_add ("jobs.queued.", job, -1);
+
 		g_object_unref (G_OBJECT (job));
 		g_queue_delete_link (queue, list);
 
@@ -55,31 +122,90 @@ remove_job_from_queue (GQueue *queue, EomJob *job)
 static void
 add_job_to_queue_locked (GQueue *queue, EomJob  *job)
 {
+	trace_job_queued (job);
+	stats_job_add ("jobs.queued.", job, 1);
+
 	g_object_ref (job);
 	g_queue_push_tail (queue, job);
-	g_cond_broadcast (&render_cond);
+	g_cond_broadcast (queue == trash_queue ? &trash_cond : &render_cond);
 }
 
 static gboolean
 notify_finished (GObject *job)
 {
+	eom_trace_event ("job", G_OBJECT_TYPE_NAME (job), 'e', job,
+			 "\"cancelled\":false,\"failed\":%s",
+			 EOM_JOB (job)->error != NULL ? "true" : "false");
+
+	stats_job_add ("jobs.finished.", EOM_JOB (job), 1);
+
 	eom_job_finished (EOM_JOB (job));
 
 	return FALSE;
 }
 
+static gboolean
+notify_finished_jobs (gpointer user_data)
+{
+	gint64 start, deadline;
+	EomJob *job;
+	gint n_jobs = 0;
+
+	start = eom_trace_now ();
+	deadline = g_get_monotonic_time () + FINISHED_TIME_BUDGET;
+
+	do {
+		g_mutex_lock (&finished_mutex);
+
+		job = g_queue_pop_head (&finished_queue);
+
+		if (job == NULL)
+			finished_source_id = 0;
+
+		g_mutex_unlock (&finished_mutex);
+
+		if (job == NULL)
+			break;
+
+		notify_finished (G_OBJECT (job));
+		g_object_unref (job);
+
+		n_jobs++;
+	} while (g_get_monotonic_time () < deadline);
+
+	eom_stats_histogram_add ("jobs.finished-per-dispatch", n_jobs);
+	eom_trace_complete ("job", "notify-finished", start,
+			    "\"jobs\":%d", n_jobs);
+
+	/* Keep the source only if the budget ran out */
+	return (job != NULL);
+}
+
 static void
 handle_job (EomJob *job)
 {
 	g_object_ref (G_OBJECT (job));
 
+	eom_trace_event ("job", "run", 'b', job, NULL);
+
 	// Do the EOM_JOB cast for safety
 	eom_job_run (EOM_JOB (job));
 
-	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-			 (GSourceFunc) notify_finished,
-			 job,
-			 g_object_unref);
+	eom_trace_event ("job", "run", 'e', job, NULL);
+
+	/* Completions are delivered in batches by a single idle
+	 * source rather than with one dispatch per job */
+	g_mutex_lock (&finished_mutex);
+
+	g_queue_push_tail (&finished_queue, job);
+
+	if (finished_source_id == 0) {
+		finished_source_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+						      notify_finished_jobs,
+						      NULL, NULL);
+	}
+
+	g_mutex_unlock (&finished_mutex);
 }
 
 static gboolean
@@ -90,7 +216,8 @@ no_jobs_available_unlocked (void)
 		g_queue_is_empty (thumbnail_queue) &&
 		g_queue_is_empty (model_queue) &&
 		g_queue_is_empty (save_queue) &&
-		g_queue_is_empty (copy_queue);
+		g_queue_is_empty (copy_queue) &&
+		g_queue_is_empty (crop_queue);
 }
 
 static EomJob *
@@ -122,6 +249,10 @@ search_for_jobs_unlocked (void)
 	if (job)
 		return job;
 
+	job = (EomJob *) g_queue_pop_head (crop_queue);
+	if (job)
+		return job;
+
 	return NULL;
 }
 
@@ -143,6 +274,7 @@ eom_render_thread (gpointer data)
 
 		/* Now that we have our job, we handle it */
 		if (job) {
+			stats_job_add ("jobs.queued.", job, -1);
 			handle_job (job);
 			g_object_unref (G_OBJECT (job));
 		}
@@ -151,10 +283,37 @@ eom_render_thread (gpointer data)
 
 }
 
+/* Trashing waits for every file, which can take long on slow mounts,
+ * so trash jobs get a thread of their own and don't hold up loading
+ * and thumbnailing in the meantime */
+static gpointer
+eom_trash_thread (gpointer data)
+{
+	while (TRUE) {
+		EomJob *job;
+
+		g_mutex_lock (&eom_queue_mutex);
+
+		while (g_queue_is_empty (trash_queue)) {
+			g_cond_wait (&trash_cond, &eom_queue_mutex);
+		}
+
+		job = (EomJob *) g_queue_pop_head (trash_queue);
+
+		g_mutex_unlock (&eom_queue_mutex);
+
+		stats_job_add ("jobs.queued.", job, -1);
+		handle_job (job);
+		g_object_unref (G_OBJECT (job));
+	}
+	return NULL;
+}
+
 void
 eom_job_queue_init (void)
 {
 	g_cond_init (&render_cond);
+	g_cond_init (&trash_cond);
 	g_mutex_init (&eom_queue_mutex);
 
 	thumbnail_queue = g_queue_new ();
@@ -163,8 +322,11 @@ eom_job_queue_init (void)
 	transform_queue = g_queue_new ();
 	save_queue = g_queue_new ();
 	copy_queue = g_queue_new ();
+	trash_queue = g_queue_new ();
+	crop_queue = g_queue_new ();
 
 	g_thread_new ("EomJobQueue", eom_render_thread, NULL);
+	g_thread_new ("EomTrashQueue", eom_trash_thread, NULL);
 }
 
 static GQueue *
@@ -182,6 +344,10 @@ find_queue (EomJob *job)
 		return save_queue;
 	} else if (EOM_IS_JOB_COPY (job)) {
 		return copy_queue;
+	} else if (EOM_IS_JOB_TRASH (job)) {
+		return trash_queue;
+	} else if (EOM_IS_JOB_CROP (job)) {
+		return crop_queue;
 	}
 
 	g_assert_not_reached ();
@@ -226,6 +392,10 @@ eom_job_queue_remove_job (EomJob *job)
 		retval = remove_job_from_queue (save_queue, job);
 	} else if (EOM_IS_JOB_COPY (job)) {
 		retval = remove_job_from_queue (copy_queue, job);
+	} else if (EOM_IS_JOB_TRASH (job)) {
+		retval = remove_job_from_queue (trash_queue, job);
+	} else if (EOM_IS_JOB_CROP (job)) {
+		retval = remove_job_from_queue (crop_queue, job);
 	} else {
 		g_assert_not_reached ();
 	}
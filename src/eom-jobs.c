@@ -22,6 +22,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "eom-uri-converter.h"
 #include "eom-jobs.h"
 #include "eom-job-queue.h"
@@ -31,8 +35,14 @@
 #include "eom-thumbnail.h"
 #include "eom-pixbuf-util.h"
 #include "eom-util.h"
+#ifdef HAVE_JPEG
+#include "eom-image-jpeg.h"
+#endif
 
+#include <string.h>
+#include <math.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib/gi18n.h>
 
 G_DEFINE_TYPE (EomJob, eom_job, G_TYPE_OBJECT);
 G_DEFINE_TYPE (EomJobThumbnail, eom_job_thumbnail, EOM_TYPE_JOB);
@@ -42,6 +52,8 @@ G_DEFINE_TYPE (EomJobTransform, eom_job_transform, EOM_TYPE_JOB);
 G_DEFINE_TYPE (EomJobSave, eom_job_save, EOM_TYPE_JOB);
 G_DEFINE_TYPE (EomJobSaveAs, eom_job_save_as, EOM_TYPE_JOB_SAVE);
 G_DEFINE_TYPE (EomJobCopy, eom_job_copy, EOM_TYPE_JOB);
+G_DEFINE_TYPE (EomJobTrash, eom_job_trash, EOM_TYPE_JOB);
+G_DEFINE_TYPE (EomJobCrop, eom_job_crop, EOM_TYPE_JOB);
 
 enum
 {
@@ -59,6 +71,8 @@ static void eom_job_save_run      (EomJob *job);
 static void eom_job_save_as_run   (EomJob *job);
 static void eom_job_thumbnail_run (EomJob *ejob);
 static void eom_job_transform_run (EomJob *ejob);
+static void eom_job_trash_run     (EomJob *ejob);
+static void eom_job_crop_run      (EomJob *ejob);
 
 static void eom_job_init (EomJob *job)
 {
@@ -174,7 +188,9 @@ eom_job_set_progress (EomJob *job, float progress)
 	job->progress = progress;
 	g_mutex_unlock (job->mutex);
 
-	g_idle_add (notify_progress, job);
+	/* The job may be finished and released before this runs */
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, notify_progress,
+			 g_object_ref (job), g_object_unref);
 }
 
 static void eom_job_thumbnail_init (EomJobThumbnail *job) { /* Do Nothing */ }
@@ -253,10 +269,10 @@ eom_job_thumbnail_run (EomJob *ejob)
 	orig_width = g_strdup (gdk_pixbuf_get_option (job->thumbnail, "tEXt::Thumb::Image::Width"));
 	orig_height = g_strdup (gdk_pixbuf_get_option (job->thumbnail, "tEXt::Thumb::Image::Height"));
 
+	/* The frame is drawn by the gallery, see eom-thumb-atlas.c */
 	pixbuf = eom_thumbnail_fit_to_size (job->thumbnail, EOM_LIST_STORE_THUMB_SIZE);
 	g_object_unref (job->thumbnail);
-	job->thumbnail = eom_thumbnail_add_frame (pixbuf);
-	g_object_unref (pixbuf);
+	job->thumbnail = pixbuf;
 
 	if (orig_width) {
 		sscanf (orig_width, "%i", &width);
@@ -343,9 +359,26 @@ eom_job_load_run (EomJob *job)
 
 static void eom_job_model_init (EomJobModel *job) { /* Do Nothing */ }
 
+static void
+eom_job_model_dispose (GObject *object)
+{
+	EomJobModel *job;
+
+	job = EOM_JOB_MODEL (object);
+
+	if (job->initial_image) {
+		g_object_unref (job->initial_image);
+		job->initial_image = NULL;
+	}
+
+	(* G_OBJECT_CLASS (eom_job_model_parent_class)->dispose) (object);
+}
+
 static void
 eom_job_model_class_init (EomJobModelClass *class)
 {
+	G_OBJECT_CLASS (class)->dispose = eom_job_model_dispose;
+
 	EOM_JOB_CLASS (class)->run = eom_job_model_run;
 }
 
@@ -442,6 +475,20 @@ eom_job_model_run (EomJob *ejob)
 	filter_files (job->file_list, &filtered_list, &error_list);
 
 	job->store = EOM_LIST_STORE (eom_list_store_new ());
+	eom_list_store_set_autorotate (job->store, job->autorotate);
+
+	/* Keep the image the window is already loading, if the file
+	 * it was created for survived the filtering */
+	if (job->initial_image != NULL &&
+	    filtered_list != NULL && filtered_list->next == NULL) {
+		GFile *file = eom_image_get_file (job->initial_image);
+
+		if (g_file_equal (file, filtered_list->data))
+			eom_list_store_set_initial_image (job->store,
+							  job->initial_image);
+
+		g_object_unref (file);
+	}
 
 	eom_list_store_add_files (job->store, filtered_list, job->preserve_order);
 
@@ -696,6 +743,11 @@ static void eom_job_save_as_dispose (GObject *object)
 		job->file = NULL;
 	}
 
+	if (job->saved_images != NULL) {
+		g_list_free_full (job->saved_images, g_object_unref);
+		job->saved_images = NULL;
+	}
+
 	(* G_OBJECT_CLASS (eom_job_save_as_parent_class)->dispose) (object);
 }
 
@@ -825,6 +877,12 @@ eom_job_save_as_run (EomJob *ejob)
 						     dest_info,
 						     &ejob->error);
 
+		/* @image keeps its file, so hand the window the image
+		 * of the new one to put in its place */
+		if (success)
+			saveas_job->saved_images = g_list_prepend (saveas_job->saved_images,
+								   eom_image_new_file (dest_info->file, NULL));
+
 		if (src_info)
 			g_object_unref (src_info);
 
@@ -840,6 +898,8 @@ eom_job_save_as_run (EomJob *ejob)
 			break;
 	}
 
+	saveas_job->saved_images = g_list_reverse (saveas_job->saved_images);
+
 	ejob->finished = TRUE;
 }
 
@@ -937,3 +997,594 @@ eom_job_copy_run (EomJob *ejob)
 
 	ejob->finished = TRUE;
 }
+
+/* Files trashed or deleted at the same time, so that slow mounts
+ * don't have a batch wait for every single file in turn */
+#define TRASH_MAX_THREADS 4
+
+/* Minimum time in microseconds between progress notifications */
+#define TRASH_PROGRESS_INTERVAL (G_USEC_PER_SEC / 10)
+
+static void eom_job_trash_init (EomJobTrash *job) { /* do nothing */ }
+
+static void
+eom_job_trash_dispose (GObject *object)
+{
+	EomJobTrash *job = EOM_JOB_TRASH (object);
+
+	g_list_free_full (job->images, g_object_unref);
+	job->images = NULL;
+
+	g_list_free_full (job->processed, g_object_unref);
+	job->processed = NULL;
+
+	g_list_free_full (job->trashed, g_object_unref);
+	job->trashed = NULL;
+
+	g_list_free_full (job->failed, g_object_unref);
+	job->failed = NULL;
+
+	(* G_OBJECT_CLASS (eom_job_trash_parent_class)->dispose) (object);
+}
+
+static void
+eom_job_trash_class_init (EomJobTrashClass *class)
+{
+	G_OBJECT_CLASS (class)->dispose = eom_job_trash_dispose;
+	EOM_JOB_CLASS (class)->run = eom_job_trash_run;
+}
+
+/**
+ * eom_job_trash_new:
+ * @images: (element-type EomImage) (transfer full): a #EomImage list
+ *
+ * Creates a new #EomJob moving the files of @images to the trash, or
+ * deleting them where there is no trash. Images whose file is gone
+ * can be collected with eom_job_trash_take_processed() while the job
+ * runs. Once finished, the images moved to the trash are kept in the
+ * trashed field of the job, so that they can be restored later.
+ *
+ * Returns: A #EomJob.
+ */
+EomJob *
+eom_job_trash_new (GList *images)
+{
+	EomJobTrash *job;
+
+	job = g_object_new (EOM_TYPE_JOB_TRASH, NULL);
+
+	job->images = images;
+	job->n_images = g_list_length (images);
+
+	return EOM_JOB (job);
+}
+
+/**
+ * eom_job_trash_new_restore:
+ * @images: (element-type EomImage) (transfer full): a #EomImage list
+ *
+ * Creates a new #EomJob moving the files of @images back from the
+ * trash, undoing an earlier eom_job_trash_new() job. The images
+ * restored are collected with eom_job_trash_take_processed().
+ *
+ * Returns: A #EomJob.
+ */
+EomJob *
+eom_job_trash_new_restore (GList *images)
+{
+	EomJob *job;
+
+	job = eom_job_trash_new (images);
+	EOM_JOB_TRASH (job)->restore = TRUE;
+
+	return job;
+}
+
+/**
+ * eom_job_trash_take_processed:
+ * @job: a #EomJobTrash
+ *
+ * Gets the images @job is done with since the last call, so
+ * that they can be taken out of (or put back in) a view in
+ * batches while the job is still running.
+ *
+ * Returns: (element-type EomImage) (transfer full): a #EomImage list
+ */
+GList *
+eom_job_trash_take_processed (EomJobTrash *job)
+{
+	GList *images;
+
+	g_return_val_if_fail (EOM_IS_JOB_TRASH (job), NULL);
+
+	g_mutex_lock (EOM_JOB (job)->mutex);
+	images = g_list_reverse (job->processed);
+	job->processed = NULL;
+	g_mutex_unlock (EOM_JOB (job)->mutex);
+
+	return images;
+}
+
+/* Records the outcome for @image, called from the worker threads */
+static void
+eom_job_trash_done (EomJobTrash *job, EomImage *image,
+		    gboolean success, gboolean trashed, GError *error)
+{
+	EomJob *ejob = EOM_JOB (job);
+	gboolean notify;
+	float progress;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (ejob->mutex);
+
+	job->n_done++;
+
+	if (success) {
+		job->processed = g_list_prepend (job->processed,
+						 g_object_ref (image));
+		if (trashed)
+			job->trashed = g_list_prepend (job->trashed,
+						       g_object_ref (image));
+	} else {
+		job->failed = g_list_append (job->failed, g_object_ref (image));
+
+		/* The first error is the one reported */
+		if (ejob->error == NULL && error != NULL)
+			ejob->error = g_error_copy (error);
+	}
+
+	progress = (float) job->n_done / job->n_images;
+
+	notify = (job->n_done == job->n_images ||
+		  now - job->last_progress >= TRASH_PROGRESS_INTERVAL);
+	if (notify)
+		job->last_progress = now;
+
+	g_mutex_unlock (ejob->mutex);
+
+	if (notify)
+		eom_job_set_progress (ejob, progress);
+}
+
+static void
+eom_job_trash_file (gpointer data, gpointer user_data)
+{
+	EomImage *image = EOM_IMAGE (data);
+	EomJobTrash *job = EOM_JOB_TRASH (user_data);
+	GFileInfo *file_info;
+	GError *error = NULL;
+	gboolean can_trash = FALSE, success = FALSE;
+	GFile *file;
+
+	file = eom_image_get_file (image);
+
+	file_info = g_file_query_info (file,
+				       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
+				       0, NULL, &error);
+
+	if (file_info != NULL) {
+		can_trash = g_file_info_get_attribute_boolean (file_info,
+							       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH);
+		g_object_unref (file_info);
+
+		if (can_trash)
+			success = g_file_trash (file, NULL, &error);
+		else
+			success = g_file_delete (file, NULL, &error);
+	}
+
+	g_object_unref (file);
+
+	eom_job_trash_done (job, image, success, can_trash, error);
+
+	if (error != NULL)
+		g_error_free (error);
+}
+
+/* Moves the files of the images back to where they were trashed
+ * from. Files trashed more than once come back in their latest
+ * version. */
+static void
+eom_job_trash_restore (EomJobTrash *job)
+{
+	GFileEnumerator *enumerator;
+	GHashTable *found;
+	GFileInfo *info;
+	GFile *trash;
+	GList *it;
+
+	trash = g_file_new_for_uri ("trash:///");
+
+	found = g_hash_table_new_full (g_str_hash, g_str_equal,
+				       g_free, g_object_unref);
+
+	enumerator = g_file_enumerate_children (trash,
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_TRASH_ORIG_PATH ","
+						G_FILE_ATTRIBUTE_TRASH_DELETION_DATE,
+						G_FILE_QUERY_INFO_NONE,
+						NULL, NULL);
+
+	while (enumerator != NULL &&
+	       (info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+		const gchar *orig_path;
+		GFileInfo *other;
+
+		orig_path = g_file_info_get_attribute_byte_string (info,
+								   G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
+		other = orig_path ? g_hash_table_lookup (found, orig_path) : NULL;
+
+		/* Deletion dates are in ISO 8601, which sorts as text */
+		if (orig_path != NULL &&
+		    (other == NULL ||
+		     g_strcmp0 (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE),
+				g_file_info_get_attribute_string (other, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE)) > 0))
+			g_hash_table_replace (found, g_strdup (orig_path), info);
+		else
+			g_object_unref (info);
+	}
+
+	if (enumerator != NULL)
+		g_object_unref (enumerator);
+
+	for (it = job->images; it != NULL; it = it->next) {
+		EomImage *image = EOM_IMAGE (it->data);
+		GError *error = NULL;
+		gboolean success = FALSE;
+		GFile *file;
+		gchar *path;
+
+		file = eom_image_get_file (image);
+		path = g_file_get_path (file);
+
+		info = path ? g_hash_table_lookup (found, path) : NULL;
+
+		if (info != NULL) {
+			GFile *trashed;
+
+			trashed = g_file_get_child (trash, g_file_info_get_name (info));
+			success = g_file_move (trashed, file,
+					       G_FILE_COPY_NOFOLLOW_SYMLINKS |
+					       G_FILE_COPY_ALL_METADATA,
+					       NULL, NULL, NULL, &error);
+			g_object_unref (trashed);
+		} else {
+			gchar *name = g_file_get_parse_name (file);
+
+			g_set_error (&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+				     _("Couldn't find \"%s\" in the trash"), name);
+			g_free (name);
+		}
+
+		eom_job_trash_done (job, image, success, FALSE, error);
+
+		if (error != NULL)
+			g_error_free (error);
+
+		g_free (path);
+		g_object_unref (file);
+	}
+
+	g_hash_table_destroy (found);
+	g_object_unref (trash);
+}
+
+static void
+eom_job_trash_run (EomJob *ejob)
+{
+	EomJobTrash *job;
+	GThreadPool *pool;
+	GList *it;
+
+	g_return_if_fail (EOM_IS_JOB_TRASH (ejob));
+
+	job = EOM_JOB_TRASH (ejob);
+
+	if (job->restore) {
+		eom_job_trash_restore (job);
+	} else {
+		pool = g_thread_pool_new (eom_job_trash_file, job,
+					  TRASH_MAX_THREADS, FALSE, NULL);
+
+		for (it = job->images; it != NULL; it = it->next)
+			g_thread_pool_push (pool, it->data, NULL);
+
+		/* Wait for all of them, trash jobs have their own thread
+		 * in the job queue so nothing else is held up */
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+		job->trashed = g_list_reverse (job->trashed);
+	}
+
+	ejob->finished = TRUE;
+}
+
+static void eom_job_crop_init (EomJobCrop *job) { /* do nothing */ }
+
+static void
+eom_job_crop_dispose (GObject *object)
+{
+	EomJobCrop *job = EOM_JOB_CROP (object);
+
+	if (job->image) {
+		g_object_unref (job->image);
+		job->image = NULL;
+	}
+
+	if (job->file) {
+		g_object_unref (job->file);
+		job->file = NULL;
+	}
+
+	(* G_OBJECT_CLASS (eom_job_crop_parent_class)->dispose) (object);
+}
+
+static void
+eom_job_crop_class_init (EomJobCropClass *class)
+{
+	G_OBJECT_CLASS (class)->dispose = eom_job_crop_dispose;
+	EOM_JOB_CLASS (class)->run = eom_job_crop_run;
+}
+
+/**
+ * eom_job_crop_new:
+ * @image: a #EomImage
+ * @area: the area of @image to keep, as it is shown
+ * @file: the #GFile to save the area to
+ *
+ * Creates a new #EomJob saving @area of @image to @file, in the format
+ * matching the extension of @file. Unmodified JPEG images saved as JPEG
+ * are cropped without decoding them where the JPEG library allows it,
+ * their top left corner being moved to the closest block boundary.
+ * Otherwise, the pixels of @image are used if it is loaded, or only
+ * the part of its file covering @area is decoded where possible.
+ *
+ * Returns: A #EomJob.
+ */
+EomJob *
+eom_job_crop_new (EomImage *image, const GdkRectangle *area, GFile *file)
+{
+	EomJobCrop *job;
+
+	g_return_val_if_fail (EOM_IS_IMAGE (image), NULL);
+	g_return_val_if_fail (area != NULL, NULL);
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	job = g_object_new (EOM_TYPE_JOB_CROP, NULL);
+
+	job->image = g_object_ref (image);
+	job->area = *area;
+	job->file = g_object_ref (file);
+
+	return EOM_JOB (job);
+}
+
+static void
+transform_box (const cairo_matrix_t *matrix, GdkRectangle *box)
+{
+	double x1 = box->x, y1 = box->y;
+	double x2 = box->x + box->width, y2 = box->y + box->height;
+
+	cairo_matrix_transform_point (matrix, &x1, &y1);
+	cairo_matrix_transform_point (matrix, &x2, &y2);
+
+	box->x = (int) floor (MIN (x1, x2) + 0.5);
+	box->y = (int) floor (MIN (y1, y2) + 0.5);
+	box->width = (int) floor (fabs (x2 - x1) + 0.5);
+	box->height = (int) floor (fabs (y2 - y1) + 0.5);
+}
+
+/* Maps @area of the image as shown to the image as stored in its
+ * file, undoing the rotation from the Exif orientation, if any */
+static void
+eom_job_crop_get_source_area (EomJobCrop *job, GdkRectangle *area)
+{
+	EomTransform *trans;
+	cairo_matrix_t affine;
+	GdkRectangle bounds;
+
+	*area = job->area;
+
+	trans = eom_image_get_autorotate_transform (job->image);
+	if (trans == NULL)
+		return;
+
+	eom_transform_get_affine (trans, &affine);
+	if (cairo_matrix_invert (&affine) != CAIRO_STATUS_SUCCESS)
+		return;
+
+	bounds.x = 0;
+	bounds.y = 0;
+	eom_image_get_size (job->image, &bounds.width, &bounds.height);
+
+	/* Rotating about the origin leaves the image in negative
+	 * coordinates, which the bounds moved back to zero tell */
+	transform_box (&affine, &bounds);
+	transform_box (&affine, area);
+
+	area->x -= bounds.x;
+	area->y -= bounds.y;
+}
+
+static GdkPixbuf *
+eom_job_crop_apply_autorotate (EomJobCrop *job, GdkPixbuf *pixbuf)
+{
+	EomTransform *trans;
+	GdkPixbuf *rotated;
+
+	trans = eom_image_get_autorotate_transform (job->image);
+	if (trans == NULL || pixbuf == NULL)
+		return pixbuf;
+
+	rotated = eom_transform_apply (trans, pixbuf, NULL);
+	g_object_unref (pixbuf);
+
+	return rotated;
+}
+
+static GdkPixbuf *
+eom_job_crop_get_pixbuf (EomJobCrop *job, GdkRectangle *area, GError **error)
+{
+	GdkPixbuf *pixbuf;
+	GFile *file;
+	GFileInputStream *stream;
+
+	pixbuf = eom_image_get_pixbuf (job->image);
+	if (pixbuf != NULL)
+		return pixbuf;
+
+	/* Modified images have to be taken as they are shown */
+	if (eom_image_is_modified (job->image)) {
+		g_set_error (error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_NOT_LOADED,
+			     _("No image loaded."));
+		return NULL;
+	}
+
+#ifdef HAVE_JPEG
+	if (eom_image_is_jpeg (job->image)) {
+		GError *jpeg_error = NULL;
+
+		eom_job_crop_get_source_area (job, area);
+		pixbuf = eom_image_jpeg_decode_area (job->image, area, &jpeg_error);
+
+		if (pixbuf != NULL) {
+			pixbuf = eom_job_crop_apply_autorotate (job, pixbuf);
+
+			/* Nothing but the area was decoded */
+			area->x = 0;
+			area->y = 0;
+			area->width = gdk_pixbuf_get_width (pixbuf);
+			area->height = gdk_pixbuf_get_height (pixbuf);
+
+			return pixbuf;
+		}
+
+		*area = job->area;
+		g_clear_error (&jpeg_error);
+	}
+#endif
+
+	/* The pixbuf loaders can't tell when the rows of the area
+	 * are final, as interlaced images come in several passes,
+	 * so other formats are decoded as a whole */
+	file = eom_image_get_file (job->image);
+	stream = g_file_read (file, NULL, error);
+	g_object_unref (file);
+
+	if (stream == NULL)
+		return NULL;
+
+	pixbuf = gdk_pixbuf_new_from_stream (G_INPUT_STREAM (stream), NULL, error);
+	g_object_unref (stream);
+
+	return eom_job_crop_apply_autorotate (job, pixbuf);
+}
+
+static void
+eom_job_crop_run (EomJob *ejob)
+{
+	EomJobCrop *job;
+	GdkPixbufFormat *format = NULL;
+	GdkPixbuf *pixbuf, *region;
+	GFileOutputStream *stream;
+	GdkRectangle area, bounds;
+	gchar *basename, *suffix;
+	gchar *type;
+
+	g_return_if_fail (EOM_IS_JOB_CROP (ejob));
+
+	job = EOM_JOB_CROP (ejob);
+
+	basename = g_file_get_basename (job->file);
+	suffix = strrchr (basename, '.');
+	if (suffix != NULL)
+		format = eom_pixbuf_get_format_by_suffix (suffix + 1);
+	g_free (basename);
+
+	if (format == NULL || !gdk_pixbuf_format_is_writable (format)) {
+		g_set_error (&ejob->error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_GENERIC,
+			     _("Unsupported image file format"));
+		ejob->finished = TRUE;
+		return;
+	}
+
+	type = gdk_pixbuf_format_get_name (format);
+
+#ifdef HAVE_JPEG
+	/* Cropping the compressed data keeps the quality of the
+	 * original and takes no decoding at all */
+	if (!eom_image_is_modified (job->image) &&
+	    eom_image_is_jpeg (job->image) &&
+	    g_ascii_strcasecmp (type, EOM_FILE_FORMAT_JPEG) == 0) {
+		GFile *source = eom_image_get_file (job->image);
+		gchar *path = NULL;
+
+		/* The source is read while the file is written, so
+		 * cropping it in place has to go through the pixels */
+		if (!g_file_equal (source, job->file))
+			path = g_file_get_path (job->file);
+		g_object_unref (source);
+
+		eom_job_crop_get_source_area (job, &area);
+
+		if (path != NULL &&
+		    eom_image_jpeg_crop_file (job->image, &area, path, NULL)) {
+			g_free (path);
+			g_free (type);
+			ejob->finished = TRUE;
+			return;
+		}
+
+		g_free (path);
+	}
+#endif
+
+	area = job->area;
+	pixbuf = eom_job_crop_get_pixbuf (job, &area, &ejob->error);
+
+	if (pixbuf == NULL) {
+		g_free (type);
+		ejob->finished = TRUE;
+		return;
+	}
+
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.width = gdk_pixbuf_get_width (pixbuf);
+	bounds.height = gdk_pixbuf_get_height (pixbuf);
+
+	if (!gdk_rectangle_intersect (&area, &bounds, &area)) {
+		g_set_error (&ejob->error, EOM_IMAGE_ERROR,
+			     EOM_IMAGE_ERROR_GENERIC,
+			     _("The selected area is outside of the image"));
+		g_object_unref (pixbuf);
+		g_free (type);
+		ejob->finished = TRUE;
+		return;
+	}
+
+	region = gdk_pixbuf_new_subpixbuf (pixbuf, area.x, area.y,
+					   area.width, area.height);
+
+	stream = g_file_replace (job->file, NULL, FALSE,
+				 G_FILE_CREATE_REPLACE_DESTINATION,
+				 NULL, &ejob->error);
+
+	if (stream != NULL) {
+		if (gdk_pixbuf_save_to_stream (region, G_OUTPUT_STREAM (stream),
+					       type, NULL, &ejob->error, NULL))
+			g_output_stream_close (G_OUTPUT_STREAM (stream),
+					       NULL, &ejob->error);
+		g_object_unref (stream);
+	}
+
+	g_object_unref (region);
+	g_object_unref (pixbuf);
+	g_free (type);
+
+	ejob->finished = TRUE;
+}
@@ -73,6 +73,12 @@ typedef struct _EomJobSaveAsClass EomJobSaveAsClass;
 typedef struct _EomJobCopy EomJobCopy;
 typedef struct _EomJobCopyClass EomJobCopyClass;
 
+typedef struct _EomJobTrash EomJobTrash;
+typedef struct _EomJobTrashClass EomJobTrashClass;
+
+typedef struct _EomJobCrop EomJobCrop;
+typedef struct _EomJobCropClass EomJobCropClass;
+
 #define EOM_TYPE_JOB		       (eom_job_get_type())
 #define EOM_JOB(obj)		       (G_TYPE_CHECK_INSTANCE_CAST((obj), EOM_TYPE_JOB, EomJob))
 #define EOM_JOB_CLASS(klass)	       (G_TYPE_CHECK_CLASS_CAST((klass),  EOM_TYPE_JOB, EomJobClass))
@@ -115,6 +121,16 @@ typedef struct _EomJobCopyClass EomJobCopyClass;
 #define EOM_JOB_COPY_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass),  EOM_TYPE_JOB_COPY, EomJobCopyClass))
 #define EOM_IS_JOB_COPY(obj)      (G_TYPE_CHECK_INSTANCE_TYPE((obj), EOM_TYPE_JOB_COPY))
 
+#define EOM_TYPE_JOB_TRASH	       (eom_job_trash_get_type())
+#define EOM_JOB_TRASH(obj)	       (G_TYPE_CHECK_INSTANCE_CAST((obj), EOM_TYPE_JOB_TRASH, EomJobTrash))
+#define EOM_JOB_TRASH_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass),  EOM_TYPE_JOB_TRASH, EomJobTrashClass))
+#define EOM_IS_JOB_TRASH(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), EOM_TYPE_JOB_TRASH))
+
+#define EOM_TYPE_JOB_CROP	       (eom_job_crop_get_type())
+#define EOM_JOB_CROP(obj)	       (G_TYPE_CHECK_INSTANCE_CAST((obj), EOM_TYPE_JOB_CROP, EomJobCrop))
+#define EOM_JOB_CROP_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass),  EOM_TYPE_JOB_CROP, EomJobCropClass))
+#define EOM_IS_JOB_CROP(obj)           (G_TYPE_CHECK_INSTANCE_TYPE((obj), EOM_TYPE_JOB_CROP))
+
 struct _EomJob
 {
 	GObject  parent;
@@ -164,6 +180,8 @@ struct _EomJobModel
 	EomListStore *store;
 	GSList       *file_list;
 	gboolean      preserve_order;
+	EomImage     *initial_image;
+	gboolean      autorotate;
 };
 
 struct _EomJobModelClass
@@ -210,6 +228,7 @@ struct _EomJobSaveAs
 	EomJobSave       parent;
 	EomURIConverter *converter;
 	GFile           *file;
+	GList           *saved_images;
 };
 
 struct _EomJobSaveAsClass
@@ -230,6 +249,37 @@ struct _EomJobCopyClass
 	EomJobClass parent_class;
 };
 
+struct _EomJobTrash
+{
+	EomJob    parent;
+	GList    *images;
+	gboolean  restore;
+	guint     n_images;
+	guint     n_done;
+	GList    *processed;
+	GList    *trashed;
+	GList    *failed;
+	gint64    last_progress;
+};
+
+struct _EomJobTrashClass
+{
+	EomJobClass parent_class;
+};
+
+struct _EomJobCrop
+{
+	EomJob        parent;
+	EomImage     *image;
+	GdkRectangle  area;
+	GFile        *file;
+};
+
+struct _EomJobCropClass
+{
+	EomJobClass parent_class;
+};
+
 /* base job class */
 GType           eom_job_get_type           (void) G_GNUC_CONST;
 void            eom_job_finished           (EomJob          *job);
@@ -271,6 +321,18 @@ GType          eom_job_copy_get_type      (void) G_GNUC_CONST;
 EomJob        *eom_job_copy_new           (GList            *images,
 					   const gchar      *dest);
 
+/* EomJobTrash */
+GType           eom_job_trash_get_type     (void) G_GNUC_CONST;
+EomJob         *eom_job_trash_new          (GList           *images);
+EomJob         *eom_job_trash_new_restore  (GList           *images);
+GList          *eom_job_trash_take_processed (EomJobTrash   *job);
+
+/* EomJobCrop */
+GType           eom_job_crop_get_type      (void) G_GNUC_CONST;
+EomJob         *eom_job_crop_new           (EomImage           *image,
+					    const GdkRectangle *area,
+					    GFile              *file);
+
 G_END_DECLS
 
 #endif /* __EOM_JOBS_H__ */
@@ -24,9 +24,15 @@
 #include "eom-list-store.h"
 #include "eom-thumbnail.h"
 #include "eom-image.h"
+#include "eom-image-private.h"
+#include "eom-image-header.h"
 #include "eom-job-queue.h"
 #include "eom-jobs.h"
+#include "eom-thumb-atlas.h"
 #include "eom-util.h"
+#include "eom-stats.h"
+
+#include <cairo-gobject.h>
 
 #include <string.h>
 
@@ -37,6 +43,12 @@ struct _EomListStorePrivate {
 	GdkPixbuf *missing_image; /* Missing image icon */
 	GMutex mutex;             /* Mutex for saving the jobs in the model */
 	gboolean preserve_order;  /* If TRUE, preserves the original order of files */
+	GFile *initial_file;      /* File of the image added by eom_list_store_set_initial_image() */
+	gboolean autorotate;      /* If TRUE, images added from files are autorotated */
+	GHashTable *finished_jobs; /* Finished thumbnail jobs waiting to be applied */
+	guint finished_jobs_id;   /* Idle source applying the finished jobs */
+	GHashTable *file_index;   /* Row of each file, as a persistent GtkTreeIter */
+	GHashTable *thumbnail_holds; /* Images whose thumbnail a row shows */
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (EomListStore, eom_list_store, GTK_TYPE_LIST_STORE);
@@ -47,6 +59,12 @@ foreach_monitors_free (gpointer data, gpointer user_data)
 	g_file_monitor_cancel (G_FILE_MONITOR (data));
 }
 
+static void
+foreach_thumbnail_release (gpointer key, gpointer value, gpointer user_data)
+{
+	eom_image_release_thumbnail (EOM_IMAGE (key));
+}
+
 static void
 eom_list_store_dispose (GObject *object)
 {
@@ -59,6 +77,8 @@ eom_list_store_dispose (GObject *object)
 
 	store->priv->monitors = NULL;
 
+	g_clear_object (&store->priv->initial_file);
+
 	if(store->priv->busy_image != NULL) {
 		g_object_unref (store->priv->busy_image);
 		store->priv->busy_image = NULL;
@@ -69,6 +89,28 @@ eom_list_store_dispose (GObject *object)
 		store->priv->missing_image = NULL;
 	}
 
+	if (store->priv->finished_jobs_id != 0) {
+		g_source_remove (store->priv->finished_jobs_id);
+		store->priv->finished_jobs_id = 0;
+	}
+
+	if (store->priv->finished_jobs != NULL) {
+		g_hash_table_destroy (store->priv->finished_jobs);
+		store->priv->finished_jobs = NULL;
+	}
+
+	if (store->priv->file_index != NULL) {
+		g_hash_table_destroy (store->priv->file_index);
+		store->priv->file_index = NULL;
+	}
+
+	if (store->priv->thumbnail_holds != NULL) {
+		g_hash_table_foreach (store->priv->thumbnail_holds,
+				      foreach_thumbnail_release, NULL);
+		g_hash_table_destroy (store->priv->thumbnail_holds);
+		store->priv->thumbnail_holds = NULL;
+	}
+
 	g_mutex_clear (&store->priv->mutex);
 
 	G_OBJECT_CLASS (eom_list_store_parent_class)->dispose (object);
@@ -120,6 +162,10 @@ eom_list_store_get_icon (const gchar *icon_name)
 	GtkIconTheme *icon_theme;
 	GdkPixbuf *pixbuf;
 
+	/* There is no icon theme without a display, e.g. in eom-benchmark */
+	if (gdk_screen_get_default () == NULL)
+		return NULL;
+
 	icon_theme = gtk_icon_theme_get_default ();
 
 	pixbuf = gtk_icon_theme_load_icon (icon_theme,
@@ -145,6 +191,7 @@ eom_list_store_init (EomListStore *self)
 	types[EOM_LIST_STORE_EOM_IMAGE] = G_TYPE_OBJECT;
 	types[EOM_LIST_STORE_THUMB_SET] = G_TYPE_BOOLEAN;
 	types[EOM_LIST_STORE_EOM_JOB]   = G_TYPE_POINTER;
+	types[EOM_LIST_STORE_THUMB_SURFACE] = CAIRO_GOBJECT_TYPE_SURFACE;
 
 	gtk_list_store_set_column_types (GTK_LIST_STORE (self),
 					 EOM_LIST_STORE_NUM_COLUMNS, types);
@@ -159,6 +206,18 @@ eom_list_store_init (EomListStore *self)
 
 	g_mutex_init (&self->priv->mutex);
 
+	/* Rows are looked up by file for every selection and image
+	 * change, so avoid walking the model for each of them */
+	self->priv->file_index = g_hash_table_new_full (g_file_hash,
+							(GEqualFunc) g_file_equal,
+							g_object_unref,
+							(GDestroyNotify) gtk_tree_iter_free);
+
+	/* Other windows may show the same images, so the thumbnails
+	 * are only dropped from them once no store holds them */
+	self->priv->thumbnail_holds = g_hash_table_new (g_direct_hash,
+							g_direct_equal);
+
 	gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (self),
 						 eom_list_store_compare_func,
 						 NULL, NULL);
@@ -186,103 +245,145 @@ eom_list_store_new (void)
    then sets @iter_found to a #GtkTreeIter pointing to the file.
  */
 static gboolean
-is_file_in_list_store (EomListStore *store,
-		       const gchar *info_uri,
-		       GtkTreeIter *iter_found)
+is_file_in_list_store_file (EomListStore *store,
+			   GFile *file,
+			   GtkTreeIter *iter_found)
 {
-	gboolean found = FALSE;
-	EomImage *image;
-	GFile *file;
-	gchar *str;
-	GtkTreeIter iter;
+	GtkTreeIter *indexed;
 
-	if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter)) {
-		return FALSE;
+	/* Images keep their file for as long as they live,
+	 * so every row is found through the index */
+	indexed = g_hash_table_lookup (store->priv->file_index, file);
+
+	if (indexed != NULL && iter_found != NULL) {
+		*iter_found = *indexed;
 	}
 
-	do {
-		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
-				    EOM_LIST_STORE_EOM_IMAGE, &image,
-				    -1);
-		if (!image)
-			continue;
+	return indexed != NULL;
+}
+
+/* Shows @thumbnail in the row, packed in a thumbnail atlas
+ * so the gallery can draw it without converting it first.
+ * The pixbuf is only kept when it doesn't fit in an atlas,
+ * the image itself holds on to it otherwise. */
+static void
+eom_list_store_set_row_thumbnail (EomListStore *store,
+				  GtkTreeIter *iter,
+				  EomImage *image,
+				  GdkPixbuf *thumbnail)
+{
+	cairo_surface_t *surface;
+
+	if (g_hash_table_add (store->priv->thumbnail_holds, image))
+		eom_image_hold_thumbnail (image);
+
+	surface = eom_thumb_atlas_add (thumbnail);
+
+	gtk_list_store_set (GTK_LIST_STORE (store), iter,
+			    EOM_LIST_STORE_THUMBNAIL, surface != NULL ? NULL : thumbnail,
+			    EOM_LIST_STORE_THUMB_SURFACE, surface,
+			    EOM_LIST_STORE_THUMB_SET, TRUE,
+			    -1);
 
-		file = eom_image_get_file (image);
-		str = g_file_get_uri (file);
+	if (surface != NULL)
+		cairo_surface_destroy (surface);
+}
 
-		found = (strcmp (str, info_uri) == 0)? TRUE : FALSE;
+static void
+eom_list_store_apply_thumbnail (EomListStore *store,
+				GtkTreeIter *iter,
+				EomJobThumbnail *job)
+{
+	EomImage *image;
+	GdkPixbuf *thumbnail;
 
-		g_object_unref (file);
-		g_free (str);
-		g_object_unref (G_OBJECT (image));
+	gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
+			    EOM_LIST_STORE_EOM_IMAGE, &image,
+			    -1);
 
-	} while (!found &&
-		 gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter));
+	if (job->thumbnail) {
+		eom_image_set_thumbnail (image, job->thumbnail);
 
-	if (found && iter_found != NULL) {
-		*iter_found = iter;
+		/* Getting the thumbnail, in case it needed
+		 * transformations */
+		thumbnail = eom_image_get_thumbnail (image);
+		eom_list_store_set_row_thumbnail (store, iter, image, thumbnail);
+		g_object_unref (thumbnail);
+	} else {
+		gtk_list_store_set (GTK_LIST_STORE (store), iter,
+				    EOM_LIST_STORE_THUMBNAIL, store->priv->missing_image,
+				    EOM_LIST_STORE_THUMB_SET, TRUE,
+				    -1);
 	}
 
-	return found;
+	gtk_list_store_set (GTK_LIST_STORE (store), iter,
+			    EOM_LIST_STORE_EOM_JOB, NULL,
+			    -1);
+	g_object_unref (image);
 }
 
 static gboolean
-is_file_in_list_store_file (EomListStore *store,
-			   GFile *file,
-			   GtkTreeIter *iter_found)
+eom_list_store_apply_finished_jobs (gpointer data)
 {
-	gchar *uri_str;
-	gboolean result;
+	EomListStore *store = EOM_LIST_STORE (data);
+	GHashTable *finished = store->priv->finished_jobs;
+	GtkTreeIter iter;
+	EomJob *job;
+	gboolean valid;
+
+	store->priv->finished_jobs_id = 0;
+
+	/* A single walk over the model for all the thumbnails that
+	 * finished since the last one. Jobs no longer referenced by
+	 * their row were cancelled in the meantime and are dropped. */
+	valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter);
+
+	while (valid && g_hash_table_size (finished) > 0) {
+		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+				    EOM_LIST_STORE_EOM_JOB, &job,
+				    -1);
 
-	uri_str = g_file_get_uri (file);
+		if (job != NULL) {
+			if (g_hash_table_contains (finished, job)) {
+				eom_list_store_apply_thumbnail (store, &iter,
+								EOM_JOB_THUMBNAIL (job));
+				g_hash_table_remove (finished, job);
+			}
 
-	result = is_file_in_list_store (store, uri_str, iter_found);
+			g_object_unref (job);
+		}
 
-	g_free (uri_str);
+		valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter);
+	}
 
-	return result;
+	g_hash_table_remove_all (finished);
+
+	return FALSE;
 }
 
 static void
 eom_job_thumbnail_cb (EomJobThumbnail *job, gpointer data)
 {
 	EomListStore *store;
-	GtkTreeIter iter;
-	EomImage *image;
-	GdkPixbuf *thumbnail;
-	GFile *file;
 
 	g_return_if_fail (EOM_IS_LIST_STORE (data));
 
 	store = EOM_LIST_STORE (data);
 
-	file = eom_image_get_file (job->image);
-
-	if (is_file_in_list_store_file (store, file, &iter)) {
-		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
-				    EOM_LIST_STORE_EOM_IMAGE, &image,
-				    -1);
-
-		if (job->thumbnail) {
-			eom_image_set_thumbnail (image, job->thumbnail);
+	/* Completions arrive in batches from the job queue, so
+	 * collect them and update the rows together afterwards */
+	if (store->priv->finished_jobs == NULL) {
+		store->priv->finished_jobs =
+			g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       g_object_unref, NULL);
+	}
 
-			/* Getting the thumbnail, in case it needed
- 			 * transformations */
-			thumbnail = eom_image_get_thumbnail (image);
-		} else {
-			thumbnail = g_object_ref (store->priv->missing_image);
-		}
+	g_hash_table_add (store->priv->finished_jobs, g_object_ref (job));
 
-		gtk_list_store_set (GTK_LIST_STORE (store), &iter,
-				    EOM_LIST_STORE_THUMBNAIL, thumbnail,
-				    EOM_LIST_STORE_THUMB_SET, TRUE,
-				    EOM_LIST_STORE_EOM_JOB, NULL,
-				    -1);
-		g_object_unref (image);
-		g_object_unref (thumbnail);
+	if (store->priv->finished_jobs_id == 0) {
+		store->priv->finished_jobs_id =
+			g_idle_add (eom_list_store_apply_finished_jobs, store);
 	}
-
-	g_object_unref (file);
 }
 
 static void
@@ -311,12 +412,27 @@ static void
 eom_list_store_remove (EomListStore *store, GtkTreeIter *iter)
 {
 	EomImage *image;
+	GtkTreeIter *indexed;
+	GFile *file;
 
 	gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
 			    EOM_LIST_STORE_EOM_IMAGE, &image,
 			    -1);
 
 	g_signal_handlers_disconnect_by_func (image, on_image_changed, store);
+
+	file = eom_image_get_file (image);
+	indexed = g_hash_table_lookup (store->priv->file_index, file);
+
+	/* Leave the entry alone if another row holds the same file */
+	if (indexed != NULL && indexed->user_data == iter->user_data) {
+		g_hash_table_remove (store->priv->file_index, file);
+	}
+
+	if (g_hash_table_remove (store->priv->thumbnail_holds, image))
+		eom_image_release_thumbnail (image);
+
+	g_object_unref (file);
 	g_object_unref (image);
 
 	gtk_list_store_remove (GTK_LIST_STORE (store), iter);
@@ -337,9 +453,11 @@ eom_list_store_append_image (EomListStore *store, EomImage *image)
 {
 	GtkTreeIter iter;
 
-	g_signal_connect (image, "changed",
- 			  G_CALLBACK (on_image_changed),
- 			  store);
+	/* Images may outlive the store, e.g. when they are handed
+	 * over to the store replacing this one */
+	g_signal_connect_object (image, "changed",
+				 G_CALLBACK (on_image_changed),
+				 store, 0);
 
 	gtk_list_store_append (GTK_LIST_STORE (store), &iter);
 	gtk_list_store_set (GTK_LIST_STORE (store), &iter,
@@ -347,6 +465,12 @@ eom_list_store_append_image (EomListStore *store, EomImage *image)
 			    EOM_LIST_STORE_THUMBNAIL, store->priv->busy_image,
 			    EOM_LIST_STORE_THUMB_SET, FALSE,
 			    -1);
+
+	/* Iterators of a GtkListStore stay valid until their row
+	 * is removed, sorting included */
+	g_hash_table_replace (store->priv->file_index,
+			      eom_image_get_file (image),
+			      gtk_tree_iter_copy (&iter));
 }
 
 static void
@@ -358,9 +482,20 @@ eom_list_store_append_image_from_file (EomListStore *store,
 
 	g_return_if_fail (EOM_IS_LIST_STORE (store));
 
+	/* Already added by eom_list_store_set_initial_image() */
+	if (store->priv->initial_file != NULL &&
+	    g_file_equal (file, store->priv->initial_file))
+		return;
+
 	image = eom_image_new_file (file, caption);
 
+	/* Before the header is probed, so the orientation
+	 * found there is already taken into account */
+	if (store->priv->autorotate)
+		eom_image_autorotate (image);
+
 	eom_list_store_append_image (store, image);
+	g_object_unref (image);
 }
 
 static void
@@ -375,6 +510,8 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 	GtkTreeIter iter;
 	EomImage *image;
 
+	eom_stats_counter_add ("monitor.events", 1);
+
 	switch (event) {
 	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
 		file_info = g_file_query_info (file,
@@ -815,6 +952,51 @@ eom_list_store_get_initial_pos (EomListStore *store)
 	return store->priv->initial_image;
 }
 
+/**
+ * eom_list_store_set_initial_image:
+ * @store: An #EomListStore.
+ * @image: An #EomImage.
+ *
+ * Appends @image to @store and makes it the image to be loaded first.
+ * A later eom_list_store_add_files() adding the file of @image keeps
+ * this #EomImage instead of creating a new one, so an image that is
+ * already being loaded can be shown before its folder is read.
+ **/
+void
+eom_list_store_set_initial_image (EomListStore *store, EomImage *image)
+{
+	GtkTreeIter iter;
+
+	g_return_if_fail (EOM_IS_LIST_STORE (store));
+	g_return_if_fail (EOM_IS_IMAGE (image));
+	g_return_if_fail (store->priv->initial_file == NULL);
+
+	eom_list_store_append_image (store, image);
+
+	store->priv->initial_file = eom_image_get_file (image);
+
+	if (is_file_in_list_store_file (store, store->priv->initial_file, &iter))
+		store->priv->initial_image = eom_list_store_get_pos_by_iter (store, &iter);
+}
+
+/**
+ * eom_list_store_set_autorotate:
+ * @store: An #EomListStore.
+ * @autorotate: whether to autorotate images
+ *
+ * Sets whether the images @store creates for the files added to it
+ * from now on are rotated according to their EXIF orientation. This
+ * happens while the files are added, e.g. by eom_list_store_add_files()
+ * or the folder monitors, not for images already in @store.
+ **/
+void
+eom_list_store_set_autorotate (EomListStore *store, gboolean autorotate)
+{
+	g_return_if_fail (EOM_IS_LIST_STORE (store));
+
+	store->priv->autorotate = autorotate;
+}
+
 static void
 eom_list_store_remove_thumbnail_job (EomListStore *store,
 				     GtkTreeIter *iter)
@@ -881,17 +1063,37 @@ void
 eom_list_store_thumbnail_set (EomListStore *store,
 			      GtkTreeIter *iter)
 {
+	EomImage *image;
+	GdkPixbuf *thumbnail;
 	gboolean thumb_set = FALSE;
 
 	gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
+			    EOM_LIST_STORE_EOM_IMAGE, &image,
 			    EOM_LIST_STORE_THUMB_SET, &thumb_set,
 			    -1);
 
+	/* Only the images being shown get their header read, so
+	 * the dimensions are ready by the time a tooltip asks */
+	if (!eom_image_has_data (image, EOM_IMAGE_DATA_DIMENSION))
+		eom_image_header_probe_async (image);
+
 	if (thumb_set) {
+		g_object_unref (image);
 		return;
 	}
 
-	eom_list_store_add_thumbnail_job (store, iter);
+	/* The image may be shown in another window which
+	 * already created its thumbnail */
+	thumbnail = eom_image_get_thumbnail (image);
+
+	if (thumbnail != NULL) {
+		eom_list_store_set_row_thumbnail (store, iter, image, thumbnail);
+		g_object_unref (thumbnail);
+	} else {
+		eom_list_store_add_thumbnail_job (store, iter);
+	}
+
+	g_object_unref (image);
 }
 
 /**
@@ -914,11 +1116,15 @@ eom_list_store_thumbnail_unset (EomListStore *store,
 	gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
 			    EOM_LIST_STORE_EOM_IMAGE, &image,
 			    -1);
-	eom_image_set_thumbnail (image, NULL);
+
+	if (g_hash_table_remove (store->priv->thumbnail_holds, image))
+		eom_image_release_thumbnail (image);
+
 	g_object_unref (image);
 
 	gtk_list_store_set (GTK_LIST_STORE (store), iter,
 			    EOM_LIST_STORE_THUMBNAIL, store->priv->busy_image,
+			    EOM_LIST_STORE_THUMB_SURFACE, NULL,
 			    EOM_LIST_STORE_THUMB_SET, FALSE,
 			    -1);
 }
@@ -53,6 +53,7 @@ typedef enum {
 	EOM_LIST_STORE_THUMB_SET,
 	EOM_LIST_STORE_EOM_IMAGE,
 	EOM_LIST_STORE_EOM_JOB,
+	EOM_LIST_STORE_THUMB_SURFACE,
 	EOM_LIST_STORE_NUM_COLUMNS
 } EomListStoreColumn;
 
@@ -100,6 +101,12 @@ gint            eom_list_store_length                (EomListStore *store);
 
 gint            eom_list_store_get_initial_pos 	     (EomListStore *store);
 
+void            eom_list_store_set_initial_image     (EomListStore *store,
+						      EomImage     *image);
+
+void            eom_list_store_set_autorotate        (EomListStore *store,
+						      gboolean      autorotate);
+
 void            eom_list_store_thumbnail_set         (EomListStore *store,
 						      GtkTreeIter *iter);
 
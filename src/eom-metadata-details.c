@@ -58,25 +58,26 @@ typedef enum {
 
 typedef struct {
     char *label;
-    char *path;
 } ExifCategoryInfo;
 
 static ExifCategoryInfo exif_categories[] = {
-    { N_("Camera"),                  "0" },
-    { N_("Image Data"),              "1" },
-    { N_("Image Taking Conditions"), "2" },
-    { N_("GPS Data"),                "3" },
-    { N_("Maker Note"),              "4" },
-    { N_("Other"),                   "5" },
+    { N_("Camera") },
+    { N_("Image Data") },
+    { N_("Image Taking Conditions") },
+    { N_("GPS Data") },
+    { N_("Maker Note") },
+    { N_("Other") },
 #ifdef HAVE_EXEMPI
-    { N_("XMP Exif"),                "6" },
-    { N_("XMP IPTC"),                "7" },
-    { N_("XMP Rights Management"),   "8" },
-    { N_("XMP Other"),               "9" },
+    { N_("XMP Exif") },
+    { N_("XMP IPTC") },
+    { N_("XMP Rights Management") },
+    { N_("XMP Other") },
 #endif
-    { NULL, NULL }
+    { NULL }
 };
 
+#define N_CATEGORIES (G_N_ELEMENTS (exif_categories) - 1)
+
 typedef struct {
     int id;
     MetadataCategory category;
@@ -191,22 +192,58 @@ static ExifTagCategory exif_tag_category_map[] = {
 };
 #endif
 
+
+#ifdef HAVE_EXIF
+/* Category of each Exif tag, indexed by the tag number and offset
+ * by one so that unlisted tags read as zero; filled in from the
+ * map above once */
+static guint8 exif_tag_category_table[G_MAXUINT16 + 1];
+#endif
+
+/* Time the user must have settled on an image before the
+ * details are updated, in milliseconds */
+#define UPDATE_DELAY 150
+
 #define MODEL_COLUMN_ATTRIBUTE 0
 #define MODEL_COLUMN_VALUE     1
 
+typedef struct {
+    GtkTreeIter iter;
+    guint       generation;
+} MetadataRow;
+
 struct _EomMetadataDetailsPrivate {
     GtkTreeModel *model;
 
-    GHashTable   *id_path_hash;
-    GHashTable   *id_path_hash_mnote;
-};
+    GtkTreeIter   category_iters[N_CATEGORIES];
 
-static char*  set_row_data (GtkTreeStore *store, char *path, char *parent, const char *attribute, const char *value);
+    /* Rows currently shown, so that they are updated in place */
+    GHashTable   *exif_rows;
+    GHashTable   *mnote_rows;
+    GHashTable   *xmp_rows;
+    guint         generation;
 
-static void eom_metadata_details_reset (EomMetadataDetails *exif_details);
+    /* Metadata waiting to be shown */
+    guint         update_id;
+    gboolean      settling;
+#ifdef HAVE_EXIF
+    gboolean      exif_pending;
+    ExifData     *exif_data;
+#endif
+#ifdef HAVE_EXEMPI
+    gboolean      xmp_pending;
+    XmpPtr        xmp_data;
+#endif
+};
 
 G_DEFINE_TYPE_WITH_PRIVATE (EomMetadataDetails, eom_metadata_details, GTK_TYPE_TREE_VIEW)
 
+static void
+metadata_row_free (MetadataRow *row)
+{
+    g_slice_free (MetadataRow, row);
+}
+
 static void
 eom_metadata_details_dispose (GObject *object)
 {
@@ -214,19 +251,43 @@ eom_metadata_details_dispose (GObject *object)
 
     priv = EOM_METADATA_DETAILS (object)->priv;
 
+    if (priv->update_id != 0) {
+        g_source_remove (priv->update_id);
+        priv->update_id = 0;
+    }
+
+#ifdef HAVE_EXIF
+    if (priv->exif_data) {
+        exif_data_unref (priv->exif_data);
+        priv->exif_data = NULL;
+    }
+#endif
+
+#ifdef HAVE_EXEMPI
+    if (priv->xmp_data) {
+        xmp_free (priv->xmp_data);
+        priv->xmp_data = NULL;
+    }
+#endif
+
     if (priv->model) {
         g_object_unref (priv->model);
         priv->model = NULL;
     }
 
-    if (priv->id_path_hash) {
-        g_hash_table_destroy (priv->id_path_hash);
-        priv->id_path_hash = NULL;
+    if (priv->exif_rows) {
+        g_hash_table_destroy (priv->exif_rows);
+        priv->exif_rows = NULL;
+    }
+
+    if (priv->mnote_rows) {
+        g_hash_table_destroy (priv->mnote_rows);
+        priv->mnote_rows = NULL;
     }
 
-    if (priv->id_path_hash_mnote) {
-        g_hash_table_destroy (priv->id_path_hash_mnote);
-        priv->id_path_hash_mnote = NULL;
+    if (priv->xmp_rows) {
+        g_hash_table_destroy (priv->xmp_rows);
+        priv->xmp_rows = NULL;
     }
     G_OBJECT_CLASS (eom_metadata_details_parent_class)->dispose (object);
 }
@@ -237,14 +298,19 @@ eom_metadata_details_init (EomMetadataDetails *details)
     EomMetadataDetailsPrivate *priv;
     GtkTreeViewColumn *column;
     GtkCellRenderer *cell;
+    guint i;
 
     details->priv = eom_metadata_details_get_instance_private (details);
 
     priv = details->priv;
 
     priv->model = GTK_TREE_MODEL (gtk_tree_store_new (2, G_TYPE_STRING, G_TYPE_STRING));
-    priv->id_path_hash = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
-    priv->id_path_hash_mnote = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    priv->exif_rows = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, (GDestroyNotify) metadata_row_free);
+    priv->mnote_rows = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                              NULL, (GDestroyNotify) metadata_row_free);
+    priv->xmp_rows = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, (GDestroyNotify) metadata_row_free);
 
     /* Tag name column */
     cell = gtk_cell_renderer_text_new ();
@@ -263,92 +329,103 @@ eom_metadata_details_init (EomMetadataDetails *details)
                                                        NULL);
     gtk_tree_view_append_column (GTK_TREE_VIEW (details), column);
 
-    eom_metadata_details_reset (details);
+    /* The category rows stay, only the tags below them come and go */
+    for (i = 0; i < N_CATEGORIES; i++) {
+        gtk_tree_store_insert_with_values (GTK_TREE_STORE (priv->model),
+                                           &priv->category_iters[i], NULL, -1,
+                                           MODEL_COLUMN_ATTRIBUTE,
+                                           gettext (exif_categories[i].label),
+                                           -1);
+    }
 
     gtk_tree_view_set_model (GTK_TREE_VIEW (details),
                              GTK_TREE_MODEL (priv->model));
 }
 
-static void
-eom_metadata_details_class_init (EomMetadataDetailsClass *klass)
-{
-    GObjectClass *object_class = (GObjectClass*) klass;
-
-    object_class->dispose = eom_metadata_details_dispose;
-}
-
 #ifdef HAVE_EXIF
 static MetadataCategory
 get_exif_category (ExifEntry *entry)
 {
-    MetadataCategory cat = EXIF_CATEGORY_OTHER;
-    int i;
+    guint8 cat;
 
     /* Some GPS tag IDs overlap with other ones, so check the IFD */
     if (exif_entry_get_ifd (entry) == EXIF_IFD_GPS) {
         return EXIF_CATEGORY_GPS_DATA;
     }
 
-    for (i = 0; exif_tag_category_map [i].id != -1; i++) {
-        if (exif_tag_category_map[i].id == (int) entry->tag) {
-            cat = exif_tag_category_map[i].category;
-            break;
-        }
-    }
+    cat = exif_tag_category_table[(guint16) entry->tag];
 
-    return cat;
+    return cat != 0 ? (MetadataCategory) (cat - 1) : EXIF_CATEGORY_OTHER;
 }
 #endif
 
-static char*
-set_row_data (GtkTreeStore *store, char *path, char *parent, const char *attribute, const char *value)
+static MetadataRow *
+get_row (EomMetadataDetails *details, GHashTable *rows, gconstpointer key,
+         MetadataCategory cat, gboolean *created)
 {
-    GtkTreeIter iter;
-    gchar *utf_attribute = NULL;
-    gchar *utf_value = NULL;
-    gboolean iter_valid = FALSE;
+    EomMetadataDetailsPrivate *priv = details->priv;
+    MetadataRow *row;
 
-    if (!attribute) return NULL;
+    row = g_hash_table_lookup (rows, key);
+    *created = (row == NULL);
 
-    if (path != NULL) {
-        iter_valid = gtk_tree_model_get_iter_from_string (GTK_TREE_MODEL (store), &iter, path);
+    if (row == NULL) {
+        row = g_slice_new (MetadataRow);
+        gtk_tree_store_append (GTK_TREE_STORE (priv->model), &row->iter,
+                               &priv->category_iters[cat]);
     }
 
-    if (!iter_valid) {
-        GtkTreePath *tree_path;
-        GtkTreeIter parent_iter;
-        gboolean parent_valid = FALSE;
+    row->generation = priv->generation;
 
-        if (parent != NULL) {
-            parent_valid = gtk_tree_model_get_iter_from_string (GTK_TREE_MODEL (store),
-                                                                &parent_iter,
-                                                                parent);
-        }
+    return row;
+}
 
-        gtk_tree_store_append (store, &iter, parent_valid ? &parent_iter : NULL);
+/* Only touches the columns which changed, so that browsing through
+ * images with similar metadata leaves most rows alone */
+static void
+set_row_data (GtkTreeStore *store, GtkTreeIter *iter, const char *attribute, const char *value)
+{
+    gchar *old_attribute = NULL;
+    gchar *old_value = NULL;
+    gchar *utf_attribute;
 
-        if (path == NULL) {
-            tree_path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
-
-            if (tree_path != NULL) {
-                path = gtk_tree_path_to_string (tree_path);
-                gtk_tree_path_free (tree_path);
-            }
-        }
-    }
+    gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
+                        MODEL_COLUMN_ATTRIBUTE, &old_attribute,
+                        MODEL_COLUMN_VALUE, &old_value,
+                        -1);
 
     utf_attribute = eom_util_make_valid_utf8 (attribute);
 
-    gtk_tree_store_set (store, &iter, MODEL_COLUMN_ATTRIBUTE, utf_attribute, -1);
+    if (g_strcmp0 (old_attribute, utf_attribute) != 0) {
+        gtk_tree_store_set (store, iter, MODEL_COLUMN_ATTRIBUTE, utf_attribute, -1);
+    }
     g_free (utf_attribute);
 
     if (value != NULL) {
-        utf_value = eom_util_make_valid_utf8 (value);
-        gtk_tree_store_set (store, &iter, MODEL_COLUMN_VALUE, utf_value, -1);
+        gchar *utf_value = eom_util_make_valid_utf8 (value);
+
+        if (g_strcmp0 (old_value, utf_value) != 0) {
+            gtk_tree_store_set (store, iter, MODEL_COLUMN_VALUE, utf_value, -1);
+        }
         g_free (utf_value);
     }
 
-    return path;
+    g_free (old_attribute);
+    g_free (old_value);
+}
+
+static gboolean
+remove_stale_row (gpointer key, gpointer value, gpointer data)
+{
+    EomMetadataDetailsPrivate *priv = EOM_METADATA_DETAILS (data)->priv;
+    MetadataRow *row = value;
+
+    if (row->generation == priv->generation)
+        return FALSE;
+
+    gtk_tree_store_remove (GTK_TREE_STORE (priv->model), &row->iter);
+
+    return TRUE;
 }
 
 #ifdef HAVE_EXIF
@@ -463,9 +540,11 @@ exif_entry_cb (ExifEntry *entry, gpointer data)
     GtkTreeStore *store;
     EomMetadataDetails *view;
     EomMetadataDetailsPrivate *priv;
-    MetadataCategory cat;
+    MetadataRow *row;
+    ExifMnoteData *mnote;
     ExifIfd ifd = exif_entry_get_ifd (entry);
-    char *path;
+    const char *name;
+    gboolean created;
     char b[1024];
     const gint key = ifd << 16 | entry->tag;
 
@@ -475,59 +554,45 @@ exif_entry_cb (ExifEntry *entry, gpointer data)
     view = EOM_METADATA_DETAILS (data);
     priv = view->priv;
 
-    store = GTK_TREE_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (view)));
+    store = GTK_TREE_STORE (priv->model);
 
-    /* Take the tag's IFD into account when caching their GtkTreePaths.
-     * That should fix key collisions for tags that have the same number
-     * but are stored in different IFDs. Exif tag numbers are 16-bit
-     * values so we should be able to set the high word to the IFD number.
-     */
-    path = g_hash_table_lookup (priv->id_path_hash, GINT_TO_POINTER (key));
+    mnote = (entry->tag == EXIF_TAG_MAKER_NOTE ?
+             exif_data_get_mnote_data (entry->parent->parent) : NULL);
 
-    if (path != NULL) {
-        set_row_data (store,
-                      path,
-                      NULL,
-                      exif_tag_get_name_in_ifd (entry->tag, ifd),
-                      eom_exif_entry_get_value (entry, b, sizeof(b)));
-    } else {
+    if (mnote) {
+        // Supported MakerNote Found
+        unsigned int i, c = exif_mnote_data_count (mnote);
 
-        ExifMnoteData *mnote = (entry->tag == EXIF_TAG_MAKER_NOTE ?
-                                exif_data_get_mnote_data (entry->parent->parent) : NULL);
-
-        if (mnote) {
-            // Supported MakerNote Found
-            unsigned int i, c = exif_mnote_data_count (mnote);
-
-            for (i = 0; i < c; i++) {
-                path = g_hash_table_lookup (priv->id_path_hash_mnote, GINT_TO_POINTER (i));
-                if (path != NULL) {
-                    set_row_data (store, path, NULL,
-                                  exif_mnote_data_get_title (mnote, i),
-                                  exif_mnote_data_get_value (mnote, i, b, sizeof(b)));
-                } else {
-                    path = set_row_data (store,
-                                         NULL,
-                                         exif_categories[EXIF_CATEGORY_MAKER_NOTE].path,
-                                         exif_mnote_data_get_title (mnote, i),
-                                         exif_mnote_data_get_value (mnote, i, b, sizeof(b)));
-                    g_hash_table_insert (priv->id_path_hash_mnote, GINT_TO_POINTER (i), path);
-                }
-            }
-        } else {
-            cat = get_exif_category (entry);
-
-            path = set_row_data (store,
-                                 NULL,
-                                 exif_categories[cat].path,
-                                 exif_tag_get_name_in_ifd (entry->tag, ifd),
-                                 eom_exif_entry_get_value (entry, b,
-                                 sizeof(b)));
-
-            g_hash_table_insert (priv->id_path_hash,
-                                 GINT_TO_POINTER (key),
-                                 path);
+        for (i = 0; i < c; i++) {
+            name = exif_mnote_data_get_title (mnote, i);
+            if (name == NULL)
+                continue;
+
+            row = get_row (view, priv->mnote_rows, GINT_TO_POINTER (i),
+                           EXIF_CATEGORY_MAKER_NOTE, &created);
+            set_row_data (store, &row->iter, name,
+                          exif_mnote_data_get_value (mnote, i, b, sizeof(b)));
+
+            if (created)
+                g_hash_table_insert (priv->mnote_rows, GINT_TO_POINTER (i), row);
         }
+    } else {
+        name = exif_tag_get_name_in_ifd (entry->tag, ifd);
+        if (name == NULL)
+            return;
+
+        /* Take the tag's IFD into account when caching their rows.
+         * That should fix key collisions for tags that have the same number
+         * but are stored in different IFDs. Exif tag numbers are 16-bit
+         * values so we should be able to set the high word to the IFD number.
+         */
+        row = get_row (view, priv->exif_rows, GINT_TO_POINTER (key),
+                       get_exif_category (entry), &created);
+        set_row_data (store, &row->iter, name,
+                      eom_exif_entry_get_value (entry, b, sizeof(b)));
+
+        if (created)
+            g_hash_table_insert (priv->exif_rows, GINT_TO_POINTER (key), row);
     }
 }
 #endif
@@ -538,54 +603,23 @@ exif_content_cb (ExifContent *content, gpointer data)
 {
     exif_content_foreach_entry (content, exif_entry_cb, data);
 }
-#endif
-
-GtkWidget *
-eom_metadata_details_new (void)
-{
-    GObject *object;
-
-    object = g_object_new (EOM_TYPE_METADATA_DETAILS, NULL);
-
-    return GTK_WIDGET (object);
-}
 
 static void
-eom_metadata_details_reset (EomMetadataDetails *details)
+eom_metadata_details_show_exif (EomMetadataDetails *details, ExifData *data)
 {
     EomMetadataDetailsPrivate *priv = details->priv;
-    int i;
-
-    gtk_tree_store_clear (GTK_TREE_STORE (priv->model));
-
-    g_hash_table_remove_all (priv->id_path_hash);
-    g_hash_table_remove_all (priv->id_path_hash_mnote);
 
-    for (i = 0; exif_categories [i].label != NULL; i++) {
-        char *translated_string;
-
-        translated_string = gettext (exif_categories[i].label);
-
-        set_row_data (GTK_TREE_STORE (priv->model),
-                      exif_categories[i].path,
-                      NULL,
-                      translated_string,
-                      NULL);
-    }
-}
-
-#ifdef HAVE_EXIF
-void
-eom_metadata_details_update (EomMetadataDetails *details, ExifData *data)
-{
-    g_return_if_fail (EOM_IS_METADATA_DETAILS (details));
+    /* Rows not seen again while walking the new data are dropped */
+    priv->generation++;
 
-    eom_metadata_details_reset (details);
     if (data) {
         exif_data_foreach_content (data, exif_content_cb, details);
     }
+
+    g_hash_table_foreach_remove (priv->exif_rows, remove_stale_row, details);
+    g_hash_table_foreach_remove (priv->mnote_rows, remove_stale_row, details);
 }
-#endif /* HAVE_EXIF */
+#endif
 
 #ifdef HAVE_EXEMPI
 typedef struct {
@@ -626,43 +660,37 @@ static void
 xmp_entry_insert (EomMetadataDetails *view, XmpStringPtr xmp_schema,
                   XmpStringPtr xmp_path, XmpStringPtr xmp_prop)
 {
-    GtkTreeStore *store;
     EomMetadataDetailsPrivate *priv;
-    MetadataCategory cat;
-    char *path;
+    MetadataRow *row;
+    gboolean created;
     gchar *key;
 
     priv = view->priv;
 
+    if (xmp_string_cstr (xmp_path) == NULL)
+        return;
+
     key = g_strconcat (xmp_string_cstr (xmp_schema), ":",
                        xmp_string_cstr (xmp_path), NULL);
 
-    store = GTK_TREE_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (view)));
-
-    path = g_hash_table_lookup (priv->id_path_hash, key);
-
-    if (path != NULL) {
-        set_row_data (store, path, NULL,
-                      xmp_string_cstr (xmp_path),
-                      xmp_string_cstr (xmp_prop));
-
-        g_free(key);
-    }
-    else {
-        cat = get_xmp_category (xmp_schema);
+    row = get_row (view, priv->xmp_rows, key,
+                   get_xmp_category (xmp_schema), &created);
+    set_row_data (GTK_TREE_STORE (priv->model), &row->iter,
+                  xmp_string_cstr (xmp_path),
+                  xmp_string_cstr (xmp_prop));
 
-        path = set_row_data (store, NULL, exif_categories[cat].path,
-                             xmp_string_cstr(xmp_path),
-                             xmp_string_cstr(xmp_prop));
-
-        g_hash_table_insert (priv->id_path_hash, key, path);
-    }
+    if (created)
+        g_hash_table_insert (priv->xmp_rows, key, row);
+    else
+        g_free (key);
 }
 
-void
-eom_metadata_details_xmp_update (EomMetadataDetails *view, XmpPtr data)
+static void
+eom_metadata_details_show_xmp (EomMetadataDetails *view, XmpPtr data)
 {
-    g_return_if_fail (EOM_IS_METADATA_DETAILS (view));
+    EomMetadataDetailsPrivate *priv = view->priv;
+
+    priv->generation++;
 
     if (data) {
         XmpIteratorPtr iter = xmp_iterator_new(data, NULL, NULL, XMP_ITER_JUSTLEAFNODES);
@@ -679,5 +707,161 @@ eom_metadata_details_xmp_update (EomMetadataDetails *view, XmpPtr data)
         xmp_string_free (the_schema);
         xmp_iterator_free (iter);
     }
+
+    g_hash_table_foreach_remove (priv->xmp_rows, remove_stale_row, view);
+}
+#endif
+
+/* Fills the tree with the metadata set last, provided it can be
+ * seen; a collapsed expander gets it once opened */
+static void
+eom_metadata_details_flush (EomMetadataDetails *details)
+{
+    EomMetadataDetailsPrivate *priv = details->priv;
+
+    if (!gtk_widget_get_mapped (GTK_WIDGET (details)))
+        return;
+
+#ifdef HAVE_EXIF
+    if (priv->exif_pending) {
+        eom_metadata_details_show_exif (details, priv->exif_data);
+
+        if (priv->exif_data) {
+            exif_data_unref (priv->exif_data);
+            priv->exif_data = NULL;
+        }
+        priv->exif_pending = FALSE;
+    }
+#endif
+
+#ifdef HAVE_EXEMPI
+    if (priv->xmp_pending) {
+        eom_metadata_details_show_xmp (details, priv->xmp_data);
+
+        if (priv->xmp_data) {
+            xmp_free (priv->xmp_data);
+            priv->xmp_data = NULL;
+        }
+        priv->xmp_pending = FALSE;
+    }
+#endif
+}
+
+static gboolean
+update_cb (gpointer data)
+{
+    EomMetadataDetails *details = EOM_METADATA_DETAILS (data);
+    EomMetadataDetailsPrivate *priv = details->priv;
+
+    eom_metadata_details_flush (details);
+
+    if (priv->settling) {
+        priv->settling = FALSE;
+        priv->update_id = 0;
+    } else {
+        /* Hold back what comes next until the user stops
+         * going through the images */
+        priv->settling = TRUE;
+        priv->update_id = g_timeout_add (UPDATE_DELAY, update_cb, details);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+eom_metadata_details_queue_update (EomMetadataDetails *details)
+{
+    EomMetadataDetailsPrivate *priv = details->priv;
+
+    if (priv->update_id == 0) {
+        /* The first change is shown right away */
+        priv->update_id = g_idle_add (update_cb, details);
+    } else if (priv->settling) {
+        g_source_remove (priv->update_id);
+        priv->update_id = g_timeout_add (UPDATE_DELAY, update_cb, details);
+    }
+}
+
+static void
+eom_metadata_details_map (GtkWidget *widget)
+{
+    EomMetadataDetails *details = EOM_METADATA_DETAILS (widget);
+
+    GTK_WIDGET_CLASS (eom_metadata_details_parent_class)->map (widget);
+
+    /* Catch up with the image shown while hidden */
+    if (details->priv->update_id == 0)
+        eom_metadata_details_flush (details);
+}
+
+static void
+eom_metadata_details_class_init (EomMetadataDetailsClass *klass)
+{
+    GObjectClass *object_class = (GObjectClass*) klass;
+    GtkWidgetClass *widget_class = (GtkWidgetClass*) klass;
+#ifdef HAVE_EXIF
+    int i;
+
+    for (i = 0; exif_tag_category_map[i].id != -1; i++) {
+        exif_tag_category_table[exif_tag_category_map[i].id] =
+            exif_tag_category_map[i].category + 1;
+    }
+#endif
+
+    object_class->dispose = eom_metadata_details_dispose;
+
+    widget_class->map = eom_metadata_details_map;
+}
+
+GtkWidget *
+eom_metadata_details_new (void)
+{
+    GObject *object;
+
+    object = g_object_new (EOM_TYPE_METADATA_DETAILS, NULL);
+
+    return GTK_WIDGET (object);
+}
+
+#ifdef HAVE_EXIF
+void
+eom_metadata_details_update (EomMetadataDetails *details, ExifData *data)
+{
+    EomMetadataDetailsPrivate *priv;
+
+    g_return_if_fail (EOM_IS_METADATA_DETAILS (details));
+
+    priv = details->priv;
+
+    if (data) {
+        exif_data_ref (data);
+    }
+    if (priv->exif_data) {
+        exif_data_unref (priv->exif_data);
+    }
+    priv->exif_data = data;
+    priv->exif_pending = TRUE;
+
+    eom_metadata_details_queue_update (details);
+}
+#endif /* HAVE_EXIF */
+
+#ifdef HAVE_EXEMPI
+void
+eom_metadata_details_xmp_update (EomMetadataDetails *view, XmpPtr data)
+{
+    EomMetadataDetailsPrivate *priv;
+
+    g_return_if_fail (EOM_IS_METADATA_DETAILS (view));
+
+    priv = view->priv;
+
+    if (priv->xmp_data) {
+        xmp_free (priv->xmp_data);
+    }
+    priv->xmp_data = data ? xmp_copy (data) : NULL;
+    priv->xmp_pending = TRUE;
+
+    eom_metadata_details_queue_update (view);
 }
 #endif
@@ -56,6 +56,11 @@ typedef enum {
 #define EOM_JPEG_MARKER_APP1	0xE1
 #define EOM_JPEG_MARKER_APP2	0xE2
 #define EOM_JPEG_MARKER_APP14	0xED
+#define EOM_JPEG_MARKER_TEM	0x01
+#define EOM_JPEG_MARKER_RST0	0xD0
+#define EOM_JPEG_MARKER_SOI	0xD8
+#define EOM_JPEG_MARKER_EOI	0xD9
+#define EOM_JPEG_MARKER_SOS	0xDA
 
 #define IS_FINISHED(priv) (priv->state == EMR_READ  && \
                            priv->exif_chunk != NULL && \
@@ -232,10 +237,28 @@ eom_metadata_reader_jpg_consume (EomMetadataReaderJpg *emr, const guchar *buf, g
 
 				eom_debug_message (DEBUG_IMAGE_DATA, "APPx or COM Marker Found: %x", priv->last_marker);
 			}
-			else {
-				/* otherwise simply consume the byte */
+			else if (buf[i] == EOM_JPEG_MARKER_START) {
+				/* fill byte, the marker follows */
+			}
+			else if (buf[i] == EOM_JPEG_MARKER_SOS ||
+				 buf[i] == EOM_JPEG_MARKER_EOI) {
+				/* entropy-coded data follows, which never
+				 * contains metadata */
+				priv->state = EMR_FINISHED;
+			}
+			else if (buf[i] == EOM_JPEG_MARKER_TEM ||
+				 (buf[i] >= EOM_JPEG_MARKER_RST0 &&
+				  buf[i] <= EOM_JPEG_MARKER_SOI)) {
+				/* standalone marker without a length */
 				priv->state = EMR_READ;
 			}
+			else {
+				/* skip other segments (DQT, SOFn, ...) by
+				 * their length, as APPn segments may follow */
+				priv->last_marker = buf [i];
+				priv->size = 0;
+				priv->state = EMR_READ_SIZE_HIGH_BYTE;
+			}
 			break;
 
 		case EMR_READ_SIZE_HIGH_BYTE:
@@ -629,6 +652,26 @@ eom_metadata_reader_jpg_get_icc_profile (EomMetadataReaderJpg *emr)
 }
 #endif
 
+static gsize
+eom_metadata_reader_jpg_skip (EomMetadataReaderJpg *emr)
+{
+	EomMetadataReaderJpgPrivate *priv;
+	gsize skip;
+
+	g_return_val_if_fail (EOM_IS_METADATA_READER_JPG (emr), 0);
+
+	priv = emr->priv;
+
+	if (priv->state != EMR_SKIP_BYTES || priv->size <= 0)
+		return 0;
+
+	skip = priv->size;
+	priv->size = 0;
+	priv->state = EMR_READ;
+
+	return skip;
+}
+
 static void
 eom_metadata_reader_jpg_init_emr_iface (gpointer g_iface, gpointer iface_data)
 {
@@ -642,6 +685,9 @@ eom_metadata_reader_jpg_init_emr_iface (gpointer g_iface, gpointer iface_data)
 	iface->finished =
 		(gboolean (*) (EomMetadataReader *self))
 			eom_metadata_reader_jpg_finished;
+	iface->skip =
+		(gsize (*) (EomMetadataReader *self))
+			eom_metadata_reader_jpg_skip;
 	iface->get_raw_exif =
 		(void (*) (EomMetadataReader *self, guchar **data, guint *len))
 			eom_metadata_reader_jpg_get_exif_chunk;
@@ -158,6 +158,27 @@ eom_metadata_reader_png_finished (EomMetadataReaderPng *emr)
 	return (emr->priv->state == EMR_FINISHED);
 }
 
+static gsize
+eom_metadata_reader_png_skip (EomMetadataReaderPng *emr)
+{
+	EomMetadataReaderPngPrivate *priv;
+	gsize skip;
+
+	g_return_val_if_fail (EOM_IS_METADATA_READER_PNG (emr), 0);
+
+	priv = emr->priv;
+
+	if (priv->state != EMR_SKIP_BYTES || priv->size == 0)
+		return 0;
+
+	/* The remainder of the chunk, e.g. IDAT data, is never needed */
+	skip = priv->size;
+	priv->size = 0;
+	priv->state = EMR_READ_SIZE_HIGH_HIGH_BYTE;
+
+	return skip;
+}
+
 static void
 eom_metadata_reader_png_get_next_block (EomMetadataReaderPngPrivate* priv,
 				    	guchar *chunk,
@@ -667,6 +688,9 @@ eom_metadata_reader_png_init_emr_iface (gpointer g_iface, gpointer iface_data)
 	iface->finished =
 		(gboolean (*) (EomMetadataReader *self))
 			eom_metadata_reader_png_finished;
+	iface->skip =
+		(gsize (*) (EomMetadataReader *self))
+			eom_metadata_reader_png_skip;
 #if defined(HAVE_LCMS) && defined(GDK_WINDOWING_X11)
 	iface->get_icc_profile =
 		(cmsHPROFILE (*) (EomMetadataReader *self))
@@ -66,6 +66,19 @@ eom_metadata_reader_consume (EomMetadataReader *emr, const guchar *buf, guint le
 	EOM_METADATA_READER_GET_INTERFACE (emr)->consume (emr, buf, len);
 }
 
+/* Returns the number of bytes following the data consumed so far that
+ * the reader is not interested in, e.g. the rest of a segment it is
+ * skipping. These bytes are considered consumed, so the caller must seek
+ * past them instead of passing them to eom_metadata_reader_consume().
+ */
+gsize
+eom_metadata_reader_skip (EomMetadataReader *emr)
+{
+	g_return_val_if_fail (EOM_IS_METADATA_READER (emr), 0);
+
+	return EOM_METADATA_READER_GET_INTERFACE (emr)->skip (emr);
+}
+
 /* Returns the raw exif data. NOTE: The caller of this function becomes
  * the new owner of this piece of memory and is responsible for freeing it!
  */
@@ -119,6 +132,13 @@ _eom_metadata_reader_default_get_null (EomMetadataReader *emr)
 {
 	return NULL;
 }
+
+/* Default vfunc for readers that can't tell which data they will skip */
+static gsize
+_eom_metadata_reader_default_skip (EomMetadataReader *emr)
+{
+	return 0;
+}
 static void
 eom_metadata_reader_default_init (EomMetadataReaderInterface *iface)
 {
@@ -128,4 +148,5 @@ eom_metadata_reader_default_init (EomMetadataReaderInterface *iface)
 	iface->get_exif_data = _eom_metadata_reader_default_get_null;
 	iface->get_icc_profile = _eom_metadata_reader_default_get_null;
 	iface->get_xmp_ptr = _eom_metadata_reader_default_get_null;
+	iface->skip = _eom_metadata_reader_default_skip;
 }
@@ -52,6 +52,8 @@ struct _EomMetadataReaderInterface {
 
 	gboolean	(*finished)		(EomMetadataReader *self);
 
+	gsize		(*skip)			(EomMetadataReader *self);
+
 	void		(*get_raw_exif)		(EomMetadataReader *self,
 						 guchar **data,
 						 guint *len);
@@ -82,6 +84,9 @@ void                 eom_metadata_reader_consume	(EomMetadataReader *emr,
 G_GNUC_INTERNAL
 gboolean             eom_metadata_reader_finished	(EomMetadataReader *emr);
 
+G_GNUC_INTERNAL
+gsize                eom_metadata_reader_skip		(EomMetadataReader *emr);
+
 G_GNUC_INTERNAL
 void                 eom_metadata_reader_get_exif_chunk (EomMetadataReader *emr,
 							 guchar **data,
@@ -0,0 +1,484 @@
+/* Eye Of Mate - Decoded Pixel Cache
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Images that were slow to decode are written, uncompressed and already
+ * oriented, to a size limited directory once their pixels are dropped
+ * from memory. Loading them again maps the file straight into a
+ * GdkPixbuf, so going back to a large image costs paging it in instead
+ * of decoding it again. Entries are keyed by the URI, size and
+ * modification time of the image file, so stale ones are never hit and
+ * simply age out; the least recently used entries are removed first
+ * once the cache grows over the size set in the preferences. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "eom-pixel-cache.h"
+#include "eom-config-keys.h"
+#include "eom-debug.h"
+#include "eom-stats.h"
+#include "eom-util.h"
+
+#define PIXEL_CACHE_DIR		"pixel-cache"
+#define PIXEL_CACHE_MAGIC	"EOMPIXC1"
+
+/* The pixels start on a page boundary of their own */
+#define PIXEL_CACHE_DATA_OFFSET	4096
+
+typedef struct {
+	gchar   magic[8];
+	guint32 width;
+	guint32 height;
+	guint32 rowstride;
+	guint32 n_channels;
+	gint32  orientation;
+	gchar   file_type[32];
+} EomPixelCacheHeader;
+
+typedef struct {
+	gchar     *key;
+	GdkPixbuf *pixbuf;
+	gint       orientation;
+	gchar     *file_type;
+} StoreRequest;
+
+typedef struct {
+	gchar  *path;
+	gint64  mtime;
+	goffset size;
+} CacheEntry;
+
+static gchar *cache_dir = NULL;
+static gint cache_size_mb = 0;
+static GSettings *cache_settings = NULL;
+
+static GMutex store_pool_mutex;
+static GThreadPool *store_pool = NULL;
+
+static void
+store_request_free (StoreRequest *request)
+{
+	g_free (request->key);
+	g_free (request->file_type);
+
+	if (request->pixbuf != NULL)
+		g_object_unref (request->pixbuf);
+
+	g_slice_free (StoreRequest, request);
+}
+
+static gboolean
+header_is_valid (const EomPixelCacheHeader *header, gsize length,
+		 gsize *byte_length)
+{
+	guint64 needed;
+
+	if (memcmp (header->magic, PIXEL_CACHE_MAGIC, sizeof (header->magic)) != 0)
+		return FALSE;
+
+	if (header->width == 0 || header->height == 0 ||
+	    header->width > G_MAXINT || header->height > G_MAXINT ||
+	    (header->n_channels != 3 && header->n_channels != 4) ||
+	    header->rowstride < (guint64) header->width * header->n_channels)
+		return FALSE;
+
+	if (memchr (header->file_type, '\0', sizeof (header->file_type)) == NULL)
+		return FALSE;
+
+	/* The last row isn't padded to the rowstride */
+	needed = (guint64) header->rowstride * (header->height - 1) +
+		 (guint64) header->width * header->n_channels;
+
+	if (needed > length - PIXEL_CACHE_DATA_OFFSET)
+		return FALSE;
+
+	*byte_length = (gsize) needed;
+
+	return TRUE;
+}
+
+static gint
+compare_entries (gconstpointer a, gconstpointer b)
+{
+	const CacheEntry *entry_a = a;
+	const CacheEntry *entry_b = b;
+
+	return (entry_a->mtime > entry_b->mtime) - (entry_a->mtime < entry_b->mtime);
+}
+
+/* Removes the least recently used entries until the cache fits in
+ * its size again. Temporary files of entries being written count as
+ * well, so that those left behind by a crash go away eventually. */
+static void
+trim_cache (void)
+{
+	guint64 max_size, total = 0;
+	GArray *entries;
+	const gchar *name;
+	GDir *dir;
+	guint i;
+
+	dir = g_dir_open (cache_dir, 0, NULL);
+
+	if (dir == NULL)
+		return;
+
+	max_size = (guint64) g_atomic_int_get (&cache_size_mb) * 1024 * 1024;
+	entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		CacheEntry entry;
+		GStatBuf st;
+
+		entry.path = g_build_filename (cache_dir, name, NULL);
+
+		if (g_stat (entry.path, &st) != 0 || !S_ISREG (st.st_mode)) {
+			g_free (entry.path);
+			continue;
+		}
+
+		entry.mtime = st.st_mtime;
+		entry.size = st.st_size;
+		total += entry.size;
+
+		g_array_append_val (entries, entry);
+	}
+
+	g_dir_close (dir);
+
+	if (total > max_size) {
+		g_array_sort (entries, compare_entries);
+
+		for (i = 0; i < entries->len && total > max_size; i++) {
+			CacheEntry *entry = &g_array_index (entries, CacheEntry, i);
+
+			if (g_unlink (entry->path) == 0) {
+				total -= entry->size;
+				eom_stats_counter_add ("pixel-cache.evictions", 1);
+			}
+		}
+	}
+
+	for (i = 0; i < entries->len; i++)
+		g_free (g_array_index (entries, CacheEntry, i).path);
+
+	g_array_free (entries, TRUE);
+}
+
+/* Writes the entry under a temporary name first, so that a lookup
+ * never maps a file which is still being written; files are never
+ * modified once renamed either, as that would break their mappings */
+static void
+write_entry (StoreRequest *request)
+{
+	EomPixelCacheHeader *header;
+	guchar *block;
+	gchar *path, *tmp_path;
+	gboolean success;
+	FILE *fp;
+	gint fd;
+
+	path = g_build_filename (cache_dir, request->key, NULL);
+
+	if (g_file_test (path, G_FILE_TEST_EXISTS)) {
+		g_free (path);
+		return;
+	}
+
+	tmp_path = g_strconcat (path, ".XXXXXX", NULL);
+	fd = g_mkstemp (tmp_path);
+
+	if (fd == -1 || (fp = fdopen (fd, "wb")) == NULL) {
+		if (fd != -1) {
+			close (fd);
+			g_unlink (tmp_path);
+		}
+
+		g_free (tmp_path);
+		g_free (path);
+		return;
+	}
+
+	block = g_malloc0 (PIXEL_CACHE_DATA_OFFSET);
+	header = (EomPixelCacheHeader *) block;
+
+	memcpy (header->magic, PIXEL_CACHE_MAGIC, sizeof (header->magic));
+	header->width = gdk_pixbuf_get_width (request->pixbuf);
+	header->height = gdk_pixbuf_get_height (request->pixbuf);
+	header->rowstride = gdk_pixbuf_get_rowstride (request->pixbuf);
+	header->n_channels = gdk_pixbuf_get_n_channels (request->pixbuf);
+	header->orientation = request->orientation;
+
+	if (request->file_type != NULL)
+		g_strlcpy (header->file_type, request->file_type,
+			   sizeof (header->file_type));
+
+	success = (fwrite (block, PIXEL_CACHE_DATA_OFFSET, 1, fp) == 1 &&
+		   fwrite (gdk_pixbuf_read_pixels (request->pixbuf),
+			   gdk_pixbuf_get_byte_length (request->pixbuf),
+			   1, fp) == 1);
+
+	success = (fclose (fp) == 0 && success);
+
+	if (success && g_rename (tmp_path, path) == 0) {
+		eom_stats_counter_add ("pixel-cache.stores", 1);
+	} else {
+		eom_debug_message (DEBUG_IMAGE_LOAD,
+				   "Failed to write pixel cache entry %s",
+				   request->key);
+		g_unlink (tmp_path);
+	}
+
+	g_free (block);
+	g_free (tmp_path);
+	g_free (path);
+}
+
+static void
+store_run (gpointer data, gpointer user_data)
+{
+	StoreRequest *request = data;
+
+	if (request->pixbuf != NULL &&
+	    g_mkdir_with_parents (cache_dir, 0700) == 0)
+		write_entry (request);
+
+	trim_cache ();
+
+	store_request_free (request);
+}
+
+static void
+store_push (StoreRequest *request)
+{
+	/* A single thread is enough, writing in parallel
+	 * only makes the disk seek more */
+	g_mutex_lock (&store_pool_mutex);
+	if (store_pool == NULL)
+		store_pool = g_thread_pool_new (store_run, NULL, 1, FALSE, NULL);
+	g_mutex_unlock (&store_pool_mutex);
+
+	g_thread_pool_push (store_pool, request, NULL);
+}
+
+static void
+cache_size_changed_cb (GSettings   *settings,
+		       const gchar *key,
+		       gpointer     user_data)
+{
+	gint size;
+
+	size = MAX (0, g_settings_get_int (settings, key));
+	g_atomic_int_set (&cache_size_mb, size);
+
+	/* Shrink the cache to its new size, which also empties it
+	 * when it was disabled */
+	if (g_file_test (cache_dir, G_FILE_TEST_IS_DIR))
+		store_push (g_slice_new0 (StoreRequest));
+}
+
+/**
+ * eom_pixel_cache_init:
+ *
+ * Sets the pixel cache up, following the size set in the preferences.
+ * Must be called from the main thread before any image is loaded.
+ **/
+void
+eom_pixel_cache_init (void)
+{
+	const gchar *dot_dir;
+
+	if (cache_settings != NULL)
+		return;
+
+	dot_dir = eom_util_dot_dir ();
+
+	if (dot_dir == NULL)
+		return;
+
+	cache_dir = g_build_filename (dot_dir, PIXEL_CACHE_DIR, NULL);
+
+	cache_settings = g_settings_new (EOM_CONF_VIEW);
+	g_signal_connect (cache_settings,
+			  "changed::" EOM_CONF_VIEW_PIXEL_CACHE_SIZE,
+			  G_CALLBACK (cache_size_changed_cb), NULL);
+
+	cache_size_changed_cb (cache_settings, EOM_CONF_VIEW_PIXEL_CACHE_SIZE, NULL);
+}
+
+/**
+ * eom_pixel_cache_get_key:
+ * @file: the image file
+ * @size: the size of @file
+ * @mtime: the modification time of @file, in microseconds
+ *
+ * Computes the key of the cache entry holding the pixels of @file.
+ *
+ * Returns: a newly allocated key, or %NULL if the cache is disabled.
+ **/
+gchar *
+eom_pixel_cache_get_key (GFile    *file,
+			 goffset   size,
+			 guint64   mtime)
+{
+	gchar *uri, *data, *key;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	if (cache_dir == NULL || g_atomic_int_get (&cache_size_mb) == 0)
+		return NULL;
+
+	uri = g_file_get_uri (file);
+	data = g_strdup_printf ("%s\n%" G_GOFFSET_FORMAT "\n%" G_GUINT64_FORMAT,
+				uri, size, mtime);
+
+	key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, data, -1);
+
+	g_free (data);
+	g_free (uri);
+
+	return key;
+}
+
+/**
+ * eom_pixel_cache_lookup:
+ * @key: a key from eom_pixel_cache_get_key()
+ * @orientation: (out): return location for the EXIF orientation
+ * which was applied to the pixels, 0 if they weren't oriented
+ * @file_type: (out): return location for the name of the image format
+ *
+ * Maps the cache entry for @key, if any, into a pixbuf. Its pixels are
+ * read-only; GdkPixbuf copies them the first time they are written to.
+ * Can be called from any thread.
+ *
+ * Returns: (transfer full): the cached pixels, or %NULL.
+ **/
+GdkPixbuf *
+eom_pixel_cache_lookup (const gchar  *key,
+			gint         *orientation,
+			gchar       **file_type)
+{
+	const EomPixelCacheHeader *header;
+	GdkPixbuf *pixbuf = NULL;
+	GMappedFile *mapped;
+	gsize length, byte_length;
+	gchar *path;
+
+	if (key == NULL || cache_dir == NULL)
+		return NULL;
+
+	path = g_build_filename (cache_dir, key, NULL);
+	mapped = g_mapped_file_new (path, FALSE, NULL);
+
+	if (mapped == NULL) {
+		eom_stats_counter_add ("pixel-cache.misses", 1);
+		g_free (path);
+		return NULL;
+	}
+
+	length = g_mapped_file_get_length (mapped);
+	header = (const EomPixelCacheHeader *) g_mapped_file_get_contents (mapped);
+
+	if (length > PIXEL_CACHE_DATA_OFFSET &&
+	    header_is_valid (header, length, &byte_length)) {
+		GBytes *bytes, *pixels;
+
+		bytes = g_mapped_file_get_bytes (mapped);
+		pixels = g_bytes_new_from_bytes (bytes, PIXEL_CACHE_DATA_OFFSET,
+						 byte_length);
+
+		pixbuf = gdk_pixbuf_new_from_bytes (pixels,
+						    GDK_COLORSPACE_RGB,
+						    header->n_channels == 4,
+						    8,
+						    header->width,
+						    header->height,
+						    header->rowstride);
+
+		if (orientation != NULL)
+			*orientation = header->orientation;
+
+		if (file_type != NULL)
+			*file_type = (header->file_type[0] != '\0' ?
+				      g_strdup (header->file_type) : NULL);
+
+		g_bytes_unref (pixels);
+		g_bytes_unref (bytes);
+
+		/* Mark the entry as recently used */
+		g_utime (path, NULL);
+
+		eom_stats_counter_add ("pixel-cache.hits", 1);
+	} else {
+		g_unlink (path);
+
+		eom_stats_counter_add ("pixel-cache.misses", 1);
+	}
+
+	g_mapped_file_unref (mapped);
+	g_free (path);
+
+	return pixbuf;
+}
+
+/**
+ * eom_pixel_cache_store:
+ * @key: a key from eom_pixel_cache_get_key()
+ * @pixbuf: the decoded and oriented pixels of the image
+ * @orientation: the EXIF orientation applied to @pixbuf, 0 if
+ * automatic orientation was disabled
+ * @file_type: (allow-none): the name of the image format
+ *
+ * Writes @pixbuf to the cache in the background, unless there is an
+ * entry for @key already. A reference on @pixbuf is held until then.
+ **/
+void
+eom_pixel_cache_store (const gchar *key,
+		       GdkPixbuf   *pixbuf,
+		       gint         orientation,
+		       const gchar *file_type)
+{
+	StoreRequest *request;
+
+	g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+	if (key == NULL || cache_dir == NULL ||
+	    g_atomic_int_get (&cache_size_mb) == 0)
+		return;
+
+	if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+	    gdk_pixbuf_get_bits_per_sample (pixbuf) != 8)
+		return;
+
+	request = g_slice_new0 (StoreRequest);
+	request->key = g_strdup (key);
+	request->pixbuf = g_object_ref (pixbuf);
+	request->orientation = orientation;
+	request->file_type = g_strdup (file_type);
+
+	store_push (request);
+}
@@ -0,0 +1,53 @@
+/* Eye Of Mate - Decoded Pixel Cache
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __EOM_PIXEL_CACHE_H__
+#define __EOM_PIXEL_CACHE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* Decodes faster than this aren't worth a cache entry */
+#define EOM_PIXEL_CACHE_MIN_DECODE_US	(20 * 1000)
+
+G_GNUC_INTERNAL
+void		eom_pixel_cache_init		(void);
+
+G_GNUC_INTERNAL
+gchar *		eom_pixel_cache_get_key		(GFile       *file,
+						 goffset      size,
+						 guint64      mtime);
+
+G_GNUC_INTERNAL
+GdkPixbuf *	eom_pixel_cache_lookup		(const gchar *key,
+						 gint        *orientation,
+						 gchar      **file_type);
+
+G_GNUC_INTERNAL
+void		eom_pixel_cache_store		(const gchar *key,
+						 GdkPixbuf   *pixbuf,
+						 gint         orientation,
+						 const gchar *file_type);
+
+G_END_DECLS
+
+#endif /* __EOM_PIXEL_CACHE_H__ */
@@ -29,14 +29,26 @@
 struct _EomPrintPreviewPrivate {
 	GtkWidget *area;
 	GdkPixbuf *image;
-	GdkPixbuf *image_scaled;
+
+	/* Downscaled copies of the image, each one half the size
+	   of the previous one. Built once in the background. */
+	GPtrArray *mips;
 
 	/* The surface to set to the cairo context, created from the image */
 	cairo_surface_t *surface;
 
+	/* the size in pixels the current surface was rendered for */
+	gint surface_width, surface_height;
+
         /* Flag whether we have to create surface */
 	gboolean flag_create_surface;
 
+	/* set while a surface is being rendered in the background */
+	GCancellable *render_cancellable;
+
+	/* whether the surface went stale while rendering */
+	gboolean render_pending;
+
 	/* the alignment of the image in the page */
 	gfloat image_x_align, image_y_align;
 
@@ -97,8 +109,7 @@ static void eom_print_preview_draw (EomPrintPreview *preview, cairo_t *cr);
 static void eom_print_preview_finalize (GObject *object);
 static void update_relative_sizes (EomPrintPreview *preview);
 static void create_surface (EomPrintPreview *preview);
-static void create_image_scaled (EomPrintPreview *preview);
-static gboolean create_surface_when_idle (EomPrintPreview *preview);
+static void cancel_render (EomPrintPreview *preview);
 
 static void
 eom_print_preview_get_property (GObject    *object,
@@ -160,9 +171,16 @@ eom_print_preview_set_property (GObject      *object,
 		}
 		priv->image = GDK_PIXBUF (g_value_dup_object (value));
 
-		if (priv->image_scaled) {
-			g_object_unref (priv->image_scaled);
-			priv->image_scaled = NULL;
+		cancel_render (EOM_PRINT_PREVIEW (object));
+
+		if (priv->mips) {
+			g_ptr_array_unref (priv->mips);
+			priv->mips = NULL;
+		}
+
+		if (priv->surface) {
+			cairo_surface_destroy (priv->surface);
+			priv->surface = NULL;
 		}
 
 		priv->flag_create_surface = TRUE;
@@ -400,9 +418,11 @@ eom_print_preview_finalize (GObject *object)
 		priv->image = NULL;
 	}
 
-	if (priv->image_scaled) {
-		g_object_unref (priv->image_scaled);
-		priv->image_scaled = NULL;
+	cancel_render (EOM_PRINT_PREVIEW (object));
+
+	if (priv->mips) {
+		g_ptr_array_unref (priv->mips);
+		priv->mips = NULL;
 	}
 
 	if (priv->surface) {
@@ -434,13 +454,17 @@ eom_print_preview_init (EomPrintPreview *preview)
 			      0.5, 0.5, ratio, FALSE);
 
 	priv->image = NULL;
-	priv->image_scaled = NULL;
+	priv->mips = NULL;
 	priv->image_x_align = 0.5;
 	priv->image_y_align = 0.5;
 	priv->i_scale = 1;
 
 	priv->surface = NULL;
+	priv->surface_width = 0;
+	priv->surface_height = 0;
 	priv->flag_create_surface = TRUE;
+	priv->render_cancellable = NULL;
+	priv->render_pending = FALSE;
 
 	priv->p_scale = 0;
 
@@ -617,103 +641,231 @@ press_inside_image_area (EomPrintPreview *preview,
 	return FALSE;
 }
 
+/* Smallest mip level we bother to create, in pixels */
+#define MIP_MIN_SIZE 64
+
+typedef struct {
+	GdkPixbuf *image;
+	GPtrArray *mips;
+	gint width;
+	gint height;
+} RenderData;
+
 static void
-create_image_scaled (EomPrintPreview *preview)
+render_data_free (RenderData *data)
 {
-	EomPrintPreviewPrivate *priv = preview->priv;
+	g_object_unref (data->image);
 
-	if (!priv->image_scaled) {
-		gint i_width, i_height;
-		GtkAllocation allocation;
+	if (data->mips)
+		g_ptr_array_unref (data->mips);
 
-		gtk_widget_get_allocation (priv->area, &allocation);
-		i_width = gdk_pixbuf_get_width (priv->image);
-		i_height = gdk_pixbuf_get_height (priv->image);
+	g_slice_free (RenderData, data);
+}
 
-                if ((i_width > allocation.width) ||
-		    (i_height > allocation.height)) {
-			gdouble scale;
-			scale = MIN ((gdouble) allocation.width/i_width,
-				     (gdouble) allocation.height/i_height);
-			scale *= gtk_widget_get_scale_factor (GTK_WIDGET (priv->area));
-			priv->image_scaled = gdk_pixbuf_scale_simple (priv->image,
-								      i_width*scale,
-								      i_height*scale,
-								      GDK_INTERP_TILES);
-		} else {
-			priv->image_scaled = priv->image;
-			g_object_ref (priv->image_scaled);
-		}
+static GPtrArray *
+create_mips (GdkPixbuf *image, GCancellable *cancellable)
+{
+	GPtrArray *mips;
+	GdkPixbuf *level;
+	gint width, height;
+
+	mips = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (mips, g_object_ref (image));
+
+	level = image;
+	width = gdk_pixbuf_get_width (image) / 2;
+	height = gdk_pixbuf_get_height (image) / 2;
+
+	/* halving with bilinear filtering averages each 2x2 block,
+	   so every level is a proper box-filtered reduction */
+	while (width >= MIP_MIN_SIZE && height >= MIP_MIN_SIZE &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+		level = gdk_pixbuf_scale_simple (level, width, height,
+						 GDK_INTERP_BILINEAR);
+		if (level == NULL)
+			break;
+
+		g_ptr_array_add (mips, level);
+
+		width /= 2;
+		height /= 2;
 	}
+
+	return mips;
 }
 
-static GdkPixbuf *
-create_preview_buffer (EomPrintPreview *preview)
+static void
+render_thread (GTask        *task,
+	       gpointer      source_object,
+	       gpointer      task_data,
+	       GCancellable *cancellable)
 {
-	GdkPixbuf *pixbuf;
-	gint width, height, widget_scale;
+	RenderData *data = task_data;
+	GdkPixbuf *source, *pixbuf;
 	GdkInterpType type = GDK_INTERP_TILES;
+	guint i;
 
-	if (preview->priv->image == NULL) {
-		return NULL;
-	}
+	if (data->mips == NULL)
+		data->mips = create_mips (data->image, cancellable);
 
-	create_image_scaled (preview);
+	if (g_task_return_error_if_cancelled (task))
+		return;
 
-	width  = gdk_pixbuf_get_width (preview->priv->image);
-	height = gdk_pixbuf_get_height (preview->priv->image);
-	widget_scale = gtk_widget_get_scale_factor (GTK_WIDGET (preview->priv->area));
+	/* pick the smallest level which is still bigger than the buffer */
+	source = g_ptr_array_index (data->mips, 0);
+	for (i = 1; i < data->mips->len; i++) {
+		GdkPixbuf *level = g_ptr_array_index (data->mips, i);
 
-	width   *= preview->priv->i_scale * preview->priv->p_scale
-			* widget_scale;
-	height  *= preview->priv->i_scale * preview->priv->p_scale
-			* widget_scale;
+		if (gdk_pixbuf_get_width (level) < data->width ||
+		    gdk_pixbuf_get_height (level) < data->height)
+			break;
 
-	if (width < 1 || height < 1)
-		return NULL;
+		source = level;
+	}
 
 	/* to use GDK_INTERP_TILES for small pixbufs is expensive and unnecessary */
-	if (width < 25 || height < 25)
+	if (data->width < 25 || data->height < 25)
 		type = GDK_INTERP_NEAREST;
 
-	if (preview->priv->image_scaled) {
-		pixbuf = gdk_pixbuf_scale_simple (preview->priv->image_scaled,
-						  width, height, type);
-	} else {
-		pixbuf = gdk_pixbuf_scale_simple (preview->priv->image,
-						  width, height, type);
+	pixbuf = gdk_pixbuf_scale_simple (source, data->width, data->height, type);
+
+	g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+/**
+ * get_preview_buffer_size:
+ * @preview: an #EomPrintPreview
+ * @width: A pointer where to store the width.
+ * @height: A pointer where to store the height.
+ *
+ * Computes the size, in pixels, the image is currently drawn at.
+ *
+ * Returns: %FALSE if there is nothing to draw, %TRUE otherwise.
+ **/
+static gboolean
+get_preview_buffer_size (EomPrintPreview *preview,
+			 gint *width, gint *height)
+{
+	EomPrintPreviewPrivate *priv = preview->priv;
+	gint widget_scale;
+
+	if (priv->image == NULL) {
+		return FALSE;
 	}
 
-	return pixbuf;
+	widget_scale = gtk_widget_get_scale_factor (GTK_WIDGET (priv->area));
+
+	*width  = gdk_pixbuf_get_width (priv->image)
+		* priv->i_scale * priv->p_scale * widget_scale;
+	*height = gdk_pixbuf_get_height (priv->image)
+		* priv->i_scale * priv->p_scale * widget_scale;
+
+	return (*width >= 1 && *height >= 1);
 }
 
 static void
-create_surface (EomPrintPreview *preview)
+render_done_cb (GObject      *source_object,
+		GAsyncResult *res,
+		gpointer      user_data)
 {
+	EomPrintPreview *preview = EOM_PRINT_PREVIEW (source_object);
 	EomPrintPreviewPrivate *priv = preview->priv;
+	GTask *task = G_TASK (res);
+	RenderData *data;
 	GdkPixbuf *pixbuf;
 
-	if (priv->surface) {
-		cairo_surface_destroy (priv->surface);
-		priv->surface = NULL;
+	data = g_task_get_task_data (task);
+	pixbuf = g_task_propagate_pointer (task, NULL);
+
+	/* results of a render cancelled by an image change are dropped */
+	if (g_task_get_cancellable (task) == priv->render_cancellable) {
+		g_clear_object (&priv->render_cancellable);
+
+		if (priv->mips == NULL && data->mips != NULL)
+			priv->mips = g_ptr_array_ref (data->mips);
+
+		if (pixbuf) {
+			if (priv->surface)
+				cairo_surface_destroy (priv->surface);
+
+			priv->surface =
+				gdk_cairo_surface_create_from_pixbuf (pixbuf, 0,
+				                                      gtk_widget_get_window (GTK_WIDGET (preview)));
+			priv->surface_width = data->width;
+			priv->surface_height = data->height;
+		}
+
+		gtk_widget_queue_draw (GTK_WIDGET (preview));
 	}
 
-	pixbuf = create_preview_buffer (preview);
-	if (pixbuf) {
-		priv->surface =
-			gdk_cairo_surface_create_from_pixbuf (pixbuf, 0,
-			                                      gtk_widget_get_window (GTK_WIDGET (preview)));
+	if (pixbuf)
 		g_object_unref (pixbuf);
+
+	if (priv->render_cancellable == NULL && priv->render_pending) {
+		priv->render_pending = FALSE;
+		create_surface (preview);
 	}
-	priv->flag_create_surface = FALSE;
 }
 
-static gboolean
-create_surface_when_idle (EomPrintPreview *preview)
+static void
+cancel_render (EomPrintPreview *preview)
 {
-	create_surface (preview);
+	EomPrintPreviewPrivate *priv = preview->priv;
 
-	return FALSE;
+	if (priv->render_cancellable) {
+		g_cancellable_cancel (priv->render_cancellable);
+		g_clear_object (&priv->render_cancellable);
+	}
+}
+
+/**
+ * create_surface:
+ * @preview: an #EomPrintPreview
+ *
+ * Starts rendering the preview surface in a background thread. Requests
+ * made while a render is running are coalesced into a single one, issued
+ * with the latest settings once the running one finishes.
+ **/
+static void
+create_surface (EomPrintPreview *preview)
+{
+	EomPrintPreviewPrivate *priv = preview->priv;
+	RenderData *data;
+	GTask *task;
+	gint width, height;
+
+	priv->flag_create_surface = FALSE;
+
+	if (priv->render_cancellable) {
+		priv->render_pending = TRUE;
+		return;
+	}
+
+	if (!get_preview_buffer_size (preview, &width, &height)) {
+		if (priv->surface) {
+			cairo_surface_destroy (priv->surface);
+			priv->surface = NULL;
+		}
+		return;
+	}
+
+	if (priv->surface &&
+	    priv->surface_width == width && priv->surface_height == height)
+		return;
+
+	data = g_slice_new0 (RenderData);
+	data->image = g_object_ref (priv->image);
+	data->mips = priv->mips ? g_ptr_array_ref (priv->mips) : NULL;
+	data->width = width;
+	data->height = height;
+
+	priv->render_cancellable = g_cancellable_new ();
+
+	task = g_task_new (preview, priv->render_cancellable,
+			   render_done_cb, NULL);
+	g_task_set_task_data (task, data, (GDestroyNotify) render_data_free);
+	g_task_run_in_thread (task, render_thread);
+	g_object_unref (task);
 }
 
 static gboolean
@@ -876,13 +1028,6 @@ size_allocate_cb (GtkWidget *widget,
 	update_relative_sizes (preview);
 
 	preview->priv->flag_create_surface = TRUE;
-
-	if (preview->priv->image_scaled) {
-		g_object_unref (preview->priv->image_scaled);
-		preview->priv->image_scaled = NULL;
-	}
-
-	g_idle_add ((GSourceFunc) create_surface_when_idle, preview);
 }
 
 static void
@@ -922,30 +1067,23 @@ eom_print_preview_draw (EomPrintPreview *preview, cairo_t *cr)
 	}
 
 	if (priv->surface) {
-		cairo_set_source_surface (cr, priv->surface, x0, y0);
-		cairo_paint (cr);
-	} else if (priv->image_scaled) {
-		/* just in the remote case we don't have the surface */
-
-		/* adjust (x0, y0) to the new scale */
-		gdouble scale = priv->i_scale * priv->p_scale *
-			gdk_pixbuf_get_width (priv->image) / gdk_pixbuf_get_width (priv->image_scaled);
-		x0 /= scale;
-		y0 /= scale;
-
-		cairo_scale (cr, scale, scale);
-		gdk_cairo_set_source_pixbuf (cr, priv->image_scaled, x0, y0);
-		cairo_paint (cr);
-	} else if (priv->image) {
-		/* just in the remote case we don't have the surface */
-
-		/* adjust (x0, y0) to the new scale */
-		x0 /=  priv->i_scale * priv->p_scale;
-		y0 /=  priv->i_scale * priv->p_scale;
+		gint width, height;
+
+		cairo_save (cr);
+		cairo_translate (cr, x0, y0);
+
+		/* stretch the last surface until the one being
+		   rendered in the background is ready */
+		if (get_preview_buffer_size (preview, &width, &height) &&
+		    (width != priv->surface_width || height != priv->surface_height)) {
+			cairo_scale (cr,
+				     (gdouble) width / priv->surface_width,
+				     (gdouble) height / priv->surface_height);
+		}
 
-		cairo_scale (cr, priv->i_scale*priv->p_scale, priv->i_scale*priv->p_scale);
-		gdk_cairo_set_source_pixbuf (cr, priv->image, x0, y0);
+		cairo_set_source_surface (cr, priv->surface, 0, 0);
 		cairo_paint (cr);
+		cairo_restore (cr);
 	}
 
 	if (has_focus) {
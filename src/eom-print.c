@@ -21,9 +21,11 @@
 
 #include "config.h"
 
+#include <math.h>
 #include <gtk/gtk.h>
 #include <glib/gi18n.h>
 #include "eom-image.h"
+#include "eom-image-private.h"
 #include "eom-print.h"
 #include "eom-print-image-setup.h"
 #include "eom-util.h"
@@ -125,9 +127,7 @@ eom_print_draw_page (GtkPrintOperation *operation,
 #ifdef HAVE_RSVG
 	if (eom_image_is_svg (data->image))
 	{
-		RsvgHandle *svg = eom_image_get_svg (data->image);
-
-		rsvg_handle_render_cairo (svg, cr);
+		eom_image_render_svg (eom_image_get_svg (data->image), cr);
 		return;
 	} else
 #endif
@@ -246,9 +246,57 @@ eom_print_draw_page (GtkPrintOperation *operation,
 	}
 
 	{
+		GtkPrintSettings *settings;
 		GdkPixbuf *pixbuf;
+		gdouble res_x, res_y;
+		gdouble dev_width, dev_height;
+		gint pix_width, pix_height;
 
 		pixbuf = eom_image_get_pixbuf (data->image);
+		pix_width = gdk_pixbuf_get_width (pixbuf);
+		pix_height = gdk_pixbuf_get_height (pixbuf);
+
+		/* The context resolution only tells how big a cairo unit
+		 * is, PDF and PostScript backends always report 72 dpi.
+		 * The printer resolution comes from the print settings. */
+		res_x = dpi_x;
+		res_y = dpi_y;
+
+		settings = gtk_print_operation_get_print_settings (operation);
+		if (settings != NULL) {
+			if (gtk_print_settings_get_resolution_x (settings) > 0)
+				res_x = gtk_print_settings_get_resolution_x (settings);
+			if (gtk_print_settings_get_resolution_y (settings) > 0)
+				res_y = gtk_print_settings_get_resolution_y (settings);
+		}
+
+		/* There is no point in sending more pixels than the printer
+		 * can put on paper, so downscale the image to the printer
+		 * resolution before handing it to cairo. */
+		dev_width = ceil (pix_width * scale_factor * res_x / dpi_x);
+		dev_height = ceil (pix_height * scale_factor * res_y / dpi_y);
+
+		if (dev_width >= 1 && dev_height >= 1 &&
+		    (dev_width < pix_width || dev_height < pix_height)) {
+			GdkPixbuf *scaled;
+
+			eom_debug_message (DEBUG_PRINTING,
+					   "Rasterizing at %.0fx%.0f printer pixels",
+					   dev_width, dev_height);
+
+			scaled = gdk_pixbuf_scale_simple (pixbuf,
+							  MIN (dev_width, pix_width),
+							  MIN (dev_height, pix_height),
+							  GDK_INTERP_BILINEAR);
+			if (scaled != NULL) {
+				cairo_scale (cr,
+					     (gdouble) pix_width / gdk_pixbuf_get_width (scaled),
+					     (gdouble) pix_height / gdk_pixbuf_get_height (scaled));
+				g_object_unref (pixbuf);
+				pixbuf = scaled;
+			}
+		}
+
 		gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
  		cairo_paint (cr);
 		g_object_unref (pixbuf);
@@ -409,6 +409,8 @@ pd_update_metadata_tab (EomPropertiesDialog *prop_dlg,
 		gtk_label_set_text (GTK_LABEL (priv->xmp_keywords_label), NULL);
 		gtk_label_set_text (GTK_LABEL (priv->xmp_creator_label), NULL);
 		gtk_label_set_text (GTK_LABEL (priv->xmp_rights_label), NULL);
+
+		eom_metadata_details_xmp_update (EOM_METADATA_DETAILS (priv->metadata_details), NULL);
 	}
 #endif
 }
@@ -14,6 +14,7 @@
 #include "eom-enum-types.h"
 #include "eom-marshal.h"
 #include "eom-scroll-view.h"
+#include "eom-image-private.h"
 #include "eom-debug.h"
 #include "zoom.h"
 
@@ -37,6 +38,24 @@
  */
 #define IMAGE_VIEW_ZOOM_MULTIPLIER 1.05
 
+/* Duration of the animation towards a new zoom factor, in microseconds */
+#define ZOOM_ANIMATION_TIME 150000
+
+/* Kinetic panning decelerates by this factor per second, and stops
+ * below the minimum velocity in pixels per second */
+#define KINETIC_FRICTION 4.0
+#define KINETIC_MIN_VELOCITY 30.0
+
+/* Number of halved copies of the image kept for animation frames */
+#define PREVIEW_LEVELS 4
+
+/* SVGs are rasterized in square tiles of this many logical pixels.
+ * Tiles away from the visible area are dropped once the cache holds
+ * more than SVG_TILE_CACHE_SIZE of them. */
+#define SVG_TILE_SIZE 256
+#define SVG_TILE_CACHE_SIZE 64
+#define SVG_TILE_MAX_INDEX 0x7fff
+
 /* States for automatically adjusting the zoom factor */
 typedef enum {
 	ZOOM_MODE_FIT,		/* Image is fitted to scroll view even if the latter changes size */
@@ -75,6 +94,22 @@ enum {
 	PROP_ZOOM_MULTIPLIER
 };
 
+/* A rescale of the visible part of the image, at the given zoom factor
+ * and offsets, with a filter too expensive to run on the UI thread */
+typedef struct {
+	EomScrollView *view;
+	GdkPixbuf *pixbuf;
+	cairo_surface_t *source;
+	cairo_surface_t *target;
+	cairo_filter_t filter;
+	double zoom;
+	int width, height, scale;
+	int xofs, yofs;
+	int scaled_width, scaled_height;
+	gint bands_left;
+	gint cancelled;
+} HQRequest;
+
 /* Private part of the EomScrollView structure */
 struct _EomScrollViewPrivate {
 	/* some widgets we rely on */
@@ -143,13 +178,51 @@ struct _EomScrollViewPrivate {
 
 	cairo_surface_t *background_surface;
 
-	/* Two-pass filtering */
-	GSource *hq_redraw_timeout_source;
-	gboolean force_unfiltered;
+	/* High quality rescaling, done by worker threads */
+	HQRequest *hq_request;
+	HQRequest *hq_result;
+
+	/* The rendered viewport, kept around so that scrolling only
+	 * needs to draw the newly exposed areas. It is only valid for
+	 * the zoom factor and size it was rendered at. */
+	cairo_surface_t *view_surface;
+	cairo_surface_t *view_back_surface;
+	int view_width, view_height, view_scale;
+	int view_xofs, view_yofs;
+	double view_zoom;
+	cairo_filter_t view_filter;
+	gboolean view_preview;
+
+	/* Zooming and panning applied once per frame by the frame clock */
+	guint tick_id;
+	gint64 last_frame_time;
+	double pending_dx, pending_dy;
+	gboolean zoom_animating;
+	double zoom_start, zoom_target;
+	gint64 zoom_start_time;
+	int zoom_anchor_x, zoom_anchor_y;
+	gboolean zoom_have_anchor;
+	gboolean kinetic;
+	double velocity_x, velocity_y;
+	guint32 last_motion_time;
+	int last_motion_x, last_motion_y;
+
+	/* Halved copies of the surface, drawn while animating */
+	cairo_surface_t *preview_surfaces[PREVIEW_LEVELS];
+
+	/* Rasterized SVG tiles for the zoom and scale factor below, by
+	 * tile position. Tiles still being rendered map to NULL. */
+	GHashTable *svg_tiles;
+	double svg_tiles_zoom;
+	int svg_tiles_scale;
+	gint svg_tiles_generation;
 };
 
 static void scroll_by (EomScrollView *view, int xofs, int yofs);
 static void set_zoom_fit (EomScrollView *view);
+static void stop_animation (EomScrollView *view);
+static void preview_clear (EomScrollView *view);
+static void svg_tiles_clear (EomScrollView *view);
 /* static void request_paint_area (EomScrollView *view, GdkRectangle *area); */
 static void set_minimum_zoom_factor (EomScrollView *view);
 static void view_on_drag_begin_cb (GtkWidget *widget, GdkDragContext *context,
@@ -172,11 +245,19 @@ static cairo_surface_t *
 create_surface_from_pixbuf (EomScrollView *view, GdkPixbuf *pixbuf)
 {
 	cairo_surface_t *surface;
+	gint64 start;
+
+	start = eom_trace_now ();
 
 	surface = gdk_cairo_surface_create_from_pixbuf (pixbuf,
 			                                view->priv->scale,
 			                                gtk_widget_get_window (view->priv->display));
 
+	eom_trace_complete ("view", "surface-upload", start,
+			    "\"width\":%d,\"height\":%d",
+			    gdk_pixbuf_get_width (pixbuf),
+			    gdk_pixbuf_get_height (pixbuf));
+
 	return surface;
 }
 
@@ -188,6 +269,8 @@ free_image_resources (EomScrollView *view)
 
 	priv = view->priv;
 
+	stop_animation (view);
+
 #if GLIB_CHECK_VERSION(2,62,0)
 	g_clear_signal_handler (&priv->image_changed_id, priv->image);
 	g_clear_signal_handler (&priv->frame_changed_id, priv->image);
@@ -217,6 +300,9 @@ free_image_resources (EomScrollView *view)
 		cairo_surface_destroy (priv->surface);
 		priv->surface = NULL;
 	}
+
+	preview_clear (view);
+	svg_tiles_clear (view);
 }
 
 /* Computes the size in pixels of the scaled image */
@@ -777,6 +863,8 @@ set_zoom_fit (EomScrollView *view)
 
 	priv = view->priv;
 
+	stop_animation (view);
+
 	priv->zoom_mode = ZOOM_MODE_FIT;
 
 	if (!gtk_widget_get_mapped (GTK_WIDGET (view)))
@@ -804,6 +892,199 @@ set_zoom_fit (EomScrollView *view)
 	g_signal_emit (view, view_signals[SIGNAL_ZOOM_CHANGED], 0, priv->zoom);
 }
 
+/*===================================
+
+   frame clock driven animation
+
+  ---------------------------------*/
+
+/* Applies the zoom and scrolling that accumulated since the last frame,
+ * so that input arriving faster than the display refreshes only causes
+ * one redraw per frame */
+static gboolean
+view_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+{
+	EomScrollView *view;
+	EomScrollViewPrivate *priv;
+	gint64 now;
+	double dt;
+	int dx, dy;
+
+	view = EOM_SCROLL_VIEW (data);
+	priv = view->priv;
+
+	now = gdk_frame_clock_get_frame_time (frame_clock);
+	dt = priv->last_frame_time > 0 ?
+		(double) (now - priv->last_frame_time) / G_USEC_PER_SEC : 0.0;
+	priv->last_frame_time = now;
+
+	if (priv->zoom_animating) {
+		double t;
+
+		if (priv->zoom_start_time == 0)
+			priv->zoom_start_time = now;
+
+		t = MIN (1.0, (double) (now - priv->zoom_start_time) / ZOOM_ANIMATION_TIME);
+
+		/* Ease out, interpolating in log space so that every
+		 * frame changes the zoom by the same ratio */
+		set_zoom (view,
+			  priv->zoom_start * pow (priv->zoom_target / priv->zoom_start,
+						  1.0 - pow (1.0 - t, 3.0)),
+			  priv->zoom_have_anchor,
+			  priv->zoom_anchor_x, priv->zoom_anchor_y);
+
+		if (t >= 1.0)
+			priv->zoom_animating = FALSE;
+	}
+
+	if (priv->kinetic) {
+		double decay = exp (-KINETIC_FRICTION * dt);
+
+		priv->pending_dx += priv->velocity_x * dt;
+		priv->pending_dy += priv->velocity_y * dt;
+		priv->velocity_x *= decay;
+		priv->velocity_y *= decay;
+
+		if (hypot (priv->velocity_x, priv->velocity_y) < KINETIC_MIN_VELOCITY)
+			priv->kinetic = FALSE;
+	}
+
+	dx = (int) priv->pending_dx;
+	dy = (int) priv->pending_dy;
+
+	if (dx != 0 || dy != 0) {
+		int xofs = priv->xofs;
+		int yofs = priv->yofs;
+
+		priv->pending_dx -= dx;
+		priv->pending_dy -= dy;
+
+		scroll_by (view, dx, dy);
+
+		/* Stop flinging at the edges of the image */
+		if (priv->xofs == xofs && priv->yofs == yofs)
+			priv->kinetic = FALSE;
+	}
+
+	if (priv->zoom_animating || priv->kinetic)
+		return G_SOURCE_CONTINUE;
+
+	priv->tick_id = 0;
+	priv->last_frame_time = 0;
+	priv->pending_dx = 0.0;
+	priv->pending_dy = 0.0;
+
+	/* At rest, replace the quick frames by a high quality one */
+	gtk_widget_queue_draw (priv->display);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+ensure_tick (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	if (priv->tick_id == 0)
+		priv->tick_id = gtk_widget_add_tick_callback (priv->display,
+							      view_tick_cb,
+							      view, NULL);
+}
+
+static void
+stop_animation (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	if (priv->tick_id != 0) {
+		gtk_widget_remove_tick_callback (priv->display, priv->tick_id);
+		priv->tick_id = 0;
+	}
+
+	priv->last_frame_time = 0;
+	priv->pending_dx = 0.0;
+	priv->pending_dy = 0.0;
+	priv->zoom_animating = FALSE;
+	priv->kinetic = FALSE;
+}
+
+/* Scrolls by the given amount of pixels on the next frame */
+static void
+queue_scroll (EomScrollView *view, double dx, double dy)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	priv->pending_dx += dx;
+	priv->pending_dy += dy;
+
+	ensure_tick (view);
+}
+
+/* Animates the zoom towards @factor times the zoom being animated to.
+ * Further requests during the animation retarget it, so that smooth
+ * scrolling deltas add up instead of being applied one by one. */
+static void
+queue_zoom (EomScrollView *view, double factor,
+	    gboolean have_anchor, int anchorx, int anchory)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	double target;
+
+	if (priv->pixbuf == NULL)
+		return;
+
+	target = (priv->zoom_animating ? priv->zoom_target : priv->zoom) * factor;
+
+	priv->zoom_start = priv->zoom;
+	priv->zoom_target = CLAMP (target, MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+	priv->zoom_start_time = 0;
+	priv->zoom_have_anchor = have_anchor;
+	priv->zoom_anchor_x = anchorx;
+	priv->zoom_anchor_y = anchory;
+	priv->zoom_animating = !DOUBLE_EQUAL (priv->zoom_start, priv->zoom_target);
+
+	if (priv->zoom_animating)
+		ensure_tick (view);
+}
+
+/* Keeps a running estimate of the panning velocity from the scroll or
+ * motion events, in pixels per second */
+static void
+track_velocity (EomScrollView *view, double dx, double dy, guint32 time)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	guint32 elapsed = time - priv->last_motion_time;
+
+	if (priv->last_motion_time == 0 || elapsed > 100) {
+		priv->velocity_x = 0.0;
+		priv->velocity_y = 0.0;
+	} else if (elapsed > 0) {
+		priv->velocity_x = 0.6 * dx * 1000.0 / elapsed + 0.4 * priv->velocity_x;
+		priv->velocity_y = 0.6 * dy * 1000.0 / elapsed + 0.4 * priv->velocity_y;
+	}
+
+	priv->last_motion_time = time;
+}
+
+static void
+start_kinetic (EomScrollView *view, guint32 time)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	/* The pointer rested before it was released */
+	if (time - priv->last_motion_time > 100)
+		priv->kinetic = FALSE;
+	else
+		priv->kinetic = (hypot (priv->velocity_x, priv->velocity_y)
+				 >= KINETIC_MIN_VELOCITY);
+
+	priv->last_motion_time = 0;
+
+	if (priv->kinetic)
+		ensure_tick (view);
+}
+
 /*===================================
 
    internal signal callbacks
@@ -951,6 +1232,9 @@ eom_scroll_view_button_press_event (GtkWidget *widget, GdkEventButton *event, gp
 			if (is_image_movable (view)) {
 				eom_scroll_view_set_cursor (view, EOM_SCROLL_VIEW_CURSOR_DRAG);
 
+				/* Catch the image if it is still moving */
+				stop_animation (view);
+
 				priv->dragging = TRUE;
 				priv->drag_anchor_x = event->x;
 				priv->drag_anchor_y = event->y;
@@ -958,6 +1242,12 @@ eom_scroll_view_button_press_event (GtkWidget *widget, GdkEventButton *event, gp
 				priv->drag_ofs_x = priv->xofs;
 				priv->drag_ofs_y = priv->yofs;
 
+				priv->last_motion_x = event->x;
+				priv->last_motion_y = event->y;
+				priv->last_motion_time = event->time;
+				priv->velocity_x = 0.0;
+				priv->velocity_y = 0.0;
+
 				return TRUE;
 			}
 		default:
@@ -986,6 +1276,9 @@ eom_scroll_view_button_release_event (GtkWidget *widget, GdkEventButton *event,
 			drag_to (view, event->x, event->y);
 			priv->dragging = FALSE;
 
+			/* Keep the image moving after a quick drag */
+			start_kinetic (view, event->time);
+
 			eom_scroll_view_set_cursor (view, EOM_SCROLL_VIEW_CURSOR_NORMAL);
 			break;
 
@@ -1006,40 +1299,44 @@ eom_scroll_view_scroll_event (GtkWidget *widget, GdkEventScroll *event, gpointer
 {
 	EomScrollView *view;
 	EomScrollViewPrivate *priv;
-	double zoom_factor;
-	int xofs, yofs;
+	double delta_x = 0.0, delta_y = 0.0;
+	double step_x, step_y, zoom_steps;
+	gboolean zoom;
 
 	view = EOM_SCROLL_VIEW (data);
 	priv = view->priv;
 
-	/* Compute zoom factor and scrolling offsets; we'll only use either of them */
+	/* Compute the scrolling steps */
 	/* same as in gtkscrolledwindow.c */
-	xofs = gtk_adjustment_get_page_increment (priv->hadj) / 2;
-	yofs = gtk_adjustment_get_page_increment (priv->vadj) / 2;
+	step_x = gtk_adjustment_get_page_increment (priv->hadj) / 2;
+	step_y = gtk_adjustment_get_page_increment (priv->vadj) / 2;
 
 	switch (event->direction) {
 	case GDK_SCROLL_UP:
-		zoom_factor = priv->zoom_multiplier;
-		xofs = 0;
-		yofs = -yofs;
+		delta_y = -1.0;
+		zoom_steps = 1.0;
 		break;
 
 	case GDK_SCROLL_LEFT:
-		zoom_factor = 1.0 / priv->zoom_multiplier;
-		xofs = -xofs;
-		yofs = 0;
+		delta_x = -1.0;
+		zoom_steps = -1.0;
 		break;
 
 	case GDK_SCROLL_DOWN:
-		zoom_factor = 1.0 / priv->zoom_multiplier;
-		xofs = 0;
-		/* yofs = yofs; */
+		delta_y = 1.0;
+		zoom_steps = -1.0;
 		break;
 
 	case GDK_SCROLL_RIGHT:
-		zoom_factor = priv->zoom_multiplier;
-		/* xofs = xofs; */
-		yofs = 0;
+		delta_x = 1.0;
+		zoom_steps = 1.0;
+		break;
+
+	case GDK_SCROLL_SMOOTH:
+		gdk_event_get_scroll_deltas ((GdkEvent *) event, &delta_x, &delta_y);
+		zoom_steps = -delta_y;
+		step_x = pow (gtk_adjustment_get_page_size (priv->hadj), 2.0 / 3.0);
+		step_y = pow (gtk_adjustment_get_page_size (priv->vadj), 2.0 / 3.0);
 		break;
 
 	default:
@@ -1047,23 +1344,43 @@ eom_scroll_view_scroll_event (GtkWidget *widget, GdkEventScroll *event, gpointer
 		return FALSE;
 	}
 
-        if (priv->scroll_wheel_zoom) {
-		if (event->state & GDK_SHIFT_MASK)
-			scroll_by (view, yofs, xofs);
-		else if (event->state & GDK_CONTROL_MASK)
-			scroll_by (view, xofs, yofs);
-		else
-			set_zoom (view, priv->zoom * zoom_factor,
-				  TRUE, event->x, event->y);
-	} else {
-		if (event->state & GDK_SHIFT_MASK)
-			scroll_by (view, yofs, xofs);
-		else if (event->state & GDK_CONTROL_MASK)
-			set_zoom (view, priv->zoom * zoom_factor,
-				  TRUE, event->x, event->y);
-		else
-			scroll_by (view, xofs, yofs);
-        }
+	if (event->state & GDK_SHIFT_MASK)
+		zoom = FALSE;
+	else if (priv->scroll_wheel_zoom)
+		zoom = !(event->state & GDK_CONTROL_MASK);
+	else
+		zoom = (event->state & GDK_CONTROL_MASK) != 0;
+
+	if (zoom) {
+		if (zoom_steps != 0.0)
+			queue_zoom (view, pow (priv->zoom_multiplier, zoom_steps),
+				    TRUE, event->x, event->y);
+		return TRUE;
+	}
+
+	delta_x *= step_x;
+	delta_y *= step_y;
+
+	if (event->state & GDK_SHIFT_MASK) {
+		double tmp = delta_x;
+
+		delta_x = delta_y;
+		delta_y = tmp;
+	}
+
+	if (event->direction == GDK_SCROLL_SMOOTH) {
+		priv->kinetic = FALSE;
+
+		/* Fling when the fingers are lifted off the touchpad */
+		if (gdk_event_is_scroll_stop_event ((GdkEvent *) event)) {
+			start_kinetic (view, event->time);
+			return TRUE;
+		}
+
+		track_velocity (view, delta_x, delta_y, event->time);
+	}
+
+	queue_scroll (view, delta_x, delta_y);
 
 	return TRUE;
 }
@@ -1090,6 +1407,12 @@ eom_scroll_view_motion_event (GtkWidget *widget, GdkEventMotion *event, gpointer
 		y = event->y;
 	}
 
+	/* The image moves against the pointer */
+	track_velocity (view, priv->last_motion_x - x,
+			priv->last_motion_y - y, event->time);
+	priv->last_motion_x = x;
+	priv->last_motion_y = y;
+
 	drag_to (view, x, y);
 	return TRUE;
 }
@@ -1177,217 +1500,973 @@ eom_scroll_view_focus_out_event (GtkWidget     *widget,
 	return FALSE;
 }
 
-static gboolean _hq_redraw_cb (gpointer user_data)
-{
-	EomScrollViewPrivate *priv = EOM_SCROLL_VIEW (user_data)->priv;
-
-	priv->force_unfiltered = FALSE;
-	gtk_widget_queue_draw (priv->display);
-
-	priv->hq_redraw_timeout_source = NULL;
-	return G_SOURCE_REMOVE;
-}
-
-static void
-_clear_hq_redraw_timeout (EomScrollView *view)
-{
-	EomScrollViewPrivate *priv = view->priv;
+/* Device pixel rows rescaled by a worker thread at a time */
+#define HQ_BAND_HEIGHT 64
 
-	if (priv->hq_redraw_timeout_source != NULL) {
-		g_source_unref (priv->hq_redraw_timeout_source);
-		g_source_destroy (priv->hq_redraw_timeout_source);
-	}
+typedef struct {
+	HQRequest *request;
+	int y, height;
+} HQBand;
 
-	priv->hq_redraw_timeout_source = NULL;
-}
+static GThreadPool *hq_pool = NULL;
 
 static void
-_set_hq_redraw_timeout (EomScrollView *view)
+hq_request_free (HQRequest *request)
 {
-	GSource *source;
+	if (request->view != NULL)
+		g_object_unref (request->view);
 
-	_clear_hq_redraw_timeout (view);
+	if (request->pixbuf != NULL)
+		g_object_unref (request->pixbuf);
 
-	source = g_timeout_source_new (200);
-	g_source_set_callback (source, &_hq_redraw_cb, view, NULL);
+	if (request->source != NULL)
+		cairo_surface_destroy (request->source);
 
-	g_source_attach (source, NULL);
+	cairo_surface_destroy (request->target);
 
-	view->priv->hq_redraw_timeout_source = source;
+	g_slice_free (HQRequest, request);
 }
 
+static void invalidate_view_surface (EomScrollView *view);
+
 static gboolean
-display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
+hq_request_done_cb (gpointer data)
 {
-	const GdkRGBA *background_color = NULL;
-	EomScrollView *view;
-	EomScrollViewPrivate *priv;
-	GtkAllocation allocation;
-	int scaled_width, scaled_height;
-	int xofs, yofs;
+	HQRequest *request = data;
+	EomScrollViewPrivate *priv = request->view->priv;
 
-	g_return_val_if_fail (GTK_IS_DRAWING_AREA (widget), FALSE);
-	g_return_val_if_fail (EOM_IS_SCROLL_VIEW (data), FALSE);
+	if (request->pixbuf != NULL) {
+		GdkPixbuf *pixbuf = request->pixbuf;
 
-	view = EOM_SCROLL_VIEW (data);
+		/* Rescaled ahead of time, kept along with the pixbuf
+		 * until the view shows it */
+		request->pixbuf = NULL;
+		cairo_surface_mark_dirty (request->target);
+		g_clear_object (&request->view);
+		cairo_surface_destroy (request->source);
+		request->source = NULL;
 
-	priv = view->priv;
+		g_object_set_data_full (G_OBJECT (pixbuf), "eom-view-prescaled",
+					request, (GDestroyNotify) hq_request_free);
+		g_object_unref (pixbuf);
 
-	if (priv->pixbuf == NULL)
-		return TRUE;
+		return G_SOURCE_REMOVE;
+	}
 
-	compute_scaled_size (view, priv->zoom, &scaled_width, &scaled_height);
+	if (priv->hq_request != request) {
+		hq_request_free (request);
+		return G_SOURCE_REMOVE;
+	}
 
-	gtk_widget_get_allocation (priv->display, &allocation);
+	priv->hq_request = NULL;
 
-	/* Compute image offsets with respect to the window */
+	cairo_surface_mark_dirty (request->target);
 
-	if (scaled_width <= allocation.width)
-		xofs = (allocation.width - scaled_width) / 2;
-	else
-		xofs = -priv->xofs;
+	if (priv->hq_result != NULL)
+		hq_request_free (priv->hq_result);
 
-	if (scaled_height <= allocation.height)
-		yofs = (allocation.height - scaled_height) / 2;
-	else
-		yofs = -priv->yofs;
+	priv->hq_result = request;
 
-	eom_debug_message (DEBUG_WINDOW, "zoom %.2f, xofs: %i, yofs: %i scaled w: %i h: %i\n",
-	priv->zoom, xofs, yofs, scaled_width, scaled_height);
+	invalidate_view_surface (request->view);
+	gtk_widget_queue_draw (priv->display);
 
-	/* Paint the background */
-	cairo_rectangle (cr, 0, 0, allocation.width, allocation.height);
-	if (priv->transp_style != EOM_TRANSP_BACKGROUND)
-		cairo_rectangle (cr, MAX (0, xofs), MAX (0, yofs),
-				 scaled_width, scaled_height);
-	if (priv->override_bg_color != NULL)
-		background_color = priv->override_bg_color;
-	else if (priv->use_bg_color)
-		background_color = priv->background_color;
-	if (background_color != NULL)
-		cairo_set_source_rgba (cr,
-				       background_color->red,
-				       background_color->green,
-				       background_color->blue,
-				       background_color->alpha);
-	else
-		cairo_set_source (cr, gdk_window_get_background_pattern (gtk_widget_get_window (priv->display)));
-	cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-	cairo_fill (cr);
+	/* Only the result is kept from now on */
+	g_clear_object (&request->view);
+	cairo_surface_destroy (request->source);
+	request->source = NULL;
 
-	if (gdk_pixbuf_get_has_alpha (priv->pixbuf)) {
-		if (priv->background_surface == NULL) {
-			priv->background_surface = create_background_surface (view);
-		}
-		cairo_set_source_surface (cr, priv->background_surface, xofs, yofs);
-		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_REPEAT);
-		cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
-		cairo_fill (cr);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+hq_band_run (gpointer data, gpointer user_data)
+{
+	HQBand *band = data;
+	HQRequest *request = band->request;
+
+	if (!g_atomic_int_get (&request->cancelled)) {
+		cairo_surface_t *surface;
+		cairo_t *cr;
+		unsigned char *pixels;
+		int stride;
+
+		stride = cairo_image_surface_get_stride (request->target);
+		pixels = cairo_image_surface_get_data (request->target)
+			+ band->y * stride;
+
+		/* Each band draws to its own rows of the target */
+		surface = cairo_image_surface_create_for_data (pixels,
+							       CAIRO_FORMAT_ARGB32,
+							       cairo_image_surface_get_width (request->target),
+							       band->height,
+							       stride);
+		cairo_surface_set_device_scale (surface, request->scale, request->scale);
+		cairo_surface_set_device_offset (surface, 0, -band->y);
+
+		cr = cairo_create (surface);
+
+		cairo_rectangle (cr, request->xofs, request->yofs,
+				 request->scaled_width, request->scaled_height);
+		cairo_clip (cr);
+
+		cairo_scale (cr, request->zoom, request->zoom);
+		cairo_set_source_surface (cr, request->source,
+					  request->xofs / request->zoom,
+					  request->yofs / request->zoom);
+		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+		cairo_pattern_set_filter (cairo_get_source (cr), request->filter);
+		cairo_paint (cr);
+
+		cairo_destroy (cr);
+		cairo_surface_destroy (surface);
 	}
 
-	/* Make sure the image is only drawn as large as needed.
-	 * This is especially necessary for SVGs where there might
-	 * be more image data available outside the image boundaries.
-	 */
-	cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
-	cairo_clip (cr);
+	if (g_atomic_int_dec_and_test (&request->bands_left))
+		g_idle_add (hq_request_done_cb, request);
 
-#ifdef HAVE_RSVG
-	if (eom_image_is_svg (view->priv->image)) {
-		cairo_matrix_t matrix, translate, scale, original;
-		EomTransform *transform = eom_image_get_transform (priv->image);
-		cairo_matrix_init_identity (&matrix);
-		if (transform) {
-			cairo_matrix_t affine;
-			int image_offset_x = 0;
-			int image_offset_y = 0;
-
-			eom_transform_get_affine (transform, &affine);
-			cairo_matrix_multiply (&matrix, &affine, &matrix);
-
-			switch (eom_transform_get_transform_type (transform)) {
-			case EOM_TRANSFORM_ROT_90:
-			case EOM_TRANSFORM_FLIP_HORIZONTAL:
-				image_offset_x = gdk_pixbuf_get_width (priv->pixbuf);
-				break;
-			case EOM_TRANSFORM_ROT_270:
-			case EOM_TRANSFORM_FLIP_VERTICAL:
-				image_offset_y = gdk_pixbuf_get_height (priv->pixbuf);
-				break;
-			case EOM_TRANSFORM_ROT_180:
-			case EOM_TRANSFORM_TRANSPOSE:
-			case EOM_TRANSFORM_TRANSVERSE:
-				image_offset_x = gdk_pixbuf_get_width (priv->pixbuf);
-				image_offset_y = gdk_pixbuf_get_height (priv->pixbuf);
-				break;
-			case EOM_TRANSFORM_NONE:
-				default:
-				break;
-			}
-			cairo_matrix_init_translate (&translate, (double) image_offset_x, (double) image_offset_y);
-			cairo_matrix_multiply (&matrix, &matrix, &translate);
-		}
-		/* Zoom factor for SVGs is already scaled, so scale back to application pixels. */
-		cairo_matrix_init_scale (&scale, priv->zoom / priv->scale, priv->zoom / priv->scale);
-		cairo_matrix_multiply (&matrix, &matrix, &scale);
-		cairo_matrix_init_translate (&translate, xofs, yofs);
-		cairo_matrix_multiply (&matrix, &matrix, &translate);
+	g_slice_free (HQBand, band);
+}
 
-		cairo_get_matrix (cr, &original);
-		cairo_matrix_multiply (&matrix, &matrix, &original);
-		cairo_set_matrix (cr, &matrix);
+static void
+hq_cancel (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
 
-		rsvg_handle_render_cairo (eom_image_get_svg (priv->image), cr);
+	/* The request is freed once its bands are done */
+	if (priv->hq_request != NULL) {
+		g_atomic_int_set (&priv->hq_request->cancelled, TRUE);
+		priv->hq_request = NULL;
+	}
+}
 
-	} else
-#endif /* HAVE_RSVG */
-	{
-		cairo_filter_t interp_type;
+static void
+hq_clear (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
 
-		if(!DOUBLE_EQUAL(priv->zoom, 1.0) && priv->force_unfiltered)
-		{
-			interp_type = CAIRO_FILTER_NEAREST;
-			_set_hq_redraw_timeout(view);
-		}
-		else
-		{
-			if (is_zoomed_in (view))
-				interp_type = priv->interp_type_in;
-			else
-				interp_type = priv->interp_type_out;
-
-			_clear_hq_redraw_timeout (view);
-			priv->force_unfiltered = TRUE;
-		}
-		cairo_scale (cr, priv->zoom, priv->zoom);
-		cairo_set_source_surface (cr, priv->surface, xofs/priv->zoom, yofs/priv->zoom);
-		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
-		if (is_zoomed_in (view) || is_zoomed_out (view))
-			cairo_pattern_set_filter (cairo_get_source (cr), interp_type);
+	hq_cancel (view);
 
-		cairo_paint (cr);
+	if (priv->hq_result != NULL) {
+		hq_request_free (priv->hq_result);
+		priv->hq_result = NULL;
 	}
+}
 
-	return TRUE;
+static gboolean
+hq_request_matches (HQRequest *request, EomScrollView *view,
+		    int width, int height, int scale,
+		    int xofs, int yofs, cairo_filter_t filter)
+{
+	return (request != NULL &&
+		request->width == width && request->height == height &&
+		request->scale == scale &&
+		request->xofs == xofs && request->yofs == yofs &&
+		request->filter == filter &&
+		DOUBLE_EQUAL (request->zoom, view->priv->zoom));
 }
 
-/*==================================
+/* Hands the rows of @request showing the image over to the worker
+ * threads, returns FALSE if there is nothing to rescale at all */
+static gboolean
+hq_request_push (HQRequest *request)
+{
+	int y, y_end;
 
-   image loading callbacks
+	/* Only the rows showing the image need to be rescaled */
+	y = MAX (0, request->yofs) * request->scale;
+	y_end = MIN (request->height, request->yofs + request->scaled_height) * request->scale;
 
-   -----------------------------------*/
+	if (y >= y_end)
+		return FALSE;
 
-/* Use when the pixbuf in the view is changed, to keep a
-   reference to it and create its cairo surface. */
-static void
-update_pixbuf (EomScrollView *view, GdkPixbuf *pixbuf)
-{
-	EomScrollViewPrivate *priv;
+	if (hq_pool == NULL)
+		hq_pool = g_thread_pool_new (hq_band_run, NULL,
+					     g_get_num_processors (),
+					     FALSE, NULL);
 
-	priv = view->priv;
+	request->bands_left = (y_end - y + HQ_BAND_HEIGHT - 1) / HQ_BAND_HEIGHT;
 
-	if (priv->pixbuf != NULL) {
-		g_object_unref (priv->pixbuf);
+	for (; y < y_end; y += HQ_BAND_HEIGHT) {
+		HQBand *band = g_slice_new (HQBand);
+
+		band->request = request;
+		band->y = y;
+		band->height = MIN (HQ_BAND_HEIGHT, y_end - y);
+
+		g_thread_pool_push (hq_pool, band, NULL);
+	}
+
+	return TRUE;
+}
+
+/* Starts rescaling the visible part of the image in the worker threads,
+ * superseding any rescale still running for an older zoom or position */
+static void
+hq_schedule (EomScrollView *view, int width, int height,
+	     int xofs, int yofs, int scaled_width, int scaled_height,
+	     cairo_filter_t filter)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	HQRequest *request;
+	int scale;
+
+	scale = gdk_window_get_scale_factor (gtk_widget_get_window (priv->display));
+
+	if (hq_request_matches (priv->hq_request, view, width, height, scale,
+				xofs, yofs, filter))
+		return;
+
+	hq_cancel (view);
+
+	request = g_slice_new0 (HQRequest);
+	request->view = g_object_ref (view);
+	request->source = cairo_surface_reference (priv->surface);
+	request->target = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      width * scale,
+						      height * scale);
+	cairo_surface_set_device_scale (request->target, scale, scale);
+	cairo_surface_flush (request->target);
+	request->filter = filter;
+	request->zoom = priv->zoom;
+	request->width = width;
+	request->height = height;
+	request->scale = scale;
+	request->xofs = xofs;
+	request->yofs = yofs;
+	request->scaled_width = scaled_width;
+	request->scaled_height = scaled_height;
+
+	if (!hq_request_push (request)) {
+		hq_request_free (request);
+		return;
+	}
+
+	priv->hq_request = request;
+}
+
+static void
+preview_clear (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	int i;
+
+	for (i = 0; i < PREVIEW_LEVELS; i++) {
+		if (priv->preview_surfaces[i] != NULL) {
+			cairo_surface_destroy (priv->preview_surfaces[i]);
+			priv->preview_surfaces[i] = NULL;
+		}
+	}
+}
+
+/* Returns a copy of @source with half its pixels in each direction and
+ * the same size in user space, so it can be drawn in place of @source */
+static cairo_surface_t *
+create_half_surface (cairo_surface_t *source, int source_width, int source_height)
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	double x_scale, y_scale;
+	int width, height;
+
+	width = MAX (1, source_width / 2);
+	height = MAX (1, source_height / 2);
+
+	cairo_surface_get_device_scale (source, &x_scale, &y_scale);
+
+	surface = cairo_surface_create_similar_image (source, CAIRO_FORMAT_ARGB32,
+						      width, height);
+	cairo_surface_set_device_scale (surface,
+					x_scale * width / source_width,
+					y_scale * height / source_height);
+
+	cr = cairo_create (surface);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface (cr, source, 0, 0);
+	cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_BILINEAR);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	return surface;
+}
+
+/* Picks the smallest halved copy of the image that still has at least
+ * one pixel per screen pixel at the current zoom. The copies are made
+ * from each other on first use, which is cheap compared to drawing
+ * every animation frame from the full sized image. */
+static cairo_surface_t *
+get_preview_surface (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	cairo_surface_t *source = priv->surface;
+	double zoom = priv->zoom;
+	int width, height, i;
+
+	width = gdk_pixbuf_get_width (priv->pixbuf);
+	height = gdk_pixbuf_get_height (priv->pixbuf);
+
+	for (i = 0; i < PREVIEW_LEVELS && zoom <= 0.5; i++) {
+		if (priv->preview_surfaces[i] == NULL)
+			priv->preview_surfaces[i] =
+				create_half_surface (source, width, height);
+
+		source = priv->preview_surfaces[i];
+		width = MAX (1, width / 2);
+		height = MAX (1, height / 2);
+		zoom *= 2.0;
+	}
+
+	return source;
+}
+
+#ifdef HAVE_RSVG
+/* A tile of an SVG rendered by the SVG worker thread */
+typedef struct {
+	EomScrollView *view;
+	RsvgHandle *svg;
+	cairo_matrix_t matrix;
+	cairo_surface_t *surface;
+	guint key;
+	int scale;
+	gint generation;
+} SvgTileRequest;
+
+static GMutex svg_pool_mutex;
+static GThreadPool *svg_pool = NULL;
+
+/* Computes the matrix drawing the SVG with its top left corner at
+ * @x, @y, taking the image transformation and zoom into account */
+static void
+svg_get_matrix (EomScrollView *view, double x, double y, cairo_matrix_t *matrix)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	EomTransform *transform = eom_image_get_transform (priv->image);
+	cairo_matrix_t translate, scale;
+
+	cairo_matrix_init_identity (matrix);
+	if (transform) {
+		cairo_matrix_t affine;
+		int image_offset_x = 0;
+		int image_offset_y = 0;
+
+		eom_transform_get_affine (transform, &affine);
+		cairo_matrix_multiply (matrix, &affine, matrix);
+
+		switch (eom_transform_get_transform_type (transform)) {
+		case EOM_TRANSFORM_ROT_90:
+		case EOM_TRANSFORM_FLIP_HORIZONTAL:
+			image_offset_x = gdk_pixbuf_get_width (priv->pixbuf);
+			break;
+		case EOM_TRANSFORM_ROT_270:
+		case EOM_TRANSFORM_FLIP_VERTICAL:
+			image_offset_y = gdk_pixbuf_get_height (priv->pixbuf);
+			break;
+		case EOM_TRANSFORM_ROT_180:
+		case EOM_TRANSFORM_TRANSPOSE:
+		case EOM_TRANSFORM_TRANSVERSE:
+			image_offset_x = gdk_pixbuf_get_width (priv->pixbuf);
+			image_offset_y = gdk_pixbuf_get_height (priv->pixbuf);
+			break;
+		case EOM_TRANSFORM_NONE:
+			default:
+			break;
+		}
+		cairo_matrix_init_translate (&translate, (double) image_offset_x, (double) image_offset_y);
+		cairo_matrix_multiply (matrix, matrix, &translate);
+	}
+	/* Zoom factor for SVGs is already scaled, so scale back to application pixels. */
+	cairo_matrix_init_scale (&scale, priv->zoom / priv->scale, priv->zoom / priv->scale);
+	cairo_matrix_multiply (matrix, matrix, &scale);
+	cairo_matrix_init_translate (&translate, x, y);
+	cairo_matrix_multiply (matrix, matrix, &translate);
+}
+
+static void
+svg_tile_request_free (SvgTileRequest *request)
+{
+	g_object_unref (request->view);
+	g_object_unref (request->svg);
+
+	if (request->surface != NULL)
+		cairo_surface_destroy (request->surface);
+
+	g_slice_free (SvgTileRequest, request);
+}
+
+static gboolean
+svg_tile_done_cb (gpointer data)
+{
+	SvgTileRequest *request = data;
+	EomScrollViewPrivate *priv = request->view->priv;
+	gpointer key = GUINT_TO_POINTER (request->key);
+	gpointer value;
+
+	/* Only fill in tiles still waiting for this very request */
+	if (request->surface != NULL &&
+	    priv->svg_tiles != NULL &&
+	    request->generation == priv->svg_tiles_generation &&
+	    g_hash_table_lookup_extended (priv->svg_tiles, key, NULL, &value) &&
+	    value == NULL) {
+		g_hash_table_insert (priv->svg_tiles, key, request->surface);
+		request->surface = NULL;
+
+		invalidate_view_surface (request->view);
+		gtk_widget_queue_draw (priv->display);
+	}
+
+	svg_tile_request_free (request);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+svg_tile_run (gpointer data, gpointer user_data)
+{
+	SvgTileRequest *request = data;
+	EomScrollViewPrivate *priv = request->view->priv;
+	cairo_t *cr;
+
+	/* Skip tiles made useless by a zoom change in the meantime */
+	if (g_atomic_int_get (&priv->svg_tiles_generation) == request->generation) {
+		request->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+							       SVG_TILE_SIZE * request->scale,
+							       SVG_TILE_SIZE * request->scale);
+		cairo_surface_set_device_scale (request->surface,
+						request->scale, request->scale);
+
+		cr = cairo_create (request->surface);
+		cairo_set_matrix (cr, &request->matrix);
+		eom_image_render_svg (request->svg, cr);
+		cairo_destroy (cr);
+
+		cairo_surface_flush (request->surface);
+	}
+
+	g_idle_add (svg_tile_done_cb, request);
+}
+
+static void
+svg_tiles_clear (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	/* Requests still in flight notice the generation change */
+	g_atomic_int_inc (&priv->svg_tiles_generation);
+
+	if (priv->svg_tiles != NULL)
+		g_hash_table_remove_all (priv->svg_tiles);
+}
+
+static void
+svg_tile_schedule (EomScrollView *view, int tx, int ty, int scale)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	SvgTileRequest *request;
+
+	/* A single thread, SVGs are only rendered one at a time anyway */
+	g_mutex_lock (&svg_pool_mutex);
+	if (svg_pool == NULL)
+		svg_pool = g_thread_pool_new (svg_tile_run, NULL, 1, FALSE, NULL);
+	g_mutex_unlock (&svg_pool_mutex);
+
+	request = g_slice_new0 (SvgTileRequest);
+	request->view = g_object_ref (view);
+	/* The image drops its handle when unloaded, which may
+	 * happen while the tile is still being rendered */
+	request->svg = g_object_ref (eom_image_get_svg (priv->image));
+	request->key = (ty << 16) | tx;
+	request->scale = scale;
+	request->generation = priv->svg_tiles_generation;
+	svg_get_matrix (view, -tx * SVG_TILE_SIZE, -ty * SVG_TILE_SIZE,
+			&request->matrix);
+
+	g_hash_table_insert (priv->svg_tiles, GUINT_TO_POINTER (request->key), NULL);
+	g_thread_pool_push (svg_pool, request, NULL);
+}
+
+typedef struct {
+	int tx0, ty0, tx1, ty1;
+} SvgTileRange;
+
+static gboolean
+svg_tile_outside_range (gpointer key, gpointer value, gpointer user_data)
+{
+	SvgTileRange *range = user_data;
+	int tx = GPOINTER_TO_UINT (key) & 0xffff;
+	int ty = GPOINTER_TO_UINT (key) >> 16;
+
+	return (tx < range->tx0 || tx > range->tx1 ||
+		ty < range->ty0 || ty > range->ty1);
+}
+
+/* Draws the SVG from tiles rasterized in the background at the current
+ * zoom, so that scrolling doesn't render the document again. Tiles which
+ * are not ready yet are filled in from the rasterized image meanwhile. */
+static void
+draw_svg_tiles (EomScrollView *view, cairo_t *cr, int xofs, int yofs,
+		int scaled_width, int scaled_height, cairo_filter_t interp_type)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	SvgTileRange range;
+	double x1, y1, x2, y2;
+	gboolean missing = FALSE;
+	int scale, tx, ty;
+
+	scale = gdk_window_get_scale_factor (gtk_widget_get_window (priv->display));
+
+	if (priv->svg_tiles == NULL)
+		priv->svg_tiles = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							 NULL,
+							 (GDestroyNotify) cairo_surface_destroy);
+
+	if (!DOUBLE_EQUAL (priv->svg_tiles_zoom, priv->zoom) ||
+	    priv->svg_tiles_scale != scale) {
+		svg_tiles_clear (view);
+		priv->svg_tiles_zoom = priv->zoom;
+		priv->svg_tiles_scale = scale;
+	}
+
+	cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+	range.tx0 = MAX (0, (int) floor ((x1 - xofs) / SVG_TILE_SIZE));
+	range.ty0 = MAX (0, (int) floor ((y1 - yofs) / SVG_TILE_SIZE));
+	range.tx1 = MIN ((int) ceil ((x2 - xofs) / SVG_TILE_SIZE),
+			 (scaled_width + SVG_TILE_SIZE - 1) / SVG_TILE_SIZE) - 1;
+	range.ty1 = MIN ((int) ceil ((y2 - yofs) / SVG_TILE_SIZE),
+			 (scaled_height + SVG_TILE_SIZE - 1) / SVG_TILE_SIZE) - 1;
+
+	cairo_save (cr);
+
+	for (ty = range.ty0; ty <= range.ty1; ty++) {
+		for (tx = range.tx0; tx <= range.tx1; tx++) {
+			cairo_surface_t *tile = NULL;
+			int x = xofs + tx * SVG_TILE_SIZE;
+			int y = yofs + ty * SVG_TILE_SIZE;
+
+			if (tx <= SVG_TILE_MAX_INDEX && ty <= SVG_TILE_MAX_INDEX) {
+				gpointer key = GUINT_TO_POINTER ((ty << 16) | tx);
+				gpointer value;
+
+				if (g_hash_table_lookup_extended (priv->svg_tiles, key,
+								  NULL, &value))
+					tile = value;
+				else
+					svg_tile_schedule (view, tx, ty, scale);
+			}
+
+			if (tile != NULL) {
+				cairo_set_source_surface (cr, tile, x, y);
+				cairo_rectangle (cr, x, y, SVG_TILE_SIZE, SVG_TILE_SIZE);
+				cairo_fill (cr);
+			} else {
+				missing = TRUE;
+			}
+		}
+	}
+
+	if (missing) {
+		/* Fill in the tiles still being rendered from the
+		 * rasterized image */
+		for (ty = range.ty0; ty <= range.ty1; ty++) {
+			for (tx = range.tx0; tx <= range.tx1; tx++) {
+				gpointer value = NULL;
+
+				if (tx <= SVG_TILE_MAX_INDEX && ty <= SVG_TILE_MAX_INDEX)
+					value = g_hash_table_lookup (priv->svg_tiles,
+								     GUINT_TO_POINTER ((ty << 16) | tx));
+				if (value == NULL)
+					cairo_rectangle (cr,
+							 xofs + tx * SVG_TILE_SIZE,
+							 yofs + ty * SVG_TILE_SIZE,
+							 SVG_TILE_SIZE, SVG_TILE_SIZE);
+			}
+		}
+
+		cairo_clip (cr);
+		cairo_scale (cr, priv->zoom, priv->zoom);
+		cairo_set_source_surface (cr, priv->surface,
+					  xofs / priv->zoom, yofs / priv->zoom);
+		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+		cairo_pattern_set_filter (cairo_get_source (cr), interp_type);
+		cairo_paint (cr);
+	}
+
+	cairo_restore (cr);
+
+	if (g_hash_table_size (priv->svg_tiles) > SVG_TILE_CACHE_SIZE) {
+		/* Keep what is visible in the whole view, not only
+		 * in the area being drawn */
+		GtkAllocation allocation;
+
+		gtk_widget_get_allocation (priv->display, &allocation);
+
+		range.tx0 = MAX (0, -xofs / SVG_TILE_SIZE);
+		range.ty0 = MAX (0, -yofs / SVG_TILE_SIZE);
+		range.tx1 = (allocation.width - xofs) / SVG_TILE_SIZE;
+		range.ty1 = (allocation.height - yofs) / SVG_TILE_SIZE;
+
+		g_hash_table_foreach_remove (priv->svg_tiles,
+					     svg_tile_outside_range, &range);
+	}
+}
+#else
+static void
+svg_tiles_clear (EomScrollView *view)
+{
+}
+#endif /* HAVE_RSVG */
+
+/* Draws the background and the image, at the given offsets, to @cr.
+ * A @preview is drawn quickly from a reduced copy of the image. */
+static void
+draw_view (EomScrollView *view, cairo_t *cr,
+	   int width, int height, int xofs, int yofs,
+	   int scaled_width, int scaled_height,
+	   cairo_filter_t interp_type, gboolean preview)
+{
+	const GdkRGBA *background_color = NULL;
+	EomScrollViewPrivate *priv = view->priv;
+
+	cairo_save (cr);
+
+	/* Paint the background */
+	cairo_rectangle (cr, 0, 0, width, height);
+	if (priv->transp_style != EOM_TRANSP_BACKGROUND)
+		cairo_rectangle (cr, MAX (0, xofs), MAX (0, yofs),
+				 scaled_width, scaled_height);
+	if (priv->override_bg_color != NULL)
+		background_color = priv->override_bg_color;
+	else if (priv->use_bg_color)
+		background_color = priv->background_color;
+	if (background_color != NULL)
+		cairo_set_source_rgba (cr,
+				       background_color->red,
+				       background_color->green,
+				       background_color->blue,
+				       background_color->alpha);
+	else
+		cairo_set_source (cr, gdk_window_get_background_pattern (gtk_widget_get_window (priv->display)));
+	cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+	cairo_fill (cr);
+
+	if (gdk_pixbuf_get_has_alpha (priv->pixbuf)) {
+		if (priv->background_surface == NULL) {
+			priv->background_surface = create_background_surface (view);
+		}
+		cairo_set_source_surface (cr, priv->background_surface, xofs, yofs);
+		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_REPEAT);
+		cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
+		cairo_fill (cr);
+	}
+
+	/* Make sure the image is only drawn as large as needed.
+	 * This is especially necessary for SVGs where there might
+	 * be more image data available outside the image boundaries.
+	 */
+	cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
+	cairo_clip (cr);
+
+#ifdef HAVE_RSVG
+	/* Animation frames come from the rasterized image instead */
+	if (eom_image_is_svg (view->priv->image) && !preview) {
+		draw_svg_tiles (view, cr, xofs, yofs,
+				scaled_width, scaled_height, interp_type);
+	} else
+#endif /* HAVE_RSVG */
+	if (!preview &&
+	    hq_request_matches (priv->hq_result, view, width, height,
+				gdk_window_get_scale_factor (gtk_widget_get_window (priv->display)),
+				xofs, yofs, interp_type)) {
+		/* already rescaled by the worker threads */
+		cairo_set_source_surface (cr, priv->hq_result->target, 0, 0);
+		cairo_paint (cr);
+	} else {
+		cairo_scale (cr, priv->zoom, priv->zoom);
+		cairo_set_source_surface (cr,
+					  preview ? get_preview_surface (view) : priv->surface,
+					  xofs/priv->zoom, yofs/priv->zoom);
+		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+		if (is_zoomed_in (view) || is_zoomed_out (view))
+			cairo_pattern_set_filter (cairo_get_source (cr), interp_type);
+
+		cairo_paint (cr);
+	}
+
+	cairo_restore (cr);
+}
+
+static void
+invalidate_view_surface (EomScrollView *view)
+{
+	EomScrollViewPrivate *priv = view->priv;
+
+	if (priv->view_surface != NULL) {
+		cairo_surface_destroy (priv->view_surface);
+		priv->view_surface = NULL;
+	}
+}
+
+/* Brings the rendered viewport up to date. When the view was only
+ * scrolled, the previous contents are moved by the scroll delta and only
+ * the uncovered strips are drawn. Returns whether anything was drawn. */
+static gboolean
+update_view_surface (EomScrollView *view, int width, int height,
+		     int xofs, int yofs, int scaled_width, int scaled_height,
+		     cairo_filter_t interp_type, gboolean preview)
+{
+	EomScrollViewPrivate *priv = view->priv;
+	GdkWindow *window;
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	int scale;
+	int dx, dy;
+
+	window = gtk_widget_get_window (priv->display);
+	scale = gdk_window_get_scale_factor (window);
+
+	if (priv->view_surface != NULL &&
+	    priv->view_width == width && priv->view_height == height &&
+	    priv->view_scale == scale &&
+	    DOUBLE_EQUAL (priv->view_zoom, priv->zoom) &&
+	    (priv->view_filter == interp_type || interp_type == CAIRO_FILTER_NEAREST) &&
+	    (!priv->view_preview || preview)) {
+		dx = xofs - priv->view_xofs;
+		dy = yofs - priv->view_yofs;
+
+		if (dx == 0 && dy == 0)
+			return FALSE;
+
+		if (abs (dx) < width && abs (dy) < height) {
+			if (priv->view_back_surface == NULL)
+				priv->view_back_surface =
+					gdk_window_create_similar_image_surface (window,
+										 CAIRO_FORMAT_ARGB32,
+										 width * scale,
+										 height * scale,
+										 scale);
+
+			cr = cairo_create (priv->view_back_surface);
+
+			cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+			cairo_set_source_surface (cr, priv->view_surface, dx, dy);
+			cairo_paint (cr);
+			cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+			if (dx > 0)
+				cairo_rectangle (cr, 0, 0, dx, height);
+			else if (dx < 0)
+				cairo_rectangle (cr, width + dx, 0, -dx, height);
+
+			if (dy > 0)
+				cairo_rectangle (cr, 0, 0, width, dy);
+			else if (dy < 0)
+				cairo_rectangle (cr, 0, height + dy, width, -dy);
+
+			cairo_clip (cr);
+
+			draw_view (view, cr, width, height, xofs, yofs,
+				   scaled_width, scaled_height, interp_type,
+				   preview);
+
+			cairo_destroy (cr);
+
+			surface = priv->view_surface;
+			priv->view_surface = priv->view_back_surface;
+			priv->view_back_surface = surface;
+
+			priv->view_xofs = xofs;
+			priv->view_yofs = yofs;
+			/* the surface is only as good as its worst part */
+			if (interp_type == CAIRO_FILTER_NEAREST)
+				priv->view_filter = interp_type;
+			priv->view_preview |= preview;
+
+			return TRUE;
+		}
+	}
+
+	if (priv->view_surface == NULL ||
+	    priv->view_width != width || priv->view_height != height ||
+	    priv->view_scale != scale) {
+		if (priv->view_surface != NULL)
+			cairo_surface_destroy (priv->view_surface);
+
+		if (priv->view_back_surface != NULL) {
+			cairo_surface_destroy (priv->view_back_surface);
+			priv->view_back_surface = NULL;
+		}
+
+		priv->view_surface =
+			gdk_window_create_similar_image_surface (window,
+								 CAIRO_FORMAT_ARGB32,
+								 width * scale,
+								 height * scale,
+								 scale);
+	}
+
+	cr = cairo_create (priv->view_surface);
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+	draw_view (view, cr, width, height, xofs, yofs,
+		   scaled_width, scaled_height, interp_type, preview);
+
+	cairo_destroy (cr);
+
+	priv->view_width = width;
+	priv->view_height = height;
+	priv->view_scale = scale;
+	priv->view_xofs = xofs;
+	priv->view_yofs = yofs;
+	priv->view_zoom = priv->zoom;
+	priv->view_filter = interp_type;
+	priv->view_preview = preview;
+
+	return TRUE;
+}
+
+static gboolean
+display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
+{
+	EomScrollView *view;
+	EomScrollViewPrivate *priv;
+	GtkAllocation allocation;
+	int scaled_width, scaled_height;
+	int xofs, yofs;
+	gboolean use_hq;
+	cairo_filter_t interp_type;
+	static gboolean first_paint_done = FALSE;
+
+	g_return_val_if_fail (GTK_IS_DRAWING_AREA (widget), FALSE);
+	g_return_val_if_fail (EOM_IS_SCROLL_VIEW (data), FALSE);
+
+	view = EOM_SCROLL_VIEW (data);
+
+	priv = view->priv;
+
+	if (priv->pixbuf == NULL)
+		return TRUE;
+
+	if (G_UNLIKELY (!first_paint_done)) {
+		eom_debug_startup_mark ("first image painted");
+		first_paint_done = TRUE;
+	}
+
+	compute_scaled_size (view, priv->zoom, &scaled_width, &scaled_height);
+
+	gtk_widget_get_allocation (priv->display, &allocation);
+
+	/* Compute image offsets with respect to the window */
+
+	if (scaled_width <= allocation.width)
+		xofs = (allocation.width - scaled_width) / 2;
+	else
+		xofs = -priv->xofs;
+
+	if (scaled_height <= allocation.height)
+		yofs = (allocation.height - scaled_height) / 2;
+	else
+		yofs = -priv->yofs;
+
+	eom_debug_message (DEBUG_WINDOW, "zoom %.2f, xofs: %i, yofs: %i scaled w: %i h: %i\n",
+	priv->zoom, xofs, yofs, scaled_width, scaled_height);
+
+	if (is_zoomed_in (view))
+		interp_type = priv->interp_type_in;
+	else
+		interp_type = priv->interp_type_out;
+
+	use_hq = (!DOUBLE_EQUAL (priv->zoom, 1.0) &&
+		  interp_type != CAIRO_FILTER_NEAREST);
+#ifdef HAVE_RSVG
+	if (eom_image_is_svg (priv->image))
+		use_hq = FALSE;
+#endif
+
+	if (priv->tick_id != 0) {
+		/* Zooming or panning is animated, keep the frame rate
+		 * up and leave the high quality pass until it stops */
+		update_view_surface (view, allocation.width, allocation.height,
+				     xofs, yofs, scaled_width, scaled_height,
+				     CAIRO_FILTER_NEAREST, priv->zoom_animating);
+	} else if (use_hq &&
+		   !hq_request_matches (priv->hq_result, view,
+					allocation.width, allocation.height,
+					gdk_window_get_scale_factor (gtk_widget_get_window (widget)),
+					xofs, yofs, interp_type)) {
+		/* Never run the expensive filter on the UI thread, show a
+		 * quick rendering until the worker threads are done */
+		update_view_surface (view, allocation.width, allocation.height,
+				     xofs, yofs, scaled_width, scaled_height,
+				     CAIRO_FILTER_NEAREST, FALSE);
+		hq_schedule (view, allocation.width, allocation.height,
+			     xofs, yofs, scaled_width, scaled_height,
+			     interp_type);
+	} else {
+		update_view_surface (view, allocation.width, allocation.height,
+				     xofs, yofs, scaled_width, scaled_height,
+				     interp_type, FALSE);
+	}
+
+	cairo_set_source_surface (cr, priv->view_surface, 0, 0);
+	cairo_paint (cr);
+
+	return TRUE;
+}
+
+/*==================================
+
+   image loading callbacks
+
+   -----------------------------------*/
+
+/* Returns the surface showing @pixbuf, reusing the one created ahead of
+ * time if any. Only if @keep is set does the surface stay attached to
+ * @pixbuf, to be shown again later. */
+static cairo_surface_t *
+get_pixbuf_surface (EomScrollView *view, GdkPixbuf *pixbuf, gboolean keep)
+{
+	cairo_surface_t *surface;
+	double x_scale = 0;
+
+	if (keep) {
+		surface = g_object_get_data (G_OBJECT (pixbuf), "eom-frame-surface");
+		if (surface != NULL)
+			cairo_surface_reference (surface);
+	} else {
+		surface = g_object_steal_data (G_OBJECT (pixbuf), "eom-frame-surface");
+	}
+
+	if (surface != NULL) {
+		cairo_surface_get_device_scale (surface, &x_scale, NULL);
+		if (x_scale == view->priv->scale)
+			return surface;
+
+		cairo_surface_destroy (surface);
+	}
+
+	surface = create_surface_from_pixbuf (view, pixbuf);
+
+	if (keep)
+		g_object_set_data_full (G_OBJECT (pixbuf), "eom-frame-surface",
+					cairo_surface_reference (surface),
+					(GDestroyNotify) cairo_surface_destroy);
+
+	return surface;
+}
+
+/* Use when the pixbuf in the view is changed, to keep a
+   reference to it and create its cairo surface. */
+static void
+update_pixbuf (EomScrollView *view, GdkPixbuf *pixbuf)
+{
+	EomScrollViewPrivate *priv;
+
+	priv = view->priv;
+
+	if (priv->pixbuf != NULL) {
+		g_object_unref (priv->pixbuf);
 		priv->pixbuf = NULL;
 	}
 
@@ -1396,7 +2475,26 @@ update_pixbuf (EomScrollView *view, GdkPixbuf *pixbuf)
 	if (priv->surface) {
 		cairo_surface_destroy (priv->surface);
 	}
-	priv->surface = create_surface_from_pixbuf (view, priv->pixbuf);
+
+	preview_clear (view);
+	svg_tiles_clear (view);
+	invalidate_view_surface (view);
+	hq_clear (view);
+
+	if (pixbuf == NULL) {
+		priv->surface = NULL;
+		return;
+	}
+
+	/* Animation frames are cached by EomImage and shown over and over
+	 * again, so keep their surfaces along with them instead of
+	 * converting every frame each time it comes up. */
+	priv->surface = get_pixbuf_surface (view, pixbuf,
+					    priv->image != NULL &&
+					    eom_image_is_animation (priv->image));
+
+	/* Take over the rescaling eom_scroll_view_prepare_image() did */
+	priv->hq_result = g_object_steal_data (G_OBJECT (pixbuf), "eom-view-prescaled");
 }
 
 static void
@@ -1464,6 +2562,7 @@ eom_scroll_view_set_antialiasing_in (EomScrollView *view, gboolean state)
 
 	if (priv->interp_type_in != new_interp_type) {
 		priv->interp_type_in = new_interp_type;
+		invalidate_view_surface (view);
 		gtk_widget_queue_draw (priv->display);
 		g_object_notify (G_OBJECT (view), "antialiasing-in");
 	}
@@ -1483,6 +2582,7 @@ eom_scroll_view_set_antialiasing_out (EomScrollView *view, gboolean state)
 
 	if (priv->interp_type_out != new_interp_type) {
 		priv->interp_type_out = new_interp_type;
+		invalidate_view_surface (view);
 		gtk_widget_queue_draw (priv->display);
 		g_object_notify (G_OBJECT (view), "antialiasing-out");
 
@@ -1500,6 +2600,7 @@ _transp_background_changed (EomScrollView *view)
 			/* Will be recreated if needed during redraw */
 			priv->background_surface = NULL;
 		}
+		invalidate_view_surface (view);
 		gtk_widget_queue_draw (priv->display);
 	}
 
@@ -1560,6 +2661,8 @@ eom_scroll_view_zoom_in (EomScrollView *view, gboolean smooth)
 
 	priv = view->priv;
 
+	stop_animation (view);
+
 	if (smooth) {
 		zoom = priv->zoom * priv->zoom_multiplier;
 	}
@@ -1596,6 +2699,8 @@ eom_scroll_view_zoom_out (EomScrollView *view, gboolean smooth)
 
 	priv = view->priv;
 
+	stop_animation (view);
+
 	if (smooth) {
 		zoom = priv->zoom / priv->zoom_multiplier;
 	}
@@ -1635,6 +2740,7 @@ eom_scroll_view_set_zoom (EomScrollView *view, double zoom)
 {
 	g_return_if_fail (EOM_IS_SCROLL_VIEW (view));
 
+	stop_animation (view);
 	set_zoom (view, zoom, FALSE, 0, 0);
 }
 
@@ -1727,6 +2833,114 @@ eom_scroll_view_set_image (EomScrollView *view, EomImage *image)
 	g_object_notify (G_OBJECT (view), "image");
 }
 
+/**
+ * eom_scroll_view_prepare_image:
+ * @view: An #EomScrollView.
+ * @image: An #EomImage whose image data is loaded.
+ *
+ * Gets @image ready to be shown by @view without showing it yet. Its
+ * pixels are converted for drawing right away and, if @view is zoomed
+ * to fit, rescaled to fit @view in the background, so that a later
+ * eom_scroll_view_set_image() with @image puts it on screen at once.
+ **/
+void
+eom_scroll_view_prepare_image (EomScrollView *view, EomImage *image)
+{
+	EomScrollViewPrivate *priv;
+	GtkAllocation allocation;
+	GdkPixbuf *pixbuf;
+	cairo_surface_t *surface;
+	HQRequest *request;
+	cairo_filter_t filter;
+	double zoom;
+	int scaled_width, scaled_height;
+
+	g_return_if_fail (EOM_IS_SCROLL_VIEW (view));
+	g_return_if_fail (EOM_IS_IMAGE (image));
+
+	priv = view->priv;
+
+	if (image == priv->image || !gtk_widget_get_realized (priv->display))
+		return;
+
+	pixbuf = eom_image_get_pixbuf (image);
+
+	if (pixbuf == NULL)
+		return;
+
+	surface = get_pixbuf_surface (view, pixbuf, TRUE);
+
+	/* Only the zoom to fit is known before the image is shown,
+	 * and neither animations nor SVGs use the rescaled image */
+	if (priv->zoom_mode != ZOOM_MODE_FIT ||
+	    !gtk_widget_get_mapped (GTK_WIDGET (view)) ||
+	    eom_image_is_animation (image))
+		goto out;
+
+#ifdef HAVE_RSVG
+	if (eom_image_is_svg (image))
+		goto out;
+#endif
+
+	/* Same as set_zoom_fit() and display_draw() will compute */
+	gtk_widget_get_allocation (priv->display, &allocation);
+
+	zoom = zoom_fit_scale (allocation.width, allocation.height,
+			       gdk_pixbuf_get_width (pixbuf) / priv->scale,
+			       gdk_pixbuf_get_height (pixbuf) / priv->scale,
+			       priv->upscale);
+	zoom = CLAMP (zoom, MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+
+	if (zoom - 1.0 > DOUBLE_EQUAL_MAX_DIFF)
+		filter = priv->interp_type_in;
+	else
+		filter = priv->interp_type_out;
+
+	if (DOUBLE_EQUAL (zoom, 1.0) || filter == CAIRO_FILTER_NEAREST)
+		goto out;
+
+	scaled_width = floor (gdk_pixbuf_get_width (pixbuf) / priv->scale * zoom + 0.5);
+	scaled_height = floor (gdk_pixbuf_get_height (pixbuf) / priv->scale * zoom + 0.5);
+
+	if (scaled_width > allocation.width || scaled_height > allocation.height)
+		goto out;
+
+	request = g_object_get_data (G_OBJECT (pixbuf), "eom-view-prescaled");
+
+	if (request != NULL &&
+	    request->width == allocation.width &&
+	    request->height == allocation.height &&
+	    request->filter == filter && DOUBLE_EQUAL (request->zoom, zoom))
+		goto out;
+
+	request = g_slice_new0 (HQRequest);
+	request->view = g_object_ref (view);
+	request->pixbuf = g_object_ref (pixbuf);
+	request->source = cairo_surface_reference (surface);
+	request->scale = gdk_window_get_scale_factor (gtk_widget_get_window (priv->display));
+	request->target = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      allocation.width * request->scale,
+						      allocation.height * request->scale);
+	cairo_surface_set_device_scale (request->target,
+					request->scale, request->scale);
+	cairo_surface_flush (request->target);
+	request->filter = filter;
+	request->zoom = zoom;
+	request->width = allocation.width;
+	request->height = allocation.height;
+	request->xofs = (allocation.width - scaled_width) / 2;
+	request->yofs = (allocation.height - scaled_height) / 2;
+	request->scaled_width = scaled_width;
+	request->scaled_height = scaled_height;
+
+	if (!hq_request_push (request))
+		hq_request_free (request);
+
+out:
+	cairo_surface_destroy (surface);
+	g_object_unref (pixbuf);
+}
+
 /**
  * eom_scroll_view_get_image:
  * @view: An #EomScrollView.
@@ -1750,6 +2964,53 @@ eom_scroll_view_get_image (EomScrollView *view)
 	return img;
 }
 
+/**
+ * eom_scroll_view_get_visible_area:
+ * @view: An #EomScrollView.
+ * @area: (out): Return location for the visible area.
+ *
+ * Gets the part of the displayed image which is visible in @view,
+ * in pixels of the image.
+ *
+ * Returns: %TRUE if @area was set, %FALSE if there is no image
+ * or it is a vector image.
+ **/
+gboolean
+eom_scroll_view_get_visible_area (EomScrollView *view, GdkRectangle *area)
+{
+	EomScrollViewPrivate *priv;
+	GtkAllocation allocation;
+	int scaled_width, scaled_height;
+	double x1, y1, x2, y2;
+
+	g_return_val_if_fail (EOM_IS_SCROLL_VIEW (view), FALSE);
+	g_return_val_if_fail (area != NULL, FALSE);
+
+	priv = view->priv;
+
+	if (priv->pixbuf == NULL || priv->image == NULL ||
+	    eom_image_is_svg (priv->image))
+		return FALSE;
+
+	gtk_widget_get_allocation (priv->display, &allocation);
+	compute_scaled_size (view, priv->zoom, &scaled_width, &scaled_height);
+
+	/* A smaller image is centered and wholly visible */
+	x1 = (scaled_width <= allocation.width) ? 0 : priv->xofs;
+	y1 = (scaled_height <= allocation.height) ? 0 : priv->yofs;
+	x2 = x1 + MIN (scaled_width, allocation.width);
+	y2 = y1 + MIN (scaled_height, allocation.height);
+
+	area->x = floor (x1 * priv->scale / priv->zoom);
+	area->y = floor (y1 * priv->scale / priv->zoom);
+	area->width = MIN (ceil (x2 * priv->scale / priv->zoom),
+			   gdk_pixbuf_get_width (priv->pixbuf)) - area->x;
+	area->height = MIN (ceil (y2 * priv->scale / priv->zoom),
+			    gdk_pixbuf_get_height (priv->pixbuf)) - area->y;
+
+	return (area->width > 0 && area->height > 0);
+}
+
 gboolean
 eom_scroll_view_scrollbars_visible (EomScrollView *view)
 {
@@ -1851,6 +3112,7 @@ eom_scroll_view_init (EomScrollView *view)
 			       | GDK_POINTER_MOTION_MASK
 			       | GDK_POINTER_MOTION_HINT_MASK
 			       | GDK_SCROLL_MASK
+			       | GDK_SMOOTH_SCROLL_MASK
 			       | GDK_KEY_PRESS_MASK);
 
 	g_signal_connect (priv->display, "configure_event",
@@ -1953,7 +3215,7 @@ eom_scroll_view_dispose (GObject *object)
 	view = EOM_SCROLL_VIEW (object);
 	priv = view->priv;
 
-	_clear_hq_redraw_timeout (view);
+	hq_clear (view);
 
 	if (priv->idle_id != 0) {
 		g_source_remove (priv->idle_id);
@@ -1975,8 +3237,20 @@ eom_scroll_view_dispose (GObject *object)
 		priv->background_surface = NULL;
 	}
 
+	invalidate_view_surface (view);
+
+	if (priv->view_back_surface != NULL) {
+		cairo_surface_destroy (priv->view_back_surface);
+		priv->view_back_surface = NULL;
+	}
+
 	free_image_resources (view);
 
+	if (priv->svg_tiles != NULL) {
+		g_hash_table_destroy (priv->svg_tiles);
+		priv->svg_tiles = NULL;
+	}
+
 	G_OBJECT_CLASS (eom_scroll_view_parent_class)->dispose (object);
 }
 
@@ -2324,6 +3598,7 @@ _eom_scroll_view_update_bg_color (EomScrollView *view)
 		priv->background_surface = NULL;
 	}
 
+	invalidate_view_surface (view);
 	gtk_widget_queue_draw (priv->display);
 }
 
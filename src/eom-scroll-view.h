@@ -39,6 +39,7 @@ GtkWidget* eom_scroll_view_new            (void);
 
 /* loading stuff */
 void     eom_scroll_view_set_image        (EomScrollView *view, EomImage *image);
+void     eom_scroll_view_prepare_image    (EomScrollView *view, EomImage *image);
 EomImage* eom_scroll_view_get_image       (EomScrollView *view);
 
 /* general properties */
@@ -50,6 +51,8 @@ void     eom_scroll_view_set_antialiasing_out (EomScrollView *view, gboolean sta
 void     eom_scroll_view_set_transparency_color (EomScrollView *view, GdkRGBA *color);
 void     eom_scroll_view_set_transparency (EomScrollView *view, EomTransparencyStyle style);
 gboolean eom_scroll_view_scrollbars_visible (EomScrollView *view);
+gboolean eom_scroll_view_get_visible_area (EomScrollView *view,
+					   GdkRectangle  *area);
 void	 eom_scroll_view_set_popup (EomScrollView *view, GtkMenu *menu);
 void	 eom_scroll_view_set_background_color (EomScrollView *view,
 					       const GdkRGBA *color);
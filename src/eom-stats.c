@@ -0,0 +1,382 @@
+/* Eye Of Mate - Runtime Statistics
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "eom-stats.h"
+
+/* Histogram bucket i counts the values in [2^i, 2^(i+1)) */
+#define EOM_STATS_N_BUCKETS 32
+
+#define EOM_STATS_PAGE_REFRESH 1 /* seconds */
+
+typedef struct {
+	gint64 count;
+	gint64 sum;
+	gint64 max;
+	gint64 buckets[EOM_STATS_N_BUCKETS];
+} EomStatsHistogram;
+
+static GMutex      stats_mutex;
+static GHashTable *counters = NULL;
+static GHashTable *histograms = NULL;
+
+static void
+ensure_tables_unlocked (void)
+{
+	if (G_UNLIKELY (counters == NULL)) {
+		counters = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_free);
+		histograms = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, g_free);
+	}
+}
+
+/**
+ * eom_stats_counter_add:
+ * @name: the counter name
+ * @delta: the amount to add, may be negative for gauges
+ *
+ * Adds @delta to the named counter, creating it on first use.
+ * Safe to call from any thread.
+ **/
+void
+eom_stats_counter_add (const gchar *name, gint64 delta)
+{
+	gint64 *value;
+
+	g_return_if_fail (name != NULL);
+
+	g_mutex_lock (&stats_mutex);
+
+	ensure_tables_unlocked ();
+
+	value = g_hash_table_lookup (counters, name);
+
+	if (value == NULL) {
+		value = g_new0 (gint64, 1);
+		g_hash_table_insert (counters, g_strdup (name), value);
+	}
+
+	*value += delta;
+
+	g_mutex_unlock (&stats_mutex);
+}
+
+/**
+ * eom_stats_histogram_add:
+ * @name: the histogram name
+ * @value: the sample, usually a duration in microseconds
+ *
+ * Adds a sample to the named power-of-two histogram, creating it
+ * on first use. Safe to call from any thread.
+ **/
+void
+eom_stats_histogram_add (const gchar *name, gint64 value)
+{
+	EomStatsHistogram *histogram;
+	guint bucket = 0;
+
+	g_return_if_fail (name != NULL);
+
+	value = MAX (value, 0);
+
+	while (bucket < EOM_STATS_N_BUCKETS - 1 && (value >> (bucket + 1)) > 0)
+		bucket++;
+
+	g_mutex_lock (&stats_mutex);
+
+	ensure_tables_unlocked ();
+
+	histogram = g_hash_table_lookup (histograms, name);
+
+	if (histogram == NULL) {
+		histogram = g_new0 (EomStatsHistogram, 1);
+		g_hash_table_insert (histograms, g_strdup (name), histogram);
+	}
+
+	histogram->count++;
+	histogram->sum += value;
+	histogram->max = MAX (histogram->max, value);
+	histogram->buckets[bucket]++;
+
+	g_mutex_unlock (&stats_mutex);
+}
+
+static GVariant *
+histogram_to_variant (EomStatsHistogram *histogram)
+{
+	GVariantBuilder builder;
+	guint n_buckets = EOM_STATS_N_BUCKETS;
+
+	/* Trailing empty buckets carry no information */
+	while (n_buckets > 1 && histogram->buckets[n_buckets - 1] == 0)
+		n_buckets--;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "count",
+			       g_variant_new_int64 (histogram->count));
+	g_variant_builder_add (&builder, "{sv}", "sum",
+			       g_variant_new_int64 (histogram->sum));
+	g_variant_builder_add (&builder, "{sv}", "max",
+			       g_variant_new_int64 (histogram->max));
+	g_variant_builder_add (&builder, "{sv}", "buckets",
+			       g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+							  histogram->buckets,
+							  n_buckets,
+							  sizeof (gint64)));
+
+	return g_variant_builder_end (&builder);
+}
+
+static GList *
+get_sorted_keys (GHashTable *table)
+{
+	return g_list_sort (g_hash_table_get_keys (table),
+			    (GCompareFunc) strcmp);
+}
+
+/**
+ * eom_stats_dump:
+ *
+ * Takes a snapshot of all counters and histograms. Counters are
+ * stored as int64 values; histograms as dictionaries holding their
+ * count, sum, max and power-of-two buckets.
+ *
+ * Returns: (transfer floating): a #GVariant of type a{sv}
+ **/
+GVariant *
+eom_stats_dump (void)
+{
+	GVariantBuilder builder;
+	GList *keys, *l;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+	g_mutex_lock (&stats_mutex);
+
+	ensure_tables_unlocked ();
+
+	keys = get_sorted_keys (counters);
+
+	for (l = keys; l != NULL; l = l->next) {
+		gint64 *value = g_hash_table_lookup (counters, l->data);
+
+		g_variant_builder_add (&builder, "{sv}", l->data,
+				       g_variant_new_int64 (*value));
+	}
+
+	g_list_free (keys);
+
+	keys = get_sorted_keys (histograms);
+
+	for (l = keys; l != NULL; l = l->next) {
+		EomStatsHistogram *histogram;
+
+		histogram = g_hash_table_lookup (histograms, l->data);
+
+		g_variant_builder_add (&builder, "{sv}", l->data,
+				       histogram_to_variant (histogram));
+	}
+
+	g_list_free (keys);
+
+	g_mutex_unlock (&stats_mutex);
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+append_histogram (GString *str, const gchar *name, GVariant *histogram)
+{
+	gint64 count = 0, sum = 0, max = 0;
+
+	g_variant_lookup (histogram, "count", "x", &count);
+	g_variant_lookup (histogram, "sum", "x", &sum);
+	g_variant_lookup (histogram, "max", "x", &max);
+
+	g_string_append_printf (str,
+				"%s\n  n=%" G_GINT64_FORMAT
+				" avg=%" G_GINT64_FORMAT
+				" max=%" G_GINT64_FORMAT "\n",
+				name, count, count > 0 ? sum / count : 0, max);
+}
+
+static gboolean
+stats_page_update (GtkLabel *label)
+{
+	GVariant *stats;
+	GVariantIter iter;
+	const gchar *name;
+	GVariant *value;
+	GString *str;
+
+	str = g_string_new (NULL);
+	stats = g_variant_ref_sink (eom_stats_dump ());
+
+	g_variant_iter_init (&iter, stats);
+
+	while (g_variant_iter_loop (&iter, "{&sv}", &name, &value)) {
+		if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64)) {
+			g_string_append_printf (str, "%s = %" G_GINT64_FORMAT "\n",
+						name, g_variant_get_int64 (value));
+		} else {
+			append_histogram (str, name, value);
+		}
+	}
+
+	gtk_label_set_text (label, str->str);
+
+	g_variant_unref (stats);
+	g_string_free (str, TRUE);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+stats_page_map_cb (GtkWidget *widget, GtkLabel *label)
+{
+	guint source;
+
+	stats_page_update (label);
+
+	source = g_timeout_add_seconds (EOM_STATS_PAGE_REFRESH,
+					(GSourceFunc) stats_page_update,
+					label);
+
+	g_object_set_data (G_OBJECT (widget), "eom-stats-source",
+			   GUINT_TO_POINTER (source));
+}
+
+static void
+stats_page_unmap_cb (GtkWidget *widget, GtkLabel *label)
+{
+	guint source;
+
+	source = GPOINTER_TO_UINT (g_object_steal_data (G_OBJECT (widget),
+							"eom-stats-source"));
+
+	if (source != 0)
+		g_source_remove (source);
+}
+
+/**
+ * eom_stats_page_new:
+ *
+ * Creates a widget listing the current statistics, refreshed
+ * periodically while it is mapped. Meant as a debug sidebar page.
+ *
+ * Returns: (transfer floating): a new #GtkWidget
+ **/
+GtkWidget *
+eom_stats_page_new (void)
+{
+	GtkWidget *scrolled, *label;
+
+	label = gtk_label_new (NULL);
+	gtk_label_set_selectable (GTK_LABEL (label), TRUE);
+	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+	gtk_label_set_yalign (GTK_LABEL (label), 0.0);
+	gtk_widget_set_margin_start (label, 6);
+	gtk_widget_set_margin_end (label, 6);
+
+	scrolled = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled),
+					GTK_POLICY_AUTOMATIC,
+					GTK_POLICY_AUTOMATIC);
+	gtk_container_add (GTK_CONTAINER (scrolled), label);
+
+	g_signal_connect (scrolled, "map",
+			  G_CALLBACK (stats_page_map_cb), label);
+	g_signal_connect (scrolled, "unmap",
+			  G_CALLBACK (stats_page_unmap_cb), label);
+
+	gtk_widget_show_all (scrolled);
+
+	return scrolled;
+}
+
+static const gchar stats_introspection_xml[] =
+	"<node>"
+	"  <interface name='" EOM_STATS_DBUS_INTERFACE "'>"
+	"    <property name='Stats' type='a{sv}' access='read'/>"
+	"  </interface>"
+	"</node>";
+
+static GVariant *
+stats_dbus_get_property (GDBusConnection *connection,
+			 const gchar     *sender,
+			 const gchar     *object_path,
+			 const gchar     *interface_name,
+			 const gchar     *property_name,
+			 GError         **error,
+			 gpointer         user_data)
+{
+	if (g_strcmp0 (property_name, "Stats") == 0)
+		return eom_stats_dump ();
+
+	return NULL;
+}
+
+static const GDBusInterfaceVTable stats_vtable = {
+	NULL,
+	stats_dbus_get_property,
+	NULL,
+};
+
+/**
+ * eom_stats_dbus_register:
+ * @connection: the application's #GDBusConnection
+ * @object_path: the object path to export the statistics on
+ * @error: return location for a #GError, or %NULL
+ *
+ * Exports the statistics as the read-only Stats property of the
+ * org.mate.eom.Stats interface.
+ *
+ * Returns: the registration id, or 0 on error
+ **/
+guint
+eom_stats_dbus_register (GDBusConnection *connection,
+			 const gchar     *object_path,
+			 GError         **error)
+{
+	GDBusNodeInfo *info;
+	guint id;
+
+	info = g_dbus_node_info_new_for_xml (stats_introspection_xml, error);
+
+	if (info == NULL)
+		return 0;
+
+	id = g_dbus_connection_register_object (connection,
+						object_path,
+						info->interfaces[0],
+						&stats_vtable,
+						NULL, NULL,
+						error);
+
+	g_dbus_node_info_unref (info);
+
+	return id;
+}
@@ -0,0 +1,51 @@
+/* Eye Of Mate - Runtime Statistics
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __EOM_STATS_H__
+#define __EOM_STATS_H__
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define EOM_STATS_DBUS_INTERFACE "org.mate.eom.Stats"
+
+G_GNUC_INTERNAL
+void		eom_stats_counter_add	(const gchar *name,
+					 gint64       delta);
+
+G_GNUC_INTERNAL
+void		eom_stats_histogram_add	(const gchar *name,
+					 gint64       value);
+
+G_GNUC_INTERNAL
+GVariant *	eom_stats_dump		(void);
+
+G_GNUC_INTERNAL
+GtkWidget *	eom_stats_page_new	(void);
+
+G_GNUC_INTERNAL
+guint		eom_stats_dbus_register	(GDBusConnection *connection,
+					 const gchar     *object_path,
+					 GError         **error);
+
+G_END_DECLS
+
+#endif /* __EOM_STATS_H__ */
@@ -0,0 +1,385 @@
+/* Eye Of Mate - Thumbnail Atlas
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Thumbnails shown in the gallery are packed, framed and already
+ * premultiplied, into a few large image surfaces. Every atlas is
+ * split in horizontal shelves, each one holding thumbnails of about
+ * the same height side by side, so a landscape thumbnail only takes
+ * the space it needs. Each thumbnail is handed out as a sub-surface
+ * which gives its space back to the shelf once destroyed. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gdk/gdk.h>
+
+#include "eom-thumb-atlas.h"
+#include "eom-list-store.h"
+#include "eom-debug.h"
+#include "eom-stats.h"
+
+/* Space the frame takes around the thumbnail; the same
+ * as the frame image used by eom_thumbnail_add_frame() */
+#define FRAME_LEFT	3
+#define FRAME_TOP	3
+#define FRAME_RIGHT	6
+#define FRAME_BOTTOM	6
+
+#define ATLAS_SIZE	1024
+
+/* Shelf heights are rounded up to this, so thumbnails of
+ * slightly different heights can still share a shelf */
+#define SHELF_ROUNDING	8
+
+typedef struct _EomThumbAtlas EomThumbAtlas;
+typedef struct _EomThumbAtlasShelf EomThumbAtlasShelf;
+typedef struct _EomThumbAtlasSpan EomThumbAtlasSpan;
+typedef struct _EomThumbAtlasSlot EomThumbAtlasSlot;
+
+struct _EomThumbAtlasSpan {
+	gint x;
+	gint width;
+};
+
+struct _EomThumbAtlasShelf {
+	gint   y;
+	gint   height;
+	guint  n_used;
+	GList *free_spans;  /* EomThumbAtlasSpan, sorted by x */
+};
+
+struct _EomThumbAtlas {
+	cairo_surface_t *surface;
+	guint            n_used;
+	GList           *shelves;  /* EomThumbAtlasShelf, from the top */
+	gint             next_y;   /* where the next shelf goes */
+};
+
+struct _EomThumbAtlasSlot {
+	EomThumbAtlas      *atlas;
+	EomThumbAtlasShelf *shelf;
+	gint                x;
+	gint                width;
+};
+
+static const cairo_user_data_key_t slot_key;
+
+static GMutex atlas_mutex;
+static GList *atlases = NULL;
+
+static EomThumbAtlas *
+eom_thumb_atlas_new (void)
+{
+	EomThumbAtlas *atlas;
+
+	atlas = g_new0 (EomThumbAtlas, 1);
+	atlas->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						     ATLAS_SIZE,
+						     ATLAS_SIZE);
+
+	eom_stats_counter_add ("thumbnail.atlases", 1);
+
+	return atlas;
+}
+
+static void
+eom_thumb_atlas_shelf_free (EomThumbAtlasShelf *shelf)
+{
+	g_list_free_full (shelf->free_spans, g_free);
+	g_free (shelf);
+}
+
+static void
+eom_thumb_atlas_free (EomThumbAtlas *atlas)
+{
+	cairo_surface_destroy (atlas->surface);
+	g_list_free_full (atlas->shelves, (GDestroyNotify) eom_thumb_atlas_shelf_free);
+	g_free (atlas);
+
+	eom_stats_counter_add ("thumbnail.atlases", -1);
+}
+
+static EomThumbAtlasShelf *
+eom_thumb_atlas_add_shelf (EomThumbAtlas *atlas, gint height)
+{
+	EomThumbAtlasShelf *shelf;
+	EomThumbAtlasSpan *span;
+
+	if (atlas->next_y + height > ATLAS_SIZE)
+		return NULL;
+
+	span = g_new (EomThumbAtlasSpan, 1);
+	span->x = 0;
+	span->width = ATLAS_SIZE;
+
+	shelf = g_new0 (EomThumbAtlasShelf, 1);
+	shelf->y = atlas->next_y;
+	shelf->height = height;
+	shelf->free_spans = g_list_prepend (NULL, span);
+
+	atlas->shelves = g_list_append (atlas->shelves, shelf);
+	atlas->next_y += height;
+
+	return shelf;
+}
+
+/* Takes @width pixels from the first free span wide enough,
+ * returns their position or -1 if the shelf is too full */
+static gint
+eom_thumb_atlas_shelf_take (EomThumbAtlasShelf *shelf, gint width)
+{
+	GList *l;
+
+	for (l = shelf->free_spans; l != NULL; l = l->next) {
+		EomThumbAtlasSpan *span = l->data;
+		gint x = span->x;
+
+		if (span->width < width)
+			continue;
+
+		span->x += width;
+		span->width -= width;
+
+		if (span->width == 0) {
+			shelf->free_spans = g_list_delete_link (shelf->free_spans, l);
+			g_free (span);
+		}
+
+		shelf->n_used++;
+
+		return x;
+	}
+
+	return -1;
+}
+
+static void
+eom_thumb_atlas_shelf_give_back (EomThumbAtlasShelf *shelf, gint x, gint width)
+{
+	EomThumbAtlasSpan *span, *prev = NULL, *next;
+	GList *l;
+
+	for (l = shelf->free_spans; l != NULL && ((EomThumbAtlasSpan *) l->data)->x < x; l = l->next)
+		prev = l->data;
+
+	next = l != NULL ? l->data : NULL;
+
+	/* Merge with the free spans on either side */
+	if (prev != NULL && prev->x + prev->width == x) {
+		prev->width += width;
+
+		if (next != NULL && x + width == next->x) {
+			prev->width += next->width;
+			shelf->free_spans = g_list_delete_link (shelf->free_spans, l);
+			g_free (next);
+		}
+	} else if (next != NULL && x + width == next->x) {
+		next->x = x;
+		next->width += width;
+	} else {
+		span = g_new (EomThumbAtlasSpan, 1);
+		span->x = x;
+		span->width = width;
+
+		shelf->free_spans = g_list_insert_before (shelf->free_spans, l, span);
+	}
+
+	shelf->n_used--;
+}
+
+static void
+release_slot (gpointer data)
+{
+	EomThumbAtlasSlot *slot = data;
+	EomThumbAtlas *atlas = slot->atlas;
+
+	g_mutex_lock (&atlas_mutex);
+
+	eom_thumb_atlas_shelf_give_back (slot->shelf, slot->x, slot->width);
+	atlas->n_used--;
+
+	/* Empty shelves at the bottom go back to the atlas,
+	 * so their space can be used by other heights */
+	while (atlas->shelves != NULL) {
+		GList *last = g_list_last (atlas->shelves);
+		EomThumbAtlasShelf *shelf = last->data;
+
+		if (shelf->n_used > 0)
+			break;
+
+		atlas->next_y = shelf->y;
+		atlas->shelves = g_list_delete_link (atlas->shelves, last);
+		eom_thumb_atlas_shelf_free (shelf);
+	}
+
+	/* Keep one atlas around even when empty, galleries
+	 * are usually refilled right away when scrolling */
+	if (atlas->n_used == 0 && atlases->next != NULL) {
+		atlases = g_list_remove (atlases, atlas);
+		eom_thumb_atlas_free (atlas);
+	}
+
+	g_mutex_unlock (&atlas_mutex);
+
+	g_free (slot);
+
+	eom_stats_counter_add ("thumbnail.atlas-slots", -1);
+}
+
+static EomThumbAtlasSlot *
+get_free_slot (gint width, gint height)
+{
+	EomThumbAtlasSlot *slot;
+	EomThumbAtlasShelf *shelf = NULL;
+	EomThumbAtlas *atlas = NULL;
+	GList *l, *s;
+	gint x = -1;
+
+	height = (height + SHELF_ROUNDING - 1) / SHELF_ROUNDING * SHELF_ROUNDING;
+
+	for (l = atlases; l != NULL && x < 0; l = l->next) {
+		atlas = l->data;
+
+		for (s = atlas->shelves; s != NULL && x < 0; s = s->next) {
+			shelf = s->data;
+
+			if (shelf->height == height)
+				x = eom_thumb_atlas_shelf_take (shelf, width);
+		}
+
+		if (x < 0 && (shelf = eom_thumb_atlas_add_shelf (atlas, height)) != NULL)
+			x = eom_thumb_atlas_shelf_take (shelf, width);
+	}
+
+	if (x < 0) {
+		atlas = eom_thumb_atlas_new ();
+		atlases = g_list_prepend (atlases, atlas);
+
+		shelf = eom_thumb_atlas_add_shelf (atlas, height);
+		x = eom_thumb_atlas_shelf_take (shelf, width);
+	}
+
+	atlas->n_used++;
+
+	slot = g_new (EomThumbAtlasSlot, 1);
+	slot->atlas = atlas;
+	slot->shelf = shelf;
+	slot->x = x;
+	slot->width = width;
+
+	return slot;
+}
+
+static void
+draw_frame (cairo_t *cr, gint width, gint height)
+{
+	/* Soft drop shadow towards the bottom right corner */
+	cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.12);
+	cairo_rectangle (cr, FRAME_LEFT, FRAME_TOP,
+			 width + FRAME_RIGHT, height + FRAME_BOTTOM);
+	cairo_fill (cr);
+
+	cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.2);
+	cairo_rectangle (cr, FRAME_LEFT, FRAME_TOP,
+			 width + FRAME_RIGHT - 1, height + FRAME_BOTTOM - 1);
+	cairo_fill (cr);
+
+	/* White mat with a thin dark border */
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_rectangle (cr, 0, 0,
+			 width + FRAME_LEFT + 2, height + FRAME_TOP + 2);
+	cairo_fill (cr);
+
+	cairo_set_line_width (cr, 1.0);
+	cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.35);
+	cairo_rectangle (cr, 0.5, 0.5,
+			 width + FRAME_LEFT + 1, height + FRAME_TOP + 1);
+	cairo_stroke (cr);
+}
+
+/**
+ * eom_thumb_atlas_add:
+ * @thumbnail: a #GdkPixbuf fitting in %EOM_LIST_STORE_THUMB_SIZE
+ *
+ * Copies @thumbnail into a free slot of a thumbnail atlas, drawing
+ * a frame around it. The slot is released once the returned surface
+ * is destroyed.
+ *
+ * Returns: (transfer full): a surface showing the framed thumbnail,
+ * or %NULL if @thumbnail is too large for a slot.
+ **/
+cairo_surface_t *
+eom_thumb_atlas_add (GdkPixbuf *thumbnail)
+{
+	EomThumbAtlasSlot *slot;
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	gint width, height;
+	gint x, y;
+
+	g_return_val_if_fail (GDK_IS_PIXBUF (thumbnail), NULL);
+
+	width = gdk_pixbuf_get_width (thumbnail);
+	height = gdk_pixbuf_get_height (thumbnail);
+
+	if (width > EOM_LIST_STORE_THUMB_SIZE ||
+	    height > EOM_LIST_STORE_THUMB_SIZE)
+		return NULL;
+
+	g_mutex_lock (&atlas_mutex);
+
+	slot = get_free_slot (width + FRAME_LEFT + FRAME_RIGHT,
+			      height + FRAME_TOP + FRAME_BOTTOM);
+
+	x = slot->x;
+	y = slot->shelf->y;
+
+	/* The conversion to premultiplied pixels happens once here,
+	 * not each time the thumbnail is drawn */
+	cr = cairo_create (slot->atlas->surface);
+	cairo_translate (cr, x, y);
+	cairo_rectangle (cr, 0, 0, slot->width, slot->shelf->height);
+	cairo_clip (cr);
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+	draw_frame (cr, width, height);
+
+	gdk_cairo_set_source_pixbuf (cr, thumbnail, FRAME_LEFT, FRAME_TOP);
+	cairo_rectangle (cr, FRAME_LEFT, FRAME_TOP, width, height);
+	cairo_fill (cr);
+
+	cairo_destroy (cr);
+
+	surface = cairo_surface_create_for_rectangle (slot->atlas->surface,
+						      x, y,
+						      width + FRAME_LEFT + FRAME_RIGHT,
+						      height + FRAME_TOP + FRAME_BOTTOM);
+
+	g_mutex_unlock (&atlas_mutex);
+
+	cairo_surface_set_user_data (surface, &slot_key, slot, release_slot);
+
+	eom_stats_counter_add ("thumbnail.atlas-slots", 1);
+
+	return surface;
+}
@@ -0,0 +1,34 @@
+/* Eye Of Mate - Thumbnail Atlas
+ *
+ * Copyright (C) 2026 The MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __EOM_THUMB_ATLAS_H__
+#define __EOM_THUMB_ATLAS_H__
+
+#include <glib.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+cairo_surface_t *	eom_thumb_atlas_add	(GdkPixbuf *thumbnail);
+
+G_END_DECLS
+
+#endif /* __EOM_THUMB_ATLAS_H__ */
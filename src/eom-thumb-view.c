@@ -35,24 +35,52 @@
 #endif
 
 #include <gtk/gtk.h>
+#include <gtk/gtk-a11y.h>
 #include <glib/gi18n.h>
 #include <stdlib.h>
 #include <string.h>
 
 enum {
   PROP_0,
-  PROP_ORIENTATION
+  PROP_ORIENTATION,
+  PROP_HADJUSTMENT,
+  PROP_VADJUSTMENT,
+  PROP_HSCROLL_POLICY,
+  PROP_VSCROLL_POLICY
 };
 
-#define EOM_THUMB_VIEW_SPACING 0
+enum {
+  SIGNAL_SELECTION_CHANGED,
+  SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST];
+
+/* All items have the same size, so the position of any of them
+ * follows from its index and the view never has to walk the model
+ * to lay it out, however many images the folder has */
+#define EOM_THUMB_VIEW_MARGIN       4   /* around the whole grid */
+#define EOM_THUMB_VIEW_ITEM_PADDING 6   /* around each thumbnail */
+#define EOM_THUMB_VIEW_ITEM_WIDTH   115
+#define EOM_THUMB_VIEW_ITEM_HEIGHT  100
 
-static EomImage* eom_thumb_view_get_image_from_path (EomThumbView      *thumbview,
-						     GtkTreePath       *path);
+#define SELECTION_WORD_BITS 32
+
+/* Time in milliseconds after which typing starts a new search */
+#define EOM_THUMB_VIEW_TYPEAHEAD_TIMEOUT 1000
 
 static void      eom_thumb_view_popup_menu          (EomThumbView      *widget,
 						     GdkEventButton    *event);
 
-static void      eom_thumb_view_update_columns (EomThumbView *view);
+static void      eom_thumb_view_visible_range_changed (EomThumbView *thumbview);
+
+static GType     eom_thumb_view_accessible_get_type (void);
+static void      eom_thumb_view_accessible_cursor_changed (EomThumbView *thumbview,
+							    gint          old_cursor);
+static void      eom_thumb_view_accessible_selection_changed (EomThumbView *thumbview);
+static void      eom_thumb_view_accessible_rows_changed (EomThumbView *thumbview,
+							  gint          index,
+							  gint          delta);
 
 static gboolean
 thumbview_on_query_tooltip_cb (GtkWidget  *widget,
@@ -61,10 +89,6 @@ thumbview_on_query_tooltip_cb (GtkWidget  *widget,
 			       gboolean    keyboard_mode,
 			       GtkTooltip *tooltip,
 			       gpointer    user_data);
-static void
-thumbview_on_parent_set_cb (GtkWidget *widget,
-			    GtkWidget *old_parent,
-			    gpointer   user_data);
 
 static void
 thumbview_on_drag_data_get_cb (GtkWidget        *widget,
@@ -75,23 +99,2059 @@ thumbview_on_drag_data_get_cb (GtkWidget        *widget,
 			       gpointer          user_data);
 
 struct _EomThumbViewPrivate {
+	GtkTreeModel *model;
+	gint n_images;
+
 	gint start_thumb; /* the first visible thumbnail */
 	gint end_thumb;   /* the last visible thumbnail  */
 	GtkWidget *menu;  /* a contextual menu for thumbnails */
-	GtkCellRenderer *pixbuf_cell;
 	guint visible_range_changed_id;
 
-	GtkOrientation orientation;
-	gint n_images;
-	gulong image_add_id;
-	gulong image_removed_id;
-};
+	GtkOrientation orientation;
+	gint item_height;
+
+	GtkAdjustment *hadjustment;
+	GtkAdjustment *vadjustment;
+	guint hscroll_policy : 1;
+	guint vscroll_policy : 1;
+
+	/* One bit per row, kept in step with the model */
+	guint32 *selection;
+	gint selection_words;
+	gint n_selected;
+
+	gint cursor;        /* focused item, -1 if none */
+	gint anchor;        /* where shift-selected ranges start */
+	gint pressed_item;  /* selected item clicked without a drag yet */
+	gint scroll_to;     /* item to show once allocated, -1 if none */
+
+	/* Dragging starts by hand, a press outside of the
+	 * items starts a rubber band selection instead */
+	GtkTargetList *drag_targets;
+	gint drag_item;     /* item pressed, -1 if none */
+	gint press_x;
+	gint press_y;
+
+	gboolean rubberband_active;
+	guint32 *rubberband_base; /* selection when the band started */
+	gint rubberband_x1;       /* in content coordinates */
+	gint rubberband_y1;
+	gint rubberband_x2;
+	gint rubberband_y2;
+
+	GString *typeahead;
+	guint typeahead_timeout_id;
+
+	AtkObject *accessible;    /* weak, only once requested */
+};
+
+G_DEFINE_TYPE_WITH_CODE (EomThumbView, eom_thumb_view, GTK_TYPE_WIDGET,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_ORIENTABLE, NULL) \
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_SCROLLABLE, NULL) \
+			 G_ADD_PRIVATE (EomThumbView));
+
+/* Selection */
+
+static gboolean
+selection_get (EomThumbViewPrivate *priv, gint index)
+{
+	return (priv->selection[index / SELECTION_WORD_BITS] >>
+		(index % SELECTION_WORD_BITS)) & 1;
+}
+
+static void
+selection_ensure_size (EomThumbViewPrivate *priv, gint n_items)
+{
+	gint n_words = (n_items + SELECTION_WORD_BITS - 1) / SELECTION_WORD_BITS;
+
+	if (n_words <= priv->selection_words)
+		return;
+
+	n_words = MAX (n_words, 2 * priv->selection_words);
+
+	priv->selection = g_renew (guint32, priv->selection, n_words);
+	memset (priv->selection + priv->selection_words, 0,
+		(n_words - priv->selection_words) * sizeof (guint32));
+	priv->selection_words = n_words;
+}
+
+/* Returns whether the state of @index changed */
+static gboolean
+selection_set (EomThumbViewPrivate *priv, gint index, gboolean selected)
+{
+	guint32 bit = 1U << (index % SELECTION_WORD_BITS);
+	guint32 *word = &priv->selection[index / SELECTION_WORD_BITS];
+
+	if (((*word & bit) != 0) == (selected != FALSE))
+		return FALSE;
+
+	if (selected) {
+		*word |= bit;
+		priv->n_selected++;
+	} else {
+		*word &= ~bit;
+		priv->n_selected--;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+selection_clear (EomThumbViewPrivate *priv)
+{
+	if (priv->n_selected == 0)
+		return FALSE;
+
+	memset (priv->selection, 0, priv->selection_words * sizeof (guint32));
+	priv->n_selected = 0;
+
+	return TRUE;
+}
+
+static guint32 *
+selection_copy (EomThumbViewPrivate *priv, const guint32 *selection)
+{
+	guint32 *copy = g_new (guint32, priv->selection_words);
+
+	memcpy (copy, selection, priv->selection_words * sizeof (guint32));
+
+	return copy;
+}
+
+static void
+selection_recount (EomThumbViewPrivate *priv)
+{
+	gint word;
+
+	priv->n_selected = 0;
+
+	for (word = 0; word < priv->selection_words; word++) {
+		guint32 bits;
+
+		for (bits = priv->selection[word]; bits != 0; bits &= bits - 1)
+			priv->n_selected++;
+	}
+}
+
+/* Returns the first selected index from @start on, or -1 */
+static gint
+selection_next (EomThumbViewPrivate *priv, gint start)
+{
+	gint word, bit;
+
+	if (priv->n_selected == 0)
+		return -1;
+
+	for (word = start / SELECTION_WORD_BITS; word < priv->selection_words; word++) {
+		guint32 bits = priv->selection[word];
+
+		if (word == start / SELECTION_WORD_BITS)
+			bits &= ~((1U << (start % SELECTION_WORD_BITS)) - 1);
+
+		if (bits == 0)
+			continue;
+
+		for (bit = 0; (bits & (1U << bit)) == 0; bit++);
+
+		return word * SELECTION_WORD_BITS + bit;
+	}
+
+	return -1;
+}
+
+/* Makes room for a row inserted at @index, moving later bits up */
+static void
+selection_insert (EomThumbViewPrivate *priv, gint index)
+{
+	gint word = index / SELECTION_WORD_BITS;
+	guint32 low_mask = (1U << (index % SELECTION_WORD_BITS)) - 1;
+	gint i;
+
+	selection_ensure_size (priv, priv->n_images);
+
+	if (priv->n_selected == 0)
+		return;
+
+	for (i = priv->selection_words - 1; i > word; i--) {
+		priv->selection[i] = (priv->selection[i] << 1) |
+				     (priv->selection[i - 1] >> (SELECTION_WORD_BITS - 1));
+	}
+
+	priv->selection[word] = (priv->selection[word] & low_mask) |
+				((priv->selection[word] & ~low_mask) << 1);
+}
+
+/* Drops the bit of a row deleted at @index, moving later bits down.
+ * Returns whether the row was selected. */
+static gboolean
+selection_remove (EomThumbViewPrivate *priv, gint index)
+{
+	gint word = index / SELECTION_WORD_BITS;
+	gint bit = index % SELECTION_WORD_BITS;
+	guint32 low_mask = (1U << bit) - 1;
+	guint32 high_mask = bit == SELECTION_WORD_BITS - 1 ? 0 : ~((1U << (bit + 1)) - 1);
+	gboolean was_selected;
+	gint i;
+
+	if (index >= priv->selection_words * SELECTION_WORD_BITS)
+		return FALSE;
+
+	was_selected = selection_set (priv, index, FALSE);
+
+	if (priv->n_selected == 0)
+		return was_selected;
+
+	priv->selection[word] = (priv->selection[word] & low_mask) |
+				((priv->selection[word] & high_mask) >> 1);
+
+	for (i = word; i < priv->selection_words - 1; i++) {
+		priv->selection[i] |= (priv->selection[i + 1] & 1) << (SELECTION_WORD_BITS - 1);
+		priv->selection[i + 1] >>= 1;
+	}
+
+	return was_selected;
+}
+
+/* Geometry */
+
+static void
+eom_thumb_view_get_item_size (EomThumbView *thumbview,
+			      gint         *width,
+			      gint         *height)
+{
+	gint item_height = thumbview->priv->item_height;
+
+	if (item_height <= 0)
+		item_height = EOM_THUMB_VIEW_ITEM_HEIGHT;
+
+	*width = EOM_THUMB_VIEW_ITEM_WIDTH + 2 * EOM_THUMB_VIEW_ITEM_PADDING;
+	*height = item_height + 2 * EOM_THUMB_VIEW_ITEM_PADDING;
+}
+
+static gint
+eom_thumb_view_get_n_columns (EomThumbView *thumbview)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint item_width, item_height;
+	gint width;
+
+	if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+		return MAX (priv->n_images, 1);
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	width = gtk_widget_get_allocated_width (GTK_WIDGET (thumbview));
+
+	return MAX ((width - 2 * EOM_THUMB_VIEW_MARGIN) / item_width, 1);
+}
+
+static void
+eom_thumb_view_get_content_size (EomThumbView *thumbview,
+				 gint         *width,
+				 gint         *height)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint item_width, item_height;
+	gint n_columns, n_rows;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	n_columns = eom_thumb_view_get_n_columns (thumbview);
+	n_rows = (priv->n_images + n_columns - 1) / n_columns;
+
+	if (priv->orientation == GTK_ORIENTATION_HORIZONTAL) {
+		*width = 2 * EOM_THUMB_VIEW_MARGIN + priv->n_images * item_width;
+		*height = 2 * EOM_THUMB_VIEW_MARGIN + item_height;
+	} else {
+		*width = gtk_widget_get_allocated_width (GTK_WIDGET (thumbview));
+		*height = 2 * EOM_THUMB_VIEW_MARGIN + n_rows * item_height;
+	}
+}
+
+/* Gets the area of item @index, in widget coordinates */
+static void
+eom_thumb_view_get_item_area (EomThumbView *thumbview,
+			      gint          index,
+			      GdkRectangle *area)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint n_columns = eom_thumb_view_get_n_columns (thumbview);
+
+	eom_thumb_view_get_item_size (thumbview, &area->width, &area->height);
+
+	area->x = EOM_THUMB_VIEW_MARGIN + (index % n_columns) * area->width
+		- (gint) gtk_adjustment_get_value (priv->hadjustment);
+	area->y = EOM_THUMB_VIEW_MARGIN + (index / n_columns) * area->height
+		- (gint) gtk_adjustment_get_value (priv->vadjustment);
+}
+
+/* Gets the item at @x, @y in widget coordinates, or -1 */
+static gint
+eom_thumb_view_get_item_at_pos (EomThumbView *thumbview,
+				gint          x,
+				gint          y)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint item_width, item_height;
+	gint n_columns, column, row, index;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	n_columns = eom_thumb_view_get_n_columns (thumbview);
+
+	x += (gint) gtk_adjustment_get_value (priv->hadjustment) - EOM_THUMB_VIEW_MARGIN;
+	y += (gint) gtk_adjustment_get_value (priv->vadjustment) - EOM_THUMB_VIEW_MARGIN;
+
+	if (x < 0 || y < 0)
+		return -1;
+
+	column = x / item_width;
+	row = y / item_height;
+
+	if (column >= n_columns)
+		return -1;
+
+	index = row * n_columns + column;
+
+	return index < priv->n_images ? index : -1;
+}
+
+/* Gets the items intersecting @area, in widget coordinates.
+ * Returns FALSE if there is none. */
+static gboolean
+eom_thumb_view_get_items_in_area (EomThumbView       *thumbview,
+				  const GdkRectangle *area,
+				  gint               *first,
+				  gint               *last)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint item_width, item_height;
+	gint n_columns;
+	gint x1, y1, x2, y2;
+
+	if (priv->n_images == 0 || area->width <= 0 || area->height <= 0)
+		return FALSE;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	n_columns = eom_thumb_view_get_n_columns (thumbview);
+
+	x1 = area->x + (gint) gtk_adjustment_get_value (priv->hadjustment) - EOM_THUMB_VIEW_MARGIN;
+	y1 = area->y + (gint) gtk_adjustment_get_value (priv->vadjustment) - EOM_THUMB_VIEW_MARGIN;
+	x2 = x1 + area->width - 1;
+	y2 = y1 + area->height - 1;
+
+	if (x2 < 0 || y2 < 0)
+		return FALSE;
+
+	x1 = MAX (x1, 0) / item_width;
+	y1 = MAX (y1, 0) / item_height;
+	x2 = MIN (x2 / item_width, n_columns - 1);
+	y2 = y2 / item_height;
+
+	if (x1 > x2)
+		return FALSE;
+
+	*first = y1 * n_columns + x1;
+	*last = MIN (y2 * n_columns + x2, priv->n_images - 1);
+
+	return *first <= *last;
+}
+
+static void
+eom_thumb_view_queue_draw_item (EomThumbView *thumbview, gint index)
+{
+	GdkRectangle area;
+
+	eom_thumb_view_get_item_area (thumbview, index, &area);
+
+	gtk_widget_queue_draw_area (GTK_WIDGET (thumbview),
+				    area.x, area.y, area.width, area.height);
+}
+
+static EomImage *
+eom_thumb_view_get_image_at (EomThumbView *thumbview, gint index)
+{
+	GtkTreeIter iter;
+	EomImage *image = NULL;
+
+	if (gtk_tree_model_iter_nth_child (thumbview->priv->model, &iter, NULL, index)) {
+		gtk_tree_model_get (thumbview->priv->model, &iter,
+				    EOM_LIST_STORE_EOM_IMAGE, &image,
+				    -1);
+	}
+
+	return image;
+}
+
+/* Scrolling */
+
+static void
+eom_thumb_view_scroll_to_item (EomThumbView *thumbview, gint index)
+{
+	thumbview->priv->scroll_to = index;
+	gtk_widget_queue_allocate (GTK_WIDGET (thumbview));
+}
+
+static void
+eom_thumb_view_adjustment_show (GtkAdjustment *adjustment,
+				gint           start,
+				gint           length)
+{
+	gdouble value = gtk_adjustment_get_value (adjustment);
+	gdouble page_size = gtk_adjustment_get_page_size (adjustment);
+
+	/* start is relative to the current value */
+	if (start < 0)
+		gtk_adjustment_set_value (adjustment, value + start);
+	else if (start + length > page_size)
+		gtk_adjustment_set_value (adjustment, value + start + length - page_size);
+}
+
+static void
+eom_thumb_view_configure_adjustment (GtkAdjustment *adjustment,
+				     gint           page_size,
+				     gint           upper,
+				     gint           step)
+{
+	gdouble value;
+
+	upper = MAX (upper, page_size);
+	value = CLAMP (gtk_adjustment_get_value (adjustment), 0, upper - page_size);
+
+	gtk_adjustment_configure (adjustment, value, 0, upper,
+				  step, page_size * 0.9, page_size);
+}
+
+static void
+eom_thumb_view_adjustment_value_changed (GtkAdjustment *adjustment,
+					 EomThumbView  *thumbview)
+{
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+	eom_thumb_view_visible_range_changed (thumbview);
+}
+
+static void
+eom_thumb_view_set_adjustment (EomThumbView   *thumbview,
+			       GtkAdjustment **slot,
+			       GtkAdjustment  *adjustment)
+{
+	if (adjustment != NULL && *slot == adjustment)
+		return;
+
+	if (*slot != NULL) {
+		g_signal_handlers_disconnect_by_func (*slot,
+						      eom_thumb_view_adjustment_value_changed,
+						      thumbview);
+		g_object_unref (*slot);
+	}
+
+	if (adjustment == NULL)
+		adjustment = gtk_adjustment_new (0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+
+	*slot = g_object_ref_sink (adjustment);
+
+	g_signal_connect (adjustment, "value-changed",
+			  G_CALLBACK (eom_thumb_view_adjustment_value_changed),
+			  thumbview);
+
+	gtk_widget_queue_allocate (GTK_WIDGET (thumbview));
+}
+
+/* Visible range */
+
+static void
+eom_thumb_view_clear_range (EomThumbView *thumbview,
+			    const gint start_thumb,
+			    const gint end_thumb)
+{
+	GtkTreeIter iter;
+	EomListStore *store = EOM_LIST_STORE (thumbview->priv->model);
+	gint thumb = start_thumb;
+	gboolean result;
+
+	g_assert (start_thumb <= end_thumb);
+
+	for (result = gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, start_thumb);
+	     result && thumb <= end_thumb;
+	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
+		eom_list_store_thumbnail_unset (store, &iter);
+	}
+}
+
+static void
+eom_thumb_view_add_range (EomThumbView *thumbview,
+			  const gint start_thumb,
+			  const gint end_thumb)
+{
+	GtkTreeIter iter;
+	EomListStore *store = EOM_LIST_STORE (thumbview->priv->model);
+	gint thumb = start_thumb;
+	gboolean result;
+
+	g_assert (start_thumb <= end_thumb);
+
+	for (result = gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, start_thumb);
+	     result && thumb <= end_thumb;
+	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
+		eom_list_store_thumbnail_set (store, &iter);
+	}
+}
+
+static void
+eom_thumb_view_update_visible_range (EomThumbView *thumbview,
+				     const gint start_thumb,
+				     const gint end_thumb)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	int old_start_thumb, old_end_thumb;
+
+	old_start_thumb= priv->start_thumb;
+	old_end_thumb = priv->end_thumb;
+
+	if (start_thumb == old_start_thumb &&
+	    end_thumb == old_end_thumb) {
+		return;
+	}
+
+	if (old_end_thumb >= 0) {
+		if (old_start_thumb < start_thumb)
+			eom_thumb_view_clear_range (thumbview, old_start_thumb, MIN (start_thumb - 1, old_end_thumb));
+
+		if (old_end_thumb > end_thumb)
+			eom_thumb_view_clear_range (thumbview, MAX (end_thumb + 1, old_start_thumb), old_end_thumb);
+	}
+
+	if (start_thumb <= end_thumb)
+		eom_thumb_view_add_range (thumbview, start_thumb, end_thumb);
+
+	priv->start_thumb = start_thumb;
+	priv->end_thumb = end_thumb;
+}
+
+static gboolean
+visible_range_changed_cb (EomThumbView *thumbview)
+{
+	GdkRectangle area = { 0, 0, 0, 0 };
+	gint first = 0, last = -1;
+
+	thumbview->priv->visible_range_changed_id = 0;
+
+	if (thumbview->priv->model == NULL ||
+	    !gtk_widget_get_mapped (GTK_WIDGET (thumbview))) {
+		return FALSE;
+	}
+
+	area.width = gtk_widget_get_allocated_width (GTK_WIDGET (thumbview));
+	area.height = gtk_widget_get_allocated_height (GTK_WIDGET (thumbview));
+
+	if (!eom_thumb_view_get_items_in_area (thumbview, &area, &first, &last)) {
+		first = 0;
+		last = -1;
+	}
+
+	eom_thumb_view_update_visible_range (thumbview, first, last);
+
+	return FALSE;
+}
+
+static void
+eom_thumb_view_visible_range_changed (EomThumbView *thumbview)
+{
+	/* Coalesce the many adjustment changes of a scroll */
+	if (thumbview->priv->visible_range_changed_id == 0) {
+		thumbview->priv->visible_range_changed_id =
+			g_idle_add ((GSourceFunc)visible_range_changed_cb, thumbview);
+	}
+
+}
+
+/* Model */
+
+static void
+eom_thumb_view_emit_selection_changed (EomThumbView *thumbview)
+{
+	eom_thumb_view_accessible_selection_changed (thumbview);
+
+	g_signal_emit (thumbview, signals[SIGNAL_SELECTION_CHANGED], 0);
+}
+
+static void
+eom_thumb_view_set_cursor (EomThumbView *thumbview, gint index)
+{
+	gint old_cursor = thumbview->priv->cursor;
+
+	thumbview->priv->cursor = index;
+
+	if (old_cursor != index)
+		eom_thumb_view_accessible_cursor_changed (thumbview, old_cursor);
+}
+
+/* Selections made while a rubber band is dragged are relative
+ * to the rows when it started, so any model change ends it */
+static void
+eom_thumb_view_stop_rubberband (EomThumbView *thumbview)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+
+	if (!priv->rubberband_active)
+		return;
+
+	priv->rubberband_active = FALSE;
+	g_clear_pointer (&priv->rubberband_base, g_free);
+
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+}
+
+static void
+eom_thumb_view_model_changed (EomThumbView *thumbview)
+{
+	gtk_widget_queue_resize (GTK_WIDGET (thumbview));
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+	eom_thumb_view_visible_range_changed (thumbview);
+}
+
+static void
+eom_thumb_view_row_inserted_cb (GtkTreeModel    *tree_model,
+                                GtkTreePath     *path,
+                                GtkTreeIter     *iter,
+                                EomThumbView    *view)
+{
+	EomThumbViewPrivate *priv = view->priv;
+	gint index = gtk_tree_path_get_indices (path) [0];
+
+	eom_thumb_view_stop_rubberband (view);
+
+	priv->n_images++;
+	selection_insert (priv, index);
+
+	if (priv->cursor >= index)
+		priv->cursor++;
+	if (priv->anchor >= index)
+		priv->anchor++;
+
+	/* Rows with a thumbnail loaded move along */
+	if (index <= priv->start_thumb) {
+		priv->start_thumb++;
+		priv->end_thumb++;
+	} else if (index <= priv->end_thumb) {
+		priv->end_thumb++;
+	}
+
+	eom_thumb_view_model_changed (view);
+	eom_thumb_view_accessible_rows_changed (view, index, 1);
+}
+
+static void
+eom_thumb_view_row_deleted_cb (GtkTreeModel    *tree_model,
+                               GtkTreePath     *path,
+                               EomThumbView    *view)
+{
+	EomThumbViewPrivate *priv = view->priv;
+	gint index = gtk_tree_path_get_indices (path) [0];
+	gboolean was_selected;
+
+	eom_thumb_view_stop_rubberband (view);
+
+	priv->n_images--;
+	was_selected = selection_remove (priv, index);
+
+	if (priv->cursor > index || priv->cursor == priv->n_images)
+		priv->cursor--;
+	if (priv->anchor > index || priv->anchor == priv->n_images)
+		priv->anchor--;
+	if (priv->pressed_item >= index)
+		priv->pressed_item = -1;
+	if (priv->drag_item >= index)
+		priv->drag_item = -1;
+
+	if (index < priv->start_thumb) {
+		priv->start_thumb--;
+		priv->end_thumb--;
+	} else if (index <= priv->end_thumb) {
+		priv->end_thumb--;
+	}
+
+	eom_thumb_view_model_changed (view);
+	eom_thumb_view_accessible_rows_changed (view, index, -1);
+
+	if (was_selected)
+		eom_thumb_view_emit_selection_changed (view);
+}
+
+static void
+eom_thumb_view_row_changed_cb (GtkTreeModel    *tree_model,
+                               GtkTreePath     *path,
+                               GtkTreeIter     *iter,
+                               EomThumbView    *view)
+{
+	eom_thumb_view_queue_draw_item (view, gtk_tree_path_get_indices (path) [0]);
+}
+
+static void
+eom_thumb_view_rows_reordered_cb (GtkTreeModel    *tree_model,
+                                  GtkTreePath     *path,
+                                  GtkTreeIter     *iter,
+                                  gint            *new_order,
+                                  EomThumbView    *view)
+{
+	EomThumbViewPrivate *priv = view->priv;
+	guint32 *old_selection = priv->selection;
+	GtkTreeIter row;
+	gint cursor = -1, anchor = -1;
+	gint i;
+
+	eom_thumb_view_stop_rubberband (view);
+
+	priv->selection = g_new0 (guint32, priv->selection_words);
+
+	for (i = 0; i < priv->n_images; i++) {
+		gint old = new_order[i];
+
+		if ((old_selection[old / SELECTION_WORD_BITS] >> (old % SELECTION_WORD_BITS)) & 1)
+			priv->selection[i / SELECTION_WORD_BITS] |= 1U << (i % SELECTION_WORD_BITS);
+
+		if (old == priv->cursor)
+			cursor = i;
+		if (old == priv->anchor)
+			anchor = i;
+	}
+
+	g_free (old_selection);
+
+	priv->cursor = cursor;
+	priv->anchor = anchor;
+	priv->pressed_item = -1;
+	priv->drag_item = -1;
+
+	/* The loaded thumbnails are now scattered, unload them
+	 * and let the next visible range load what is shown */
+	if (priv->end_thumb >= 0 &&
+	    gtk_tree_model_get_iter_first (tree_model, &row)) {
+		i = 0;
+		do {
+			if (new_order[i] >= priv->start_thumb &&
+			    new_order[i] <= priv->end_thumb)
+				eom_list_store_thumbnail_unset (EOM_LIST_STORE (tree_model), &row);
+			i++;
+		} while (gtk_tree_model_iter_next (tree_model, &row));
+	}
+
+	priv->start_thumb = -1;
+	priv->end_thumb = -1;
+
+	eom_thumb_view_model_changed (view);
+	eom_thumb_view_accessible_rows_changed (view, 0, 0);
+}
+
+/* Selection changes from the user */
+
+static gboolean
+eom_thumb_view_select_range (EomThumbView *thumbview, gint from, gint to)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gboolean changed;
+	gint i;
+
+	changed = selection_clear (priv);
+
+	for (i = MIN (from, to); i <= MAX (from, to); i++)
+		changed = selection_set (priv, i, TRUE) || changed;
+
+	return changed;
+}
+
+static void
+eom_thumb_view_move_cursor (EomThumbView    *thumbview,
+			    gint             index,
+			    GdkModifierType  state)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gboolean changed = FALSE;
+
+	if (priv->n_images == 0)
+		return;
+
+	index = CLAMP (index, 0, priv->n_images - 1);
+
+	if (state & GDK_SHIFT_MASK) {
+		if (priv->anchor < 0)
+			priv->anchor = MAX (priv->cursor, 0);
+
+		changed = eom_thumb_view_select_range (thumbview, priv->anchor, index);
+	} else if (!(state & GDK_CONTROL_MASK)) {
+		changed = selection_clear (priv);
+		changed = selection_set (priv, index, TRUE) || changed;
+		priv->anchor = index;
+	}
+
+	eom_thumb_view_set_cursor (thumbview, index);
+
+	eom_thumb_view_scroll_to_item (thumbview, index);
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+
+	if (changed)
+		eom_thumb_view_emit_selection_changed (thumbview);
+}
+
+/* Accessibility
+ *
+ * Items are not widgets, so the view exposes each of them as a child
+ * accessible. Those are only made when an assistive technology asks
+ * for them and are kept by index, which is updated as rows come and
+ * go so that screen readers can walk a folder of any size. */
+
+typedef struct {
+	AtkObject     parent;
+	EomThumbView *thumbview; /* weak, NULL once defunct */
+	gint          index;
+} EomThumbViewItemAccessible;
+
+typedef struct {
+	AtkObjectClass parent_class;
+} EomThumbViewItemAccessibleClass;
+
+typedef struct {
+	GtkWidgetAccessible parent;
+	GHashTable         *items; /* index -> EomThumbViewItemAccessible */
+} EomThumbViewAccessible;
+
+typedef struct {
+	GtkWidgetAccessibleClass parent_class;
+} EomThumbViewAccessibleClass;
+
+static GType eom_thumb_view_item_accessible_get_type (void);
+
+static void item_accessible_component_init (AtkComponentIface *iface);
+static void item_accessible_action_init (AtkActionIface *iface);
+static void item_accessible_image_init (AtkImageIface *iface);
+static void eom_thumb_view_accessible_selection_init (AtkSelectionIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (EomThumbViewItemAccessible, eom_thumb_view_item_accessible, ATK_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (ATK_TYPE_COMPONENT, item_accessible_component_init) \
+			 G_IMPLEMENT_INTERFACE (ATK_TYPE_ACTION, item_accessible_action_init) \
+			 G_IMPLEMENT_INTERFACE (ATK_TYPE_IMAGE, item_accessible_image_init));
+
+G_DEFINE_TYPE_WITH_CODE (EomThumbViewAccessible, eom_thumb_view_accessible, GTK_TYPE_WIDGET_ACCESSIBLE,
+			 G_IMPLEMENT_INTERFACE (ATK_TYPE_SELECTION, eom_thumb_view_accessible_selection_init));
+
+#define EOM_THUMB_VIEW_ITEM_ACCESSIBLE(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST ((obj), eom_thumb_view_item_accessible_get_type (), EomThumbViewItemAccessible))
+#define EOM_THUMB_VIEW_ACCESSIBLE(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST ((obj), eom_thumb_view_accessible_get_type (), EomThumbViewAccessible))
+
+static gboolean
+item_accessible_is_defunct (EomThumbViewItemAccessible *item)
+{
+	return item->thumbview == NULL ||
+	       item->index >= item->thumbview->priv->n_images;
+}
+
+static void
+eom_thumb_view_item_accessible_init (EomThumbViewItemAccessible *item)
+{
+	item->index = -1;
+}
+
+static void
+eom_thumb_view_item_accessible_finalize (GObject *object)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (object);
+
+	if (item->thumbview != NULL)
+		g_object_remove_weak_pointer (G_OBJECT (item->thumbview),
+					      (gpointer *) &item->thumbview);
+
+	G_OBJECT_CLASS (eom_thumb_view_item_accessible_parent_class)->finalize (object);
+}
+
+static const gchar *
+eom_thumb_view_item_accessible_get_name (AtkObject *accessible)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (accessible);
+	EomImage *image;
+
+	if (accessible->name != NULL || item_accessible_is_defunct (item))
+		return accessible->name;
+
+	image = eom_thumb_view_get_image_at (item->thumbview, item->index);
+
+	if (image == NULL)
+		return NULL;
+
+	/* The caption lives as long as the image, which
+	 * the store keeps until the row is deleted */
+	accessible->name = g_strdup (eom_image_get_caption (image));
+	g_object_unref (image);
+
+	return accessible->name;
+}
+
+static gint
+eom_thumb_view_item_accessible_get_index_in_parent (AtkObject *accessible)
+{
+	return EOM_THUMB_VIEW_ITEM_ACCESSIBLE (accessible)->index;
+}
+
+static AtkStateSet *
+eom_thumb_view_item_accessible_ref_state_set (AtkObject *accessible)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (accessible);
+	EomThumbViewPrivate *priv;
+	AtkStateSet *state_set;
+	GdkRectangle area;
+
+	state_set = ATK_OBJECT_CLASS (eom_thumb_view_item_accessible_parent_class)->ref_state_set (accessible);
+
+	if (item_accessible_is_defunct (item)) {
+		atk_state_set_add_state (state_set, ATK_STATE_DEFUNCT);
+		return state_set;
+	}
+
+	priv = item->thumbview->priv;
+
+	atk_state_set_add_state (state_set, ATK_STATE_ENABLED);
+	atk_state_set_add_state (state_set, ATK_STATE_SENSITIVE);
+	atk_state_set_add_state (state_set, ATK_STATE_SELECTABLE);
+	atk_state_set_add_state (state_set, ATK_STATE_FOCUSABLE);
+	atk_state_set_add_state (state_set, ATK_STATE_VISIBLE);
+
+	eom_thumb_view_get_item_area (item->thumbview, item->index, &area);
+
+	if (gtk_widget_get_mapped (GTK_WIDGET (item->thumbview)) &&
+	    area.x + area.width > 0 && area.y + area.height > 0 &&
+	    area.x < gtk_widget_get_allocated_width (GTK_WIDGET (item->thumbview)) &&
+	    area.y < gtk_widget_get_allocated_height (GTK_WIDGET (item->thumbview)))
+		atk_state_set_add_state (state_set, ATK_STATE_SHOWING);
+
+	if (selection_get (priv, item->index))
+		atk_state_set_add_state (state_set, ATK_STATE_SELECTED);
+
+	if (priv->cursor == item->index &&
+	    gtk_widget_has_focus (GTK_WIDGET (item->thumbview)))
+		atk_state_set_add_state (state_set, ATK_STATE_FOCUSED);
+
+	return state_set;
+}
+
+static void
+eom_thumb_view_item_accessible_class_init (EomThumbViewItemAccessibleClass *klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+	AtkObjectClass *atk_class = ATK_OBJECT_CLASS (klass);
+
+	gobject_class->finalize = eom_thumb_view_item_accessible_finalize;
+
+	atk_class->get_name = eom_thumb_view_item_accessible_get_name;
+	atk_class->get_index_in_parent = eom_thumb_view_item_accessible_get_index_in_parent;
+	atk_class->ref_state_set = eom_thumb_view_item_accessible_ref_state_set;
+}
+
+static void
+item_accessible_get_extents (AtkComponent *component,
+			     gint         *x,
+			     gint         *y,
+			     gint         *width,
+			     gint         *height,
+			     AtkCoordType  coord_type)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (component);
+	GdkWindow *window;
+	GdkRectangle area;
+	gint origin_x, origin_y;
+
+	*x = *y = *width = *height = G_MININT;
+
+	if (item_accessible_is_defunct (item))
+		return;
+
+	window = gtk_widget_get_window (GTK_WIDGET (item->thumbview));
+
+	if (window == NULL)
+		return;
+
+	eom_thumb_view_get_item_area (item->thumbview, item->index, &area);
+	gdk_window_get_origin (window, &origin_x, &origin_y);
+
+	*x = origin_x + area.x;
+	*y = origin_y + area.y;
+	*width = area.width;
+	*height = area.height;
+
+	if (coord_type == ATK_XY_WINDOW) {
+		gdk_window_get_origin (gdk_window_get_toplevel (window),
+				       &origin_x, &origin_y);
+		*x -= origin_x;
+		*y -= origin_y;
+	}
+}
+
+static gboolean
+item_accessible_grab_focus (AtkComponent *component)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (component);
+
+	if (item_accessible_is_defunct (item))
+		return FALSE;
+
+	gtk_widget_grab_focus (GTK_WIDGET (item->thumbview));
+	eom_thumb_view_move_cursor (item->thumbview, item->index, 0);
+
+	return TRUE;
+}
+
+static void
+item_accessible_component_init (AtkComponentIface *iface)
+{
+	iface->get_extents = item_accessible_get_extents;
+	iface->grab_focus = item_accessible_grab_focus;
+}
+
+static gint
+item_accessible_get_n_actions (AtkAction *action)
+{
+	return 1;
+}
+
+static gboolean
+item_accessible_do_action (AtkAction *action, gint i)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (action);
+
+	if (i != 0 || item_accessible_is_defunct (item))
+		return FALSE;
+
+	/* Selecting an image shows it in the window */
+	eom_thumb_view_move_cursor (item->thumbview, item->index, 0);
+
+	return TRUE;
+}
+
+static const gchar *
+item_accessible_get_action_name (AtkAction *action, gint i)
+{
+	return i == 0 ? "activate" : NULL;
+}
+
+static const gchar *
+item_accessible_get_action_description (AtkAction *action, gint i)
+{
+	return i == 0 ? _("Show the image") : NULL;
+}
+
+static void
+item_accessible_action_init (AtkActionIface *iface)
+{
+	iface->get_n_actions = item_accessible_get_n_actions;
+	iface->do_action = item_accessible_do_action;
+	iface->get_name = item_accessible_get_action_name;
+	iface->get_description = item_accessible_get_action_description;
+}
+
+static const gchar *
+item_accessible_get_image_description (AtkImage *image)
+{
+	return atk_object_get_name (ATK_OBJECT (image));
+}
+
+static void
+item_accessible_get_image_size (AtkImage *image,
+				gint     *width,
+				gint     *height)
+{
+	EomThumbViewItemAccessible *item = EOM_THUMB_VIEW_ITEM_ACCESSIBLE (image);
+	GdkRectangle area;
+
+	if (item_accessible_is_defunct (item)) {
+		*width = *height = -1;
+		return;
+	}
+
+	eom_thumb_view_get_item_area (item->thumbview, item->index, &area);
+
+	*width = area.width;
+	*height = area.height;
+}
+
+static void
+item_accessible_get_image_position (AtkImage     *image,
+				    gint         *x,
+				    gint         *y,
+				    AtkCoordType  coord_type)
+{
+	gint width, height;
+
+	item_accessible_get_extents (ATK_COMPONENT (image), x, y,
+				     &width, &height, coord_type);
+}
+
+static void
+item_accessible_image_init (AtkImageIface *iface)
+{
+	iface->get_image_description = item_accessible_get_image_description;
+	iface->get_image_size = item_accessible_get_image_size;
+	iface->get_image_position = item_accessible_get_image_position;
+}
+
+static EomThumbView *
+eom_thumb_view_accessible_get_view (gpointer accessible)
+{
+	GtkWidget *widget = gtk_accessible_get_widget (GTK_ACCESSIBLE (accessible));
+
+	return widget != NULL ? EOM_THUMB_VIEW (widget) : NULL;
+}
+
+static void
+eom_thumb_view_accessible_init (EomThumbViewAccessible *accessible)
+{
+	accessible->items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						   NULL, g_object_unref);
+}
+
+static void
+eom_thumb_view_accessible_initialize (AtkObject *accessible, gpointer data)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (data);
+
+	ATK_OBJECT_CLASS (eom_thumb_view_accessible_parent_class)->initialize (accessible, data);
+
+	accessible->role = ATK_ROLE_LAYERED_PANE;
+
+	thumbview->priv->accessible = accessible;
+	g_object_add_weak_pointer (G_OBJECT (accessible),
+				   (gpointer *) &thumbview->priv->accessible);
+}
+
+static void
+eom_thumb_view_accessible_finalize (GObject *object)
+{
+	g_hash_table_destroy (EOM_THUMB_VIEW_ACCESSIBLE (object)->items);
+
+	G_OBJECT_CLASS (eom_thumb_view_accessible_parent_class)->finalize (object);
+}
+
+static gint
+eom_thumb_view_accessible_get_n_children (AtkObject *accessible)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (accessible);
+
+	return thumbview != NULL ? thumbview->priv->n_images : 0;
+}
+
+static AtkObject *
+eom_thumb_view_accessible_ref_child (AtkObject *accessible, gint index)
+{
+	EomThumbViewAccessible *view_accessible = EOM_THUMB_VIEW_ACCESSIBLE (accessible);
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (accessible);
+	EomThumbViewItemAccessible *item;
+
+	if (thumbview == NULL || index < 0 || index >= thumbview->priv->n_images)
+		return NULL;
+
+	item = g_hash_table_lookup (view_accessible->items, GINT_TO_POINTER (index));
+
+	if (item == NULL) {
+		item = g_object_new (eom_thumb_view_item_accessible_get_type (), NULL);
+		item->index = index;
+		item->thumbview = thumbview;
+		g_object_add_weak_pointer (G_OBJECT (thumbview),
+					   (gpointer *) &item->thumbview);
+
+		ATK_OBJECT (item)->role = ATK_ROLE_ICON;
+		atk_object_set_parent (ATK_OBJECT (item), accessible);
+
+		g_hash_table_insert (view_accessible->items,
+				     GINT_TO_POINTER (index), item);
+	}
+
+	return g_object_ref (ATK_OBJECT (item));
+}
+
+static void
+eom_thumb_view_accessible_class_init (EomThumbViewAccessibleClass *klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+	AtkObjectClass *atk_class = ATK_OBJECT_CLASS (klass);
+
+	gobject_class->finalize = eom_thumb_view_accessible_finalize;
+
+	atk_class->initialize = eom_thumb_view_accessible_initialize;
+	atk_class->get_n_children = eom_thumb_view_accessible_get_n_children;
+	atk_class->ref_child = eom_thumb_view_accessible_ref_child;
+}
+
+static gboolean
+eom_thumb_view_accessible_add_selection (AtkSelection *selection, gint i)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+
+	if (thumbview == NULL || i < 0 || i >= thumbview->priv->n_images)
+		return FALSE;
+
+	if (selection_set (thumbview->priv, i, TRUE)) {
+		eom_thumb_view_queue_draw_item (thumbview, i);
+		eom_thumb_view_emit_selection_changed (thumbview);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+eom_thumb_view_accessible_clear_selection (AtkSelection *selection)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+
+	if (thumbview == NULL)
+		return FALSE;
+
+	if (selection_clear (thumbview->priv)) {
+		gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+		eom_thumb_view_emit_selection_changed (thumbview);
+	}
+
+	return TRUE;
+}
+
+/* Gets the index of the @i-th selected item, or -1 */
+static gint
+eom_thumb_view_accessible_get_selected (EomThumbView *thumbview, gint i)
+{
+	gint index;
+
+	for (index = selection_next (thumbview->priv, 0);
+	     index >= 0 && i > 0;
+	     index = selection_next (thumbview->priv, index + 1), i--);
+
+	return index;
+}
+
+static AtkObject *
+eom_thumb_view_accessible_ref_selection (AtkSelection *selection, gint i)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+	gint index;
+
+	if (thumbview == NULL || i < 0)
+		return NULL;
+
+	index = eom_thumb_view_accessible_get_selected (thumbview, i);
+
+	if (index < 0)
+		return NULL;
+
+	return eom_thumb_view_accessible_ref_child (ATK_OBJECT (selection), index);
+}
+
+static gint
+eom_thumb_view_accessible_get_selection_count (AtkSelection *selection)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+
+	return thumbview != NULL ? thumbview->priv->n_selected : 0;
+}
+
+static gboolean
+eom_thumb_view_accessible_is_child_selected (AtkSelection *selection, gint i)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+
+	if (thumbview == NULL || i < 0 || i >= thumbview->priv->n_images)
+		return FALSE;
+
+	return selection_get (thumbview->priv, i);
+}
+
+static gboolean
+eom_thumb_view_accessible_remove_selection (AtkSelection *selection, gint i)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+	gint index;
+
+	if (thumbview == NULL || i < 0)
+		return FALSE;
+
+	index = eom_thumb_view_accessible_get_selected (thumbview, i);
+
+	if (index < 0)
+		return FALSE;
+
+	selection_set (thumbview->priv, index, FALSE);
+	eom_thumb_view_queue_draw_item (thumbview, index);
+	eom_thumb_view_emit_selection_changed (thumbview);
+
+	return TRUE;
+}
+
+static gboolean
+eom_thumb_view_accessible_select_all_selection (AtkSelection *selection)
+{
+	EomThumbView *thumbview = eom_thumb_view_accessible_get_view (selection);
+
+	if (thumbview == NULL || thumbview->priv->n_images == 0)
+		return FALSE;
+
+	if (eom_thumb_view_select_range (thumbview, 0, thumbview->priv->n_images - 1)) {
+		gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+		eom_thumb_view_emit_selection_changed (thumbview);
+	}
+
+	return TRUE;
+}
+
+static void
+eom_thumb_view_accessible_selection_init (AtkSelectionIface *iface)
+{
+	iface->add_selection = eom_thumb_view_accessible_add_selection;
+	iface->clear_selection = eom_thumb_view_accessible_clear_selection;
+	iface->ref_selection = eom_thumb_view_accessible_ref_selection;
+	iface->get_selection_count = eom_thumb_view_accessible_get_selection_count;
+	iface->is_child_selected = eom_thumb_view_accessible_is_child_selected;
+	iface->remove_selection = eom_thumb_view_accessible_remove_selection;
+	iface->select_all_selection = eom_thumb_view_accessible_select_all_selection;
+}
+
+static void
+eom_thumb_view_accessible_cursor_changed (EomThumbView *thumbview,
+					  gint          old_cursor)
+{
+	AtkObject *accessible = thumbview->priv->accessible;
+	EomThumbViewAccessible *view_accessible;
+	AtkObject *item;
+
+	if (accessible == NULL)
+		return;
+
+	view_accessible = EOM_THUMB_VIEW_ACCESSIBLE (accessible);
+
+	item = g_hash_table_lookup (view_accessible->items, GINT_TO_POINTER (old_cursor));
+	if (item != NULL)
+		atk_object_notify_state_change (item, ATK_STATE_FOCUSED, FALSE);
+
+	if (thumbview->priv->cursor < 0)
+		return;
+
+	item = eom_thumb_view_accessible_ref_child (accessible, thumbview->priv->cursor);
+	if (item == NULL)
+		return;
+
+	if (gtk_widget_has_focus (GTK_WIDGET (thumbview))) {
+		atk_object_notify_state_change (item, ATK_STATE_FOCUSED, TRUE);
+		g_signal_emit_by_name (accessible, "active-descendant-changed", item);
+	}
+
+	g_object_unref (item);
+}
+
+static void
+eom_thumb_view_accessible_selection_changed (EomThumbView *thumbview)
+{
+	if (thumbview->priv->accessible != NULL)
+		g_signal_emit_by_name (thumbview->priv->accessible, "selection-changed");
+}
+
+/* Follows the model: a @delta of 1 is a row inserted at @index,
+ * -1 a row deleted there and 0 rows moved around */
+static void
+eom_thumb_view_accessible_rows_changed (EomThumbView *thumbview,
+					gint          index,
+					gint          delta)
+{
+	AtkObject *accessible = thumbview->priv->accessible;
+	EomThumbViewAccessible *view_accessible;
+	GHashTable *items;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (accessible == NULL)
+		return;
+
+	view_accessible = EOM_THUMB_VIEW_ACCESSIBLE (accessible);
+
+	items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				       NULL, g_object_unref);
+
+	g_hash_table_iter_init (&iter, view_accessible->items);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		EomThumbViewItemAccessible *item = value;
+
+		g_hash_table_iter_steal (&iter);
+
+		if (delta == 0 || (delta < 0 && item->index == index)) {
+			/* Whatever the item was showing is gone */
+			if (item->thumbview != NULL) {
+				g_object_remove_weak_pointer (G_OBJECT (item->thumbview),
+							      (gpointer *) &item->thumbview);
+				item->thumbview = NULL;
+			}
+
+			atk_object_notify_state_change (ATK_OBJECT (item),
+							ATK_STATE_DEFUNCT, TRUE);
+			g_object_unref (item);
+			continue;
+		}
+
+		if (item->index >= index)
+			item->index += delta;
+
+		g_hash_table_insert (items, GINT_TO_POINTER (item->index), item);
+	}
+
+	g_hash_table_destroy (view_accessible->items);
+	view_accessible->items = items;
+
+	if (delta > 0)
+		g_signal_emit_by_name (accessible, "children-changed::add", index, NULL);
+	else if (delta < 0)
+		g_signal_emit_by_name (accessible, "children-changed::remove", index, NULL);
+	else
+		g_signal_emit_by_name (accessible, "visible-data-changed");
+}
+
+/* GtkWidget */
+
+static void
+eom_thumb_view_realize (GtkWidget *widget)
+{
+	GtkAllocation allocation;
+	GdkWindowAttr attributes;
+	GdkWindow *window;
+
+	gtk_widget_set_realized (widget, TRUE);
+	gtk_widget_get_allocation (widget, &allocation);
+
+	attributes.window_type = GDK_WINDOW_CHILD;
+	attributes.x = allocation.x;
+	attributes.y = allocation.y;
+	attributes.width = allocation.width;
+	attributes.height = allocation.height;
+	attributes.wclass = GDK_INPUT_OUTPUT;
+	attributes.visual = gtk_widget_get_visual (widget);
+	attributes.event_mask = gtk_widget_get_events (widget) |
+				GDK_EXPOSURE_MASK |
+				GDK_BUTTON_PRESS_MASK |
+				GDK_BUTTON_RELEASE_MASK |
+				GDK_POINTER_MOTION_MASK |
+				GDK_ENTER_NOTIFY_MASK |
+				GDK_LEAVE_NOTIFY_MASK |
+				GDK_KEY_PRESS_MASK |
+				GDK_SCROLL_MASK |
+				GDK_SMOOTH_SCROLL_MASK;
+
+	window = gdk_window_new (gtk_widget_get_parent_window (widget),
+				 &attributes,
+				 GDK_WA_X | GDK_WA_Y | GDK_WA_VISUAL);
+
+	gtk_widget_set_window (widget, window);
+	gtk_widget_register_window (widget, window);
+}
+
+static void
+eom_thumb_view_size_allocate (GtkWidget     *widget,
+			      GtkAllocation *allocation)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gint item_width, item_height;
+	gint width, height;
+
+	gtk_widget_set_allocation (widget, allocation);
+
+	if (gtk_widget_get_realized (widget)) {
+		gdk_window_move_resize (gtk_widget_get_window (widget),
+					allocation->x, allocation->y,
+					allocation->width, allocation->height);
+	}
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	eom_thumb_view_get_content_size (thumbview, &width, &height);
+
+	g_object_freeze_notify (G_OBJECT (priv->hadjustment));
+	g_object_freeze_notify (G_OBJECT (priv->vadjustment));
+
+	eom_thumb_view_configure_adjustment (priv->hadjustment,
+					     allocation->width, width, item_width);
+	eom_thumb_view_configure_adjustment (priv->vadjustment,
+					     allocation->height, height, item_height);
+
+	if (priv->scroll_to >= 0 && priv->scroll_to < priv->n_images) {
+		GdkRectangle area;
+
+		eom_thumb_view_get_item_area (thumbview, priv->scroll_to, &area);
+		eom_thumb_view_adjustment_show (priv->hadjustment, area.x, area.width);
+		eom_thumb_view_adjustment_show (priv->vadjustment, area.y, area.height);
+	}
+	priv->scroll_to = -1;
+
+	g_object_thaw_notify (G_OBJECT (priv->hadjustment));
+	g_object_thaw_notify (G_OBJECT (priv->vadjustment));
+
+	eom_thumb_view_visible_range_changed (thumbview);
+}
+
+static GtkSizeRequestMode
+eom_thumb_view_get_request_mode (GtkWidget *widget)
+{
+	return GTK_SIZE_REQUEST_HEIGHT_FOR_WIDTH;
+}
+
+/* The scrolled window compares the requested size with its own
+ * to decide whether to show the scrollbars, so request all of it */
+static void
+eom_thumb_view_get_preferred_width (GtkWidget *widget,
+				    gint      *minimum,
+				    gint      *natural)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	gint item_width, item_height;
+	gint n_columns = 1;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+
+	if (thumbview->priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+		n_columns = MAX (thumbview->priv->n_images, 1);
+
+	*minimum = *natural = 2 * EOM_THUMB_VIEW_MARGIN + n_columns * item_width;
+}
+
+static void
+eom_thumb_view_get_preferred_height_for_width (GtkWidget *widget,
+					       gint       width,
+					       gint      *minimum,
+					       gint      *natural)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	gint item_width, item_height;
+	gint n_columns, n_rows = 1;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+
+	if (thumbview->priv->orientation == GTK_ORIENTATION_VERTICAL) {
+		n_columns = MAX ((width - 2 * EOM_THUMB_VIEW_MARGIN) / item_width, 1);
+		n_rows = MAX ((thumbview->priv->n_images + n_columns - 1) / n_columns, 1);
+	}
+
+	*minimum = *natural = 2 * EOM_THUMB_VIEW_MARGIN + n_rows * item_height;
+}
+
+static void
+eom_thumb_view_get_preferred_height (GtkWidget *widget,
+				     gint      *minimum,
+				     gint      *natural)
+{
+	gint width, natural_width;
+
+	eom_thumb_view_get_preferred_width (widget, &width, &natural_width);
+	eom_thumb_view_get_preferred_height_for_width (widget, width, minimum, natural);
+}
+
+static void
+eom_thumb_view_draw_item (EomThumbView       *thumbview,
+			  cairo_t            *cr,
+			  GtkTreeIter        *iter,
+			  gint                index,
+			  const GdkRectangle *area)
+{
+	GtkWidget *widget = GTK_WIDGET (thumbview);
+	GtkStyleContext *context = gtk_widget_get_style_context (widget);
+	cairo_surface_t *surface;
+	GdkPixbuf *pixbuf;
+	GdkRectangle extents;
+	gint x, y;
+
+	gtk_style_context_save (context);
+
+	if (selection_get (thumbview->priv, index)) {
+		gtk_style_context_set_state (context,
+					     gtk_widget_get_state_flags (widget) |
+					     GTK_STATE_FLAG_SELECTED);
+		gtk_render_background (context, cr,
+				       area->x, area->y,
+				       area->width, area->height);
+	}
+
+	gtk_tree_model_get (thumbview->priv->model, iter,
+			    EOM_LIST_STORE_THUMB_SURFACE, &surface,
+			    EOM_LIST_STORE_THUMBNAIL, &pixbuf,
+			    -1);
+
+	/* Loaded thumbnails come framed and premultiplied from
+	 * their atlas; icons for busy or missing ones are pixbufs */
+	if (surface != NULL) {
+		cairo_t *surface_cr = cairo_create (surface);
+
+		gdk_cairo_get_clip_rectangle (surface_cr, &extents);
+		cairo_destroy (surface_cr);
+
+		x = area->x + (area->width - extents.width) / 2;
+		y = area->y + (area->height - extents.height) / 2;
+
+		cairo_set_source_surface (cr, surface, x, y);
+		cairo_paint (cr);
+		cairo_surface_destroy (surface);
+	} else if (pixbuf != NULL) {
+		x = area->x + (area->width - gdk_pixbuf_get_width (pixbuf)) / 2;
+		y = area->y + (area->height - gdk_pixbuf_get_height (pixbuf)) / 2;
+
+		gdk_cairo_set_source_pixbuf (cr, pixbuf, x, y);
+		cairo_paint (cr);
+	}
+
+	if (pixbuf != NULL)
+		g_object_unref (pixbuf);
+
+	if (index == thumbview->priv->cursor && gtk_widget_has_visible_focus (widget)) {
+		gtk_render_focus (context, cr,
+				  area->x, area->y,
+				  area->width, area->height);
+	}
+
+	gtk_style_context_restore (context);
+}
+
+static gboolean
+eom_thumb_view_draw (GtkWidget *widget, cairo_t *cr)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	GtkTreeIter iter;
+	GdkRectangle clip, area;
+	gint first, last, index;
+
+	gtk_render_background (gtk_widget_get_style_context (widget), cr, 0, 0,
+			       gtk_widget_get_allocated_width (widget),
+			       gtk_widget_get_allocated_height (widget));
+
+	if (thumbview->priv->model != NULL &&
+	    gdk_cairo_get_clip_rectangle (cr, &clip) &&
+	    eom_thumb_view_get_items_in_area (thumbview, &clip, &first, &last) &&
+	    gtk_tree_model_iter_nth_child (thumbview->priv->model, &iter, NULL, first)) {
+		for (index = first; index <= last; index++) {
+			eom_thumb_view_get_item_area (thumbview, index, &area);
+
+			/* Rows of a grid also span columns outside the clip */
+			if (gdk_rectangle_intersect (&area, &clip, NULL))
+				eom_thumb_view_draw_item (thumbview, cr, &iter, index, &area);
+
+			if (!gtk_tree_model_iter_next (thumbview->priv->model, &iter))
+				break;
+		}
+	}
+
+	if (thumbview->priv->rubberband_active) {
+		GtkStyleContext *context = gtk_widget_get_style_context (widget);
+		gint x, y, width, height;
+
+		x = MIN (thumbview->priv->rubberband_x1, thumbview->priv->rubberband_x2)
+		    - (gint) gtk_adjustment_get_value (thumbview->priv->hadjustment);
+		y = MIN (thumbview->priv->rubberband_y1, thumbview->priv->rubberband_y2)
+		    - (gint) gtk_adjustment_get_value (thumbview->priv->vadjustment);
+		width = ABS (thumbview->priv->rubberband_x2 - thumbview->priv->rubberband_x1) + 1;
+		height = ABS (thumbview->priv->rubberband_y2 - thumbview->priv->rubberband_y1) + 1;
+
+		gtk_style_context_save (context);
+		gtk_style_context_add_class (context, GTK_STYLE_CLASS_RUBBERBAND);
+		gtk_render_background (context, cr, x, y, width, height);
+		gtk_render_frame (context, cr, x, y, width, height);
+		gtk_style_context_restore (context);
+	}
+
+	return FALSE;
+}
+
+static gboolean
+eom_thumb_view_button_press (GtkWidget *widget, GdkEventButton *event)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gboolean changed = FALSE;
+	gint index;
+
+	if (!gtk_widget_has_focus (widget))
+		gtk_widget_grab_focus (widget);
+
+	/* Ignore double-clicks and triple-clicks */
+	if (event->button != GDK_BUTTON_PRIMARY || event->type != GDK_BUTTON_PRESS)
+		return FALSE;
+
+	index = eom_thumb_view_get_item_at_pos (thumbview, event->x, event->y);
+	priv->pressed_item = -1;
+	priv->drag_item = index;
+	priv->press_x = event->x;
+	priv->press_y = event->y;
+
+	if (index < 0) {
+		if (!(event->state & (GDK_SHIFT_MASK | GDK_CONTROL_MASK)))
+			changed = selection_clear (priv);
+
+		eom_thumb_view_stop_rubberband (thumbview);
+
+		priv->rubberband_active = TRUE;
+		priv->rubberband_base = selection_copy (priv, priv->selection);
+		priv->rubberband_x1 = priv->rubberband_x2 =
+			event->x + gtk_adjustment_get_value (priv->hadjustment);
+		priv->rubberband_y1 = priv->rubberband_y2 =
+			event->y + gtk_adjustment_get_value (priv->vadjustment);
+	} else if (event->state & GDK_CONTROL_MASK) {
+		changed = selection_set (priv, index, !selection_get (priv, index));
+		eom_thumb_view_set_cursor (thumbview, index);
+		priv->anchor = index;
+	} else if (event->state & GDK_SHIFT_MASK && priv->anchor >= 0) {
+		changed = eom_thumb_view_select_range (thumbview, priv->anchor, index);
+		eom_thumb_view_set_cursor (thumbview, index);
+	} else if (selection_get (priv, index)) {
+		/* Keep the selection in case a drag of it starts,
+		 * the release selects the item alone otherwise */
+		priv->pressed_item = index;
+		eom_thumb_view_set_cursor (thumbview, index);
+		priv->anchor = index;
+	} else {
+		changed = selection_clear (priv);
+		changed = selection_set (priv, index, TRUE) || changed;
+		eom_thumb_view_set_cursor (thumbview, index);
+		priv->anchor = index;
+	}
+
+	gtk_widget_queue_draw (widget);
+
+	if (changed)
+		eom_thumb_view_emit_selection_changed (thumbview);
+
+	return TRUE;
+}
+
+static gboolean
+eom_thumb_view_button_release (GtkWidget *widget, GdkEventButton *event)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gboolean changed;
+
+	if (event->button != GDK_BUTTON_PRIMARY)
+		return FALSE;
+
+	priv->drag_item = -1;
+
+	if (priv->rubberband_active) {
+		eom_thumb_view_stop_rubberband (thumbview);
+		return TRUE;
+	}
+
+	if (priv->pressed_item < 0)
+		return FALSE;
+
+	changed = selection_clear (priv);
+	changed = selection_set (priv, priv->pressed_item, TRUE) || changed;
+	priv->pressed_item = -1;
+
+	gtk_widget_queue_draw (widget);
+
+	if (changed)
+		eom_thumb_view_emit_selection_changed (thumbview);
+
+	return TRUE;
+}
+
+/* Selects the items within the band and those selected before it
+ * started. Returns whether the selection changed. */
+static gboolean
+eom_thumb_view_update_rubberband (EomThumbView *thumbview, gint x, gint y)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	GdkRectangle band, area;
+	guint32 *old_selection;
+	gboolean changed;
+	gint first, last, index;
+
+	priv->rubberband_x2 = x + gtk_adjustment_get_value (priv->hadjustment);
+	priv->rubberband_y2 = y + gtk_adjustment_get_value (priv->vadjustment);
+
+	band.x = MIN (priv->rubberband_x1, priv->rubberband_x2)
+		 - (gint) gtk_adjustment_get_value (priv->hadjustment);
+	band.y = MIN (priv->rubberband_y1, priv->rubberband_y2)
+		 - (gint) gtk_adjustment_get_value (priv->vadjustment);
+	band.width = ABS (priv->rubberband_x2 - priv->rubberband_x1) + 1;
+	band.height = ABS (priv->rubberband_y2 - priv->rubberband_y1) + 1;
+
+	old_selection = priv->selection;
+	priv->selection = selection_copy (priv, priv->rubberband_base);
+	selection_recount (priv);
+
+	if (eom_thumb_view_get_items_in_area (thumbview, &band, &first, &last)) {
+		for (index = first; index <= last; index++) {
+			eom_thumb_view_get_item_area (thumbview, index, &area);
+
+			/* Rows of a grid also span columns outside the band */
+			if (gdk_rectangle_intersect (&area, &band, NULL))
+				selection_set (priv, index, TRUE);
+		}
+	}
+
+	changed = memcmp (old_selection, priv->selection,
+			  priv->selection_words * sizeof (guint32)) != 0;
+	g_free (old_selection);
+
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+
+	return changed;
+}
+
+static gboolean
+eom_thumb_view_motion_notify (GtkWidget *widget, GdkEventMotion *event)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	EomThumbViewPrivate *priv = thumbview->priv;
+
+	if (priv->rubberband_active) {
+		gint width = gtk_widget_get_allocated_width (widget);
+		gint height = gtk_widget_get_allocated_height (widget);
+
+		/* Scroll along when the band leaves the view */
+		if (event->x < 0 || event->x > width) {
+			gtk_adjustment_set_value (priv->hadjustment,
+						  gtk_adjustment_get_value (priv->hadjustment) +
+						  (event->x < 0 ? event->x : event->x - width));
+		}
+		if (event->y < 0 || event->y > height) {
+			gtk_adjustment_set_value (priv->vadjustment,
+						  gtk_adjustment_get_value (priv->vadjustment) +
+						  (event->y < 0 ? event->y : event->y - height));
+		}
+
+		if (eom_thumb_view_update_rubberband (thumbview, event->x, event->y))
+			eom_thumb_view_emit_selection_changed (thumbview);
+
+		return TRUE;
+	}
+
+	if (priv->drag_item >= 0 && priv->n_selected > 0 &&
+	    (event->state & GDK_BUTTON1_MASK) &&
+	    gtk_drag_check_threshold (widget, priv->press_x, priv->press_y,
+				      event->x, event->y)) {
+		priv->drag_item = -1;
+		priv->pressed_item = -1;
+
+		gtk_drag_begin_with_coordinates (widget, priv->drag_targets,
+						 GDK_ACTION_COPY |
+						 GDK_ACTION_MOVE |
+						 GDK_ACTION_LINK |
+						 GDK_ACTION_ASK,
+						 GDK_BUTTON_PRIMARY,
+						 (GdkEvent *) event,
+						 priv->press_x, priv->press_y);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+typeahead_timeout_cb (gpointer data)
+{
+	EomThumbViewPrivate *priv = EOM_THUMB_VIEW (data)->priv;
+
+	g_string_truncate (priv->typeahead, 0);
+	priv->typeahead_timeout_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Finds the first image from @start on, wrapping around, whose
+ * caption starts with @prefix. Returns -1 if there is none. */
+static gint
+eom_thumb_view_find_caption (EomThumbView *thumbview,
+			     const gchar  *prefix,
+			     gint          start)
+{
+	GtkTreeModel *model = thumbview->priv->model;
+	GtkTreeIter iter;
+	gchar *needle;
+	gint index, found = -1;
+	gint i;
+
+	needle = g_utf8_casefold (prefix, -1);
+	index = start % thumbview->priv->n_images;
+
+	if (!gtk_tree_model_iter_nth_child (model, &iter, NULL, index)) {
+		g_free (needle);
+		return -1;
+	}
+
+	for (i = 0; i < thumbview->priv->n_images && found < 0; i++) {
+		EomImage *image;
+		gchar *caption;
+
+		gtk_tree_model_get (model, &iter,
+				    EOM_LIST_STORE_EOM_IMAGE, &image,
+				    -1);
+
+		caption = g_utf8_casefold (eom_image_get_caption (image), -1);
+
+		if (g_str_has_prefix (caption, needle))
+			found = index;
+
+		g_free (caption);
+		g_object_unref (image);
+
+		if (++index == thumbview->priv->n_images) {
+			index = 0;
+			gtk_tree_model_get_iter_first (model, &iter);
+		} else {
+			gtk_tree_model_iter_next (model, &iter);
+		}
+	}
+
+	g_free (needle);
+
+	return found;
+}
+
+/* Typing selects the next image whose name starts with the
+ * keys typed so far. Returns whether @event was used. */
+static gboolean
+eom_thumb_view_typeahead (EomThumbView *thumbview, GdkEventKey *event)
+{
+	EomThumbViewPrivate *priv = thumbview->priv;
+	gunichar c = gdk_keyval_to_unicode (event->keyval);
+	gint start, index;
+
+	if (c == 0 || !g_unichar_isprint (c) ||
+	    (event->state & (GDK_CONTROL_MASK | GDK_MOD1_MASK)))
+		return FALSE;
+
+	if (priv->typeahead == NULL)
+		priv->typeahead = g_string_new (NULL);
+
+	/* A new search moves on from the current image,
+	 * a longer one may still match it */
+	start = MAX (priv->cursor, 0);
+	if (priv->typeahead->len == 0)
+		start++;
+
+	g_string_append_unichar (priv->typeahead, c);
+
+	if (priv->typeahead_timeout_id != 0)
+		g_source_remove (priv->typeahead_timeout_id);
+
+	priv->typeahead_timeout_id = g_timeout_add (EOM_THUMB_VIEW_TYPEAHEAD_TIMEOUT,
+						    typeahead_timeout_cb,
+						    thumbview);
+
+	index = eom_thumb_view_find_caption (thumbview, priv->typeahead->str, start);
+
+	if (index >= 0)
+		eom_thumb_view_move_cursor (thumbview, index, 0);
+	else
+		gtk_widget_error_bell (GTK_WIDGET (thumbview));
+
+	return TRUE;
+}
+
+static gboolean
+eom_thumb_view_key_press (GtkWidget *widget, GdkEventKey *event)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+	EomThumbViewPrivate *priv = thumbview->priv;
+	GdkModifierType state = event->state & gtk_accelerator_get_default_mod_mask ();
+	gboolean horizontal = priv->orientation == GTK_ORIENTATION_HORIZONTAL;
+	gint item_width, item_height;
+	gint n_columns, page;
+	gint cursor = MAX (priv->cursor, 0);
+
+	if (priv->n_images == 0)
+		return FALSE;
+
+	eom_thumb_view_get_item_size (thumbview, &item_width, &item_height);
+	n_columns = eom_thumb_view_get_n_columns (thumbview);
+
+	if (horizontal) {
+		page = MAX (gtk_widget_get_allocated_width (widget) / item_width, 1);
+	} else {
+		page = MAX (gtk_widget_get_allocated_height (widget) / item_height, 1) * n_columns;
+	}
+
+	switch (event->keyval) {
+	case GDK_KEY_Left:
+	case GDK_KEY_KP_Left:
+		eom_thumb_view_move_cursor (thumbview, cursor - 1, state);
+		break;
+	case GDK_KEY_Right:
+	case GDK_KEY_KP_Right:
+		eom_thumb_view_move_cursor (thumbview, cursor + 1, state);
+		break;
+	case GDK_KEY_Up:
+	case GDK_KEY_KP_Up:
+		if (horizontal)
+			return FALSE;
+		eom_thumb_view_move_cursor (thumbview, cursor - n_columns, state);
+		break;
+	case GDK_KEY_Down:
+	case GDK_KEY_KP_Down:
+		if (horizontal)
+			return FALSE;
+		eom_thumb_view_move_cursor (thumbview, cursor + n_columns, state);
+		break;
+	case GDK_KEY_Page_Up:
+	case GDK_KEY_KP_Page_Up:
+		eom_thumb_view_move_cursor (thumbview, cursor - page, state);
+		break;
+	case GDK_KEY_Page_Down:
+	case GDK_KEY_KP_Page_Down:
+		eom_thumb_view_move_cursor (thumbview, cursor + page, state);
+		break;
+	case GDK_KEY_Home:
+	case GDK_KEY_KP_Home:
+		eom_thumb_view_move_cursor (thumbview, 0, state);
+		break;
+	case GDK_KEY_End:
+	case GDK_KEY_KP_End:
+		eom_thumb_view_move_cursor (thumbview, priv->n_images - 1, state);
+		break;
+	case GDK_KEY_space:
+	case GDK_KEY_KP_Space:
+		if (state & GDK_CONTROL_MASK) {
+			selection_set (priv, cursor, !selection_get (priv, cursor));
+			eom_thumb_view_set_cursor (thumbview, cursor);
+			priv->anchor = cursor;
+			eom_thumb_view_queue_draw_item (thumbview, cursor);
+			eom_thumb_view_emit_selection_changed (thumbview);
+		} else {
+			eom_thumb_view_move_cursor (thumbview, cursor, state);
+		}
+		break;
+	case GDK_KEY_a:
+		if (state != GDK_CONTROL_MASK)
+			return FALSE;
+		if (eom_thumb_view_select_range (thumbview, 0, priv->n_images - 1)) {
+			gtk_widget_queue_draw (widget);
+			eom_thumb_view_emit_selection_changed (thumbview);
+		}
+		break;
+	default:
+		if (eom_thumb_view_typeahead (thumbview, event))
+			return TRUE;
+
+		return GTK_WIDGET_CLASS (eom_thumb_view_parent_class)->key_press_event (widget, event);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+eom_thumb_view_focus_changed (GtkWidget *widget, GdkEventFocus *event)
+{
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
+
+	if (thumbview->priv->cursor >= 0)
+		eom_thumb_view_queue_draw_item (thumbview, thumbview->priv->cursor);
+
+	return FALSE;
+}
+
+static void
+eom_thumb_view_map (GtkWidget *widget)
+{
+	GTK_WIDGET_CLASS (eom_thumb_view_parent_class)->map (widget);
 
-G_DEFINE_TYPE_WITH_CODE (EomThumbView, eom_thumb_view, GTK_TYPE_ICON_VIEW,
-			 G_IMPLEMENT_INTERFACE (GTK_TYPE_ORIENTABLE, NULL) \
-			 G_ADD_PRIVATE (EomThumbView));
+	eom_thumb_view_visible_range_changed (EOM_THUMB_VIEW (widget));
+}
 
-/* Drag 'n Drop */
+/* GObject */
 
 static void
 eom_thumb_view_constructed (GObject *object)
@@ -103,54 +2163,15 @@ eom_thumb_view_constructed (GObject *object)
 
 	thumbview = EOM_THUMB_VIEW (object);
 
-	thumbview->priv->pixbuf_cell = gtk_cell_renderer_pixbuf_new ();
-
-	gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (thumbview),
-				    thumbview->priv->pixbuf_cell,
-				    FALSE);
-
-	g_object_set (thumbview->priv->pixbuf_cell,
-	              "height", 100,
-	              "width", 115,
-	              "yalign", 0.5,
-	              "xalign", 0.5,
-	              NULL);
-
-	gtk_cell_layout_set_attributes (GTK_CELL_LAYOUT (thumbview),
-					thumbview->priv->pixbuf_cell,
-					"pixbuf", EOM_LIST_STORE_THUMBNAIL,
-					NULL);
-
-	gtk_icon_view_set_selection_mode (GTK_ICON_VIEW (thumbview),
-					  GTK_SELECTION_MULTIPLE);
-
-	gtk_icon_view_set_column_spacing (GTK_ICON_VIEW (thumbview),
-					  EOM_THUMB_VIEW_SPACING);
-
-	gtk_icon_view_set_row_spacing (GTK_ICON_VIEW (thumbview),
-				       EOM_THUMB_VIEW_SPACING);
-
 	g_object_set (thumbview, "has-tooltip", TRUE, NULL);
 
 	g_signal_connect (thumbview, "query-tooltip",
 	                  G_CALLBACK (thumbview_on_query_tooltip_cb),
 	                  NULL);
 
-	thumbview->priv->start_thumb = 0;
-	thumbview->priv->end_thumb = 0;
-	thumbview->priv->menu = NULL;
-
-	g_signal_connect (thumbview, "parent-set",
-	                  G_CALLBACK (thumbview_on_parent_set_cb),
-	                  NULL);
-
-	gtk_icon_view_enable_model_drag_source (GTK_ICON_VIEW (thumbview), 0,
-						NULL, 0,
-						GDK_ACTION_COPY |
-						GDK_ACTION_MOVE |
-						GDK_ACTION_LINK |
-						GDK_ACTION_ASK);
-	gtk_drag_source_add_uri_targets (GTK_WIDGET (thumbview));
+	/* Drags are started from eom_thumb_view_motion_notify() */
+	thumbview->priv->drag_targets = gtk_target_list_new (NULL, 0);
+	gtk_target_list_add_uri_targets (thumbview->priv->drag_targets, 0);
 
 	g_signal_connect (thumbview, "drag-data-get",
 	                  G_CALLBACK (thumbview_on_drag_data_get_cb),
@@ -160,36 +2181,55 @@ eom_thumb_view_constructed (GObject *object)
 static void
 eom_thumb_view_dispose (GObject *object)
 {
-	EomThumbViewPrivate *priv = EOM_THUMB_VIEW (object)->priv;
-	GtkTreeModel *model;
+	EomThumbView *thumbview = EOM_THUMB_VIEW (object);
+	EomThumbViewPrivate *priv = thumbview->priv;
 
 	if (priv->visible_range_changed_id != 0) {
 		g_source_remove (priv->visible_range_changed_id);
 		priv->visible_range_changed_id = 0;
 	}
 
-#if GLIB_CHECK_VERSION(2,62,0)
-	if ((model = gtk_icon_view_get_model (GTK_ICON_VIEW (object))) != NULL) {
-		g_clear_signal_handler (&priv->image_add_id, model);
-		g_clear_signal_handler (&priv->image_removed_id, model);
+	if (priv->model != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->model, thumbview);
+		g_clear_object (&priv->model);
 	}
-#else
-	if ((model = gtk_icon_view_get_model (GTK_ICON_VIEW (object))) != NULL) {
-		if (priv->image_add_id != 0) {
-			g_signal_handler_disconnect (model, priv->image_add_id);
-			priv->image_add_id = 0;
-		}
 
-		if (priv->image_removed_id != 0) {
-			g_signal_handler_disconnect (model, priv->image_removed_id);
-			priv->image_removed_id = 0;
-		}
+	if (priv->hadjustment != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->hadjustment, thumbview);
+		g_clear_object (&priv->hadjustment);
 	}
-#endif
+
+	if (priv->vadjustment != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->vadjustment, thumbview);
+		g_clear_object (&priv->vadjustment);
+	}
+
+	g_clear_object (&priv->menu);
+
+	if (priv->typeahead_timeout_id != 0) {
+		g_source_remove (priv->typeahead_timeout_id);
+		priv->typeahead_timeout_id = 0;
+	}
+
+	g_clear_pointer (&priv->drag_targets, gtk_target_list_unref);
 
 	G_OBJECT_CLASS (eom_thumb_view_parent_class)->dispose (object);
 }
 
+static void
+eom_thumb_view_finalize (GObject *object)
+{
+	EomThumbViewPrivate *priv = EOM_THUMB_VIEW (object)->priv;
+
+	g_free (priv->selection);
+	g_free (priv->rubberband_base);
+
+	if (priv->typeahead != NULL)
+		g_string_free (priv->typeahead, TRUE);
+
+	G_OBJECT_CLASS (eom_thumb_view_parent_class)->finalize (object);
+}
+
 static void
 eom_thumb_view_get_property (GObject    *object,
 			     guint       prop_id,
@@ -203,6 +2243,18 @@ eom_thumb_view_get_property (GObject    *object,
 	case PROP_ORIENTATION:
 		g_value_set_enum (value, view->priv->orientation);
 		break;
+	case PROP_HADJUSTMENT:
+		g_value_set_object (value, view->priv->hadjustment);
+		break;
+	case PROP_VADJUSTMENT:
+		g_value_set_object (value, view->priv->vadjustment);
+		break;
+	case PROP_HSCROLL_POLICY:
+		g_value_set_enum (value, view->priv->hscroll_policy);
+		break;
+	case PROP_VSCROLL_POLICY:
+		g_value_set_enum (value, view->priv->vscroll_policy);
+		break;
 
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -222,7 +2274,24 @@ eom_thumb_view_set_property (GObject      *object,
 	{
 	case PROP_ORIENTATION:
 		view->priv->orientation = g_value_get_enum (value);
-		eom_thumb_view_update_columns (view);
+		gtk_widget_queue_resize (GTK_WIDGET (view));
+		eom_thumb_view_visible_range_changed (view);
+		break;
+	case PROP_HADJUSTMENT:
+		eom_thumb_view_set_adjustment (view, &view->priv->hadjustment,
+					       g_value_get_object (value));
+		break;
+	case PROP_VADJUSTMENT:
+		eom_thumb_view_set_adjustment (view, &view->priv->vadjustment,
+					       g_value_get_object (value));
+		break;
+	case PROP_HSCROLL_POLICY:
+		view->priv->hscroll_policy = g_value_get_enum (value);
+		gtk_widget_queue_resize (GTK_WIDGET (view));
+		break;
+	case PROP_VSCROLL_POLICY:
+		view->priv->vscroll_policy = g_value_get_enum (value);
+		gtk_widget_queue_resize (GTK_WIDGET (view));
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -234,207 +2303,87 @@ static void
 eom_thumb_view_class_init (EomThumbViewClass *class)
 {
 	GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (class);
 
 	gobject_class->constructed = eom_thumb_view_constructed;
 	gobject_class->dispose = eom_thumb_view_dispose;
+	gobject_class->finalize = eom_thumb_view_finalize;
 	gobject_class->get_property = eom_thumb_view_get_property;
 	gobject_class->set_property = eom_thumb_view_set_property;
 
+	widget_class->realize = eom_thumb_view_realize;
+	widget_class->map = eom_thumb_view_map;
+	widget_class->size_allocate = eom_thumb_view_size_allocate;
+	widget_class->get_request_mode = eom_thumb_view_get_request_mode;
+	widget_class->get_preferred_width = eom_thumb_view_get_preferred_width;
+	widget_class->get_preferred_height = eom_thumb_view_get_preferred_height;
+	widget_class->get_preferred_height_for_width = eom_thumb_view_get_preferred_height_for_width;
+	widget_class->draw = eom_thumb_view_draw;
+	widget_class->button_press_event = eom_thumb_view_button_press;
+	widget_class->button_release_event = eom_thumb_view_button_release;
+	widget_class->motion_notify_event = eom_thumb_view_motion_notify;
+	widget_class->key_press_event = eom_thumb_view_key_press;
+	widget_class->focus_in_event = eom_thumb_view_focus_changed;
+	widget_class->focus_out_event = eom_thumb_view_focus_changed;
+
 	g_object_class_override_property (gobject_class, PROP_ORIENTATION,
 	                                  "orientation");
-}
-
-static void
-eom_thumb_view_clear_range (EomThumbView *thumbview,
-			    const gint start_thumb,
-			    const gint end_thumb)
-{
-	GtkTreePath *path;
-	GtkTreeIter iter;
-	EomListStore *store = EOM_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
-	gint thumb = start_thumb;
-	gboolean result;
-
-	g_assert (start_thumb <= end_thumb);
-
-	path = gtk_tree_path_new_from_indices (start_thumb, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
-	     result && thumb <= end_thumb;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
-		eom_list_store_thumbnail_unset (store, &iter);
-	}
-	gtk_tree_path_free (path);
-}
-
-static void
-eom_thumb_view_add_range (EomThumbView *thumbview,
-			  const gint start_thumb,
-			  const gint end_thumb)
-{
-	GtkTreePath *path;
-	GtkTreeIter iter;
-	EomListStore *store = EOM_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
-	gint thumb = start_thumb;
-	gboolean result;
-
-	g_assert (start_thumb <= end_thumb);
-
-	path = gtk_tree_path_new_from_indices (start_thumb, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
-	     result && thumb <= end_thumb;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
-		eom_list_store_thumbnail_set (store, &iter);
-	}
-	gtk_tree_path_free (path);
-}
-
-static void
-eom_thumb_view_update_visible_range (EomThumbView *thumbview,
-				     const gint start_thumb,
-				     const gint end_thumb)
-{
-	EomThumbViewPrivate *priv = thumbview->priv;
-	int old_start_thumb, old_end_thumb;
-
-	old_start_thumb= priv->start_thumb;
-	old_end_thumb = priv->end_thumb;
-
-	if (start_thumb == old_start_thumb &&
-	    end_thumb == old_end_thumb) {
-		return;
-	}
-
-	if (old_start_thumb < start_thumb)
-		eom_thumb_view_clear_range (thumbview, old_start_thumb, MIN (start_thumb - 1, old_end_thumb));
-
-	if (old_end_thumb > end_thumb)
-		eom_thumb_view_clear_range (thumbview, MAX (end_thumb + 1, old_start_thumb), old_end_thumb);
-
-	eom_thumb_view_add_range (thumbview, start_thumb, end_thumb);
-
-	priv->start_thumb = start_thumb;
-	priv->end_thumb = end_thumb;
-}
-
-static gboolean
-visible_range_changed_cb (EomThumbView *thumbview)
-{
-	GtkTreePath *path1, *path2;
-
-	thumbview->priv->visible_range_changed_id = 0;
-
-	if (!gtk_icon_view_get_visible_range (GTK_ICON_VIEW (thumbview), &path1, &path2)) {
-		return FALSE;
-	}
-
-	if (path1 == NULL) {
-		path1 = gtk_tree_path_new_first ();
-	}
-	if (path2 == NULL) {
-		gint n_items = gtk_tree_model_iter_n_children (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)), NULL);
-		path2 = gtk_tree_path_new_from_indices (n_items - 1 , -1);
-	}
-
-	eom_thumb_view_update_visible_range (thumbview, gtk_tree_path_get_indices (path1) [0],
-					     gtk_tree_path_get_indices (path2) [0]);
-
-	gtk_tree_path_free (path1);
-	gtk_tree_path_free (path2);
-
-	return FALSE;
-}
-
-static void
-eom_thumb_view_visible_range_changed (EomThumbView *thumbview)
-{
-	if (thumbview->priv->visible_range_changed_id == 0) {
-		g_idle_add ((GSourceFunc)visible_range_changed_cb, thumbview);
-	}
-
-}
-
-static void
-thumbview_on_visible_range_changed_cb (EomThumbView *thumbview,
-				       gpointer user_data)
-{
-	eom_thumb_view_visible_range_changed (thumbview);
-}
-
-static void
-thumbview_on_adjustment_changed_cb (EomThumbView *thumbview,
-				    gpointer user_data)
-{
-	eom_thumb_view_visible_range_changed (thumbview);
-}
-
-static void
-thumbview_on_parent_set_cb (GtkWidget *widget,
-			    GtkWidget *old_parent,
-			    gpointer   user_data)
-{
-	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
-	GtkScrolledWindow *sw;
-	GtkAdjustment *hadjustment;
-	GtkAdjustment *vadjustment;
-
-	GtkWidget *parent = gtk_widget_get_parent (GTK_WIDGET (thumbview));
-	if (!GTK_IS_SCROLLED_WINDOW (parent)) {
-		return;
-	}
-
-	/* if we have been set to a ScrolledWindow, we connect to the callback
-	   to set and unset thumbnails. */
-	sw = GTK_SCROLLED_WINDOW (parent);
-	hadjustment = gtk_scrolled_window_get_hadjustment (GTK_SCROLLED_WINDOW (sw));
-	vadjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sw));
-
-	/* when scrolling */
-	g_signal_connect_data (hadjustment, "value-changed",
-	                       G_CALLBACK (thumbview_on_visible_range_changed_cb),
-	                       thumbview, NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
-	g_signal_connect_data (vadjustment, "value-changed",
-	                       G_CALLBACK (thumbview_on_visible_range_changed_cb),
-	                       thumbview, NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
-
-	/* when the adjustment is changed, ie. probably we have new images added. */
-	g_signal_connect_data (hadjustment, "changed",
-	                       G_CALLBACK (thumbview_on_adjustment_changed_cb),
-	                       thumbview, NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
-	g_signal_connect_data (vadjustment, "changed",
-	                       G_CALLBACK (thumbview_on_adjustment_changed_cb),
-	                       thumbview, NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
-
-	/* when resizing the scrolled window */
-	g_signal_connect_swapped (G_OBJECT (sw), "size-allocate",
-				  G_CALLBACK (thumbview_on_visible_range_changed_cb),
-				  thumbview);
+	g_object_class_override_property (gobject_class, PROP_HADJUSTMENT,
+	                                  "hadjustment");
+	g_object_class_override_property (gobject_class, PROP_VADJUSTMENT,
+	                                  "vadjustment");
+	g_object_class_override_property (gobject_class, PROP_HSCROLL_POLICY,
+	                                  "hscroll-policy");
+	g_object_class_override_property (gobject_class, PROP_VSCROLL_POLICY,
+	                                  "vscroll-policy");
+
+	/**
+	 * EomThumbView::selection-changed:
+	 * @thumbview: the object which received the signal.
+	 *
+	 * The ::selection-changed signal is emitted when the set of
+	 * selected thumbnails changes.
+	 */
+	signals[SIGNAL_SELECTION_CHANGED] =
+		g_signal_new ("selection-changed",
+			      G_OBJECT_CLASS_TYPE (gobject_class),
+			      G_SIGNAL_RUN_FIRST,
+			      G_STRUCT_OFFSET (EomThumbViewClass, selection_changed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	gtk_widget_class_set_css_name (widget_class, "iconview");
+	gtk_widget_class_set_accessible_type (widget_class,
+					      eom_thumb_view_accessible_get_type ());
 }
 
 static gboolean
 thumbview_on_button_press_event_cb (GtkWidget *thumbview, GdkEventButton *event,
 				    gpointer user_data)
 {
-	GtkTreePath *path;
+	EomThumbViewPrivate *priv = EOM_THUMB_VIEW (thumbview)->priv;
+	gint index;
 
 	/* Ignore double-clicks and triple-clicks */
 	if (event->button == 3 && event->type == GDK_BUTTON_PRESS)
 	{
-		path = gtk_icon_view_get_path_at_pos (GTK_ICON_VIEW (thumbview),
-						      (gint) event->x, (gint) event->y);
-		if (path == NULL) {
+		index = eom_thumb_view_get_item_at_pos (EOM_THUMB_VIEW (thumbview),
+							event->x, event->y);
+		if (index < 0) {
 			return FALSE;
 		}
 
-		if (!gtk_icon_view_path_is_selected (GTK_ICON_VIEW (thumbview), path) ||
-		    eom_thumb_view_get_n_selected (EOM_THUMB_VIEW (thumbview)) != 1) {
-			gtk_icon_view_unselect_all (GTK_ICON_VIEW (thumbview));
-			gtk_icon_view_select_path (GTK_ICON_VIEW (thumbview), path);
-			gtk_icon_view_set_cursor (GTK_ICON_VIEW (thumbview), path, NULL, FALSE);
+		if (!selection_get (priv, index) || priv->n_selected != 1) {
+			selection_clear (priv);
+			selection_set (priv, index, TRUE);
+			eom_thumb_view_set_cursor (EOM_THUMB_VIEW (thumbview), index);
+			priv->anchor = index;
+			gtk_widget_queue_draw (thumbview);
+			eom_thumb_view_emit_selection_changed (EOM_THUMB_VIEW (thumbview));
 		}
 		eom_thumb_view_popup_menu (EOM_THUMB_VIEW (thumbview), event);
 
-		gtk_tree_path_free (path);
-
 		return TRUE;
 	}
 
@@ -587,25 +2536,34 @@ thumbview_on_query_tooltip_cb (GtkWidget  *widget,
 			       GtkTooltip *tooltip,
 			       gpointer    user_data)
 {
-	GtkTreePath *path;
+	EomThumbView *thumbview = EOM_THUMB_VIEW (widget);
 	EomImage *image;
+	GdkRectangle area;
 	gchar *tooltip_string;
 	EomImageData data = 0;
+	gint index;
+
+	if (thumbview->priv->model == NULL)
+		return FALSE;
+
+	if (keyboard_mode)
+		index = thumbview->priv->cursor;
+	else
+		index = eom_thumb_view_get_item_at_pos (thumbview, x, y);
 
-	if (!gtk_icon_view_get_tooltip_context (GTK_ICON_VIEW (widget),
-						&x, &y, keyboard_mode,
-						NULL, &path, NULL)) {
+	if (index < 0) {
 		return FALSE;
 	}
 
-	image = eom_thumb_view_get_image_from_path (EOM_THUMB_VIEW (widget),
-						    path);
-	gtk_tree_path_free (path);
+	image = eom_thumb_view_get_image_at (thumbview, index);
 
 	if (image == NULL) {
 		return FALSE;
 	}
 
+	eom_thumb_view_get_item_area (thumbview, index, &area);
+	gtk_tooltip_set_tip_area (tooltip, &area);
+
 	if (!eom_image_has_data (image, EOM_IMAGE_DATA_EXIF) &&
             eom_image_get_metadata_status (image) == EOM_IMAGE_METADATA_NOT_READ) {
 		data = EOM_IMAGE_DATA_EXIF;
@@ -646,9 +2604,23 @@ eom_thumb_view_init (EomThumbView *thumbview)
 {
 	thumbview->priv = eom_thumb_view_get_instance_private (thumbview);
 
-	thumbview->priv->visible_range_changed_id = 0;
-	thumbview->priv->image_add_id = 0;
-	thumbview->priv->image_removed_id = 0;
+	thumbview->priv->start_thumb = -1;
+	thumbview->priv->end_thumb = -1;
+	thumbview->priv->item_height = EOM_THUMB_VIEW_ITEM_HEIGHT;
+	thumbview->priv->cursor = -1;
+	thumbview->priv->anchor = -1;
+	thumbview->priv->pressed_item = -1;
+	thumbview->priv->scroll_to = -1;
+	thumbview->priv->drag_item = -1;
+
+	eom_thumb_view_set_adjustment (thumbview, &thumbview->priv->hadjustment, NULL);
+	eom_thumb_view_set_adjustment (thumbview, &thumbview->priv->vadjustment, NULL);
+
+	gtk_widget_set_has_window (GTK_WIDGET (thumbview), TRUE);
+	gtk_widget_set_can_focus (GTK_WIDGET (thumbview), TRUE);
+
+	gtk_style_context_add_class (gtk_widget_get_style_context (GTK_WIDGET (thumbview)),
+				     GTK_STYLE_CLASS_VIEW);
 }
 
 /**
@@ -668,43 +2640,6 @@ eom_thumb_view_new (void)
 	return GTK_WIDGET (thumbview);
 }
 
-static void
-eom_thumb_view_update_columns (EomThumbView *view)
-{
-	EomThumbViewPrivate *priv;
-
-	g_return_if_fail (EOM_IS_THUMB_VIEW (view));
-
-	priv = view->priv;
-
-	if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
-			gtk_icon_view_set_columns (GTK_ICON_VIEW (view),
-			                           priv->n_images);
-}
-
-static void
-eom_thumb_view_row_inserted_cb (GtkTreeModel    *tree_model,
-                                GtkTreePath     *path,
-                                GtkTreeIter     *iter,
-                                EomThumbView    *view)
-{
-	EomThumbViewPrivate *priv = view->priv;
-
-	priv->n_images++;
-	eom_thumb_view_update_columns (view);
-}
-
-static void
-eom_thumb_view_row_deleted_cb (GtkTreeModel    *tree_model,
-                               GtkTreePath     *path,
-                               EomThumbView    *view)
-{
-	EomThumbViewPrivate *priv = view->priv;
-
-	priv->n_images--;
-	eom_thumb_view_update_columns (view);
-}
-
 /**
  * eom_thumb_view_set_model:
  * @thumbview: A #EomThumbView.
@@ -719,49 +2654,51 @@ eom_thumb_view_set_model (EomThumbView *thumbview, EomListStore *store)
 {
 	gint index;
 	EomThumbViewPrivate *priv;
-	GtkTreeModel *existing;
 
 	g_return_if_fail (EOM_IS_THUMB_VIEW (thumbview));
 	g_return_if_fail (EOM_IS_LIST_STORE (store));
 
 	priv = thumbview->priv;
 
-	existing = gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview));
-
-	if (existing != NULL) {
-		if (priv->image_add_id != 0) {
-			g_signal_handler_disconnect (existing,
-			                             priv->image_add_id);
-		}
-		if (priv->image_removed_id != 0) {
-			g_signal_handler_disconnect (existing,
-			                             priv->image_removed_id);
-
-		}
+	if (priv->model != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->model, thumbview);
+		g_object_unref (priv->model);
 	}
 
-	priv->image_add_id = g_signal_connect (store, "row-inserted",
-	                                       G_CALLBACK (eom_thumb_view_row_inserted_cb),
-	                                       thumbview);
-	priv->image_removed_id = g_signal_connect (store, "row-deleted",
-	                                           G_CALLBACK (eom_thumb_view_row_deleted_cb),
-	                                           thumbview);
-
-	thumbview->priv->n_images = eom_list_store_length (store);
+	priv->model = g_object_ref (GTK_TREE_MODEL (store));
+
+	g_signal_connect (store, "row-inserted",
+	                  G_CALLBACK (eom_thumb_view_row_inserted_cb),
+	                  thumbview);
+	g_signal_connect (store, "row-deleted",
+	                  G_CALLBACK (eom_thumb_view_row_deleted_cb),
+	                  thumbview);
+	g_signal_connect (store, "row-changed",
+	                  G_CALLBACK (eom_thumb_view_row_changed_cb),
+	                  thumbview);
+	g_signal_connect (store, "rows-reordered",
+	                  G_CALLBACK (eom_thumb_view_rows_reordered_cb),
+	                  thumbview);
+
+	priv->n_images = eom_list_store_length (store);
+	priv->start_thumb = -1;
+	priv->end_thumb = -1;
+	priv->cursor = -1;
+	priv->anchor = -1;
+	priv->pressed_item = -1;
+	priv->drag_item = -1;
+
+	eom_thumb_view_stop_rubberband (thumbview);
+	selection_clear (priv);
+	selection_ensure_size (priv, priv->n_images);
+
+	eom_thumb_view_model_changed (thumbview);
+	eom_thumb_view_accessible_rows_changed (thumbview, 0, 0);
 
 	index = eom_list_store_get_initial_pos (store);
 
-	gtk_icon_view_set_model (GTK_ICON_VIEW (thumbview),
-	                         GTK_TREE_MODEL (store));
-
-	eom_thumb_view_update_columns (thumbview);
-
 	if (index >= 0) {
-		GtkTreePath *path = gtk_tree_path_new_from_indices (index, -1);
-		gtk_icon_view_select_path (GTK_ICON_VIEW (thumbview), path);
-		gtk_icon_view_set_cursor (GTK_ICON_VIEW (thumbview), path, NULL, FALSE);
-		gtk_icon_view_scroll_to_path (GTK_ICON_VIEW (thumbview), path, FALSE, 0, 0);
-		gtk_tree_path_free (path);
+		eom_thumb_view_move_cursor (thumbview, index, 0);
 	}
 }
 
@@ -778,18 +2715,10 @@ eom_thumb_view_set_item_height (EomThumbView *thumbview, gint height)
 {
 	g_return_if_fail (EOM_IS_THUMB_VIEW (thumbview));
 
-	g_object_set (thumbview->priv->pixbuf_cell,
-	              "height", height,
-	              NULL);
-}
+	thumbview->priv->item_height = height;
 
-static void
-eom_thumb_view_get_n_selected_helper (GtkIconView *thumbview,
-				      GtkTreePath *path,
-				      gpointer data)
-{
-	/* data is of type (guint *) */
-	(*(guint *) data) ++;
+	gtk_widget_queue_resize (GTK_WIDGET (thumbview));
+	eom_thumb_view_visible_range_changed (thumbview);
 }
 
 /**
@@ -803,71 +2732,34 @@ eom_thumb_view_get_n_selected_helper (GtkIconView *thumbview,
 guint
 eom_thumb_view_get_n_selected (EomThumbView *thumbview)
 {
-	guint count = 0;
-	gtk_icon_view_selected_foreach (GTK_ICON_VIEW (thumbview),
-					eom_thumb_view_get_n_selected_helper,
-					(&count));
-	return count;
-}
-
-/**
- * eom_thumb_view_get_image_from_path:
- * @thumbview: A #EomThumbView.
- * @path: A #GtkTreePath pointing to a #EomImage in the model for @thumbview.
- *
- * Gets the #EomImage stored in @thumbview's #EomListStore at the position indicated
- * by @path.
- *
- * Returns: (transfer full): A #EomImage.
- **/
-static EomImage *
-eom_thumb_view_get_image_from_path (EomThumbView *thumbview, GtkTreePath *path)
-{
-	GtkTreeModel *model;
-	GtkTreeIter iter;
-	EomImage *image;
-
-	model = gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview));
-	gtk_tree_model_get_iter (model, &iter, path);
-
-	gtk_tree_model_get (model, &iter,
-			    EOM_LIST_STORE_EOM_IMAGE, &image,
-			    -1);
+	g_return_val_if_fail (EOM_IS_THUMB_VIEW (thumbview), 0);
 
-	return image;
+	return thumbview->priv->n_selected;
 }
 
 /**
  * eom_thumb_view_get_first_selected_image:
  * @thumbview: A #EomThumbView.
  *
- * Returns the first selected image. Note that the returned #EomImage
- * is not ensured to be really the first selected image in @thumbview, but
- * generally, it will be.
+ * Returns the first selected image, the one closest to the
+ * beginning of the model.
  *
  * Returns: (transfer full): A #EomImage.
  **/
 EomImage *
 eom_thumb_view_get_first_selected_image (EomThumbView *thumbview)
 {
-	/* The returned list is not sorted! We need to find the
-	   smaller tree path value => tricky and expensive. Do we really need this?
-	*/
-	EomImage *image;
-	GtkTreePath *path;
-	GList *list = gtk_icon_view_get_selected_items (GTK_ICON_VIEW (thumbview));
-
-	if (list == NULL) {
-		return NULL;
-	}
+	gint index;
 
-	path = (GtkTreePath *) (list->data);
+	g_return_val_if_fail (EOM_IS_THUMB_VIEW (thumbview), NULL);
 
-	image = eom_thumb_view_get_image_from_path (thumbview, path);
+	index = selection_next (thumbview->priv, 0);
 
-	g_list_free_full (list, (GDestroyNotify) gtk_tree_path_free);
+	if (index < 0) {
+		return NULL;
+	}
 
-	return image;
+	return eom_thumb_view_get_image_at (thumbview, index);
 }
 
 /**
@@ -882,23 +2774,18 @@ eom_thumb_view_get_first_selected_image (EomThumbView *thumbview)
 GList *
 eom_thumb_view_get_selected_images (EomThumbView *thumbview)
 {
-	GList *l, *item;
 	GList *list = NULL;
+	gint index;
 
-	GtkTreePath *path;
-
-	l = gtk_icon_view_get_selected_items (GTK_ICON_VIEW (thumbview));
+	g_return_val_if_fail (EOM_IS_THUMB_VIEW (thumbview), NULL);
 
-	for (item = l; item != NULL; item = item->next) {
-		path = (GtkTreePath *) item->data;
-		list = g_list_prepend (list, eom_thumb_view_get_image_from_path (thumbview, path));
-		gtk_tree_path_free (path);
+	for (index = selection_next (thumbview->priv, 0);
+	     index >= 0;
+	     index = selection_next (thumbview->priv, index + 1)) {
+		list = g_list_prepend (list, eom_thumb_view_get_image_at (thumbview, index));
 	}
 
-	g_list_free (l);
-	list = g_list_reverse (list);
-
-	return list;
+	return g_list_reverse (list);
 }
 
 /**
@@ -916,27 +2803,37 @@ void
 eom_thumb_view_set_current_image (EomThumbView *thumbview, EomImage *image,
 				  gboolean deselect_other)
 {
-	GtkTreePath *path;
-	EomListStore *store;
+	EomThumbViewPrivate *priv;
+	gboolean changed = FALSE;
 	gint pos;
 
-	store = EOM_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
-	pos = eom_list_store_get_pos_by_image (store, image);
-	path = gtk_tree_path_new_from_indices (pos, -1);
+	g_return_if_fail (EOM_IS_THUMB_VIEW (thumbview));
+
+	priv = thumbview->priv;
+
+	if (priv->model == NULL) {
+		return;
+	}
+
+	pos = eom_list_store_get_pos_by_image (EOM_LIST_STORE (priv->model), image);
 
-	if (path == NULL) {
+	if (pos < 0) {
 		return;
 	}
 
 	if (deselect_other) {
-		gtk_icon_view_unselect_all (GTK_ICON_VIEW (thumbview));
+		changed = selection_clear (priv);
 	}
 
-	gtk_icon_view_select_path (GTK_ICON_VIEW (thumbview), path);
-	gtk_icon_view_set_cursor (GTK_ICON_VIEW (thumbview), path, NULL, FALSE);
-	gtk_icon_view_scroll_to_path (GTK_ICON_VIEW (thumbview), path, FALSE, 0, 0);
+	changed = selection_set (priv, pos, TRUE) || changed;
+	eom_thumb_view_set_cursor (thumbview, pos);
+	priv->anchor = pos;
 
-	gtk_tree_path_free (path);
+	eom_thumb_view_scroll_to_item (thumbview, pos);
+	gtk_widget_queue_draw (GTK_WIDGET (thumbview));
+
+	if (changed)
+		eom_thumb_view_emit_selection_changed (thumbview);
 }
 
 /**
@@ -957,80 +2854,63 @@ void
 eom_thumb_view_select_single (EomThumbView *thumbview,
 			      EomThumbViewSelectionChange change)
 {
-  	GtkTreePath *path = NULL;
-	GtkTreeModel *model;
-	GList *list;
-	gint n_items;
+	EomThumbViewPrivate *priv;
+	gint n_items, index = -1;
 
 	g_return_if_fail (EOM_IS_THUMB_VIEW (thumbview));
 
-	model = gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview));
-
-	n_items = eom_list_store_length (EOM_LIST_STORE (model));
+	priv = thumbview->priv;
+	n_items = priv->n_images;
 
 	if (n_items == 0) {
 		return;
 	}
 
-	if (eom_thumb_view_get_n_selected (thumbview) == 0) {
+	if (priv->n_selected == 0) {
 		switch (change) {
 		case EOM_THUMB_VIEW_SELECT_CURRENT:
 			break;
 		case EOM_THUMB_VIEW_SELECT_RIGHT:
 		case EOM_THUMB_VIEW_SELECT_FIRST:
-			path = gtk_tree_path_new_first ();
+			index = 0;
 			break;
 		case EOM_THUMB_VIEW_SELECT_LEFT:
 		case EOM_THUMB_VIEW_SELECT_LAST:
-			path = gtk_tree_path_new_from_indices (n_items - 1, -1);
+			index = n_items - 1;
 			break;
 		case EOM_THUMB_VIEW_SELECT_RANDOM:
-			path = gtk_tree_path_new_from_indices (g_random_int_range (0, n_items), -1);
+			index = g_random_int_range (0, n_items);
 			break;
 		}
 	} else {
-		list = gtk_icon_view_get_selected_items (GTK_ICON_VIEW (thumbview));
-		path = gtk_tree_path_copy ((GtkTreePath *) list->data);
-		g_list_free_full (list, (GDestroyNotify) gtk_tree_path_free);
-
-		gtk_icon_view_unselect_all (GTK_ICON_VIEW (thumbview));
+		index = selection_next (priv, 0);
 
 		switch (change) {
 		case EOM_THUMB_VIEW_SELECT_CURRENT:
 			break;
 		case EOM_THUMB_VIEW_SELECT_LEFT:
-			if (!gtk_tree_path_prev (path)) {
-				gtk_tree_path_free (path);
-				path = gtk_tree_path_new_from_indices (n_items - 1, -1);
-			}
+			index = index > 0 ? index - 1 : n_items - 1;
 			break;
 		case EOM_THUMB_VIEW_SELECT_RIGHT:
-			if (gtk_tree_path_get_indices (path) [0] == n_items - 1) {
-				gtk_tree_path_free (path);
-				path = gtk_tree_path_new_first ();
-			} else {
-				gtk_tree_path_next (path);
-			}
+			index = index < n_items - 1 ? index + 1 : 0;
 			break;
 		case EOM_THUMB_VIEW_SELECT_FIRST:
-			gtk_tree_path_free (path);
-			path = gtk_tree_path_new_first ();
+			index = 0;
 			break;
 		case EOM_THUMB_VIEW_SELECT_LAST:
-			gtk_tree_path_free (path);
-			path = gtk_tree_path_new_from_indices (n_items - 1, -1);
+			index = n_items - 1;
 			break;
 		case EOM_THUMB_VIEW_SELECT_RANDOM:
-			gtk_tree_path_free (path);
-			path = gtk_tree_path_new_from_indices (g_random_int_range (0, n_items), -1);
+			index = g_random_int_range (0, n_items);
 			break;
 		}
 	}
 
-	gtk_icon_view_select_path (GTK_ICON_VIEW (thumbview), path);
-	gtk_icon_view_set_cursor (GTK_ICON_VIEW (thumbview), path, NULL, FALSE);
-	gtk_icon_view_scroll_to_path (GTK_ICON_VIEW (thumbview), path, FALSE, 0, 0);
-	gtk_tree_path_free (path);
+	if (index < 0) {
+		return;
+	}
+
+	eom_thumb_view_move_cursor (thumbview, index, 0);
 }
 
 /**
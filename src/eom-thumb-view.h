@@ -48,12 +48,14 @@ typedef enum {
 } EomThumbViewSelectionChange;
 
 struct _EomThumbView {
-	GtkIconView icon_view;
+	GtkWidget widget;
 	EomThumbViewPrivate *priv;
 };
 
 struct _EomThumbViewClass {
-	 GtkIconViewClass icon_view_class;
+	GtkWidgetClass parent_class;
+
+	void (* selection_changed) (EomThumbView *thumbview);
 };
 
 GType       eom_thumb_view_get_type 		    (void) G_GNUC_CONST;
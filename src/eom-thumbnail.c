@@ -36,6 +36,7 @@
 #include "eom-thumbnail.h"
 #include "eom-list-store.h"
 #include "eom-debug.h"
+#include "eom-stats.h"
 #include "eom-util.h"
 
 #define EOM_THUMB_ERROR eom_thumb_error_quark ()
@@ -495,11 +496,14 @@ eom_thumbnail_load (EomImage *image, GError **error)
 
 	if (thumb != NULL) {
 		eom_debug_message (DEBUG_THUMBNAIL, "%s: loaded from cache",data->uri_str);
+		eom_stats_counter_add ("thumbnail.cache-hits", 1);
 	} else if (mate_desktop_thumbnail_factory_can_thumbnail (factory, data->uri_str, data->mime_type, data->mtime)) {
 		/* Only use the image pixbuf when it is up to date. */
 		if (!eom_image_is_file_changed (image))
 			pixbuf = eom_image_get_pixbuf (image);
 
+		eom_stats_counter_add ("thumbnail.cache-misses", 1);
+
 		if (pixbuf != NULL) {
 			/* generate a thumbnail from the in-memory image,
 			   if we have already loaded the image */
@@ -55,6 +55,7 @@
 #include "eom-clipboard-handler.h"
 #include "eom-window-activatable.h"
 #include "eom-metadata-sidebar.h"
+#include "eom-stats.h"
 
 #include "eom-enum-types.h"
 
@@ -94,6 +95,9 @@
 #define EOM_WINDOW_FULLSCREEN_TIMEOUT 5 * 1000
 #define EOM_WINDOW_FULLSCREEN_POPUP_THRESHOLD 5
 
+/* How late a slide may come up before its deadline counts as missed */
+#define EOM_WINDOW_SLIDESHOW_LATENESS 50 * 1000
+
 #define EOM_RECENT_FILES_GROUP  "Graphics"
 #define EOM_RECENT_FILES_APP_NAME "Eye of MATE Image Viewer"
 #define EOM_RECENT_FILES_LIMIT  5
@@ -158,6 +162,10 @@ struct _EomWindowPrivate {
 	gboolean             slideshow_loop;
 	gint                 slideshow_switch_timeout;
 	GSource             *slideshow_switch_source;
+	gint64               slideshow_deadline;
+	EomImage            *slideshow_next_image;
+	EomJob              *slideshow_next_job;
+	gboolean             slideshow_switch_pending;
 
 	guint                fullscreen_idle_inhibit_cookie;
 
@@ -168,6 +176,10 @@ struct _EomWindowPrivate {
 	EomJob              *save_job;
 	GFile               *last_save_as_folder;
 	EomJob              *copy_job;
+	EomJob              *crop_job;
+	GList               *trash_jobs;
+	GList               *trash_undo;
+	gint                 trash_pos;
 
 	guint                image_info_message_cid;
 	guint                tip_message_cid;
@@ -181,6 +193,9 @@ struct _EomWindowPrivate {
 
 	GtkActionGroup      *actions_open_with;
 	guint                open_with_menu_id;
+	guint                open_with_source;
+
+	guint                deferred_source;
 
 	gboolean             save_disabled;
 	gboolean             needs_reload_confirmation;
@@ -207,9 +222,13 @@ static void eom_job_progress_cb (EomJobLoad *job, float progress, gpointer data)
 static void eom_job_transform_cb (EomJobTransform *job, gpointer data);
 static void fullscreen_set_timeout (EomWindow *window);
 static void fullscreen_clear_timeout (EomWindow *window);
+static void slideshow_prefetch_cb (EomJobLoad *job, gpointer data);
+static void slideshow_prefetch (EomWindow *window);
+static void slideshow_schedule_switch (EomWindow *window);
 static void update_action_groups_state (EomWindow *window);
 static void open_with_launch_application_cb (GtkAction *action, gpointer callback_data);
 static void eom_window_update_openwith_menu (EomWindow *window, EomImage *image);
+static gboolean eom_window_update_openwith_menu_idle (EomWindow *window);
 static void eom_window_list_store_image_added (GtkTreeModel *tree_model,
 					       GtkTreePath  *path,
 					       GtkTreeIter  *iter,
@@ -459,6 +478,12 @@ eom_window_get_display_profile (GdkScreen *screen)
 				 "No valid display profile set, assuming sRGB");
 	}
 
+	/* Images key their colour transforms by profile ID. Computing
+	 * it writes to the profile, which load jobs then share, so it
+	 * is done once here. */
+	if (profile != NULL)
+		cmsMD5computeID (profile);
+
 	return profile;
 }
 #endif
@@ -917,7 +942,25 @@ eom_window_display_image (EomWindow *window, EomImage *image)
 			 file,
 			 (GDestroyNotify) g_object_unref);
 
-	eom_window_update_openwith_menu (window, image);
+	/* Querying the applications for the MIME type is slow, so
+	 * don't hold up showing the image for it */
+	if (priv->open_with_source == 0) {
+		priv->open_with_source =
+			g_idle_add_full (G_PRIORITY_LOW,
+					 (GSourceFunc) eom_window_update_openwith_menu_idle,
+					 window, NULL);
+	}
+}
+
+static gboolean
+eom_window_update_openwith_menu_idle (EomWindow *window)
+{
+	window->priv->open_with_source = 0;
+
+	if (window->priv->image != NULL)
+		eom_window_update_openwith_menu (window, window->priv->image);
+
+	return G_SOURCE_REMOVE;
 }
 
 static void
@@ -1121,8 +1164,12 @@ eom_window_clear_load_job (EomWindow *window)
 	EomWindowPrivate *priv = window->priv;
 
 	if (priv->load_job != NULL) {
+		gboolean running = FALSE;
+
+		/* Only cancel a load this job started, as the image
+		 * may be loading for another window showing it too */
 		if (!priv->load_job->finished)
-			eom_job_queue_remove_job (priv->load_job);
+			running = !eom_job_queue_remove_job (priv->load_job);
 
 		g_signal_handlers_disconnect_by_func (priv->load_job,
 		                                      eom_job_progress_cb,
@@ -1132,7 +1179,8 @@ eom_window_clear_load_job (EomWindow *window)
 		                                      eom_job_load_cb,
 		                                      window);
 
-		eom_image_cancel_load (EOM_JOB_LOAD (priv->load_job)->image);
+		if (running)
+			eom_image_cancel_load (EOM_JOB_LOAD (priv->load_job)->image);
 
 		g_object_unref (priv->load_job);
 		priv->load_job = NULL;
@@ -1534,6 +1582,9 @@ handle_image_selection_changed_cb (EomThumbView *thumbview, EomWindow *window)
 
 	priv->load_job = eom_job_load_new (image, EOM_IMAGE_DATA_ALL);
 
+	if (priv->status == EOM_WINDOW_STATUS_INIT)
+		eom_debug_startup_mark ("first image load queued");
+
 	g_signal_connect (priv->load_job, "finished",
 	                  G_CALLBACK (eom_job_load_cb),
 	                  window);
@@ -1753,34 +1804,235 @@ slideshow_is_loop_end (EomWindow *window)
 
 	pos = eom_list_store_get_pos_by_image (priv->store, image);
 
+	if (image != NULL)
+		g_object_unref (image);
+
 	return (pos == (eom_list_store_length (priv->store) - 1));
 }
 
-static gboolean
-slideshow_switch_cb (gpointer data)
+/* Picks the image the slideshow is going to show after the current one */
+static EomImage *
+slideshow_get_next_image (EomWindow *window)
 {
-	EomWindow *window = EOM_WINDOW (data);
 	EomWindowPrivate *priv = window->priv;
+	EomImage *image;
+	gint n_images, pos;
 
-	eom_debug (DEBUG_WINDOW);
+	n_images = eom_list_store_length (priv->store);
+
+	if (n_images < 2)
+		return NULL;
+
+	image = eom_thumb_view_get_first_selected_image (EOM_THUMB_VIEW (priv->thumbview));
+
+	if (image == NULL)
+		return NULL;
+
+	pos = eom_list_store_get_pos_by_image (priv->store, image);
+	g_object_unref (image);
 
 	if (priv->slideshow_random) {
-		eom_thumb_view_select_single (EOM_THUMB_VIEW (priv->thumbview),
-					      EOM_THUMB_VIEW_SELECT_RANDOM);
-		return TRUE;
+		/* Any image but the current one */
+		gint next = g_random_int_range (0, n_images - 1);
+
+		pos = (next >= pos) ? next + 1 : next;
+	} else if (pos == n_images - 1) {
+		if (!priv->slideshow_loop)
+			return NULL;
+
+		pos = 0;
+	} else {
+		pos++;
+	}
+
+	return eom_list_store_get_image_by_pos (priv->store, pos);
+}
+
+static void
+slideshow_clear_prefetch (EomWindow *window, gboolean cancel)
+{
+	EomWindowPrivate *priv = window->priv;
+
+	if (priv->slideshow_next_job != NULL) {
+		EomJob *job = priv->slideshow_next_job;
+
+		/* A load still running is left alone when the image is
+		 * going to be shown, the window loads it right after */
+		if (cancel && !job->finished &&
+		    !eom_job_queue_remove_job (job))
+			eom_image_cancel_load (EOM_JOB_LOAD (job)->image);
+
+		g_signal_handlers_disconnect_by_func (job,
+						      slideshow_prefetch_cb,
+						      window);
+
+		g_object_unref (job);
+		priv->slideshow_next_job = NULL;
+	}
+
+	if (priv->slideshow_next_image != NULL) {
+		eom_image_data_unref (priv->slideshow_next_image);
+		g_object_unref (priv->slideshow_next_image);
+		priv->slideshow_next_image = NULL;
 	}
 
-	if (!priv->slideshow_loop && slideshow_is_loop_end (window)) {
+	priv->slideshow_switch_pending = FALSE;
+}
+
+/* Shows the image picked by slideshow_prefetch() and gets the one
+ * after it ready. Returns FALSE if the slideshow has come to its end. */
+static gboolean
+slideshow_switch (EomWindow *window)
+{
+	EomWindowPrivate *priv = window->priv;
+	EomImage *image = priv->slideshow_next_image;
+
+	if (!priv->slideshow_random && !priv->slideshow_loop &&
+	    slideshow_is_loop_end (window)) {
 		eom_window_stop_fullscreen (window, TRUE);
 		return FALSE;
 	}
 
-	eom_thumb_view_select_single (EOM_THUMB_VIEW (priv->thumbview),
-				      EOM_THUMB_VIEW_SELECT_RIGHT);
+	/* Only go for the prepared image if the selection didn't
+	 * change behind the slideshow's back in the meantime */
+	if (image != NULL) {
+		EomImage *expected;
+
+		if (priv->slideshow_random) {
+			expected = eom_thumb_view_get_first_selected_image (EOM_THUMB_VIEW (priv->thumbview));
+
+			if (expected == image ||
+			    eom_list_store_get_pos_by_image (priv->store, image) < 0)
+				image = NULL;
+		} else {
+			expected = slideshow_get_next_image (window);
+
+			if (expected != image)
+				image = NULL;
+		}
+
+		if (expected != NULL)
+			g_object_unref (expected);
+	}
+
+	if (image != NULL) {
+		/* Displayed right away, as it is loaded already */
+		eom_thumb_view_set_current_image (EOM_THUMB_VIEW (priv->thumbview),
+						  image, TRUE);
+	} else {
+		eom_thumb_view_select_single (EOM_THUMB_VIEW (priv->thumbview),
+					      priv->slideshow_random ?
+					      EOM_THUMB_VIEW_SELECT_RANDOM :
+					      EOM_THUMB_VIEW_SELECT_RIGHT);
+	}
+
+	/* The view holds on to the image data now */
+	slideshow_clear_prefetch (window, FALSE);
+	slideshow_prefetch (window);
 
 	return TRUE;
 }
 
+static void
+slideshow_prefetch_cb (EomJobLoad *job, gpointer data)
+{
+	EomWindow *window = EOM_WINDOW (data);
+	EomWindowPrivate *priv = window->priv;
+
+	g_signal_handlers_disconnect_by_func (job, slideshow_prefetch_cb, window);
+
+	g_object_unref (priv->slideshow_next_job);
+	priv->slideshow_next_job = NULL;
+
+	if (priv->slideshow_switch_pending) {
+		/* The deadline passed while loading, catch up now and
+		 * give the image its full time on screen */
+		priv->slideshow_switch_pending = FALSE;
+
+		if (slideshow_switch (window)) {
+			priv->slideshow_deadline = g_get_monotonic_time ();
+			slideshow_schedule_switch (window);
+		}
+		return;
+	}
+
+	if (eom_image_has_data (job->image, EOM_IMAGE_DATA_IMAGE))
+		eom_scroll_view_prepare_image (EOM_SCROLL_VIEW (priv->view),
+					       job->image);
+}
+
+/* Loads and rescales the next image ahead of its deadline, so
+ * that switching to it doesn't need to wait for the decoder */
+static void
+slideshow_prefetch (EomWindow *window)
+{
+	EomWindowPrivate *priv = window->priv;
+	EomImage *image;
+
+	slideshow_clear_prefetch (window, TRUE);
+
+	image = slideshow_get_next_image (window);
+
+	if (image == NULL)
+		return;
+
+	eom_image_data_ref (image);
+	priv->slideshow_next_image = image;
+
+	if (eom_image_has_data (image, EOM_IMAGE_DATA_IMAGE)) {
+		eom_scroll_view_prepare_image (EOM_SCROLL_VIEW (priv->view),
+					       image);
+		return;
+	}
+
+	priv->slideshow_next_job = eom_job_load_new (image, EOM_IMAGE_DATA_ALL);
+
+	g_signal_connect (priv->slideshow_next_job, "finished",
+			  G_CALLBACK (slideshow_prefetch_cb),
+			  window);
+
+	eom_job_queue_add_job (priv->slideshow_next_job);
+}
+
+static gboolean
+slideshow_switch_cb (gpointer data)
+{
+	EomWindow *window = EOM_WINDOW (data);
+	EomWindowPrivate *priv = window->priv;
+	gint64 now, lateness;
+
+	eom_debug (DEBUG_WINDOW);
+
+	g_source_unref (priv->slideshow_switch_source);
+	priv->slideshow_switch_source = NULL;
+
+	now = g_get_monotonic_time ();
+	lateness = now - priv->slideshow_deadline;
+
+	eom_stats_histogram_add ("slideshow.lateness-us", MAX (lateness, 0));
+
+	if (priv->slideshow_next_job != NULL) {
+		/* Still loading, switch as soon as it is done */
+		eom_stats_counter_add ("slideshow.missed-deadlines", 1);
+		priv->slideshow_switch_pending = TRUE;
+		return G_SOURCE_REMOVE;
+	}
+
+	if (!slideshow_switch (window))
+		return G_SOURCE_REMOVE;
+
+	/* The next deadline follows from this one rather than from
+	 * now, so that the time spent switching doesn't add up */
+	if (lateness > EOM_WINDOW_SLIDESHOW_LATENESS) {
+		eom_stats_counter_add ("slideshow.missed-deadlines", 1);
+		priv->slideshow_deadline = now;
+	}
+
+	slideshow_schedule_switch (window);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 fullscreen_clear_timeout (EomWindow *window)
 {
@@ -1824,13 +2076,33 @@ slideshow_clear_timeout (EomWindow *window)
 	}
 
 	window->priv->slideshow_switch_source = NULL;
+
+	slideshow_clear_prefetch (window, TRUE);
 }
 
+/* Arms the timer for the deadline following the current one */
 static void
-slideshow_set_timeout (EomWindow *window)
+slideshow_schedule_switch (EomWindow *window)
 {
+	EomWindowPrivate *priv = window->priv;
 	GSource *source;
+	gint64 delay;
+
+	priv->slideshow_deadline += (gint64) priv->slideshow_switch_timeout * G_USEC_PER_SEC;
 
+	delay = priv->slideshow_deadline - g_get_monotonic_time ();
+
+	source = g_timeout_source_new (MAX (delay, 0) / 1000);
+	g_source_set_callback (source, slideshow_switch_cb, window, NULL);
+
+	g_source_attach (source, NULL);
+
+	priv->slideshow_switch_source = source;
+}
+
+static void
+slideshow_set_timeout (EomWindow *window)
+{
 	eom_debug (DEBUG_WINDOW);
 
 	slideshow_clear_timeout (window);
@@ -1838,12 +2110,10 @@ slideshow_set_timeout (EomWindow *window)
 	if (window->priv->slideshow_switch_timeout <= 0)
 		return;
 
-	source = g_timeout_source_new (window->priv->slideshow_switch_timeout * 1000);
-	g_source_set_callback (source, slideshow_switch_cb, window, NULL);
-
-	g_source_attach (source, NULL);
+	window->priv->slideshow_deadline = g_get_monotonic_time ();
 
-	window->priv->slideshow_switch_source = source;
+	slideshow_schedule_switch (window);
+	slideshow_prefetch (window);
 }
 
 static void
@@ -2471,6 +2741,9 @@ eom_window_cmd_preferences (GtkAction *action, gpointer user_data)
 
 	window = EOM_WINDOW (user_data);
 
+	/* The plugin manager page needs the engine to exist */
+	eom_application_get_plugin_engine (EOM_APP);
+
 	pref_dlg = eom_preferences_dialog_get_instance (GTK_WINDOW (window));
 
 	gtk_widget_show (pref_dlg);
@@ -2836,6 +3109,35 @@ eom_window_set_wallpaper (EomWindow *window, const gchar *filename, const gchar
 	                  window);
 }
 
+/* Images saved under another name keep their file, since other
+ * windows may show them too, so put the new files in their place */
+static void
+eom_window_replace_saved_images (EomWindow *window, EomJobSaveAs *job)
+{
+	EomWindowPrivate *priv = window->priv;
+	GList *image_it, *saved_it;
+
+	for (image_it = EOM_JOB_SAVE (job)->images, saved_it = job->saved_images;
+	     image_it != NULL && saved_it != NULL;
+	     image_it = image_it->next, saved_it = saved_it->next) {
+		EomImage *image = EOM_IMAGE (image_it->data);
+		EomImage *saved = EOM_IMAGE (saved_it->data);
+
+		if (saved == image)
+			continue;
+
+		/* The folder monitor may have been first */
+		if (eom_list_store_get_pos_by_image (priv->store, saved) < 0)
+			eom_list_store_append_image (priv->store, saved);
+
+		if (image == priv->image)
+			eom_thumb_view_set_current_image (EOM_THUMB_VIEW (priv->thumbview),
+							  saved, TRUE);
+
+		eom_list_store_remove_image (priv->store, image);
+	}
+}
+
 static void
 eom_job_save_cb (EomJobSave *job, gpointer user_data)
 {
@@ -2850,6 +3152,9 @@ eom_job_save_cb (EomJobSave *job, gpointer user_data)
 	                                      eom_job_save_progress_cb,
 	                                      window);
 
+	if (EOM_IS_JOB_SAVE_AS (job) && window->priv->store != NULL)
+		eom_window_replace_saved_images (window, EOM_JOB_SAVE_AS (job));
+
 	g_object_unref (window->priv->save_job);
 	window->priv->save_job = NULL;
 
@@ -3074,6 +3379,72 @@ eom_window_cmd_save_as (GtkAction *action, gpointer user_data)
 	eom_job_queue_add_job (priv->save_job);
 }
 
+static void
+eom_job_crop_cb (EomJobCrop *job, gpointer user_data)
+{
+	EomWindow *window = EOM_WINDOW (user_data);
+
+	g_signal_handlers_disconnect_by_func (job,
+	                                      eom_job_crop_cb,
+	                                      window);
+
+	if (EOM_JOB (job)->error != NULL) {
+		GtkWidget *dlg;
+
+		dlg = gtk_message_dialog_new (GTK_WINDOW (window),
+					      GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+					      GTK_MESSAGE_ERROR,
+					      GTK_BUTTONS_OK,
+					      _("Error on saving the visible area of image %s"),
+					      eom_image_get_caption (job->image));
+
+		gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dlg),
+							  "%s", EOM_JOB (job)->error->message);
+
+		gtk_dialog_run (GTK_DIALOG (dlg));
+
+		gtk_widget_destroy (dlg);
+	}
+
+	g_object_unref (window->priv->crop_job);
+	window->priv->crop_job = NULL;
+}
+
+static void
+eom_window_cmd_export_area (GtkAction *action, gpointer user_data)
+{
+	EomWindowPrivate *priv;
+	EomWindow *window;
+	GdkRectangle area;
+	GFile *file;
+
+	g_return_if_fail (EOM_IS_WINDOW (user_data));
+
+	window = EOM_WINDOW (user_data);
+	priv = window->priv;
+
+	if (priv->crop_job != NULL || priv->image == NULL)
+		return;
+
+	/* The area to keep is selected by zooming into it */
+	if (!eom_scroll_view_get_visible_area (EOM_SCROLL_VIEW (priv->view), &area))
+		return;
+
+	file = eom_window_retrieve_save_as_file (window, priv->image);
+
+	if (file == NULL)
+		return;
+
+	priv->crop_job = eom_job_crop_new (priv->image, &area, file);
+	g_object_unref (file);
+
+	g_signal_connect (priv->crop_job, "finished",
+			  G_CALLBACK (eom_job_crop_cb),
+			  window);
+
+	eom_job_queue_add_job (priv->crop_job);
+}
+
 static void
 eom_window_cmd_open_containing_folder (GtkAction *action, gpointer user_data)
 {
@@ -3272,28 +3643,49 @@ eom_window_cmd_wallpaper (GtkAction *action, gpointer user_data)
 static gboolean
 eom_window_all_images_trasheable (GList *images)
 {
-	GFile *file;
+	GFile *file, *parent;
 	GFileInfo *file_info;
+	GHashTable *folders;
 	GList *iter;
 	EomImage *image;
 	gboolean can_trash = TRUE;
 
+	/* Whether a file can be trashed depends on the folder it is in,
+	 * so only ask once per folder instead of for every image */
+	folders = g_hash_table_new_full (g_file_hash,
+					 (GEqualFunc) g_file_equal,
+					 g_object_unref, NULL);
+
 	for (iter = images; iter != NULL; iter = g_list_next (iter)) {
 		image = (EomImage *) iter->data;
 		file = eom_image_get_file (image);
-		file_info = g_file_query_info (file,
-					       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
-					       0, NULL, NULL);
-		can_trash = g_file_info_get_attribute_boolean (file_info,
-							       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH);
+		parent = g_file_get_parent (file);
 
-		g_object_unref (file_info);
+		if (parent == NULL || !g_hash_table_contains (folders, parent)) {
+			file_info = g_file_query_info (file,
+						       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
+						       0, NULL, NULL);
+			can_trash = (file_info != NULL &&
+				     g_file_info_get_attribute_boolean (file_info,
+									G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH));
+
+			if (file_info != NULL)
+				g_object_unref (file_info);
+
+			if (parent != NULL)
+				g_hash_table_add (folders, g_object_ref (parent));
+		}
+
+		if (parent != NULL)
+			g_object_unref (parent);
 		g_object_unref (file);
 
 		if (can_trash == FALSE)
 			break;
 	}
 
+	g_hash_table_destroy (folders);
+
 	return can_trash;
 }
 
@@ -3383,54 +3775,6 @@ show_move_to_trash_confirm_dialog (EomWindow *window, GList *images, gboolean ca
 	return response;
 }
 
-static gboolean
-move_to_trash_real (EomImage *image, GError **error)
-{
-	GFile *file;
-	GFileInfo *file_info;
-	gboolean can_trash, result;
-
-	g_return_val_if_fail (EOM_IS_IMAGE (image), FALSE);
-
-	file = eom_image_get_file (image);
-	file_info = g_file_query_info (file,
-				       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
-				       0, NULL, NULL);
-	if (file_info == NULL) {
-		g_set_error (error,
-			     EOM_WINDOW_ERROR,
-			     EOM_WINDOW_ERROR_TRASH_NOT_FOUND,
-			     _("Couldn't access trash."));
-		return FALSE;
-	}
-
-	can_trash = g_file_info_get_attribute_boolean (file_info,
-						       G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH);
-	g_object_unref (file_info);
-	if (can_trash)
-	{
-		result = g_file_trash (file, NULL, NULL);
-		if (result == FALSE) {
-			g_set_error (error,
-				     EOM_WINDOW_ERROR,
-				     EOM_WINDOW_ERROR_TRASH_NOT_FOUND,
-				     _("Couldn't access trash."));
-		}
-	} else {
-		result = g_file_delete (file, NULL, NULL);
-		if (result == FALSE) {
-			g_set_error (error,
-				     EOM_WINDOW_ERROR,
-				     EOM_WINDOW_ERROR_IO,
-				     _("Couldn't delete file"));
-		}
-	}
-
-        g_object_unref (file);
-
-	return result;
-}
-
 static void
 eom_window_cmd_copy_image (GtkAction *action, gpointer user_data)
 {
@@ -3457,19 +3801,220 @@ eom_window_cmd_copy_image (GtkAction *action, gpointer user_data)
 
 }
 
+static void eom_window_queue_trash_job (EomWindow *window, EomJob *job);
+
+static void
+trash_undo_info_bar_response (GtkInfoBar *info_bar,
+			      gint response,
+			      EomWindow *window)
+{
+	EomJob *job;
+
+	if (response == GTK_RESPONSE_YES && window->priv->trash_undo != NULL) {
+		job = eom_job_trash_new_restore (window->priv->trash_undo);
+		window->priv->trash_undo = NULL;
+
+		eom_window_queue_trash_job (window, job);
+		g_object_unref (job);
+	}
+
+	eom_window_set_message_area (window, NULL);
+}
+
+static void
+eom_window_show_trash_undo (EomWindow *window, guint n_images)
+{
+	GtkWidget *info_bar;
+	GtkWidget *image;
+	GtkWidget *label;
+	GtkWidget *hbox;
+	gchar *markup;
+	gchar *text;
+
+	info_bar = gtk_info_bar_new_with_buttons (_("_Undo"),
+						  GTK_RESPONSE_YES,
+						  C_("MessageArea", "Hi_de"),
+						  GTK_RESPONSE_NO, NULL);
+	gtk_info_bar_set_message_type (GTK_INFO_BAR (info_bar),
+				       GTK_MESSAGE_INFO);
+
+	image = gtk_image_new_from_icon_name ("user-trash",
+					      GTK_ICON_SIZE_DIALOG);
+	label = gtk_label_new (NULL);
+
+	text = g_strdup_printf (ngettext ("%d image has been moved to the trash.",
+					  "%d images have been moved to the trash.",
+					  n_images), n_images);
+	markup = g_markup_printf_escaped ("<b>%s</b>", text);
+	gtk_label_set_markup (GTK_LABEL (label), markup);
+	g_free (markup);
+	g_free (text);
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 8);
+	gtk_box_pack_start (GTK_BOX (hbox), image, FALSE, FALSE, 0);
+	gtk_widget_set_halign (image, GTK_ALIGN_START);
+	gtk_widget_set_valign (image, GTK_ALIGN_END);
+	gtk_box_pack_start (GTK_BOX (hbox), label, TRUE, TRUE, 0);
+	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+	gtk_box_pack_start (GTK_BOX (gtk_info_bar_get_content_area (GTK_INFO_BAR (info_bar))), hbox, TRUE, TRUE, 0);
+	gtk_widget_show_all (hbox);
+	gtk_widget_show (info_bar);
+
+	eom_window_set_message_area (window, info_bar);
+	g_signal_connect (info_bar, "response",
+	                  G_CALLBACK (trash_undo_info_bar_response),
+	                  window);
+}
+
+/* Takes the images @job is done with out of the store, or puts
+ * them back when restoring, a batch at a time */
+static void
+eom_window_apply_trash_job (EomWindow *window, EomJobTrash *job)
+{
+	EomWindowPrivate *priv = window->priv;
+	GList *images, *it;
+	EomImage *image;
+	gint n_images;
+
+	images = eom_job_trash_take_processed (job);
+
+	if (images == NULL)
+		return;
+
+	for (it = images; it != NULL; it = it->next) {
+		image = EOM_IMAGE (it->data);
+
+		if (!job->restore)
+			eom_list_store_remove_image (priv->store, image);
+		else if (eom_list_store_get_pos_by_image (priv->store, image) < 0)
+			eom_list_store_append_image (priv->store, image);
+	}
+
+	g_list_free_full (images, g_object_unref);
+
+	/* Select the image which took the place of the removed ones */
+	n_images = eom_list_store_length (priv->store);
+
+	if (!job->restore && n_images > 0 &&
+	    eom_thumb_view_get_n_selected (EOM_THUMB_VIEW (priv->thumbview)) == 0) {
+		image = eom_list_store_get_image_by_pos (priv->store,
+							 CLAMP (priv->trash_pos, 0, n_images - 1));
+
+		eom_thumb_view_set_current_image (EOM_THUMB_VIEW (priv->thumbview),
+						  image,
+						  TRUE);
+
+		if (image != NULL) {
+			g_object_unref (image);
+		}
+	}
+}
+
+static void
+eom_job_trash_progress_cb (EomJobTrash *job, float progress, gpointer data)
+{
+	EomWindow *window = EOM_WINDOW (data);
+
+	eom_window_apply_trash_job (window, job);
+
+	eom_statusbar_set_progress (EOM_STATUSBAR (window->priv->statusbar),
+				    progress);
+}
+
+static void
+eom_job_trash_cb (EomJobTrash *job, gpointer data)
+{
+	EomWindow *window = EOM_WINDOW (data);
+	EomWindowPrivate *priv = window->priv;
+	guint n_failed;
+
+	eom_window_apply_trash_job (window, job);
+
+	eom_statusbar_set_progress (EOM_STATUSBAR (priv->statusbar), 0);
+
+	n_failed = g_list_length (job->failed);
+
+	if (n_failed > 0) {
+		char *header;
+		GtkWidget *dlg;
+
+		if (n_failed == 1 && !job->restore) {
+			header = g_strdup_printf (_("Error on deleting image %s"),
+						  eom_image_get_caption (EOM_IMAGE (job->failed->data)));
+		} else if (n_failed == 1) {
+			header = g_strdup_printf (_("Error on restoring image %s"),
+						  eom_image_get_caption (EOM_IMAGE (job->failed->data)));
+		} else if (!job->restore) {
+			header = g_strdup_printf (ngettext ("Error on deleting %d image",
+							   "Error on deleting %d images",
+							   n_failed), n_failed);
+		} else {
+			header = g_strdup_printf (ngettext ("Error on restoring %d image",
+							   "Error on restoring %d images",
+							   n_failed), n_failed);
+		}
+
+		dlg = gtk_message_dialog_new (GTK_WINDOW (window),
+					      GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+					      GTK_MESSAGE_ERROR,
+					      GTK_BUTTONS_OK,
+					      "%s", header);
+
+		if (EOM_JOB (job)->error != NULL)
+			gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dlg),
+								  "%s", EOM_JOB (job)->error->message);
+
+		gtk_dialog_run (GTK_DIALOG (dlg));
+
+		gtk_widget_destroy (dlg);
+
+		g_free (header);
+	}
+
+	/* Only the latest batch can be undone */
+	if (!job->restore && job->trashed != NULL) {
+		g_list_free_full (priv->trash_undo, g_object_unref);
+		priv->trash_undo = job->trashed;
+		job->trashed = NULL;
+
+		eom_window_show_trash_undo (window,
+					    g_list_length (priv->trash_undo));
+	}
+
+	g_signal_handlers_disconnect_by_data (job, window);
+
+	priv->trash_jobs = g_list_remove (priv->trash_jobs, job);
+	g_object_unref (job);
+}
+
+static void
+eom_window_queue_trash_job (EomWindow *window, EomJob *job)
+{
+	EomWindowPrivate *priv = window->priv;
+
+	priv->trash_jobs = g_list_prepend (priv->trash_jobs,
+					   g_object_ref (job));
+
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (eom_job_trash_cb),
+			  window);
+
+	g_signal_connect (job, "progress",
+			  G_CALLBACK (eom_job_trash_progress_cb),
+			  window);
+
+	eom_job_queue_add_job (job);
+}
+
 static void
 eom_window_cmd_move_to_trash (GtkAction *action, gpointer user_data)
 {
 	GList *images;
-	GList *it;
 	EomWindowPrivate *priv;
-	EomListStore *list;
-	int pos;
-	EomImage *img;
 	EomWindow *window;
+	EomJob *job;
 	int response;
 	int n_images;
-	gboolean success;
 	gboolean can_trash;
 	const gchar *action_name;
 
@@ -3477,7 +4022,6 @@ eom_window_cmd_move_to_trash (GtkAction *action, gpointer user_data)
 
 	window = EOM_WINDOW (user_data);
 	priv = window->priv;
-	list = priv->store;
 
 	n_images = eom_thumb_view_get_n_selected (EOM_THUMB_VIEW (priv->thumbview));
 
@@ -3501,66 +4045,20 @@ eom_window_cmd_move_to_trash (GtkAction *action, gpointer user_data)
 	    can_trash == FALSE) {
 		response = show_move_to_trash_confirm_dialog (window, images, can_trash);
 
-		if (response != GTK_RESPONSE_OK) return;
-	}
-
-	pos = eom_list_store_get_pos_by_image (list, EOM_IMAGE (images->data));
-
-	/* FIXME: make a nice progress dialog */
-	/* Do the work actually. First try to delete the image from the disk. If this
-	 * is successful, remove it from the screen. Otherwise show error dialog.
-	 */
-	for (it = images; it != NULL; it = it->next) {
-		GError *error = NULL;
-		EomImage *image;
-
-		image = EOM_IMAGE (it->data);
-
-		success = move_to_trash_real (image, &error);
-
-		if (success) {
-			eom_list_store_remove_image (list, image);
-		} else {
-			char *header;
-			GtkWidget *dlg;
-
-			header = g_strdup_printf (_("Error on deleting image %s"),
-						  eom_image_get_caption (image));
-
-			dlg = gtk_message_dialog_new (GTK_WINDOW (window),
-						      GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-						      GTK_MESSAGE_ERROR,
-						      GTK_BUTTONS_OK,
-						      "%s", header);
-
-			gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dlg),
-								  "%s", error->message);
-
-			gtk_dialog_run (GTK_DIALOG (dlg));
-
-			gtk_widget_destroy (dlg);
-
-			g_free (header);
+		if (response != GTK_RESPONSE_OK) {
+			g_list_free_full (images, g_object_unref);
+			return;
 		}
 	}
 
-	/* free list */
-	g_list_free_full (images, g_object_unref);
-
-	/* select image at previously saved position */
-	pos = MIN (pos, eom_list_store_length (list) - 1);
-
-	if (pos >= 0) {
-		img = eom_list_store_get_image_by_pos (list, pos);
+	priv->trash_pos = eom_list_store_get_pos_by_image (priv->store,
+							   EOM_IMAGE (images->data));
 
-		eom_thumb_view_set_current_image (EOM_THUMB_VIEW (priv->thumbview),
-						  img,
-						  TRUE);
-
-		if (img != NULL) {
-			g_object_unref (img);
-		}
-	}
+	/* Files are removed in the background, the images are taken
+	 * out of the view as they go. Errors are shown at the end. */
+	job = eom_job_trash_new (images);
+	eom_window_queue_trash_job (window, job);
+	g_object_unref (job);
 }
 
 static void
@@ -3821,6 +4319,9 @@ static const GtkActionEntry action_entries_image[] = {
 	{ "ImageSaveAs", "document-save-as", N_("Save _As…"), "<control><shift>s",
 	  N_("Save the selected images with a different name"),
 	  G_CALLBACK (eom_window_cmd_save_as) },
+	{ "ImageExportArea", NULL, N_("_Export Visible Area…"), NULL,
+	  N_("Save the part of the image shown in the window to a new file"),
+	  G_CALLBACK (eom_window_cmd_export_area) },
 	{ "ImageOpenContainingFolder", "folder", N_("Open Containing _Folder"), NULL,
 	  N_("Show the folder which contains this file in the file manager"),
 	  G_CALLBACK (eom_window_cmd_open_containing_folder) },
@@ -4565,8 +5066,6 @@ eom_window_construct_ui (EomWindow *window)
 	                  G_CALLBACK (eom_window_recent_manager_changed_cb),
 	                  window);
 
-	eom_window_update_recent_files_menu (window);
-
 	gtk_ui_manager_insert_action_group (priv->ui_mgr, priv->actions_recent, 0);
 
 	priv->cbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
@@ -4619,6 +5118,13 @@ eom_window_construct_ui (EomWindow *window)
 			      _("Properties"),
 			      GTK_WIDGET (eom_metadata_sidebar_new (window)));
 
+	/* Hidden page for inspecting runtime statistics */
+	if (eom_debug_is_enabled (EOM_DEBUG_STATS)) {
+		eom_sidebar_add_page (EOM_SIDEBAR (priv->sidebar),
+				      "Statistics",
+				      eom_stats_page_new ());
+	}
+
 	gtk_widget_set_size_request (GTK_WIDGET (priv->view), 100, 100);
 	g_signal_connect (priv->view, "zoom_changed",
 	                  G_CALLBACK (view_zoom_changed_cb),
@@ -4649,10 +5155,6 @@ eom_window_construct_ui (EomWindow *window)
 
 	priv->thumbview = g_object_ref (eom_thumb_view_new ());
 
-	/* giving shape to the view */
-	gtk_icon_view_set_margin (GTK_ICON_VIEW (priv->thumbview), 4);
-	gtk_icon_view_set_row_spacing (GTK_ICON_VIEW (priv->thumbview), 0);
-
 	g_signal_connect (priv->thumbview, "selection_changed",
 	                  G_CALLBACK (handle_image_selection_changed_cb),
 	                  window);
@@ -4734,6 +5236,8 @@ eom_window_init (EomWindow *window)
 	window->priv->slideshow_loop = FALSE;
 	window->priv->slideshow_switch_timeout = 0;
 	window->priv->slideshow_switch_source = NULL;
+	window->priv->slideshow_next_image = NULL;
+	window->priv->slideshow_next_job = NULL;
 	window->priv->fullscreen_idle_inhibit_cookie = 0;
 
 	gtk_window_set_geometry_hints (GTK_WINDOW (window),
@@ -4782,7 +5286,18 @@ eom_window_dispose (GObject *object)
 	window = EOM_WINDOW (object);
 	priv = window->priv;
 
-	peas_engine_garbage_collect (PEAS_ENGINE (EOM_APP->priv->plugin_engine));
+	if (priv->deferred_source != 0) {
+		g_source_remove (priv->deferred_source);
+		priv->deferred_source = 0;
+	}
+
+	if (priv->open_with_source != 0) {
+		g_source_remove (priv->open_with_source);
+		priv->open_with_source = 0;
+	}
+
+	if (EOM_APP->priv->plugin_engine != NULL)
+		peas_engine_garbage_collect (PEAS_ENGINE (EOM_APP->priv->plugin_engine));
 
 	if (priv->extensions != NULL) {
 		g_object_unref (priv->extensions);
@@ -4795,6 +5310,26 @@ eom_window_dispose (GObject *object)
 		priv->page_setup = NULL;
 	}
 
+	if (priv->crop_job != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->crop_job, window);
+		g_object_unref (priv->crop_job);
+		priv->crop_job = NULL;
+	}
+
+	if (priv->trash_jobs != NULL) {
+		GList *it;
+
+		/* The files are still removed, just nobody is told */
+		for (it = priv->trash_jobs; it != NULL; it = it->next)
+			g_signal_handlers_disconnect_by_data (it->data, window);
+
+		g_list_free_full (priv->trash_jobs, g_object_unref);
+		priv->trash_jobs = NULL;
+	}
+
+	g_list_free_full (priv->trash_undo, g_object_unref);
+	priv->trash_undo = NULL;
+
 	if (priv->thumbview)
 	{
 		/* Disconnect so we don't get any unwanted callbacks
@@ -4906,7 +5441,8 @@ eom_window_dispose (GObject *object)
 		priv->last_save_as_folder = NULL;
 	}
 
-	peas_engine_garbage_collect (PEAS_ENGINE (EOM_APP->priv->plugin_engine));
+	if (EOM_APP->priv->plugin_engine != NULL)
+		peas_engine_garbage_collect (PEAS_ENGINE (EOM_APP->priv->plugin_engine));
 
 	G_OBJECT_CLASS (eom_window_parent_class)->dispose (object);
 }
@@ -5234,6 +5770,37 @@ on_extension_removed (PeasExtensionSet *set,
 	peas_extension_call (exten, "deactivate", window);
 }
 
+/* Work that is not needed to show the first image is done once the
+ * window is idle: the recent files menu and the window extensions. */
+static gboolean
+eom_window_load_deferred (EomWindow *window)
+{
+	EomWindowPrivate *priv = window->priv;
+	EomPluginEngine *engine;
+
+	priv->deferred_source = 0;
+
+	eom_window_update_recent_files_menu (window);
+
+	engine = eom_application_get_plugin_engine (EOM_APP);
+
+	priv->extensions = peas_extension_set_new (PEAS_ENGINE (engine),
+	                                           EOM_TYPE_WINDOW_ACTIVATABLE,
+	                                           "window",
+	                                           window, NULL);
+
+	peas_extension_set_call (priv->extensions, "activate");
+
+	g_signal_connect (priv->extensions, "extension-added",
+	                  G_CALLBACK (on_extension_added),
+	                  window);
+	g_signal_connect (priv->extensions, "extension-removed",
+	                  G_CALLBACK (on_extension_removed),
+	                  window);
+
+	return G_SOURCE_REMOVE;
+}
+
 static GObject *
 eom_window_constructor (GType type,
 			guint n_construct_properties,
@@ -5249,19 +5816,11 @@ eom_window_constructor (GType type,
 
 	eom_window_construct_ui (EOM_WINDOW (object));
 
-	priv->extensions = peas_extension_set_new (PEAS_ENGINE (EOM_APP->priv->plugin_engine),
-	                                           EOM_TYPE_WINDOW_ACTIVATABLE,
-	                                           "window",
-	                                           EOM_WINDOW (object), NULL);
+	priv->deferred_source = g_idle_add_full (G_PRIORITY_LOW,
+						 (GSourceFunc) eom_window_load_deferred,
+						 object, NULL);
 
-	peas_extension_set_call (priv->extensions, "activate");
-
-	g_signal_connect (priv->extensions, "extension-added",
-	                  G_CALLBACK (on_extension_added),
-	                  object);
-	g_signal_connect (priv->extensions, "extension-removed",
-	                  G_CALLBACK (on_extension_removed),
-	                  object);
+	eom_debug_startup_mark ("window constructed");
 
 	return object;
 }
@@ -5401,11 +5960,6 @@ eom_job_model_cb (EomJobModel *job, gpointer data)
 
 	eom_debug (DEBUG_WINDOW);
 
-#ifdef HAVE_EXIF
-	int i;
-	EomImage *image;
-#endif
-
 	g_return_if_fail (EOM_IS_WINDOW (data));
 
 	window = EOM_WINDOW (data);
@@ -5420,17 +5974,30 @@ eom_job_model_cb (EomJobModel *job, gpointer data)
 
 	n_images = eom_list_store_length (EOM_LIST_STORE (priv->store));
 
-#ifdef HAVE_EXIF
-	if (g_settings_get_boolean (priv->view_settings, EOM_CONF_VIEW_AUTOROTATE)) {
-		for (i = 0; i < n_images; i++) {
-			image = eom_list_store_get_image_by_pos (priv->store, i);
-			eom_image_autorotate (image);
-			g_object_unref (image);
-		}
-	}
-#endif
+	/* The initial image might have been dropped by the filtering */
+	if (n_images == 0)
+		eom_window_clear_load_job (window);
+
+	if (job->initial_image != NULL && n_images > 0) {
+		/* Selecting the initial image again must not restart
+		 * its load, which has been going on since the window
+		 * opened the file */
+		g_signal_handlers_block_by_func (priv->thumbview,
+						 handle_image_selection_changed_cb,
+						 window);
+		eom_thumb_view_set_model (EOM_THUMB_VIEW (priv->thumbview), priv->store);
+		g_signal_handlers_unblock_by_func (priv->thumbview,
+						   handle_image_selection_changed_cb,
+						   window);
+
+		update_selection_ui_visibility (window);
+		update_action_groups_state (window);
 
-	eom_thumb_view_set_model (EOM_THUMB_VIEW (priv->thumbview), priv->store);
+		if (priv->image != NULL)
+			update_status_bar (window);
+	} else {
+		eom_thumb_view_set_model (EOM_THUMB_VIEW (priv->thumbview), priv->store);
+	}
 
 	g_signal_connect (priv->store, "row-inserted",
 	                  G_CALLBACK (eom_window_list_store_image_added),
@@ -5467,6 +6034,61 @@ eom_job_model_cb (EomJobModel *job, gpointer data)
 	}
 }
 
+static gboolean
+eom_window_get_autorotate (EomWindow *window)
+{
+#ifdef HAVE_EXIF
+	return g_settings_get_boolean (window->priv->view_settings,
+				       EOM_CONF_VIEW_AUTOROTATE);
+#else
+	return FALSE;
+#endif
+}
+
+/* When a single image is opened, start loading it right away from a
+ * store holding just that image, instead of waiting for the model job
+ * to read the whole folder. The model job then reuses the image, so
+ * swapping in its store does not interrupt the load. */
+static EomImage *
+eom_window_load_initial_image (EomWindow *window, GFile *file)
+{
+	EomWindowPrivate *priv = window->priv;
+	GFileInfo *file_info;
+	EomListStore *store;
+	EomImage *image;
+
+	file_info = g_file_query_info (file,
+				       G_FILE_ATTRIBUTE_STANDARD_TYPE","
+				       G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+				       0, NULL, NULL);
+
+	if (file_info == NULL)
+		return NULL;
+
+	if (g_file_info_get_file_type (file_info) != G_FILE_TYPE_REGULAR) {
+		g_object_unref (file_info);
+		return NULL;
+	}
+
+	image = eom_image_new_file (file, g_file_info_get_display_name (file_info));
+	g_object_unref (file_info);
+
+	if (eom_window_get_autorotate (window))
+		eom_image_autorotate (image);
+
+	store = EOM_LIST_STORE (eom_list_store_new ());
+	eom_list_store_set_initial_image (store, image);
+
+	if (priv->store != NULL)
+		g_object_unref (priv->store);
+
+	priv->store = store;
+
+	eom_thumb_view_set_model (EOM_THUMB_VIEW (priv->thumbview), store);
+
+	return image;
+}
+
 /**
  * eom_window_open_file_list:
  * @window: An #EomWindow.
@@ -5490,6 +6112,14 @@ eom_window_open_file_list (EomWindow *window, GSList *file_list)
 
 	job = eom_job_model_new (file_list, !!(window->priv->flags & EOM_STARTUP_PRESERVE_ORDER));
 
+	/* The model job flags the images while creating them, and
+	 * their orientation is read along with the header */
+	EOM_JOB_MODEL (job)->autorotate = eom_window_get_autorotate (window);
+
+	if (file_list != NULL && file_list->next == NULL)
+		EOM_JOB_MODEL (job)->initial_image =
+			eom_window_load_initial_image (window, file_list->data);
+
 	g_signal_connect (job, "finished",
 	                  G_CALLBACK (eom_job_model_cb),
 	                  window);
@@ -37,6 +37,7 @@
 #include "eom-session.h"
 #include "eom-debug.h"
 #include "eom-thumbnail.h"
+#include "eom-pixel-cache.h"
 #include "eom-job-queue.h"
 #include "eom-application.h"
 #include "eom-application-internal.h"
@@ -103,8 +104,8 @@ main (int argc, char **argv)
 {
 	GError *error = NULL;
 	GOptionContext *ctx;
-	GFile *css_file;
-	GtkCssProvider *provider;
+
+	eom_debug_startup_mark ("main");
 
 #ifdef ENABLE_NLS
 	bindtextdomain (GETTEXT_PACKAGE, EOM_LOCALE_DIR);
@@ -149,30 +150,10 @@ main (int argc, char **argv)
  	xmp_init();
 #endif
 	eom_debug_init ();
+	eom_debug_startup_mark ("options parsed");
 	eom_job_queue_init ();
 	eom_thumbnail_init ();
-
-	/* Load special style properties for EomThumbView's scrollbar */
-	css_file = g_file_new_for_uri ("resource:///org/mate/eom/ui/eom.css");
-	provider = gtk_css_provider_new ();
-	if (G_UNLIKELY (!gtk_css_provider_load_from_file(provider,
-	                                                 css_file,
-	                                                 &error)))
-	{
-		g_critical ("Could not load CSS data: %s", error->message);
-		g_clear_error (&error);
-	} else {
-		gtk_style_context_add_provider_for_screen (
-				gdk_screen_get_default(),
-				GTK_STYLE_PROVIDER (provider),
-				GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-	}
-	g_object_unref (provider);
-	g_object_unref (css_file);
-
-	/* Add application specific icons to search path */
-	gtk_icon_theme_append_search_path (gtk_icon_theme_get_default (),
-                                           EOM_DATA_DIR G_DIR_SEPARATOR_S "icons");
+	eom_pixel_cache_init ();
 
 	gtk_window_set_default_icon_name ("eom");
 	g_set_application_name (_("Eye of MATE Image Viewer"));